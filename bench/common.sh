@@ -0,0 +1,44 @@
+#
+#   common.sh
+#
+#   Corpus handling shared by run.sh and golden.sh. Source it after setting
+#   BENCH_DIR.
+#
+#   This file is in the public domain.
+#
+
+WORK_DIR=${OTX_BENCH_WORK:-${TMPDIR:-/tmp}/otx-bench}
+CORPUS=$BENCH_DIR/corpus.txt
+MACHOGEN=$WORK_DIR/machogen
+
+# build_machogen, when its source changes. Old images go with the old one.
+build_machogen()
+{
+    mkdir -p "$WORK_DIR" || return 1
+
+    if [ ! -x "$MACHOGEN" ] || [ "$BENCH_DIR/machogen.c" -nt "$MACHOGEN" ]
+    then
+        ${CC:-cc} -O2 -o "$MACHOGEN" "$BENCH_DIR/machogen.c" || return 1
+        rm -f "$WORK_DIR"/*.macho
+    fi
+}
+
+# corpus_entries <sizes>, the corpus lines in those size classes
+corpus_entries()
+{
+    grep -v '^#' "$CORPUS" | grep -v '^[[:space:]]*$' |
+        awk -v sizes=",$1," 'index(sizes, "," $3 ",")'
+}
+
+# make_image <image> <machogen arguments...>, prints the image's path
+make_image()
+{
+    IMAGE_PATH=$WORK_DIR/$1.macho
+    shift
+
+    if [ ! -f "$IMAGE_PATH" ]; then
+        "$MACHOGEN" "$@" -o "$IMAGE_PATH" || return 1
+    fi
+
+    echo "$IMAGE_PATH"
+}
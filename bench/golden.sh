@@ -0,0 +1,214 @@
+#!/bin/sh
+#
+#   golden.sh
+#
+#   Checks that otx output stays byte for byte the same. Runs otx over the
+#   corpus in corpus.txt in the reference mode, -serial, and in every
+#   alternate mode, compares the reference output with the golden file
+#   stored in golden/, and each alternate mode's output with the reference
+#   output. Outputs that differ are split into functions and the differing
+#   ones are diffed one by one into a report.
+#
+#   Usage: golden.sh [-otx <path>] [-size <small,medium,large>]
+#                    [-mode <name>:<flag>[,<flag>...]]... [-record]
+#
+#       -otx        the otx to test, default 'otx' in $PATH
+#       -size       size classes to check, default small
+#       -mode       an alternate mode, may be repeated. The defaults are
+#                   the concurrent paths, the result cache, the function
+#                   cache and spilling lines, see MODES.
+#       -record     write the reference outputs to golden/
+#
+#   Alternate modes run twice, cold then warm, and both outputs must match
+#   the reference. Each mode gets caches of its own through OTX_CACHE_DIR,
+#   emptied before the cold run, so nothing carries over from other runs
+#   or from ~/Library/Caches/otx. An entry without a golden file fails
+#   until it's recorded. Reports go in $OTX_BENCH_WORK/golden, default
+#   $TMPDIR/otx-bench/golden. Exits 1 if anything differs.
+#
+#   This file is in the public domain.
+#
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+. "$BENCH_DIR/common.sh"
+
+GOLDEN_DIR=$BENCH_DIR/golden
+OUT_DIR=$WORK_DIR/golden
+
+# The reference does everything on one thread, one otool at a time.
+REFERENCE_FLAGS=-serial
+
+# Alternate ways of producing the same output. Add new parallel or
+# streaming modes here as they appear. A 1K budget spills every line.
+MODES="concurrent: cache:-cache incremental:-incremental spill:-max-memory,1K"
+
+OTX=otx
+SIZES=small
+RECORD=0
+USER_MODES=""
+
+usage()
+{
+    sed -n '/^#   Usage/,/^#   Alternate/p' "$0" | sed '$d' | cut -c2- >&2
+    exit 1
+}
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        -otx)       OTX=$2; shift ;;
+        -size)      SIZES=$2; shift ;;
+        -mode)      USER_MODES="$USER_MODES $2"; shift ;;
+        -record)    RECORD=1 ;;
+        *)          usage ;;
+    esac
+    shift
+done
+
+[ -n "$USER_MODES" ] && MODES=$USER_MODES
+
+build_machogen || exit 1
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR" || exit 1
+[ $RECORD -eq 1 ] && { mkdir -p "$GOLDEN_DIR" || exit 1; }
+
+# run_otx <image path> <arch> <output> <cache dir> <flags...>
+# The work dir is stripped from the output, so golden files don't depend
+# on where the corpus was generated.
+run_otx()
+{
+    IMAGE_PATH=$1
+    ARCH=$2
+    OUTPUT=$3
+    CACHE_DIR=$4
+    shift 4
+
+    OTX_CACHE_DIR=$CACHE_DIR "$OTX" "$@" -arch "$ARCH" "$IMAGE_PATH" \
+        2> "$OUTPUT.log" | sed "s|$WORK_DIR/||g" > "$OUTPUT"
+
+    # The pipeline's status is sed's, so check for otx's complaints.
+    if grep -q '^otx: ' "$OUTPUT.log" || [ ! -s "$OUTPUT" ]; then
+        echo "otx failed, see $OUTPUT.log" >&2
+        return 1
+    fi
+}
+
+# split_functions <output> <dir>
+# One file per function, named after it. Function names are lines that
+# start in column 1 and end with a colon. Everything before the first one
+# goes in _header.
+split_functions()
+{
+    rm -rf "$2"
+    mkdir -p "$2"
+    awk -v dir="$2" '
+        BEGIN { file = dir "/_header" }
+        /^[^ \t(].*:$/ {
+            name = substr($0, 1, length($0) - 1)
+            key = substr(name, 1, 200)
+            gsub(/[^A-Za-z0-9_.+-]/, "_", key)
+
+            if (++seen[key] > 1)
+                key = key "." seen[key]
+
+            close(file)
+            file = dir "/" key
+            print key "\t" name >> (dir "/_names")
+        }
+        { print > file }' "$1"
+}
+
+# diff_functions <expected> <actual> <report>
+# Prints how many functions differ, with their diffs in the report.
+diff_functions()
+{
+    split_functions "$1" "$3.expected"
+    split_functions "$2" "$3.actual"
+
+    COUNT=0
+
+    for FILE in $( (ls "$3.expected"; ls "$3.actual") | sort -u); do
+        [ "$FILE" = "_names" ] && continue
+
+        if ! cmp -s "$3.expected/$FILE" "$3.actual/$FILE"; then
+            NAME=$(awk -F'\t' -v key="$FILE" \
+                '$1 == key { print $2; exit }' \
+                "$3.expected/_names" "$3.actual/_names" 2>/dev/null)
+            echo "=== ${NAME:-$FILE}" >> "$3"
+            diff -u "$3.expected/$FILE" "$3.actual/$FILE" >> "$3" 2>&1
+            COUNT=$((COUNT + 1))
+        fi
+    done
+
+    rm -rf "$3.expected" "$3.actual"
+    echo $COUNT
+}
+
+# fresh_cache_dir <name>
+# An empty cache dir for one mode of one entry.
+fresh_cache_dir()
+{
+    rm -rf "$OUT_DIR/caches/$1"
+    mkdir -p "$OUT_DIR/caches/$1" || exit 1
+    echo "$OUT_DIR/caches/$1"
+}
+
+# check <expected> <actual> <label>
+check()
+{
+    if cmp -s "$1" "$2"; then
+        printf "%-40s ok\n" "$3"
+        return
+    fi
+
+    REPORT=$OUT_DIR/$(echo "$3" | tr '/ ' '--').diff
+    COUNT=$(diff_functions "$1" "$2" "$REPORT")
+
+    printf "%-40s %s functions differ, see %s\n" "$3" "$COUNT" "$REPORT"
+    echo "$3" >> "$OUT_DIR/failures"
+}
+
+corpus_entries "$SIZES" |
+while read IMAGE ARCH SIZE GENARGS; do
+    IMAGE_PATH=$(make_image "$IMAGE" $GENARGS) || exit 1
+    ENTRY=$IMAGE-$ARCH
+    GOLDEN=$GOLDEN_DIR/$ENTRY.txt
+    REFERENCE=$OUT_DIR/$ENTRY.txt
+
+    CACHE_DIR=$(fresh_cache_dir "$ENTRY")
+
+    if ! run_otx "$IMAGE_PATH" "$ARCH" "$REFERENCE" "$CACHE_DIR" \
+        $REFERENCE_FLAGS; then
+        echo "$ENTRY reference" >> "$OUT_DIR/failures"
+        continue
+    fi
+
+    if [ $RECORD -eq 1 ]; then
+        cp "$REFERENCE" "$GOLDEN"
+        printf "%-40s recorded\n" "$ENTRY"
+    elif [ -f "$GOLDEN" ]; then
+        check "$GOLDEN" "$REFERENCE" "$ENTRY golden"
+    else
+        printf "%-40s no golden file, record it with -record\n" "$ENTRY"
+        echo "$ENTRY golden" >> "$OUT_DIR/failures"
+    fi
+
+    for MODE in $MODES; do
+        NAME=${MODE%%:*}
+        FLAGS=$(echo "${MODE#*:}" | tr ',' ' ')
+        CACHE_DIR=$(fresh_cache_dir "$ENTRY-$NAME")
+
+        for PASS in cold warm; do
+            OUTPUT=$OUT_DIR/$ENTRY-$NAME-$PASS.txt
+
+            if run_otx "$IMAGE_PATH" "$ARCH" "$OUTPUT" "$CACHE_DIR" \
+                $FLAGS; then
+                check "$REFERENCE" "$OUTPUT" "$ENTRY $NAME $PASS"
+            else
+                echo "$ENTRY $NAME $PASS" >> "$OUT_DIR/failures"
+            fi
+        done
+    done
+done
+
+[ -s "$OUT_DIR/failures" ] && exit 1
+exit 0
@@ -0,0 +1,1589 @@
+/*
+    machogen.c
+
+    Writes synthetic Mach-O executables for benchmarking otx. Images can be
+    thin or fat, ppc, ppc64, i386 and/or x86_64, with Obj-C 1 or Obj-C 2
+    metadata, C or C++ symbol names, stripped or not, and any number of
+    instructions. Output is a pure function of the arguments, so a corpus
+    regenerated on another machine is byte for byte the same.
+
+    The code is not meant to run, only to look enough like compiler output
+    to exercise otx: every function has a frame setup prologue and an
+    epilogue, and the bodies mix immediate loads, arithmetic, short forward
+    branches, calls to nearby functions, selector ref loads and C string
+    loads.
+
+    Plain C99 with no Apple headers, so it builds anywhere:
+
+        cc -O2 -o machogen machogen.c
+
+    This file is in the public domain.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_SIZE               4096
+#define MAX_ARCHS               4
+#define MAX_NAME_LENGTH         128
+#define DEFAULT_INSTRUCTIONS    10000
+#define DEFAULT_FUNC_SIZE       32      // body units per function, average
+#define METHODS_PER_CLASS       8
+#define IVARS_PER_CLASS         4
+
+// Mach-O constants, from <mach-o/loader.h> and friends.
+#define MH_MAGIC                0xfeedface
+#define MH_MAGIC_64             0xfeedfacf
+#define FAT_MAGIC               0xcafebabe
+#define MH_EXECUTE              0x2
+#define MH_FLAGS                0x85    // NOUNDEFS | DYLDLINK | TWOLEVEL
+#define LC_SEGMENT              0x1
+#define LC_SYMTAB               0x2
+#define LC_DYSYMTAB             0xb
+#define LC_SEGMENT_64           0x19
+#define N_SECT                  0xe
+#define N_EXT                   0x01
+#define S_CSTRING_LITERALS      0x2
+#define S_LITERAL_POINTERS      0x5
+#define S_ATTR_NO_DEAD_STRIP    0x10000000
+#define S_ATTR_CODE             0x80000400  // PURE_ | SOME_INSTRUCTIONS
+#define CPU_ARCH_ABI64          0x01000000
+
+/*  Arch
+
+    One entry per supported architecture.
+*/
+typedef struct
+{
+    const char* name;
+    uint32_t    cpuType;
+    uint32_t    cpuSubtype;
+    int         is64;
+    int         bigEndian;
+    int         isPPC;
+    uint64_t    textBase;   // vmaddr of __TEXT
+}
+Arch;
+
+static const Arch   gArchs[]    =
+{
+    {"ppc",     18,                     0,  0,  1,  1,  0x1000},
+    {"ppc64",   18 | CPU_ARCH_ABI64,    0,  1,  1,  1,  0x1000},
+    {"i386",    7,                      3,  0,  0,  0,  0x1000},
+    {"x86_64",  7 | CPU_ARCH_ABI64,     3,  1,  0,  0,  0x100000000ULL},
+};
+
+#define NUM_KNOWN_ARCHS     (sizeof(gArchs) / sizeof(Arch))
+
+/*  Options
+
+    From the command line.
+*/
+typedef struct
+{
+    const Arch* archs[MAX_ARCHS];
+    uint32_t    numArchs;
+    uint64_t    numInstructions;
+    uint32_t    funcSize;
+    uint32_t    objcVersion;    // 0 for none
+    int         cplusplus;
+    int         stripped;
+    uint32_t    seed;
+    const char* outPath;
+}
+Options;
+
+/*  Buffer
+
+    A growable byte buffer.
+*/
+typedef struct
+{
+    unsigned char*  bytes;
+    size_t          length;
+    size_t          capacity;
+}
+Buffer;
+
+// Sections, in file order. Each segment's sections are contiguous.
+enum {
+    TextSect,
+    CStringSect,
+    MethnameSect,
+    ClassnameSect,
+    MethtypeSect,
+    DataSect,
+    ClassListSect,
+    SelRefsSect,
+    ClassRefsSect,
+    ObjcConstSect,
+    ObjcDataSect,
+    ImageInfo2Sect,
+    MessageRefsSect,
+    ClassSect,
+    MetaClassSect,
+    InstMethSect,
+    InstVarsSect,
+    SymbolsSect,
+    ModuleInfoSect,
+    ImageInfo1Sect,
+    NumSects
+};
+
+enum {
+    TextSeg,
+    DataSeg,
+    ObjcSeg,
+    NumContentSegs
+};
+
+/*  SectionDesc
+
+    Static description of a section.
+*/
+typedef struct
+{
+    const char* sectName;
+    uint32_t    seg;
+    uint32_t    flags;
+    uint32_t    objcVersion;    // present only for this objc version, or 0
+}
+SectionDesc;
+
+static const SectionDesc    gSectDescs[NumSects]    =
+{
+    {"__text",              TextSeg,    S_ATTR_CODE,                        0},
+    {"__cstring",           TextSeg,    S_CSTRING_LITERALS,                 0},
+    {"__objc_methname",     TextSeg,    S_CSTRING_LITERALS,                 2},
+    {"__objc_classname",    TextSeg,    S_CSTRING_LITERALS,                 2},
+    {"__objc_methtype",     TextSeg,    S_CSTRING_LITERALS,                 2},
+    {"__data",              DataSeg,    0,                                  0},
+    {"__objc_classlist",    DataSeg,    S_ATTR_NO_DEAD_STRIP,               2},
+    {"__objc_selrefs",      DataSeg,
+        S_ATTR_NO_DEAD_STRIP | S_LITERAL_POINTERS,                          2},
+    {"__objc_classrefs",    DataSeg,    S_ATTR_NO_DEAD_STRIP,               2},
+    {"__objc_const",        DataSeg,    0,                                  2},
+    {"__objc_data",         DataSeg,    0,                                  2},
+    {"__objc_imageinfo",    DataSeg,    S_ATTR_NO_DEAD_STRIP,               2},
+    {"__message_refs",      ObjcSeg,
+        S_ATTR_NO_DEAD_STRIP | S_LITERAL_POINTERS,                          1},
+    {"__class",             ObjcSeg,    S_ATTR_NO_DEAD_STRIP,               1},
+    {"__meta_class",        ObjcSeg,    S_ATTR_NO_DEAD_STRIP,               1},
+    {"__inst_meth",         ObjcSeg,    S_ATTR_NO_DEAD_STRIP,               1},
+    {"__instance_vars",     ObjcSeg,    S_ATTR_NO_DEAD_STRIP,               1},
+    {"__symbols",           ObjcSeg,    S_ATTR_NO_DEAD_STRIP,               1},
+    {"__module_info",       ObjcSeg,    S_ATTR_NO_DEAD_STRIP,               1},
+    {"__image_info",        ObjcSeg,    S_ATTR_NO_DEAD_STRIP,               1},
+};
+
+static const char*  gSegNames[NumContentSegs]   =
+    {"__TEXT", "__DATA", "__OBJC"};
+
+/*  Section
+
+    Contents and placement of one section in one slice.
+*/
+typedef struct
+{
+    Buffer      contents;
+    uint64_t    addr;
+    uint32_t    offset;
+    uint32_t    align;      // power of 2
+    int         present;
+}
+Section;
+
+/*  Slice
+
+    Everything needed to write one thin image.
+*/
+typedef struct
+{
+    const Arch*     arch;
+    const Options*  opts;
+    uint32_t        ptrSize;
+    uint32_t        objcVersion;
+
+    uint32_t        numFuncs;
+    uint32_t        numClasses;
+    uint32_t        numMethods;     // the first numMethods funcs are IMPs
+    uint32_t        numStrings;
+    uint32_t*       funcOffsets;    // into __text, from the sizing pass
+
+    uint32_t*       selNameOffsets;
+    uint32_t*       classNameOffsets;
+    uint32_t*       ivarNameOffsets;
+    uint32_t*       cstringOffsets;
+    uint32_t        methTypeOffset;
+    uint32_t        ivarTypeOffset;
+    uint32_t        rootNameOffset;     // "NSObject", objc1
+    uint32_t        emptyNameOffset;    // "", objc1 module name
+
+    Section         sects[NumSects];
+    uint64_t        segAddrs[NumContentSegs];
+    uint64_t        segSizes[NumContentSegs];
+    uint32_t        segOffsets[NumContentSegs];
+    uint32_t        segFileSizes[NumContentSegs];
+    uint32_t        numSegs;        // including __PAGEZERO and __LINKEDIT
+    uint32_t        headerSize;
+
+    Buffer          symbols;
+    Buffer          strings;
+    uint32_t        numLocalSyms;
+    uint32_t        numExtSyms;
+
+    Buffer          image;
+    uint32_t        rngState;
+}
+Slice;
+
+//  Buffers
+// ----------------------------------------------------------------------------
+
+static void
+Grow(
+    Buffer* ioBuf,
+    size_t  inExtra)
+{
+    if (ioBuf->length + inExtra <= ioBuf->capacity)
+        return;
+
+    size_t  newCapacity = (ioBuf->capacity) ? ioBuf->capacity * 2 : 4096;
+
+    while (newCapacity < ioBuf->length + inExtra)
+        newCapacity *= 2;
+
+    ioBuf->bytes    = realloc(ioBuf->bytes, newCapacity);
+
+    if (!ioBuf->bytes)
+    {
+        fprintf(stderr, "machogen: out of memory\n");
+        exit(1);
+    }
+
+    ioBuf->capacity = newCapacity;
+}
+
+static void
+PutBytes(
+    Buffer*     ioBuf,
+    const void* inBytes,
+    size_t      inLength)
+{
+    Grow(ioBuf, inLength);
+    memcpy(ioBuf->bytes + ioBuf->length, inBytes, inLength);
+    ioBuf->length   += inLength;
+}
+
+static void
+PutZeros(
+    Buffer* ioBuf,
+    size_t  inLength)
+{
+    Grow(ioBuf, inLength);
+    memset(ioBuf->bytes + ioBuf->length, 0, inLength);
+    ioBuf->length   += inLength;
+}
+
+static void
+AlignBuffer(
+    Buffer*     ioBuf,
+    uint32_t    inAlign,
+    unsigned char   inFill)
+{
+    while (ioBuf->length % inAlign)
+        PutBytes(ioBuf, &inFill, 1);
+}
+
+static void
+PutU8(
+    Buffer*     ioBuf,
+    uint8_t     inValue)
+{
+    PutBytes(ioBuf, &inValue, 1);
+}
+
+static void
+PutU16(
+    Buffer*     ioBuf,
+    uint16_t    inValue,
+    int         inBigEndian)
+{
+    unsigned char   b[2];
+
+    if (inBigEndian)
+        b[0] = inValue >> 8, b[1] = inValue;
+    else
+        b[1] = inValue >> 8, b[0] = inValue;
+
+    PutBytes(ioBuf, b, 2);
+}
+
+static void
+PutU32(
+    Buffer*     ioBuf,
+    uint32_t    inValue,
+    int         inBigEndian)
+{
+    unsigned char   b[4];
+    int             i;
+
+    for (i = 0; i < 4; i++)
+        b[(inBigEndian) ? 3 - i : i]    = inValue >> (i * 8);
+
+    PutBytes(ioBuf, b, 4);
+}
+
+static void
+PutU64(
+    Buffer*     ioBuf,
+    uint64_t    inValue,
+    int         inBigEndian)
+{
+    unsigned char   b[8];
+    int             i;
+
+    for (i = 0; i < 8; i++)
+        b[(inBigEndian) ? 7 - i : i]    = inValue >> (i * 8);
+
+    PutBytes(ioBuf, b, 8);
+}
+
+static void
+PutName(
+    Buffer*     ioBuf,
+    const char* inName)
+{
+    char    name[16]    = {0};
+    size_t  length      = strlen(inName);
+
+    memcpy(name, inName, (length < sizeof(name)) ? length : sizeof(name));
+    PutBytes(ioBuf, name, sizeof(name));
+}
+
+static uint32_t
+PutString(
+    Buffer*     ioBuf,
+    const char* inString)
+{
+    uint32_t    offset  = ioBuf->length;
+
+    PutBytes(ioBuf, inString, strlen(inString) + 1);
+
+    return offset;
+}
+
+//  Slice helpers
+// ----------------------------------------------------------------------------
+
+static uint32_t
+Random(
+    Slice*  ioSlice)
+{
+    // xorshift32
+    uint32_t    x   = ioSlice->rngState;
+
+    x   ^= x << 13;
+    x   ^= x >> 17;
+    x   ^= x << 5;
+    ioSlice->rngState   = x;
+
+    return x;
+}
+
+static void
+Put32(
+    Slice*      ioSlice,
+    uint32_t    inSect,
+    uint32_t    inValue)
+{
+    PutU32(&ioSlice->sects[inSect].contents, inValue,
+        ioSlice->arch->bigEndian);
+}
+
+static void
+PutPtr(
+    Slice*      ioSlice,
+    uint32_t    inSect,
+    uint64_t    inValue)
+{
+    if (ioSlice->ptrSize == 8)
+        PutU64(&ioSlice->sects[inSect].contents, inValue,
+            ioSlice->arch->bigEndian);
+    else
+        PutU32(&ioSlice->sects[inSect].contents, (uint32_t)inValue,
+            ioSlice->arch->bigEndian);
+}
+
+static uint64_t
+SectAddr(
+    Slice*      inSlice,
+    uint32_t    inSect,
+    uint64_t    inOffset)
+{
+    return inSlice->sects[inSect].addr + inOffset;
+}
+
+static uint64_t
+FuncAddr(
+    Slice*      inSlice,
+    uint32_t    inFunc)
+{
+    return SectAddr(inSlice, TextSect, inSlice->funcOffsets[inFunc]);
+}
+
+static uint64_t
+SelRefAddr(
+    Slice*      inSlice,
+    uint32_t    inSel)
+{
+    uint32_t    sect    = (inSlice->objcVersion == 1) ?
+        MessageRefsSect : SelRefsSect;
+
+    return SectAddr(inSlice, sect, (uint64_t)inSel * inSlice->ptrSize);
+}
+
+//  Names
+// ----------------------------------------------------------------------------
+
+static void
+FunctionName(
+    Slice*      inSlice,
+    uint32_t    inFunc,
+    char*       outName)
+{
+    if (inFunc < inSlice->numMethods)
+    {
+        snprintf(outName, MAX_NAME_LENGTH, "-[BenchClass%u method%u:]",
+            inFunc / METHODS_PER_CLASS, inFunc % METHODS_PER_CLASS);
+    }
+    else if (inFunc == inSlice->numMethods)
+    {
+        strcpy(outName, "_main");
+    }
+    else if (inSlice->opts->cplusplus)
+    {
+        // bench::Widget<n>::update(int)
+        char    className[32];
+
+        snprintf(className, sizeof(className), "Widget%u", inFunc);
+        snprintf(outName, MAX_NAME_LENGTH, "__ZN5bench%zu%s6updateEi",
+            strlen(className), className);
+    }
+    else
+        snprintf(outName, MAX_NAME_LENGTH, "_bench_func%u", inFunc);
+}
+
+//  Code
+// ----------------------------------------------------------------------------
+
+static void
+EmitPPC(
+    Slice*      ioSlice,
+    uint32_t    inInstruction)
+{
+    Put32(ioSlice, TextSect, inInstruction);
+}
+
+static void
+EmitPPCFunction(
+    Slice*      ioSlice,
+    uint32_t    inFunc,
+    uint32_t    inUnits)
+{
+    Buffer*     text    = &ioSlice->sects[TextSect].contents;
+    int         is64    = ioSlice->arch->is64;
+    uint32_t    i;
+
+    EmitPPC(ioSlice, 0x7c0802a6);                               // mflr r0
+    EmitPPC(ioSlice, (is64) ? 0xf8010010 : 0x90010008);         // st r0
+    EmitPPC(ioSlice, (is64) ? 0xf821ff81 : 0x9421ffc0);         // stu r1
+
+    for (i = 0; i < inUnits; i++)
+    {
+        uint32_t    kind    = Random(ioSlice) % 6;
+        uint32_t    value   = Random(ioSlice);
+
+        if (kind == 4 && !ioSlice->objcVersion)
+            kind    = 0;
+
+        switch (kind)
+        {
+            case 0:     // li r3,imm
+                EmitPPC(ioSlice, 0x38600000 | (value & 0x7fff));
+                break;
+
+            case 1:     // addi r3,r3,1; add r3,r3,r4
+                EmitPPC(ioSlice, 0x38630001);
+                EmitPPC(ioSlice, 0x7c632214);
+                break;
+
+            case 2:     // cmpwi r3,0; bne +8; nop
+                EmitPPC(ioSlice, 0x2c030000);
+                EmitPPC(ioSlice, 0x40820008);
+                EmitPPC(ioSlice, 0x60000000);
+                break;
+
+            case 3:     // bl nearby function
+            {
+                uint32_t    target  = inFunc + (value % 64);
+                uint64_t    here    = SectAddr(ioSlice, TextSect,
+                    text->length);
+
+                if (target >= ioSlice->numFuncs)
+                    target  = inFunc;
+
+                EmitPPC(ioSlice, 0x48000001 |
+                    ((uint32_t)(FuncAddr(ioSlice, target) - here) &
+                    0x03fffffc));
+                break;
+            }
+
+            case 4:     // lis r2,ha16(selref); l r4,lo16(selref)(r2)
+            case 5:     // lis r3,ha16(string); addi r3,r3,lo16(string)
+            {
+                uint64_t    addr    = (kind == 4) ?
+                    SelRefAddr(ioSlice, value % METHODS_PER_CLASS) :
+                    SectAddr(ioSlice, CStringSect,
+                        ioSlice->cstringOffsets[value %
+                        ioSlice->numStrings]);
+                uint32_t    ha      = ((addr + 0x8000) >> 16) & 0xffff;
+                uint32_t    lo      = addr & 0xffff;
+
+                if (kind == 4)
+                {
+                    EmitPPC(ioSlice, 0x3c400000 | ha);
+                    EmitPPC(ioSlice, ((is64) ? 0xe8820000 : 0x80820000) |
+                        lo);
+                }
+                else
+                {
+                    EmitPPC(ioSlice, 0x3c600000 | ha);
+                    EmitPPC(ioSlice, 0x38630000 | lo);
+                }
+
+                break;
+            }
+        }
+    }
+
+    EmitPPC(ioSlice, (is64) ? 0x38210080 : 0x38210040);         // addi r1
+    EmitPPC(ioSlice, (is64) ? 0xe8010010 : 0x80010008);         // l r0
+    EmitPPC(ioSlice, 0x7c0803a6);                               // mtlr r0
+    EmitPPC(ioSlice, 0x4e800020);                               // blr
+}
+
+static void
+EmitX86Function(
+    Slice*      ioSlice,
+    uint32_t    inFunc,
+    uint32_t    inUnits)
+{
+    Buffer*     text    = &ioSlice->sects[TextSect].contents;
+    int         is64    = ioSlice->arch->is64;
+    uint32_t    i;
+
+    PutU8(text, 0x55);                                  // push %ebp
+    if (is64) PutU8(text, 0x48);
+    PutBytes(text, "\x89\xe5", 2);                      // mov %esp,%ebp
+
+    for (i = 0; i < inUnits; i++)
+    {
+        uint32_t    kind    = Random(ioSlice) % 6;
+        uint32_t    value   = Random(ioSlice);
+
+        if (kind == 4 && !ioSlice->objcVersion)
+            kind    = 0;
+
+        switch (kind)
+        {
+            case 0:     // mov $imm,%eax
+                PutU8(text, 0xb8);
+                PutU32(text, value & 0xffff, 0);
+                break;
+
+            case 1:     // add $imm8,%eax; add %ecx,%eax
+                PutBytes(text, "\x83\xc0", 2);
+                PutU8(text, value & 0x7f);
+                PutBytes(text, "\x01\xc8", 2);
+                break;
+
+            case 2:     // test %eax,%eax; jne +1; nop
+                PutBytes(text, "\x85\xc0\x75\x01\x90", 5);
+                break;
+
+            case 3:     // call nearby function
+            {
+                uint32_t    target  = inFunc + (value % 64);
+
+                if (target >= ioSlice->numFuncs)
+                    target  = inFunc;
+
+                PutU8(text, 0xe8);
+                PutU32(text, (uint32_t)(FuncAddr(ioSlice, target) -
+                    SectAddr(ioSlice, TextSect, text->length + 4)), 0);
+                break;
+            }
+
+            case 4:     // mov selref,%eax / mov selref(%rip),%rax
+            case 5:     // mov $string,%eax / lea string(%rip),%rax
+            {
+                uint64_t    addr    = (kind == 4) ?
+                    SelRefAddr(ioSlice, value % METHODS_PER_CLASS) :
+                    SectAddr(ioSlice, CStringSect,
+                        ioSlice->cstringOffsets[value %
+                        ioSlice->numStrings]);
+
+                if (is64)
+                {
+                    PutBytes(text, (kind == 4) ? "\x48\x8b\x05" :
+                        "\x48\x8d\x05", 3);
+                    PutU32(text, (uint32_t)(addr -
+                        SectAddr(ioSlice, TextSect, text->length + 4)), 0);
+                }
+                else
+                {
+                    PutU8(text, (kind == 4) ? 0xa1 : 0xb8);
+                    PutU32(text, (uint32_t)addr, 0);
+                }
+
+                break;
+            }
+        }
+    }
+
+    PutBytes(text, "\xc9\xc3", 2);                      // leave; ret
+}
+
+static void
+BuildText(
+    Slice*  ioSlice)
+{
+    uint32_t    i;
+
+    // Same sequence in both passes.
+    ioSlice->rngState   = ioSlice->opts->seed | 1;
+
+    for (i = 0; i < ioSlice->numFuncs; i++)
+    {
+        Buffer*     text    = &ioSlice->sects[TextSect].contents;
+        uint32_t    units   = ioSlice->opts->funcSize / 2 +
+            Random(ioSlice) % (ioSlice->opts->funcSize + 1);
+
+        if (ioSlice->arch->isPPC)
+            AlignBuffer(text, 4, 0);
+
+        ioSlice->funcOffsets[i] = text->length;
+
+        if (ioSlice->arch->isPPC)
+            EmitPPCFunction(ioSlice, i, units);
+        else
+            EmitX86Function(ioSlice, i, units);
+    }
+}
+
+//  Obj-C metadata
+// ----------------------------------------------------------------------------
+
+static void
+BuildObjc1(
+    Slice*  ioSlice)
+{
+    uint32_t    classSize   = 10 * 4;
+    uint32_t    methListSize    = 8 + METHODS_PER_CLASS * 12;
+    uint32_t    ivarListSize    = 4 + IVARS_PER_CLASS * 12;
+    uint32_t    i, j;
+
+    for (i = 0; i < METHODS_PER_CLASS; i++)
+        PutPtr(ioSlice, MessageRefsSect, SectAddr(ioSlice, CStringSect,
+            ioSlice->selNameOffsets[i]));
+
+    for (i = 0; i < ioSlice->numClasses; i++)
+    {
+        uint64_t    name    = SectAddr(ioSlice, CStringSect,
+            ioSlice->classNameOffsets[i]);
+        uint64_t    root    = SectAddr(ioSlice, CStringSect,
+            ioSlice->rootNameOffset);
+
+        // class
+        Put32(ioSlice, ClassSect, SectAddr(ioSlice, MetaClassSect,
+            i * classSize));                                        // isa
+        Put32(ioSlice, ClassSect, root);                            // super
+        Put32(ioSlice, ClassSect, name);
+        Put32(ioSlice, ClassSect, 0);                               // version
+        Put32(ioSlice, ClassSect, 0x1);                             // CLS_CLASS
+        Put32(ioSlice, ClassSect, 4 + 4 * IVARS_PER_CLASS);
+        Put32(ioSlice, ClassSect, SectAddr(ioSlice, InstVarsSect,
+            i * ivarListSize));
+        Put32(ioSlice, ClassSect, SectAddr(ioSlice, InstMethSect,
+            i * methListSize));
+        Put32(ioSlice, ClassSect, 0);                               // cache
+        Put32(ioSlice, ClassSect, 0);                               // protocols
+
+        // metaclass
+        Put32(ioSlice, MetaClassSect, root);
+        Put32(ioSlice, MetaClassSect, root);
+        Put32(ioSlice, MetaClassSect, name);
+        Put32(ioSlice, MetaClassSect, 0);
+        Put32(ioSlice, MetaClassSect, 0x2);                         // CLS_META
+        Put32(ioSlice, MetaClassSect, 48);
+        Put32(ioSlice, MetaClassSect, 0);
+        Put32(ioSlice, MetaClassSect, 0);
+        Put32(ioSlice, MetaClassSect, 0);
+        Put32(ioSlice, MetaClassSect, 0);
+
+        // methods
+        Put32(ioSlice, InstMethSect, 0);
+        Put32(ioSlice, InstMethSect, METHODS_PER_CLASS);
+
+        for (j = 0; j < METHODS_PER_CLASS; j++)
+        {
+            Put32(ioSlice, InstMethSect, SectAddr(ioSlice, CStringSect,
+                ioSlice->selNameOffsets[j]));
+            Put32(ioSlice, InstMethSect, SectAddr(ioSlice, CStringSect,
+                ioSlice->methTypeOffset));
+            Put32(ioSlice, InstMethSect,
+                FuncAddr(ioSlice, i * METHODS_PER_CLASS + j));
+        }
+
+        // ivars, after isa
+        Put32(ioSlice, InstVarsSect, IVARS_PER_CLASS);
+
+        for (j = 0; j < IVARS_PER_CLASS; j++)
+        {
+            Put32(ioSlice, InstVarsSect, SectAddr(ioSlice, CStringSect,
+                ioSlice->ivarNameOffsets[j]));
+            Put32(ioSlice, InstVarsSect, SectAddr(ioSlice, CStringSect,
+                ioSlice->ivarTypeOffset));
+            Put32(ioSlice, InstVarsSect, 4 + 4 * j);
+        }
+    }
+
+    // One symtab listing every class.
+    Buffer* symbols = &ioSlice->sects[SymbolsSect].contents;
+
+    Put32(ioSlice, SymbolsSect, METHODS_PER_CLASS);
+    Put32(ioSlice, SymbolsSect, SectAddr(ioSlice, MessageRefsSect, 0));
+    PutU16(symbols, ioSlice->numClasses, ioSlice->arch->bigEndian);
+    PutU16(symbols, 0, ioSlice->arch->bigEndian);
+
+    for (i = 0; i < ioSlice->numClasses; i++)
+        Put32(ioSlice, SymbolsSect, SectAddr(ioSlice, ClassSect,
+            i * classSize));
+
+    Put32(ioSlice, ModuleInfoSect, 7);                              // version
+    Put32(ioSlice, ModuleInfoSect, 16);                             // size
+    Put32(ioSlice, ModuleInfoSect, SectAddr(ioSlice, CStringSect,
+        ioSlice->emptyNameOffset));
+    Put32(ioSlice, ModuleInfoSect, SectAddr(ioSlice, SymbolsSect, 0));
+
+    PutZeros(&ioSlice->sects[ImageInfo1Sect].contents, 8);
+}
+
+static void
+BuildObjc2(
+    Slice*  ioSlice)
+{
+    uint32_t    p           = ioSlice->ptrSize;
+    uint32_t    classSize   = 5 * p;
+    uint32_t    roSize      = ((p == 8) ? 16 : 12) + 7 * p;
+    uint32_t    methListSize    = 8 + METHODS_PER_CLASS * 3 * p;
+    uint32_t    ivarSize    = 3 * p + 8;
+    uint32_t    ivarListSize    = 8 + IVARS_PER_CLASS * ivarSize;
+    uint32_t    perClass    = 2 * roSize + methListSize + ivarListSize;
+    uint32_t    i, j;
+
+    for (i = 0; i < METHODS_PER_CLASS; i++)
+        PutPtr(ioSlice, SelRefsSect, SectAddr(ioSlice, MethnameSect,
+            ioSlice->selNameOffsets[i]));
+
+    for (i = 0; i < ioSlice->numClasses; i++)
+    {
+        uint64_t    constBase   = (uint64_t)i * perClass;
+        uint64_t    classAddr   = SectAddr(ioSlice, ObjcDataSect,
+            (uint64_t)i * 2 * classSize);
+        uint64_t    metaAddr    = classAddr + classSize;
+        uint64_t    name        = SectAddr(ioSlice, ClassnameSect,
+            ioSlice->classNameOffsets[i]);
+        uint32_t    meta;
+
+        PutPtr(ioSlice, ClassListSect, classAddr);
+        PutPtr(ioSlice, ClassRefsSect, classAddr);
+
+        // class_t and its metaclass
+        PutPtr(ioSlice, ObjcDataSect, metaAddr);                    // isa
+        PutPtr(ioSlice, ObjcDataSect, 0);                           // super
+        PutPtr(ioSlice, ObjcDataSect, 0);                           // cache
+        PutPtr(ioSlice, ObjcDataSect, 0);                           // vtable
+        PutPtr(ioSlice, ObjcDataSect, SectAddr(ioSlice, ObjcConstSect,
+            constBase));
+        PutPtr(ioSlice, ObjcDataSect, 0);
+        PutPtr(ioSlice, ObjcDataSect, 0);
+        PutPtr(ioSlice, ObjcDataSect, 0);
+        PutPtr(ioSlice, ObjcDataSect, 0);
+        PutPtr(ioSlice, ObjcDataSect, SectAddr(ioSlice, ObjcConstSect,
+            constBase + roSize));
+
+        // class_ro_t's
+        for (meta = 0; meta < 2; meta++)
+        {
+            uint32_t    instanceSize    = (meta) ? 5 * p :
+                p + 4 * IVARS_PER_CLASS;
+
+            Put32(ioSlice, ObjcConstSect, meta);                    // RO_META
+            Put32(ioSlice, ObjcConstSect, (meta) ? instanceSize : p);
+            Put32(ioSlice, ObjcConstSect, instanceSize);
+
+            if (p == 8)
+                Put32(ioSlice, ObjcConstSect, 0);                   // reserved
+
+            PutPtr(ioSlice, ObjcConstSect, 0);                      // ivarLayout
+            PutPtr(ioSlice, ObjcConstSect, name);
+            PutPtr(ioSlice, ObjcConstSect, (meta) ? 0 :
+                SectAddr(ioSlice, ObjcConstSect, constBase + 2 * roSize));
+            PutPtr(ioSlice, ObjcConstSect, 0);                      // protocols
+            PutPtr(ioSlice, ObjcConstSect, (meta) ? 0 :
+                SectAddr(ioSlice, ObjcConstSect,
+                constBase + 2 * roSize + methListSize));
+            PutPtr(ioSlice, ObjcConstSect, 0);                      // weak
+            PutPtr(ioSlice, ObjcConstSect, 0);                      // props
+        }
+
+        // method_list_t
+        Put32(ioSlice, ObjcConstSect, 3 * p);
+        Put32(ioSlice, ObjcConstSect, METHODS_PER_CLASS);
+
+        for (j = 0; j < METHODS_PER_CLASS; j++)
+        {
+            PutPtr(ioSlice, ObjcConstSect, SectAddr(ioSlice, MethnameSect,
+                ioSlice->selNameOffsets[j]));
+            PutPtr(ioSlice, ObjcConstSect, SectAddr(ioSlice, MethtypeSect,
+                ioSlice->methTypeOffset));
+            PutPtr(ioSlice, ObjcConstSect,
+                FuncAddr(ioSlice, i * METHODS_PER_CLASS + j));
+        }
+
+        // ivar_list_t, the uintptr_t offsets live in __data
+        Put32(ioSlice, ObjcConstSect, ivarSize);
+        Put32(ioSlice, ObjcConstSect, IVARS_PER_CLASS);
+
+        for (j = 0; j < IVARS_PER_CLASS; j++)
+        {
+            PutPtr(ioSlice, ObjcConstSect, SectAddr(ioSlice, DataSect,
+                p * ((uint64_t)i * IVARS_PER_CLASS + j)));
+            PutPtr(ioSlice, ObjcConstSect, SectAddr(ioSlice, MethnameSect,
+                ioSlice->ivarNameOffsets[j]));
+            PutPtr(ioSlice, ObjcConstSect, SectAddr(ioSlice, MethtypeSect,
+                ioSlice->ivarTypeOffset));
+            Put32(ioSlice, ObjcConstSect, 2);                       // align
+            Put32(ioSlice, ObjcConstSect, 4);                       // size
+            PutPtr(ioSlice, DataSect, p + 4 * j);
+        }
+    }
+
+    PutZeros(&ioSlice->sects[ImageInfo2Sect].contents, 8);
+}
+
+//  Layout
+// ----------------------------------------------------------------------------
+
+/*  BuildSections
+
+    Fill every section using the current addresses. Section sizes never
+    depend on addresses, so a first pass with all addresses zero sizes
+    everything, and a second pass after LayOut writes the real thing.
+*/
+static void
+BuildSections(
+    Slice*  ioSlice)
+{
+    uint32_t    i;
+    char        name[MAX_NAME_LENGTH];
+    uint32_t    objcStrings = (ioSlice->objcVersion == 2) ?
+        MethnameSect : CStringSect;
+    uint32_t    classStrings    = (ioSlice->objcVersion == 2) ?
+        ClassnameSect : CStringSect;
+
+    for (i = 0; i < NumSects; i++)
+        ioSlice->sects[i].contents.length   = 0;
+
+    for (i = 0; i < ioSlice->numStrings; i++)
+    {
+        snprintf(name, sizeof(name), "bench string %u", i);
+        ioSlice->cstringOffsets[i]  = PutString(
+            &ioSlice->sects[CStringSect].contents, name);
+    }
+
+    if (ioSlice->objcVersion)
+    {
+        Buffer* names   = &ioSlice->sects[objcStrings].contents;
+        Buffer* types   = &ioSlice->sects[(ioSlice->objcVersion == 2) ?
+            MethtypeSect : CStringSect].contents;
+
+        for (i = 0; i < METHODS_PER_CLASS; i++)
+        {
+            snprintf(name, sizeof(name), "method%u:", i);
+            ioSlice->selNameOffsets[i]  = PutString(names, name);
+        }
+
+        for (i = 0; i < IVARS_PER_CLASS; i++)
+        {
+            snprintf(name, sizeof(name), "iValue%u", i);
+            ioSlice->ivarNameOffsets[i] = PutString(names, name);
+        }
+
+        for (i = 0; i < ioSlice->numClasses; i++)
+        {
+            snprintf(name, sizeof(name), "BenchClass%u", i);
+            ioSlice->classNameOffsets[i]    = PutString(
+                &ioSlice->sects[classStrings].contents, name);
+        }
+
+        ioSlice->methTypeOffset = PutString(types, (ioSlice->ptrSize == 8) ?
+            "v24@0:8@16" : "v12@0:4@8");
+        ioSlice->ivarTypeOffset = PutString(types, "i");
+        ioSlice->rootNameOffset = PutString(
+            &ioSlice->sects[classStrings].contents, "NSObject");
+        ioSlice->emptyNameOffset    = PutString(
+            &ioSlice->sects[CStringSect].contents, "");
+    }
+
+    BuildText(ioSlice);
+
+    if (ioSlice->objcVersion == 1)
+        BuildObjc1(ioSlice);
+    else if (ioSlice->objcVersion == 2)
+        BuildObjc2(ioSlice);
+
+    // Something in __data either way.
+    if (!ioSlice->sects[DataSect].contents.length)
+        PutZeros(&ioSlice->sects[DataSect].contents, ioSlice->ptrSize);
+}
+
+static uint32_t
+LoadCommandsSize(
+    Slice*  ioSlice)
+{
+    uint32_t    segSize     = (ioSlice->ptrSize == 8) ? 72 : 56;
+    uint32_t    sectSize    = (ioSlice->ptrSize == 8) ? 80 : 68;
+    uint32_t    size        = 0;
+    uint32_t    i;
+
+    ioSlice->numSegs    = 2;    // __PAGEZERO, __LINKEDIT
+    size                += 2 * segSize;
+
+    for (i = 0; i < NumContentSegs; i++)
+    {
+        uint32_t    j;
+        int         used    = 0;
+
+        for (j = 0; j < NumSects; j++)
+        {
+            if (gSectDescs[j].seg == i && ioSlice->sects[j].present)
+            {
+                size    += sectSize;
+                used    = 1;
+            }
+        }
+
+        if (used)
+        {
+            size    += segSize;
+            ioSlice->numSegs++;
+        }
+    }
+
+    return size + 24 + 80;  // LC_SYMTAB, LC_DYSYMTAB
+}
+
+static uint64_t
+RoundUp(
+    uint64_t    inValue,
+    uint64_t    inAlign)
+{
+    return (inValue + inAlign - 1) & ~(inAlign - 1);
+}
+
+static void
+LayOut(
+    Slice*  ioSlice)
+{
+    uint32_t    headerSize  = (ioSlice->ptrSize == 8) ? 32 : 28;
+    uint64_t    addr        = ioSlice->arch->textBase;
+    uint32_t    offset      = 0;
+    uint32_t    i, j;
+
+    ioSlice->headerSize = headerSize + LoadCommandsSize(ioSlice);
+
+    for (i = 0; i < NumContentSegs; i++)
+    {
+        uint32_t    segStart    = offset;
+        uint64_t    segAddr     = addr;
+
+        ioSlice->segSizes[i]    = 0;
+
+        if (i == TextSeg)
+        {
+            offset  += ioSlice->headerSize;
+            addr    += ioSlice->headerSize;
+        }
+
+        for (j = 0; j < NumSects; j++)
+        {
+            Section*    sect    = &ioSlice->sects[j];
+            uint32_t    align   = 1 << sect->align;
+
+            if (gSectDescs[j].seg != i || !sect->present)
+                continue;
+
+            addr    = RoundUp(addr, align);
+            offset  = RoundUp(offset, align);
+            sect->addr      = addr;
+            sect->offset    = offset;
+            addr    += sect->contents.length;
+            offset  += sect->contents.length;
+        }
+
+        if (offset == segStart)
+            continue;   // no sections
+
+        offset  = RoundUp(offset, PAGE_SIZE);
+        addr    = RoundUp(addr, PAGE_SIZE);
+        ioSlice->segAddrs[i]        = segAddr;
+        ioSlice->segSizes[i]        = addr - segAddr;
+        ioSlice->segOffsets[i]      = segStart;
+        ioSlice->segFileSizes[i]    = offset - segStart;
+    }
+}
+
+//  Symbols
+// ----------------------------------------------------------------------------
+
+static const char*  gSortNames;
+
+static int
+ExtSymbolCompare(
+    const void* inA,
+    const void* inB)
+{
+    const uint32_t* a   = inA;
+    const uint32_t* b   = inB;
+
+    return strcmp(gSortNames + a[1], gSortNames + b[1]);
+}
+
+static void
+PutSymbol(
+    Slice*      ioSlice,
+    uint32_t    inStrx,
+    uint8_t     inType,
+    uint64_t    inValue)
+{
+    Buffer* syms    = &ioSlice->symbols;
+    int     be      = ioSlice->arch->bigEndian;
+
+    PutU32(syms, inStrx, be);
+    PutU8(syms, inType);
+    PutU8(syms, 1);     // n_sect, __text is always first
+    PutU16(syms, 0, be);
+
+    if (ioSlice->ptrSize == 8)
+        PutU64(syms, inValue, be);
+    else
+        PutU32(syms, (uint32_t)inValue, be);
+}
+
+/*  BuildSymbols
+
+    Locals (methods) first, then external definitions sorted by name, as
+    LC_DYSYMTAB expects. A stripped image keeps only _main.
+*/
+static void
+BuildSymbols(
+    Slice*  ioSlice)
+{
+    char        name[MAX_NAME_LENGTH];
+    uint32_t*   exts    = calloc(ioSlice->numFuncs, 2 * sizeof(uint32_t));
+    uint32_t    i;
+
+    PutBytes(&ioSlice->strings, " ", 2);
+
+    if (!ioSlice->opts->stripped)
+    {
+        for (i = 0; i < ioSlice->numMethods; i++)
+        {
+            FunctionName(ioSlice, i, name);
+            PutSymbol(ioSlice, PutString(&ioSlice->strings, name), N_SECT,
+                FuncAddr(ioSlice, i));
+            ioSlice->numLocalSyms++;
+        }
+    }
+
+    for (i = ioSlice->numMethods; i < ioSlice->numFuncs; i++)
+    {
+        if (ioSlice->opts->stripped && i != ioSlice->numMethods)
+            break;
+
+        FunctionName(ioSlice, i, name);
+        exts[ioSlice->numExtSyms * 2]       = i;
+        exts[ioSlice->numExtSyms * 2 + 1]   =
+            PutString(&ioSlice->strings, name);
+        ioSlice->numExtSyms++;
+    }
+
+    gSortNames  = (const char*)ioSlice->strings.bytes;
+    qsort(exts, ioSlice->numExtSyms, 2 * sizeof(uint32_t),
+        ExtSymbolCompare);
+
+    for (i = 0; i < ioSlice->numExtSyms; i++)
+        PutSymbol(ioSlice, exts[i * 2 + 1], N_SECT | N_EXT,
+            FuncAddr(ioSlice, exts[i * 2]));
+
+    AlignBuffer(&ioSlice->strings, ioSlice->ptrSize, 0);
+    free(exts);
+}
+
+//  Writing
+// ----------------------------------------------------------------------------
+
+static void
+PutSegment(
+    Slice*      ioSlice,
+    const char* inName,
+    uint64_t    inAddr,
+    uint64_t    inSize,
+    uint32_t    inOffset,
+    uint32_t    inFileSize,
+    uint32_t    inProt,
+    int         inSeg)  // -1 for none
+{
+    Buffer*     out     = &ioSlice->image;
+    int         be      = ioSlice->arch->bigEndian;
+    int         is64    = (ioSlice->ptrSize == 8);
+    uint32_t    nsects  = 0;
+    uint32_t    i;
+
+    if (inSeg >= 0)
+        for (i = 0; i < NumSects; i++)
+            if (gSectDescs[i].seg == (uint32_t)inSeg &&
+                ioSlice->sects[i].present)
+                nsects++;
+
+    PutU32(out, (is64) ? LC_SEGMENT_64 : LC_SEGMENT, be);
+    PutU32(out, ((is64) ? 72 : 56) + nsects * ((is64) ? 80 : 68), be);
+    PutName(out, inName);
+
+    if (is64)
+    {
+        PutU64(out, inAddr, be);
+        PutU64(out, inSize, be);
+        PutU64(out, inOffset, be);
+        PutU64(out, inFileSize, be);
+    }
+    else
+    {
+        PutU32(out, (uint32_t)inAddr, be);
+        PutU32(out, (uint32_t)inSize, be);
+        PutU32(out, inOffset, be);
+        PutU32(out, inFileSize, be);
+    }
+
+    PutU32(out, inProt, be);    // maxprot
+    PutU32(out, inProt, be);    // initprot
+    PutU32(out, nsects, be);
+    PutU32(out, 0, be);
+
+    if (inSeg < 0)
+        return;
+
+    for (i = 0; i < NumSects; i++)
+    {
+        Section*    sect    = &ioSlice->sects[i];
+
+        if (gSectDescs[i].seg != (uint32_t)inSeg || !sect->present)
+            continue;
+
+        PutName(out, gSectDescs[i].sectName);
+        PutName(out, inName);
+
+        if (is64)
+        {
+            PutU64(out, sect->addr, be);
+            PutU64(out, sect->contents.length, be);
+        }
+        else
+        {
+            PutU32(out, (uint32_t)sect->addr, be);
+            PutU32(out, sect->contents.length, be);
+        }
+
+        PutU32(out, sect->offset, be);
+        PutU32(out, sect->align, be);
+        PutU32(out, 0, be);     // reloff
+        PutU32(out, 0, be);     // nreloc
+        PutU32(out, gSectDescs[i].flags, be);
+        PutU32(out, 0, be);
+        PutU32(out, 0, be);
+
+        if (is64)
+            PutU32(out, 0, be);
+    }
+}
+
+static void
+WriteSlice(
+    Slice*  ioSlice)
+{
+    Buffer*     out         = &ioSlice->image;
+    int         be          = ioSlice->arch->bigEndian;
+    int         is64        = (ioSlice->ptrSize == 8);
+    uint32_t    linkOffset  = 0;
+    uint64_t    linkAddr    = 0;
+    uint32_t    i;
+
+    for (i = 0; i < NumContentSegs; i++)
+    {
+        if (!ioSlice->segFileSizes[i])
+            continue;
+
+        linkOffset  = ioSlice->segOffsets[i] + ioSlice->segFileSizes[i];
+        linkAddr    = ioSlice->segAddrs[i] + ioSlice->segSizes[i];
+    }
+
+    uint32_t    symSize     = ioSlice->symbols.length;
+    uint32_t    linkSize    = symSize + ioSlice->strings.length;
+
+    // mach_header
+    PutU32(out, (is64) ? MH_MAGIC_64 : MH_MAGIC, be);
+    PutU32(out, ioSlice->arch->cpuType, be);
+    PutU32(out, ioSlice->arch->cpuSubtype, be);
+    PutU32(out, MH_EXECUTE, be);
+    PutU32(out, ioSlice->numSegs + 2, be);
+    PutU32(out, ioSlice->headerSize - ((is64) ? 32 : 28), be);
+    PutU32(out, MH_FLAGS, be);
+
+    if (is64)
+        PutU32(out, 0, be);
+
+    PutSegment(ioSlice, "__PAGEZERO", 0, ioSlice->arch->textBase, 0, 0, 0,
+        -1);
+
+    for (i = 0; i < NumContentSegs; i++)
+    {
+        if (!ioSlice->segFileSizes[i])
+            continue;
+
+        PutSegment(ioSlice, gSegNames[i], ioSlice->segAddrs[i],
+            ioSlice->segSizes[i], ioSlice->segOffsets[i],
+            ioSlice->segFileSizes[i], (i == TextSeg) ? 5 : 3, i);
+    }
+
+    PutSegment(ioSlice, "__LINKEDIT", linkAddr,
+        RoundUp(linkSize, PAGE_SIZE), linkOffset, linkSize, 1, -1);
+
+    // LC_SYMTAB
+    PutU32(out, LC_SYMTAB, be);
+    PutU32(out, 24, be);
+    PutU32(out, linkOffset, be);
+    PutU32(out, ioSlice->numLocalSyms + ioSlice->numExtSyms, be);
+    PutU32(out, linkOffset + symSize, be);
+    PutU32(out, ioSlice->strings.length, be);
+
+    // LC_DYSYMTAB
+    uint32_t    dysymtab[18]    = {0};
+
+    dysymtab[1] = ioSlice->numLocalSyms;    // nlocalsym
+    dysymtab[2] = ioSlice->numLocalSyms;    // iextdefsym
+    dysymtab[3] = ioSlice->numExtSyms;      // nextdefsym
+    dysymtab[4] = ioSlice->numLocalSyms + ioSlice->numExtSyms;  // iundefsym
+
+    PutU32(out, LC_DYSYMTAB, be);
+    PutU32(out, 80, be);
+
+    for (i = 0; i < 18; i++)
+        PutU32(out, dysymtab[i], be);
+
+    // Section contents, in order.
+    for (i = 0; i < NumSects; i++)
+    {
+        Section*    sect    = &ioSlice->sects[i];
+
+        if (!sect->present)
+            continue;
+
+        PutZeros(out, sect->offset - out->length);
+        PutBytes(out, sect->contents.bytes, sect->contents.length);
+    }
+
+    PutZeros(out, linkOffset - out->length);
+    PutBytes(out, ioSlice->symbols.bytes, ioSlice->symbols.length);
+    PutBytes(out, ioSlice->strings.bytes, ioSlice->strings.length);
+}
+
+static void
+MakeSlice(
+    Slice*          ioSlice,
+    const Arch*     inArch,
+    const Options*  inOpts)
+{
+    uint32_t    i;
+
+    memset(ioSlice, 0, sizeof(Slice));
+    ioSlice->arch       = inArch;
+    ioSlice->opts       = inOpts;
+    ioSlice->ptrSize    = (inArch->is64) ? 8 : 4;
+    ioSlice->objcVersion    = inOpts->objcVersion;
+
+    // Obj-C 1 was never 64-bit.
+    if (inArch->is64 && ioSlice->objcVersion == 1)
+        ioSlice->objcVersion    = 2;
+
+    // Prologue, epilogue and about 1.5 instructions per body unit.
+    uint64_t    funcInstructions    = 6 + inOpts->funcSize * 3 / 2;
+
+    ioSlice->numFuncs   = inOpts->numInstructions / funcInstructions;
+
+    if (ioSlice->numFuncs < 2)
+        ioSlice->numFuncs   = 2;
+
+    if (ioSlice->objcVersion)
+    {
+        // Half the functions are methods.
+        ioSlice->numClasses = ioSlice->numFuncs / 2 / METHODS_PER_CLASS;
+
+        if (!ioSlice->numClasses)
+            ioSlice->numClasses = 1;
+
+        ioSlice->numMethods = ioSlice->numClasses * METHODS_PER_CLASS;
+
+        if (ioSlice->numFuncs <= ioSlice->numMethods)
+            ioSlice->numFuncs   = ioSlice->numMethods + 1;
+    }
+
+    ioSlice->numStrings = ioSlice->numFuncs / 4 + 16;
+    ioSlice->funcOffsets        = calloc(ioSlice->numFuncs, sizeof(uint32_t));
+    ioSlice->cstringOffsets     = calloc(ioSlice->numStrings,
+        sizeof(uint32_t));
+    ioSlice->classNameOffsets   = calloc(ioSlice->numClasses + 1,
+        sizeof(uint32_t));
+    ioSlice->selNameOffsets     = calloc(METHODS_PER_CLASS, sizeof(uint32_t));
+    ioSlice->ivarNameOffsets    = calloc(IVARS_PER_CLASS, sizeof(uint32_t));
+
+    for (i = 0; i < NumSects; i++)
+    {
+        Section*    sect    = &ioSlice->sects[i];
+
+        sect->present   = (!gSectDescs[i].objcVersion ||
+            gSectDescs[i].objcVersion == ioSlice->objcVersion);
+
+        if (i == TextSect)
+            sect->align = (inArch->isPPC) ? 2 : 4;
+        else if (gSectDescs[i].flags & S_CSTRING_LITERALS)
+            sect->align = 0;
+        else
+            sect->align = (inArch->is64) ? 3 : 2;
+    }
+
+    BuildSections(ioSlice);
+    LayOut(ioSlice);
+    BuildSections(ioSlice);
+    BuildSymbols(ioSlice);
+    WriteSlice(ioSlice);
+}
+
+static void
+FreeSlice(
+    Slice*  ioSlice)
+{
+    uint32_t    i;
+
+    for (i = 0; i < NumSects; i++)
+        free(ioSlice->sects[i].contents.bytes);
+
+    free(ioSlice->symbols.bytes);
+    free(ioSlice->strings.bytes);
+    free(ioSlice->image.bytes);
+    free(ioSlice->funcOffsets);
+    free(ioSlice->cstringOffsets);
+    free(ioSlice->classNameOffsets);
+    free(ioSlice->selNameOffsets);
+    free(ioSlice->ivarNameOffsets);
+}
+
+//  main
+// ----------------------------------------------------------------------------
+
+static void
+Usage(void)
+{
+    fprintf(stderr,
+        "Usage: machogen [-arch <arch>[,<arch>...]] [-n <instructions>]\n"
+        "                [-f <units per function>] [-objc1 | -objc2] [-cxx]\n"
+        "                [-strip] [-seed <n>] -o <output file>\n"
+        "\t-arch    ppc, ppc64, i386 or x86_64, more than one makes a fat\n"
+        "\t         file, default i386\n"
+        "\t-n       approximate instructions per slice, default %u\n"
+        "\t-f       average body size of a function, default %u\n"
+        "\t-objc1   Obj-C 1 metadata, 64-bit slices get Obj-C 2\n"
+        "\t-objc2   Obj-C 2 metadata\n"
+        "\t-cxx     mangled C++ names for C functions\n"
+        "\t-strip   no symbols except _main\n",
+        DEFAULT_INSTRUCTIONS, DEFAULT_FUNC_SIZE);
+}
+
+static int
+ParseArchs(
+    const char* inList,
+    Options*    ioOpts)
+{
+    char    list[256];
+    char*   name;
+
+    strncpy(list, inList, sizeof(list) - 1);
+    list[sizeof(list) - 1]  = 0;
+    ioOpts->numArchs        = 0;
+
+    for (name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+        uint32_t    i;
+
+        for (i = 0; i < NUM_KNOWN_ARCHS; i++)
+            if (!strcmp(name, gArchs[i].name))
+                break;
+
+        if (i == NUM_KNOWN_ARCHS || ioOpts->numArchs == MAX_ARCHS)
+        {
+            fprintf(stderr, "machogen: bad architecture: %s\n", name);
+            return 0;
+        }
+
+        ioOpts->archs[ioOpts->numArchs++]   = &gArchs[i];
+    }
+
+    return ioOpts->numArchs != 0;
+}
+
+int
+main(
+    int     argc,
+    char**  argv)
+{
+    Options opts    = {{&gArchs[2]}, 1, DEFAULT_INSTRUCTIONS,
+        DEFAULT_FUNC_SIZE, 0, 0, 0, 1, NULL};
+    int     i;
+
+    for (i = 1; i < argc; i++)
+    {
+        const char* arg     = argv[i];
+        const char* value   = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "-arch") && value)
+        {
+            if (!ParseArchs(value, &opts))
+                return 1;
+
+            i++;
+        }
+        else if (!strcmp(arg, "-n") && value)
+            opts.numInstructions    = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(arg, "-f") && value)
+            opts.funcSize   = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(arg, "-seed") && value)
+            opts.seed       = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(arg, "-o") && value)
+            opts.outPath    = argv[++i];
+        else if (!strcmp(arg, "-objc1"))
+            opts.objcVersion    = 1;
+        else if (!strcmp(arg, "-objc2"))
+            opts.objcVersion    = 2;
+        else if (!strcmp(arg, "-cxx"))
+            opts.cplusplus  = 1;
+        else if (!strcmp(arg, "-strip"))
+            opts.stripped   = 1;
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if (!opts.outPath || opts.funcSize < 2)
+    {
+        Usage();
+        return 1;
+    }
+
+    FILE*   outFile = fopen(opts.outPath, "wb");
+
+    if (!outFile)
+    {
+        perror("machogen: unable to open output file");
+        return 1;
+    }
+
+    Slice   slices[MAX_ARCHS];
+    Buffer  fatHeader   = {NULL, 0, 0};
+    int     fat         = (opts.numArchs > 1);
+    uint32_t    offset  = 0;
+    uint32_t    s;
+
+    for (s = 0; s < opts.numArchs; s++)
+        MakeSlice(&slices[s], opts.archs[s], &opts);
+
+    // fat_header and fat_arch's are always big-endian.
+    if (fat)
+    {
+        PutU32(&fatHeader, FAT_MAGIC, 1);
+        PutU32(&fatHeader, opts.numArchs, 1);
+        offset  = RoundUp(8 + 20 * opts.numArchs, PAGE_SIZE);
+
+        for (s = 0; s < opts.numArchs; s++)
+        {
+            PutU32(&fatHeader, slices[s].arch->cpuType, 1);
+            PutU32(&fatHeader, slices[s].arch->cpuSubtype, 1);
+            PutU32(&fatHeader, offset, 1);
+            PutU32(&fatHeader, slices[s].image.length, 1);
+            PutU32(&fatHeader, 12, 1);      // 2^12
+            offset  = RoundUp(offset + slices[s].image.length, PAGE_SIZE);
+        }
+    }
+
+    for (s = 0; s < opts.numArchs; s++)
+    {
+        Buffer* image   = &slices[s].image;
+
+        if (fat)
+        {
+            AlignBuffer(&fatHeader, PAGE_SIZE, 0);
+            PutBytes(&fatHeader, image->bytes, image->length);
+        }
+        else if (fwrite(image->bytes, 1, image->length, outFile) !=
+            image->length)
+        {
+            perror("machogen: unable to write output file");
+            return 1;
+        }
+    }
+
+    if (fat && fwrite(fatHeader.bytes, 1, fatHeader.length, outFile) !=
+        fatHeader.length)
+    {
+        perror("machogen: unable to write output file");
+        return 1;
+    }
+
+    if (fclose(outFile) != 0)
+    {
+        perror("machogen: unable to close output file");
+        return 1;
+    }
+
+    for (s = 0; s < opts.numArchs; s++)
+        FreeSlice(&slices[s]);
+
+    free(fatHeader.bytes);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+#!/bin/sh
+#
+#   run.sh
+#
+#   Benchmarks otx against the synthetic corpus in corpus.txt. Builds
+#   machogen, generates any missing images, runs 'otx -debug-json' on each
+#   corpus entry and reports lines/sec, peak RSS and per-phase times. With
+#   baselines.txt present, exits 1 if any entry is slower or bigger than its
+#   baseline by more than the tolerance.
+#
+#   Usage: run.sh [-otx <path>] [-size <small,medium,large>] [-runs <n>]
+#                 [-tolerance <percent>] [-record]
+#
+#       -otx        the otx to test, default 'otx' in $PATH
+#       -size       size classes to run, default small,medium
+#       -runs       runs per entry, the best is kept, default 3
+#       -tolerance  allowed regression in percent, default 10
+#       -record     write the results to baselines.txt instead of comparing
+#
+#   Images and logs go in $OTX_BENCH_WORK, default $TMPDIR/otx-bench. Nothing
+#   needs the network.
+#
+#   This file is in the public domain.
+#
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+. "$BENCH_DIR/common.sh"
+
+BASELINES=$BENCH_DIR/baselines.txt
+
+OTX=otx
+SIZES=small,medium
+RUNS=3
+TOLERANCE=10
+RECORD=0
+
+usage()
+{
+    sed -n '/^#   Usage/,/^#   Images/p' "$0" | sed '$d' | cut -c2- >&2
+    exit 1
+}
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        -otx)       OTX=$2; shift ;;
+        -size)      SIZES=$2; shift ;;
+        -runs)      RUNS=$2; shift ;;
+        -tolerance) TOLERANCE=$2; shift ;;
+        -record)    RECORD=1 ;;
+        *)          usage ;;
+    esac
+    shift
+done
+
+build_machogen || exit 1
+
+# Peak RSS comes from time(1), whose flags and units differ.
+if /usr/bin/time -l true >/dev/null 2>&1; then
+    TIME="/usr/bin/time -l"     # BSD, bytes
+elif /usr/bin/time -v true >/dev/null 2>&1; then
+    TIME="/usr/bin/time -v"     # GNU, kilobytes
+else
+    TIME=""
+fi
+
+# peak_rss <time output>, in kilobytes
+peak_rss()
+{
+    awk '/maximum resident set size/ { print int($1 / 1024); exit }
+         /Maximum resident set size/ { print $NF; exit }' "$1"
+}
+
+# json_field <json> <key>, a number
+json_field()
+{
+    echo "$1" | sed -n "s/.*\"$2\":\([0-9.]*\).*/\1/p"
+}
+
+# phase_times <json>, "name=ms ..." and the total on the last line
+phase_times()
+{
+    echo "$1" | sed 's/.*"phases_ms":{\([^}]*\)}.*/\1/' | tr ',' '\n' |
+        awk -F: '{ gsub(/"/, "", $1); total += $2; printf "%s=%s ", $1, $2 }
+                 END { printf "\n%.3f\n", total }'
+}
+
+# baseline <key> <field>
+baseline()
+{
+    [ -f "$BASELINES" ] &&
+        awk -v key="$1" -v field="$2" '$1 == key { print $field; exit }' \
+            "$BASELINES"
+}
+
+RESULTS=$WORK_DIR/results.txt
+STATUS=0
+
+: > "$RESULTS"
+rm -f "$WORK_DIR/regressions.txt"
+printf "%-30s %12s %12s %10s\n" "entry" "lines" "lines/sec" "peak KB"
+
+corpus_entries "$SIZES" |
+while read IMAGE ARCH SIZE GENARGS; do
+    IMAGE_PATH=$(make_image "$IMAGE" $GENARGS) || exit 1
+    KEY=$IMAGE/$ARCH
+
+    BEST_RATE=0
+    BEST_RSS=0
+    BEST_PHASES=""
+    LINES=0
+    RUN=0
+
+    while [ $RUN -lt "$RUNS" ]; do
+        RUN=$((RUN + 1))
+        LOG=$WORK_DIR/$IMAGE-$ARCH.log
+
+        if ! $TIME "$OTX" -debug-json -arch "$ARCH" "$IMAGE_PATH" \
+            > /dev/null 2> "$LOG"; then
+            echo "otx failed on $KEY, see $LOG" >&2
+            echo "$KEY failed" >> "$RESULTS"
+            continue 2
+        fi
+
+        JSON=$(grep '^{' "$LOG" | tail -n 1)
+        LINES=$(json_field "$JSON" lines)
+        PHASES=$(phase_times "$JSON")
+        TOTAL_MS=$(echo "$PHASES" | tail -n 1)
+        RATE=$(awk -v l="$LINES" -v ms="$TOTAL_MS" \
+            'BEGIN { print (ms > 0) ? int(l * 1000 / ms) : 0 }')
+        RSS=$(peak_rss "$LOG")
+        RSS=${RSS:-0}
+
+        if [ "$RATE" -gt "$BEST_RATE" ]; then
+            BEST_RATE=$RATE
+            BEST_PHASES=$(echo "$PHASES" | head -n 1)
+        fi
+
+        if [ "$BEST_RSS" -eq 0 ] || [ "$RSS" -lt "$BEST_RSS" ]; then
+            BEST_RSS=$RSS
+        fi
+    done
+
+    printf "%-30s %12s %12s %10s\n" "$KEY" "$LINES" "$BEST_RATE" "$BEST_RSS"
+    echo "    $BEST_PHASES"
+    echo "$KEY $BEST_RATE $BEST_RSS" >> "$RESULTS"
+
+    if [ $RECORD -eq 0 ]; then
+        BASE_RATE=$(baseline "$KEY" 2)
+        BASE_RSS=$(baseline "$KEY" 3)
+
+        if [ -n "$BASE_RATE" ]; then
+            awk -v rate="$BEST_RATE" -v rss="$BEST_RSS" \
+                -v brate="$BASE_RATE" -v brss="$BASE_RSS" -v tol="$TOLERANCE" \
+                'BEGIN {
+                    if (rate < brate * (1 - tol / 100))
+                        printf "    REGRESSION: %d lines/sec, baseline %d\n",
+                            rate, brate
+                    if (rss > 0 && brss > 0 && rss > brss * (1 + tol / 100))
+                        printf "    REGRESSION: %d KB peak, baseline %d\n",
+                            rss, brss
+                }' | tee -a "$WORK_DIR/regressions.txt"
+        fi
+    fi
+done
+
+if [ $RECORD -eq 1 ]; then
+    {
+        echo "# entry lines/sec peak-KB, written by 'run.sh -record' on $(uname -m)"
+        grep -v ' failed$' "$RESULTS"
+    } > "$BASELINES"
+    echo "wrote $BASELINES"
+fi
+
+# The loop ran in a subshell, so regressions are counted after it.
+if [ -s "$WORK_DIR/regressions.txt" ] || grep -q ' failed$' "$RESULTS"; then
+    STATUS=1
+fi
+
+rm -f "$WORK_DIR/regressions.txt"
+exit $STATUS
@@ -12,8 +12,6 @@
     #import <AppKit/NSApplication.h>
 #endif
 
-BOOL gCancel = NO;
-
 int main(
     int     argc,
     char*   argv[])
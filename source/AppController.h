@@ -8,7 +8,7 @@
 
 #import "DropBox.h"
 #import "ErrorReporter.h"
-#import "ProgressReporter.h"
+#import "ProcessingJob.h"
 
 #define kOutputTextTag      100
 #define kOutputFileBaseTag  200
@@ -73,7 +73,7 @@ CPUID;
 
 // ============================================================================
 
-@interface AppController : NSObject<ProgressReporter, ErrorReporter, NSAnimationDelegate, NSToolbarDelegate>
+@interface AppController : NSObject<ErrorReporter, NSAnimationDelegate, NSToolbarDelegate>
 {
 @private
 // main window
@@ -107,7 +107,6 @@ CPUID;
     BOOL                    iFileIsValid;
     BOOL                    iIgnoreArch;
     BOOL                    iExeIsFat;
-    BOOL                    iProcessing;
     NSString*               iExeName;
     NSString*               iOutputFileLabel;
     NSString*               iOutputFileName;
@@ -116,7 +115,14 @@ CPUID;
     NSUInteger              iPrefsCurrentViewIndex;
     host_basic_info_data_t  iHostInfo;
     NSShadow*               iTextShadow;
-    NSTimer*                iIndeterminateProgBarMainThreadTimer;
+    NSTimer*                iProgressTimer;
+
+// processing
+    NSMutableArray*         iJobs;              // ProcessingJobs, in order
+    NSUInteger              iNumRunningJobs;
+    NSUInteger              iMaxRunningJobs;
+    BOOL                    iProgViewShown;
+    float                   iJobRowHeight;
 }
 
 // main window
@@ -129,11 +135,13 @@ CPUID;
 - (IBAction)attemptToProcessFile: (id)sender;
 - (IBAction)cancel: (id)sender;
 - (void)processFile;
-- (void)continueProcessingFile;
+- (void)getProcOptions: (ProcOptions*)outOpts;
+- (void)startJobs;
+- (void)layOutJobRows;
+- (void)processingJobDidFinish: (ProcessingJob*)inJob;
 - (void)adjustInterfaceForMultiThread;
 - (void)adjustInterfaceForSingleThread;
-- (void)processingThreadDidFinish: (NSString*)result;
-- (void)nudgeIndeterminateProgBar: (NSTimer*)timer;
+- (void)sampleProgress: (NSTimer*)timer;
 
 - (IBAction)thinFile: (id)sender;
 - (IBAction)verifyNops: (id)sender;
@@ -148,6 +156,7 @@ CPUID;
             returnCode: (int)returnCode
            contextInfo: (void*)contextInfo;
 - (void)showProgView;
+- (void)progViewDidShow;
 - (void)hideProgView: (BOOL)inAnimate
             openFile: (BOOL)inOpenFile;
 
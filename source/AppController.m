@@ -10,7 +10,9 @@
 #import "SystemIncludes.h"
 
 #import "AppController.h"
+#import "FunctionFilter.h"
 #import "ListUtils.h"
+#import "OutputFile.h"
 #import "PPCProcessor.h"
 #import "PPC64Processor.h"
 #import "SmoothViewAnimation.h"
@@ -24,8 +26,6 @@
 #define CONTENT_BORDER_SIZE_BOTTOM      10
 #define CONTENT_BORDER_MARGIN_BOTTOM    4
 
-#define PROCESS_SUCCESS @"PROCESS_SUCCESS"
-
 @implementation AppController
 
 //  initialize
@@ -38,6 +38,7 @@
     NSDictionary*               theValues       =
         [NSDictionary dictionaryWithObjectsAndKeys:
         @"1",       AskOutputDirKey,
+        @"NO",      CompressOutputKey,
         @"YES",     DemangleCppNamesKey,
         @"NO",      EntabOutputKey,
         @"YES",     OpenOutputFileKey,
@@ -52,6 +53,8 @@
         @"YES",     ShowMethodReturnTypesKey,
         @"YES",     ShowReturnStatementsKey,
         @"0",       UseCustomNameKey,
+        @"NO",      UseFunctionCacheKey,
+        @"NO",      UseResultCacheKey,
         @"YES",     VerboseMsgSendsKey,
         nil];
 
@@ -67,6 +70,9 @@
     if ((self = [super init]) == nil)
         return nil;
 
+    iJobs           = [[NSMutableArray alloc] init];
+    iMaxRunningJobs = 1;
+
     return self;
 }
 
@@ -96,8 +102,11 @@
     if (iPrefsViews)
         free(iPrefsViews);
 
-    if (iIndeterminateProgBarMainThreadTimer)
-        [iIndeterminateProgBarMainThreadTimer release];
+    if (iProgressTimer)
+        [iProgressTimer release];
+
+    if (iJobs)
+        [iJobs release];
 
     [super dealloc];
 }
@@ -269,6 +278,17 @@
     // resizes the window, which results in our delegate saving the day.
     [self hideProgView: NO openFile: NO];
 
+    // The prog view's controls in the nib are the template for each job's
+    // row, and the prog view grows by one of them for each job.
+    iJobRowHeight   = [iProgView frame].size.height;
+
+    NSEnumerator*   templateControls    =
+        [[iProgView subviews] objectEnumerator];
+    NSView*         templateControl;
+
+    while ((templateControl = [templateControls nextObject]))
+        [templateControl setHidden: YES];
+
     [iMainWindow setFrameAutosaveName: [iMainWindow title]];
 //    [iArchPopup selectItemWithTag: iSelectedArchCPUType];
 }
@@ -357,22 +377,6 @@
 
 - (IBAction)attemptToProcessFile: (id)sender
 {
-    gCancel = NO;    // Fresh start.
-
-    NSTimeInterval interval = 0.0333;
-
-    if (OS_IS_PRE_SNOW)
-        interval = 0.0;
-
-    if (iIndeterminateProgBarMainThreadTimer)
-    {
-        [iIndeterminateProgBarMainThreadTimer invalidate];
-    }
-
-    iIndeterminateProgBarMainThreadTimer = [NSTimer scheduledTimerWithTimeInterval: interval
-        target: self selector: @selector(nudgeIndeterminateProgBar:)
-        userInfo: nil repeats: YES];
-
     if (!iObjectFile)
     {
         fprintf(stderr, "otx: [AppController attemptToProcessFile]: "
@@ -420,17 +424,11 @@
 
 //  processFile
 // ----------------------------------------------------------------------------
+//  Queue a job for the current file. Jobs run in order, iMaxRunningJobs at
+//  a time, and the rest wait their turn in iJobs.
 
 - (void)processFile
 {
-    NSDictionary*   progDict    = [[NSDictionary alloc] initWithObjectsAndKeys:
-        [NSNumber numberWithBool: YES], PRIndeterminateKey,
-        @"Loading executable", PRDescriptionKey,
-        nil];
-
-    [self reportProgress: progDict];
-    [progDict release];
-
     if ([self checkOtool: [iObjectFile path]] == NO)
     {
         [self reportError: @"otool was not found."
@@ -438,53 +436,53 @@
         return;
     }
 
-    iProcessing = YES;
-    [self adjustInterfaceForMultiThread];
-    [self showProgView];
-}
+    ProcOptions opts;
 
-//  continueProcessingFile
-// ----------------------------------------------------------------------------
+    [self getProcOptions: &opts];
 
-- (void)continueProcessingFile
-{
-    NSAutoreleasePool*  pool        = [[NSAutoreleasePool alloc] init];
-    Class               procClass   = nil;
-
-    switch (iSelectedArchCPUType)
-    {
-        case CPU_TYPE_POWERPC:
-            procClass = [PPCProcessor class];
-            break;
+    // No UI for the filters yet, set with 'defaults write'.
+    ProcessingJob*  theJob  = [[ProcessingJob alloc] initWithFile: iObjectFile
+        outputPath: iOutputFilePath exeName: iExeName
+        cpuType: iSelectedArchCPUType options: &opts
+        functionFilters: [[NSUserDefaults standardUserDefaults]
+        stringArrayForKey: FunctionFiltersKey]
+        delegate: self];
 
-        case CPU_TYPE_POWERPC64:
-            procClass = [PPC64Processor class];
-            break;
+    [theJob rowLike: iProgView];
+    [iJobs addObject: theJob];
+    [theJob release];
 
-        case CPU_TYPE_I386:
-            procClass = [X86Processor class];
-            break;
+    if (!iProgressTimer)
+    {
+        NSTimeInterval interval = 0.0333;
 
-        case CPU_TYPE_X86_64:
-            procClass = [X8664Processor class];
-            break;
+        if (OS_IS_PRE_SNOW)
+            interval = 0.0;
 
-        default:
-            fprintf(stderr, "otx: [AppController continueProcessingFile]: "
-                "unknown arch type: %d", iSelectedArchCPUType);
-            break;
+        iProgressTimer = [NSTimer scheduledTimerWithTimeInterval: interval
+            target: self selector: @selector(sampleProgress:)
+            userInfo: nil repeats: YES];
     }
 
-    if (!procClass)
+    if ([iJobs count] == 1)
     {
-        [self performSelectorOnMainThread: @selector(processingThreadDidFinish:)
-                               withObject: @"Unsupported architecture."
-                            waitUntilDone: NO];
-        [pool release];
-        return;
+        [self adjustInterfaceForMultiThread];
+        [self showProgView];
+    }
+    else
+    {
+        [self layOutJobRows];
+        [self startJobs];
     }
+}
+
+//  getProcOptions:
+// ----------------------------------------------------------------------------
+//  Save defaults into a ProcOptions struct. Each job gets its own copy, so
+//  changing prefs doesn't affect jobs already queued.
 
-    // Save defaults into the ProcOptions struct.
+- (void)getProcOptions: (ProcOptions*)outOpts
+{
     NSUserDefaults* theDefaults = [NSUserDefaults standardUserDefaults];
     ProcOptions     opts        = {0};
 
@@ -508,77 +506,157 @@
         [theDefaults boolForKey: ShowIvarTypesKey];
     opts.returnStatements       =
         [theDefaults boolForKey: ShowReturnStatementsKey];
+    opts.resultCache            =
+        [theDefaults boolForKey: UseResultCacheKey];
+    opts.functionCache          =
+        [theDefaults boolForKey: UseFunctionCacheKey];
+    opts.compressOutput         =
+        [theDefaults boolForKey: CompressOutputKey];
+
+    *outOpts    = opts;
+}
 
-    id  theProcessor    = [[procClass alloc] initWithURL: iObjectFile
-        controller: self options: &opts];
+//  startJobs
+// ----------------------------------------------------------------------------
+//  Start queued jobs in order while there are free CPUs.
 
-    if (!theProcessor)
+- (void)startJobs
+{
+    if (!iProgViewShown)
+        return;
+
+    NSUInteger  i;
+    NSUInteger  numJobs = [iJobs count];
+
+    for (i = 0; i < numJobs && iNumRunningJobs < iMaxRunningJobs; i++)
     {
-        [self performSelectorOnMainThread: @selector(processingThreadDidFinish:)
-                               withObject: @"Unable to create processor."
-                            waitUntilDone: NO];
-        [pool release];
+        ProcessingJob*  theJob  = [iJobs objectAtIndex: i];
+
+        if ([theJob isStarted])
+            continue;
+
+        [theJob start];
+        iNumRunningJobs++;
+    }
+}
+
+//  layOutJobRows
+// ----------------------------------------------------------------------------
+//  Resize the prog view to fit one row per job, oldest on top, growing or
+//  shrinking the window to match.
+
+- (void)layOutJobRows
+{
+    NSUInteger  numJobs = [iJobs count];
+
+    if (!iProgViewShown || numJobs == 0)
         return;
+
+    NSRect  progViewFrame   = [iProgView frame];
+    float   delta           = (numJobs * iJobRowHeight) -
+        progViewFrame.size.height;
+
+    if (delta != 0.0f)
+    {
+        NSRect  targetWindowFrame   = [iMainWindow frame];
+        NSSize  maxSize             = [iMainWindow contentMaxSize];
+        NSSize  minSize             = [iMainWindow contentMinSize];
+
+        targetWindowFrame.origin.y      -= delta;
+        targetWindowFrame.size.height   += delta;
+        maxSize.height                  += delta;
+        minSize.height                  += delta;
+
+        // Save the resize masks and apply new ones.
+        NSUInteger  origMainViewMask    = [iMainView autoresizingMask];
+        NSUInteger  origProgViewMask    = [iProgView autoresizingMask];
+
+        [iMainView setAutoresizingMask: NSViewMinYMargin];
+        [iProgView setAutoresizingMask: NSViewHeightSizable];
+
+        // Loosen the size limit in our way first.
+        if (delta > 0.0f)
+            [iMainWindow setContentMaxSize: maxSize];
+        else
+            [iMainWindow setContentMinSize: minSize];
+
+        [iMainWindow setFrame: targetWindowFrame display: YES animate: YES];
+
+        if (delta > 0.0f)
+            [iMainWindow setContentMinSize: minSize];
+        else
+            [iMainWindow setContentMaxSize: maxSize];
+
+        [iMainView setAutoresizingMask: origMainViewMask];
+        [iProgView setAutoresizingMask: origProgViewMask];
     }
 
-    if (![theProcessor processExe: iOutputFilePath])
+    NSUInteger  i;
+
+    for (i = 0; i < numJobs; i++)
     {
-        NSString* resultString = (gCancel == YES) ? PROCESS_SUCCESS :
-            [NSString stringWithFormat: @"Unable to process %@.", [iObjectFile path]];
-
-        [self performSelectorOnMainThread: @selector(processingThreadDidFinish:)
-                               withObject: resultString
-                            waitUntilDone: NO];
-        [theProcessor release];
-        [pool release];
-        return;
+        NSView* theRow  = [[iJobs objectAtIndex: i] rowView];
+
+        [theRow setFrameOrigin:
+            NSMakePoint(0.0f, (numJobs - i - 1) * iJobRowHeight)];
+
+        if ([theRow superview] != iProgView)
+            [iProgView addSubview: theRow];
     }
 
-    [self performSelectorOnMainThread: @selector(processingThreadDidFinish:)
-                           withObject: PROCESS_SUCCESS
-                        waitUntilDone: NO];
-    [theProcessor release];
-    [pool release];
+    [iProgView setNeedsDisplay: YES];
 }
 
-//  processingThreadDidFinish:
+//  processingJobDidFinish:
 // ----------------------------------------------------------------------------
+//  Sent by a job when its thread finishes, or when it's cancelled before
+//  starting.
 
-- (void)processingThreadDidFinish: (NSString*)result
+- (void)processingJobDidFinish: (ProcessingJob*)inJob
 {
-    iProcessing = NO;
-    [iIndeterminateProgBarMainThreadTimer invalidate];
-    iIndeterminateProgBarMainThreadTimer = nil;
+    [inJob retain];
 
-    if ([result isEqualTo: PROCESS_SUCCESS])
+    if ([inJob isStarted])
+        iNumRunningJobs--;
+
+    [[inJob rowView] removeFromSuperview];
+    [iJobs removeObjectIdenticalTo: inJob];
+
+    if ([inJob errorText])
+        [self reportError: @"Error processing file."
+               suggestion: [inJob errorText]];
+    else if ([inJob isStarted] && ![inJob isCancelled] &&
+        [[NSUserDefaults standardUserDefaults] boolForKey: OpenOutputFileKey])
+        [[NSWorkspace sharedWorkspace] openFile: [inJob outputFilePath]
+            withApplication: [[NSUserDefaults standardUserDefaults]
+            objectForKey: OutputAppKey]];
+
+    [inJob release];
+
+    if ([iJobs count] == 0)
     {
-        [self hideProgView: YES openFile: (gCancel == YES) ? NO :
-            [[NSUserDefaults standardUserDefaults]
-            boolForKey: OpenOutputFileKey]];
+        [iProgressTimer invalidate];
+        iProgressTimer  = nil;
+        iProgViewShown  = NO;
+        [self hideProgView: YES openFile: NO];
     }
     else
     {
-        [self hideProgView: YES openFile: NO];
-        [self reportError: @"Error processing file."
-               suggestion: result];
+        [self layOutJobRows];
+        [self startJobs];
     }
 }
 
-
 #pragma mark -
 //  adjustInterfaceForMultiThread
 // ----------------------------------------------------------------------------
-//  In future, we may allow the user to do more than twiddle prefs and resize
-//  the window. For now, just disable the fun stuff.
+//  More files can be queued while jobs run, so only closing the window,
+//  which would quit, is disabled.
 
 - (void)adjustInterfaceForMultiThread
 {
     [self syncSaveButton];
 
-    [iArchPopup setEnabled: NO];
-    [iThinButton setEnabled: NO];
-    [iVerifyButton setEnabled: NO];
-    [iOutputText setEnabled: NO];
     [[iMainWindow standardWindowButton: NSWindowCloseButton]
         setEnabled: NO];
 
@@ -667,14 +745,12 @@
     [newWindowItem setObject: minSizeValue
         forKey: NSXViewAnimationWindowMinSizeKey];
 
-    // Continue processing after the animation completes.
-    SEL continueSel = @selector(continueProcessingFile);
+    // Start processing after the animation completes.
+    SEL continueSel = @selector(progViewDidShow);
 
     [newWindowItem setObject:
         [NSValue value: &continueSel withObjCType: @encode(SEL)]
         forKey: NSXViewAnimationSelectorKey];
-    [newWindowItem setObject: [NSNumber numberWithBool: YES]
-        forKey: NSXViewAnimationPerformInNewThreadKey];
 
     SmoothViewAnimation*    theAnim = [[SmoothViewAnimation alloc]
         initWithViewAnimations: [NSArray arrayWithObject: newWindowItem]];
@@ -688,6 +764,16 @@
     [theAnim autorelease];
 }
 
+//  progViewDidShow
+// ----------------------------------------------------------------------------
+
+- (void)progViewDidShow
+{
+    iProgViewShown  = YES;
+    [self layOutJobRows];
+    [self startJobs];
+}
+
 //  hideProgView:
 // ----------------------------------------------------------------------------
 
@@ -1311,7 +1397,7 @@
 
 - (void)syncSaveButton
 {
-    [iSaveButton setEnabled: (iFileIsValid && !iProcessing &&
+    [iSaveButton setEnabled: (iFileIsValid &&
         [[iOutputText stringValue] length] > 0)];
 }
 
@@ -1320,7 +1406,7 @@
 
 - (IBAction)syncOutputText: (id)sender
 {
-    if (!iFileIsValid || iProcessing)
+    if (!iFileIsValid)
         return;
 
     NSUserDefaults* theDefaults = [NSUserDefaults standardUserDefaults];
@@ -1344,6 +1430,11 @@
 
     theString   = [theString stringByAppendingPathExtension: theExt];
 
+    // No UI for this one, it's set with defaults(1).
+    if ([theDefaults boolForKey: CompressOutputKey])
+        theString   = [theString stringByAppendingPathExtension:
+            COMPRESSED_OUTPUT_FILE_EXT];
+
     if (theString)
         [iOutputText setStringValue: theString];
     else
@@ -1463,26 +1554,25 @@
 //  cancel:
 // ----------------------------------------------------------------------------
 
+//  Cancel every job. Each job's row also has its own cancel button.
+
 - (IBAction)cancel: (id)sender
 {
-    NSDictionary*   progDict    = [NSDictionary dictionaryWithObjectsAndKeys:
-        [NSNumber numberWithBool: YES], PRIndeterminateKey,
-        @"Cancelling", PRDescriptionKey,
-        nil];
-
-    [self reportProgress: progDict];
+    NSArray*    theJobs = [[iJobs copy] autorelease];
 
-    gCancel = YES;
+    [theJobs makeObjectsPerformSelector: @selector(cancel:)
+        withObject: sender];
 }
 
 #pragma mark -
-//  nudgeIndeterminateProgBar:
+//  sampleProgress:
 // ----------------------------------------------------------------------------
+//  Called by iProgressTimer on the main thread. Processing threads only
+//  update their jobs' ProgressStates, and the jobs update their rows here.
 
-- (void)nudgeIndeterminateProgBar: (NSTimer*)timer
+- (void)sampleProgress: (NSTimer*)timer
 {
-    if ([iProgBar isIndeterminate])
-        [iProgBar startAnimation: self];
+    [iJobs makeObjectsPerformSelector: @selector(sampleProgress)];
 }
 
 #pragma mark -
@@ -1503,47 +1593,6 @@
     [theAlert release];
 }
 
-#pragma mark -
-#pragma mark ProgressReporter protocol
-//  reportProgress:
-// ----------------------------------------------------------------------------
-
-- (void)reportProgress: (NSDictionary*)inDict
-{
-    if (!inDict)
-    {
-        fprintf(stderr, "otx: [AppController reportProgress:] nil inDict\n");
-        return;
-    }
-
-    NSString*   description     = [inDict objectForKey: PRDescriptionKey];
-    NSNumber*   indeterminate   = [inDict objectForKey: PRIndeterminateKey];
-    NSNumber*   value           = [inDict objectForKey: PRValueKey];
-
-    if (description)
-    {
-        [iProgText setStringValue: description];
-        [self applyShadowToText: iProgText];
-    }
-
-    if (value)
-        [iProgBar setDoubleValue: [value doubleValue]];
-
-    if (indeterminate)
-        [iProgBar setIndeterminate: [indeterminate boolValue]];
-
-    // This is a workaround for the bug mentioned by Mike Ash here:
-    // http://mikeash.com/blog/pivot/entry.php?id=25 In our case, it causes
-    // the progress bar to freeze when processing more than once per launch.
-    // In other words, the first time you process an exe, everything is fine.
-    // Subsequent processing of any exe displays a retarded progress bar.
-    NSEvent*    pingUI  = [NSEvent otherEventWithType: NSApplicationDefined
-        location: NSMakePoint(0, 0) modifierFlags: 0 timestamp: 0
-        windowNumber: 0 context: nil subtype: 0 data1: 0 data2: 0];
-
-    [[NSApplication sharedApplication] postEvent: pingUI atStart: NO];
-}
-
 #pragma mark -
 #pragma mark DropBox delegates
 //  dropBox:dragDidEnter:
@@ -1552,7 +1601,7 @@
 - (NSDragOperation)dropBox: (DropBox*)inDropBox
               dragDidEnter: (id <NSDraggingInfo>)inItem
 {
-    if (inDropBox != iDropBox || iProcessing)
+    if (inDropBox != iDropBox)
         return NSDragOperationNone;
 
     NSPasteboard*   pasteBoard  = [inItem draggingPasteboard];
@@ -1643,7 +1692,7 @@
 - (BOOL)dropBox: (DropBox*)inDropBox
  didReceiveItem: (id<NSDraggingInfo>)inItem
 {
-    if (inDropBox != iDropBox || iProcessing)
+    if (inDropBox != iDropBox)
         return NO;
 
     NSURL*  theURL  = [NSURL URLFromPasteboard: [inItem draggingPasteboard]];
@@ -1920,6 +1969,8 @@
         (host_info_t)&iHostInfo, &infoCount);
 
     iSelectedArchCPUType    = iHostInfo.cpu_type;
+    iMaxRunningJobs         = (iHostInfo.avail_cpus > 0) ?
+        iHostInfo.avail_cpus : 1;
 
     if (iSelectedArchCPUType != CPU_TYPE_POWERPC    &&
         iSelectedArchCPUType != CPU_TYPE_I386)
@@ -5,6 +5,7 @@
 */
 
 #import <Cocoa/Cocoa.h>
+#import <pthread.h>
 
 #import "SharedDefs.h"
 #import "ErrorReporter.h"
@@ -28,18 +29,31 @@
 {
 @private
     NSURL*              iOFile;
+    NSURL*              iDiffOFile;     // the old build, with -diff
     cpu_type_t          iArchSelector;
     uint32_t              iFileArchMagic;
     NSString*           iExeName;
     BOOL                iVerify;
     BOOL                iShowProgress;
+    BOOL                iJSONSummary;
     ProcOptions         iOpts;
+    NSMutableArray*     iFunctionFilters;
+    NSString*           iLookupSpec;
+    NSString*           iCrossRefSpec;
+    NSString*           iLookupPath;    // with -lookup or -xref
+    ProgressState       iProgress;
+    volatile BOOL       iSampling;      // iSampler runs until this is NO
+    pthread_t           iSampler;
 }
 
 - (id)initWithArgs: (char**)argv
              count: (SInt32)argc;
 - (void)usage;
 - (void)processFile;
+- (void)diffFiles: (Class)inProcClass;
+- (void)sampleProgress;
+- (void)lookupFunction;
+- (void)lookupCrossRefs;
 - (void)verifyNops;
 - (void)newPackageFile: (NSURL*)inPackageFile;
 - (void)newOFile: (NSURL*)inOFile
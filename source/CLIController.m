@@ -10,12 +10,74 @@
 #import "SystemIncludes.h"
 
 #import "CLIController.h"
+#import "CrossRefs.h"
+#import "FunctionDiff.h"
+#import "FunctionFilter.h"
+#import "Instrumentation.h"
+#import "OutputIndex.h"
 #import "PPCProcessor.h"
 #import "PPC64Processor.h"
 #import "SysUtils.h"
 #import "X86Processor.h"
 #import "X8664Processor.h"
 
+//  SampleProgress
+// ----------------------------------------------------------------------------
+//  Body of iSampler, which prints progress to stderr while processExe: runs
+//  on the main thread.
+
+static void*
+SampleProgress(
+    void*   inController)
+{
+    [(CLIController*)inController sampleProgress];
+    return NULL;
+}
+
+//  ParseMemorySize
+// ----------------------------------------------------------------------------
+//  A -max-memory size, in megabytes unless it ends in K, M or G. Returns 0
+//  if it's not a size.
+
+static UInt64
+ParseMemorySize(
+    const char* inString)
+{
+    char*   sizeEnd = NULL;
+    UInt64  size    = strtoull(inString, &sizeEnd, 10);
+    UInt64  unit    = 1024 * 1024;
+
+    if (sizeEnd == inString)
+        return 0;
+
+    switch (*sizeEnd)
+    {
+        case 'K': case 'k':
+            unit    = 1024;
+            sizeEnd++;
+            break;
+
+        case 'M': case 'm':
+            sizeEnd++;
+            break;
+
+        case 'G': case 'g':
+            unit    = 1024 * 1024 * 1024;
+            sizeEnd++;
+            break;
+
+        default:
+            break;
+    }
+
+    if (*sizeEnd || size > UINT64_MAX / unit)
+        return 0;
+
+    return size * unit;
+}
+
+// ============================================================================
+
 @implementation CLIController
 
 //  init
@@ -76,6 +138,7 @@
 
     // Parse options.
     NSString*   origFilePath    = nil;
+    NSString*   diffFilePath    = nil;
     uint32_t      i, j;
 
     for (i = 1; i < argc; i++)
@@ -115,6 +178,105 @@
             {
                 iOpts.debugMode = YES;
             }
+            else if (!strncmp(&argv[i][1], "debug-json", 11))
+            {
+                iOpts.debugMode = YES;
+                iJSONSummary    = YES;
+            }
+            else if (!strncmp(&argv[i][1], "cache", 6))
+            {
+                iOpts.resultCache = YES;
+            }
+            else if (!strncmp(&argv[i][1], "incremental", 12))
+            {
+                iOpts.functionCache = YES;
+            }
+            else if (!strncmp(&argv[i][1], "gzip", 5))
+            {
+                iOpts.compressOutput = YES;
+            }
+            else if (!strncmp(&argv[i][1], "json", 5))
+            {
+                iOpts.jsonOutput = YES;
+            }
+            else if (!strncmp(&argv[i][1], "serial", 7))
+            {
+                iOpts.serial = YES;
+            }
+            else if (!strncmp(&argv[i][1], "max-memory", 11))
+            {
+                if (++i >= argc)
+                {
+                    [self usage];
+                    [self release];
+                    return nil;
+                }
+
+                iOpts.maxMemory = ParseMemorySize(argv[i]);
+
+                if (!iOpts.maxMemory)
+                {
+                    fprintf(stderr, "otx: bad -max-memory size: \"%s\"\n",
+                        argv[i]);
+                    [self usage];
+                    [self release];
+                    return nil;
+                }
+            }
+            else if (!strncmp(&argv[i][1], "filter", 7))
+            {
+                if (++i >= argc)
+                {
+                    [self usage];
+                    [self release];
+                    return nil;
+                }
+
+                if (!iFunctionFilters)
+                    iFunctionFilters    = [[NSMutableArray alloc] init];
+
+                [iFunctionFilters addObject: [NSString stringWithUTF8String: argv[i]]];
+            }
+            else if (!strncmp(&argv[i][1], "lookup", 7))
+            {
+                if (++i >= argc)
+                {
+                    [self usage];
+                    [self release];
+                    return nil;
+                }
+
+                if (iLookupSpec)
+                    [iLookupSpec release];
+
+                iLookupSpec = [[NSString alloc] initWithUTF8String: argv[i]];
+            }
+            else if (!strncmp(&argv[i][1], "diff", 5))
+            {
+                if (++i >= argc)
+                {
+                    [self usage];
+                    [self release];
+                    return nil;
+                }
+
+                diffFilePath    = [NSString stringWithCString: argv[i]
+                    encoding: NSMacOSRomanStringEncoding];
+            }
+            else if (!strncmp(&argv[i][1], "xref", 5))
+            {
+                if (++i >= argc)
+                {
+                    [self usage];
+                    [self release];
+                    return nil;
+                }
+
+                if (iCrossRefSpec)
+                    [iCrossRefSpec release];
+
+                iCrossRefSpec   = [[NSString alloc] initWithUTF8String: argv[i]];
+            }
             else
             {
                 for (j = 1; argv[i][j] != '\0'; j++)
@@ -182,8 +344,44 @@
         return nil;
     }
 
+    // With -lookup or -xref, the file is an earlier output file, not an
+    // executable.
+    if (iLookupSpec || iCrossRefSpec)
+    {
+        iLookupPath = [origFilePath retain];
+        return self;
+    }
+
     NSFileManager*  fileMan = [NSFileManager defaultManager];
 
+    // With -diff, find the old build's executable the same way as the new
+    // one's, below. It gets processed for the same arch.
+    if (diffFilePath)
+    {
+        if (![fileMan fileExistsAtPath: diffFilePath])
+        {
+            fprintf(stderr, "otx: No file found at %s.\n",
+                UTF8STRING(diffFilePath));
+            [self release];
+            return nil;
+        }
+
+        if ([[NSWorkspace sharedWorkspace] isFilePackageAtPath: diffFilePath])
+            [self newPackageFile: [NSURL fileURLWithPath: diffFilePath]];
+        else
+            [self newOFile: [NSURL fileURLWithPath: diffFilePath]
+                needsPath: YES];
+
+        if (!iOFile)
+        {
+            fprintf(stderr, "otx: Invalid file.\n");
+            [self release];
+            return nil;
+        }
+
+        iDiffOFile  = [iOFile retain];
+    }
+
     // Check that the file exists.
     if (![fileMan fileExistsAtPath: origFilePath])
     {
@@ -295,7 +493,12 @@
 - (void)usage
 {
     fprintf(stderr,
-        "Usage: otx [-bcdelmnoprv] [-arch <arch type>] <object file>\n"
+        "Usage: otx [-bcdelmnoprv] [-arch <arch type>] [-cache] [-incremental]\n"
+        "           [-gzip] [-json] [-debug | -debug-json] [-filter <spec>]...\n"
+        "           [-max-memory <n>] [-serial] <object file>\n"
+        "       otx -lookup <function> <output file>\n"
+        "       otx -xref <kind>:<name> <output file>\n"
+        "       otx -diff <old object file> [options] <object file>\n"
         "\t-b             separate logical blocks\n"
         "\t-c             don't show md5 checksum\n"
         "\t-d             show data sections\n"
@@ -310,6 +513,35 @@
         "\t-arch archVal  specify a single architecture in a universal binary\n"
         "\t               if not specified, the host architecture is used\n"
         "\t               allowed values: ppc, ppc64, i386, x86_64\n"
+        "\t-cache         reuse output cached from an earlier identical run,\n"
+        "\t               and Obj-C metadata from any earlier run\n"
+        "\t-incremental   reuse output of unchanged functions from an earlier\n"
+        "\t               build of the same executable\n"
+        "\t-gzip          compress the output with gzip\n"
+        "\t-json          write JSON Lines, one record per instruction,\n"
+        "\t               function, text line or data section\n"
+        "\t-filter spec   process only matching functions, may be repeated:\n"
+        "\t               0x1f00-0x2000, 0x1f00 (the function containing it),\n"
+        "\t               -[Class sel*], Class(Category), or a symbol or\n"
+        "\t               class name glob\n"
+        "\t-max-memory n  keep the memory otx holds under n, by moving lines\n"
+        "\t               to a temp file once they're done. n is in\n"
+        "\t               megabytes unless it ends in K, M or G\n"
+        "\t-serial        do everything on one thread, one otool at a time,\n"
+        "\t               as a reference for the concurrent paths\n"
+        "\t-debug         print selector counts, phase times, work counts\n"
+        "\t               and memory use to stderr when done\n"
+        "\t-debug-json    same as -debug, as one line of JSON\n"
+        "\t-lookup func   print one function from a file that otx wrote\n"
+        "\t               earlier, using its .idx index. func is an address\n"
+        "\t               in the function, or a symbol or method name glob\n"
+        "\t-xref ref      list the instructions in a file that otx wrote\n"
+        "\t               earlier that refer to something, using its .xref\n"
+        "\t               file. ref is call:, sel:, str:, class: or ivar:\n"
+        "\t               followed by a name or name glob\n"
+        "\t-diff old      print only the functions that were added, removed\n"
+        "\t               or changed since the old build, which must also\n"
+        "\t               contain the selected architecture\n"
     );
 }
 
@@ -321,9 +553,24 @@
     if (iOFile)
         [iOFile release];
 
+    if (iDiffOFile)
+        [iDiffOFile release];
+
     if (iExeName)
         [iExeName release];
 
+    if (iFunctionFilters)
+        [iFunctionFilters release];
+
+    if (iLookupSpec)
+        [iLookupSpec release];
+
+    if (iCrossRefSpec)
+        [iCrossRefSpec release];
+
+    if (iLookupPath)
+        [iLookupPath release];
+
     [super dealloc];
 }
 
@@ -383,6 +630,18 @@
 
 - (void)processFile
 {
+    if (iLookupSpec)
+    {
+        [self lookupFunction];
+        return;
+    }
+
+    if (iCrossRefSpec)
+    {
+        [self lookupCrossRefs];
+        return;
+    }
+
     if (!iOFile)
     {
         fprintf(stderr, "otx: [CLIController processFile]: "
@@ -432,6 +691,12 @@
     if (!procClass)
         return;
 
+    if (iDiffOFile)
+    {
+        [self diffFiles: procClass];
+        return;
+    }
+
     id  theProcessor    =
         [[procClass alloc] initWithURL: iOFile controller: self
         options: &iOpts];
@@ -443,15 +708,31 @@
         return;
     }
 
-    NSDictionary*   progDict    = [[NSDictionary alloc] initWithObjectsAndKeys:
-        [NSNumber numberWithBool: YES], PRIndeterminateKey,
-        @"Loading executable", PRDescriptionKey,
-        nil];
+    [theProcessor setFunctionFilters: iFunctionFilters];
+
+    ProgressReset(&iProgress);
+    ProgressBeginStage(&iProgress, LoadingStage, 0);
+
+    if (iShowProgress)
+    {
+        iSampling   = YES;
+
+        if (pthread_create(&iSampler, NULL, SampleProgress, self) != 0)
+        {
+            perror("otx: unable to create progress thread");
+            iSampling   = NO;
+        }
+    }
+
+    BOOL    processed   = [theProcessor processExe: nil];
 
-    [self reportProgress: progDict];
-    [progDict release];
+    if (iSampling)
+    {
+        iSampling   = NO;
+        pthread_join(iSampler, NULL);
+    }
 
-    if (![theProcessor processExe: nil])
+    if (!processed)
     {
         fprintf(stderr, "otx: -[CLIController processFile]: "
             "possible permission error\n");
@@ -461,12 +742,48 @@
     
     if (iOpts.debugMode)
     {
-        [theProcessor printSummary];
+        if (iJSONSummary)
+            [theProcessor printJSONSummary];
+        else
+            [theProcessor printSummary];
     }
 
     [theProcessor release];
 }
 
+//  diffFiles:
+// ----------------------------------------------------------------------------
+//  Compare the old build with iOFile. Progress isn't shown, since each
+//  build reports to its own ProgressState, see FunctionDiff.
+
+- (void)diffFiles: (Class)inProcClass
+{
+    if (!PrintFunctionDiff(inProcClass, iDiffOFile, iOFile, &iOpts,
+        iFunctionFilters, stdout))
+        fprintf(stderr, "otx: unable to compare %s with %s\n",
+            UTF8STRING([iDiffOFile path]), UTF8STRING([iOFile path]));
+}
+
+//  lookupFunction
+// ----------------------------------------------------------------------------
+//  Print one function from an existing output file, using its index.
+
+- (void)lookupFunction
+{
+    PrintIndexedFunction([iLookupPath fileSystemRepresentation],
+        UTF8STRING(iLookupSpec), stdout);
+}
+
+//  lookupCrossRefs
+// ----------------------------------------------------------------------------
+//  Print references from an existing output file's cross-references.
+
+- (void)lookupCrossRefs
+{
+    PrintCrossRefs([iLookupPath fileSystemRepresentation],
+        UTF8STRING(iCrossRefSpec), stdout);
+}
+
 //  verifyNops
 // ----------------------------------------------------------------------------
 //  Create an instance of xxxProcessor to search for obfuscated nops. If any
@@ -557,37 +874,57 @@
 }
 
 #pragma mark -
-#pragma mark ProgressReporter protocol
-//  reportProgress:
+//  sampleProgress
 // ----------------------------------------------------------------------------
+//  Print each stage as it begins, then a dot for every sample in which the
+//  stage made progress.
 
-- (void)reportProgress: (NSDictionary*)inDict
+- (void)sampleProgress
 {
-    if (!iShowProgress)
-        return;
+    ProgressSnapshot    snapshot;
+    UInt32              lastSequence    = UINT32_MAX;
+    UInt64              lastDone        = 0;
+    BOOL                sampling        = YES;
 
-    if (!inDict)
+    while (sampling)
     {
-        fprintf(stderr, "otx: [CLIController reportProgress:] nil inDict\n");
-        return;
-    }
+        // Sample once more after iSampling goes NO to catch the last stage.
+        sampling    = iSampling;
+        ProgressSample(&iProgress, &snapshot);
+
+        if (snapshot.sequence != lastSequence)
+        {
+            if (lastSequence != UINT32_MAX)
+                fprintf(stderr, "\n");
+
+            fprintf(stderr, "%s", ProgressStageDescription(snapshot.stage));
 
-    NSString*   description = [inDict objectForKey: PRDescriptionKey];
-    NSNumber*   newLine     = [inDict objectForKey: PRNewLineKey];
-    NSNumber*   value       = [inDict objectForKey: PRValueKey];
-    NSNumber*   complete    = [inDict objectForKey: PRCompleteKey];
+            if (snapshot.stage == CompleteStage)
+                fprintf(stderr, "\n");
 
-    if (newLine && [newLine boolValue])
-        fprintf(stderr, "\n");
+            lastSequence    = snapshot.sequence;
+            lastDone        = 0;
+        }
 
-    if (description)
-        fprintf(stderr, "%s", UTF8STRING(description));
+        if (snapshot.done > lastDone)
+        {
+            fprintf(stderr, ".");
+            lastDone    = snapshot.done;
+        }
+
+        if (sampling)
+            usleep(100000);
+    }
+}
 
-    if (value)
-        fprintf(stderr, ".");
+#pragma mark -
+#pragma mark ProgressReporter protocol
+//  progressState
+// ----------------------------------------------------------------------------
 
-    if (complete && [complete boolValue])
-        fprintf(stderr, "\n");
+- (ProgressState*)progressState
+{
+    return &iProgress;
 }
 
 @end
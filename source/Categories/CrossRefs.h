@@ -0,0 +1,146 @@
+/*
+    CrossRefs.h
+
+    A category on ExeProcessor that keeps what the commenting code resolves
+    along the way: the calls, selectors, strings, classes and ivars each
+    function refers to. They're written to a sidecar next to the output
+    file, "foo.txt" -> "foo.txt.xref", sorted by what is referred to, so
+    that 'otx -xref sel:initWithFrame: foo.txt' finds every sender with a
+    binary search instead of a grep.
+
+    Like the output index, the sidecar is written only when the output goes
+    to a regular file, and its header records the size of the output file
+    so that a stale one is ignored. It's not written when -incremental
+    reused functions, since their lines were never commented.
+
+    PrintCrossRefs implements 'otx -xref'.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+#define CROSS_REFS_MAGIC        0x6f747878  // 'otxx'
+#define CROSS_REFS_VERSION      1
+#define CROSS_REFS_FILE_EXT     @"xref"
+
+// Kinds of reference, in file order. The names are used by 'otx -xref'.
+enum {
+    CallRef,        // "call"
+    SelectorRef,    // "sel"
+    StringRef,      // "str"
+    ClassRef,       // "class"
+    IvarRef,        // "ivar"
+    NumCrossRefKinds
+};
+
+/*  CrossRefsHeader
+
+    The file is a header, 'numRefs' CrossRef's sorted by kind, name and
+    address, 'numFuncs' CrossRefFunction's sorted by address, and
+    'namesSize' bytes of null-terminated names, sorted so that comparing
+    name offsets compares names. All in host byte order.
+*/
+typedef struct
+{
+    uint32_t    magic;
+    uint32_t    version;
+    UInt64      outputSize;     // of the finished output file
+    uint32_t    numRefs;
+    uint32_t    numFuncs;
+    uint32_t    namesSize;
+    uint32_t    padding;
+}
+CrossRefsHeader;
+
+/*  CrossRef
+
+    One reference, from the instruction at 'address' in the function that
+    starts at 'funcAddress'. While collecting, 'nameOffset' holds a name
+    number instead.
+*/
+typedef struct
+{
+    UInt64      address;
+    UInt64      funcAddress;
+    uint32_t    kind;
+    uint32_t    nameOffset;
+}
+CrossRef;
+
+/*  CrossRefFunction
+
+    A function's name, for printing references from it.
+*/
+typedef struct
+{
+    UInt64      address;
+    uint32_t    nameOffset;
+    uint32_t    padding;
+}
+CrossRefFunction;
+
+/*  CrossRefsState
+
+    References gathered during processCodeLine:, waiting for
+    finishCrossRefs. Names are interned in 'names', and 'nameTable' is an
+    open-addressed hash table of name number + 1.
+*/
+struct CrossRefsState
+{
+    char                path[MAXPATHLEN];   // the output file
+    CrossRef*           refs;
+    uint32_t            numRefs;
+    uint32_t            maxRefs;
+    CrossRefFunction*   funcs;
+    uint32_t            numFuncs;
+    uint32_t            maxFuncs;
+    char*               names;
+    uint32_t            namesSize;
+    uint32_t            maxNamesSize;
+    uint32_t*           nameOffsets;        // by name number
+    uint32_t            numNames;
+    uint32_t            maxNames;
+    uint32_t*           nameTable;
+    uint32_t            nameTableSize;      // a power of 2
+
+    // The line being commented.
+    BOOL                haveLine;
+    UInt64              lineAddress;
+    UInt64              funcAddress;
+};
+
+// ============================================================================
+
+@interface ExeProcessor(CrossRefs)
+
+- (void)beginCrossRefs;
+- (void)beginCrossRefLine: (UInt64)inAddress
+                 function: (UInt64)inFuncAddress;
+- (void)addCrossRef: (uint32_t)inKind
+               name: (const char*)inName;
+- (void)addCrossRefForType: (UInt8)inType
+                      name: (const char*)inName;
+- (void)addCrossRefCall: (const char*)inMnemonic
+                 target: (const char*)inTarget;
+- (void)addCrossRefFunction: (UInt64)inAddress
+                       name: (const char*)inChars
+                     length: (size_t)inLength;
+- (BOOL)finishCrossRefs;
+- (void)freeCrossRefs;
+
+@end
+
+// ----------------------------------------------------------------------------
+
+NSString*
+CrossRefsPath(
+    NSString*   inOutputPath);
+
+BOOL
+PrintCrossRefs(
+    const char* inOutputPath,
+    const char* inSpec,
+    FILE*       outFile);
@@ -0,0 +1,807 @@
+/*
+    CrossRefs.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <fcntl.h>
+#import <fnmatch.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+#import "CrossRefs.h"
+#import "FunctionCache.h"
+#import "OutputIndex.h"
+
+static const char*  gCrossRefKindNames[NumCrossRefKinds]    =
+    {"call", "sel", "str", "class", "ivar"};
+
+/*  SortedName
+
+    A name and its number, for sorting the names before they're written.
+*/
+typedef struct
+{
+    const char* name;
+    uint32_t    number;
+}
+SortedName;
+
+// ----------------------------------------------------------------------------
+//  Make room for one more of inCount elements.
+
+static BOOL
+GrowArray(
+    void**      ioArray,
+    uint32_t*   ioMax,
+    uint32_t    inCount,
+    size_t      inElementSize,
+    uint32_t    inInitialMax)
+{
+    if (inCount < *ioMax)
+        return YES;
+
+    uint32_t    newMax      = (*ioMax) ? *ioMax * 2 : inInitialMax;
+    void*       newArray    = realloc(*ioArray, newMax * inElementSize);
+
+    if (!newArray)
+        return NO;
+
+    *ioArray    = newArray;
+    *ioMax      = newMax;
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+//  FNV-1a.
+
+static uint32_t
+HashName(
+    const char* inName)
+{
+    uint32_t    hash    = 2166136261U;
+
+    while (*inName)
+    {
+        hash    ^= (UInt8)*inName++;
+        hash    *= 16777619;
+    }
+
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+//  Set outNumber to inName's number, adding it if it's new. Returns NO if
+//  out of memory.
+
+static BOOL
+InternName(
+    CrossRefsState* ioState,
+    const char*     inName,
+    uint32_t*       outNumber)
+{
+    uint32_t    hash    = HashName(inName);
+    uint32_t    mask    = ioState->nameTableSize - 1;
+    uint32_t    slot;
+
+    if (ioState->nameTableSize)
+    {
+        for (slot = hash & mask; ioState->nameTable[slot];
+            slot = (slot + 1) & mask)
+        {
+            uint32_t    number  = ioState->nameTable[slot] - 1;
+
+            if (!strcmp(&ioState->names[ioState->nameOffsets[number]], inName))
+            {
+                *outNumber  = number;
+                return YES;
+            }
+        }
+    }
+
+    // Keep the table at most half full.
+    if ((ioState->numNames + 1) * 2 > ioState->nameTableSize)
+    {
+        uint32_t    newSize     = (ioState->nameTableSize) ?
+            ioState->nameTableSize * 2 : 4096;
+        uint32_t*   newTable    = calloc(newSize, sizeof(uint32_t));
+        uint32_t    i;
+
+        if (!newTable)
+            return NO;
+
+        for (i = 0; i < ioState->numNames; i++)
+        {
+            slot    = HashName(&ioState->names[ioState->nameOffsets[i]]) &
+                (newSize - 1);
+
+            while (newTable[slot])
+                slot    = (slot + 1) & (newSize - 1);
+
+            newTable[slot]  = i + 1;
+        }
+
+        if (ioState->nameTable)
+            free(ioState->nameTable);
+
+        ioState->nameTable      = newTable;
+        ioState->nameTableSize  = newSize;
+        mask                    = newSize - 1;
+    }
+
+    uint32_t    nameSize    = (uint32_t)strlen(inName) + 1;
+
+    if (ioState->namesSize + nameSize > ioState->maxNamesSize)
+    {
+        uint32_t    newMax  = (ioState->maxNamesSize) ?
+            ioState->maxNamesSize * 2 : 64 * 1024;
+
+        while (ioState->namesSize + nameSize > newMax)
+            newMax  *= 2;
+
+        char*   newNames    = realloc(ioState->names, newMax);
+
+        if (!newNames)
+            return NO;
+
+        ioState->names          = newNames;
+        ioState->maxNamesSize   = newMax;
+    }
+
+    if (!GrowArray((void**)&ioState->nameOffsets, &ioState->maxNames,
+        ioState->numNames, sizeof(uint32_t), 4096))
+        return NO;
+
+    for (slot = hash & mask; ioState->nameTable[slot]; slot = (slot + 1) & mask)
+        ;
+
+    memcpy(&ioState->names[ioState->namesSize], inName, nameSize);
+    ioState->nameOffsets[ioState->numNames] = ioState->namesSize;
+    ioState->nameTable[slot]                = ioState->numNames + 1;
+    ioState->namesSize                      += nameSize;
+    *outNumber                              = ioState->numNames++;
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+
+static int
+CrossRef_Compare(
+    const CrossRef* inRef1,
+    const CrossRef* inRef2)
+{
+    if (inRef1->kind != inRef2->kind)
+        return (inRef1->kind < inRef2->kind) ? -1 : 1;
+
+    if (inRef1->nameOffset != inRef2->nameOffset)
+        return (inRef1->nameOffset < inRef2->nameOffset) ? -1 : 1;
+
+    if (inRef1->address != inRef2->address)
+        return (inRef1->address < inRef2->address) ? -1 : 1;
+
+    if (inRef1->funcAddress != inRef2->funcAddress)
+        return (inRef1->funcAddress < inRef2->funcAddress) ? -1 : 1;
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+static int
+CrossRefFunction_Compare(
+    const CrossRefFunction* inFunc1,
+    const CrossRefFunction* inFunc2)
+{
+    if (inFunc1->address < inFunc2->address)
+        return -1;
+
+    return (inFunc1->address > inFunc2->address);
+}
+
+// ----------------------------------------------------------------------------
+
+static int
+SortedName_Compare(
+    const SortedName*   inName1,
+    const SortedName*   inName2)
+{
+    return strcmp(inName1->name, inName2->name);
+}
+
+// ----------------------------------------------------------------------------
+//  The first of inNumRefs refs whose kind is not less than inKind.
+
+static uint32_t
+FirstRefOfKind(
+    const CrossRef* inRefs,
+    uint32_t        inNumRefs,
+    uint32_t        inKind)
+{
+    uint32_t    low     = 0;
+    uint32_t    high    = inNumRefs;
+
+    while (low < high)
+    {
+        uint32_t    mid = (low + high) / 2;
+
+        if (inRefs[mid].kind < inKind)
+            low     = mid + 1;
+        else
+            high    = mid;
+    }
+
+    return low;
+}
+
+// ----------------------------------------------------------------------------
+//  The first of inNumRefs refs, sorted by name, whose name is not less
+//  than inName.
+
+static uint32_t
+FirstRefWithName(
+    const CrossRef* inRefs,
+    uint32_t        inNumRefs,
+    const char*     inNames,
+    const char*     inName)
+{
+    uint32_t    low     = 0;
+    uint32_t    high    = inNumRefs;
+
+    while (low < high)
+    {
+        uint32_t    mid = (low + high) / 2;
+
+        if (strcmp(&inNames[inRefs[mid].nameOffset], inName) < 0)
+            low     = mid + 1;
+        else
+            high    = mid;
+    }
+
+    return low;
+}
+
+// ----------------------------------------------------------------------------
+
+static void
+PrintCrossRef(
+    const CrossRef*         inRef,
+    const CrossRefFunction* inFuncs,
+    uint32_t                inNumFuncs,
+    const char*             inNames,
+    FILE*                   outFile)
+{
+    CrossRefFunction    searchKey   = {inRef->funcAddress, 0, 0};
+    CrossRefFunction*   func        = bsearch(&searchKey, inFuncs,
+        inNumFuncs, sizeof(CrossRefFunction),
+        (COMPARISON_FUNC_TYPE)CrossRefFunction_Compare);
+
+    if (func)
+        fprintf(outFile, "0x%llx\t%s\t%s\n", inRef->address,
+            &inNames[func->nameOffset], &inNames[inRef->nameOffset]);
+    else
+        fprintf(outFile, "0x%llx\t0x%llx\t%s\n", inRef->address,
+            inRef->funcAddress, &inNames[inRef->nameOffset]);
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(CrossRefs)
+
+//  beginCrossRefs
+// ----------------------------------------------------------------------------
+//  Call before the first line is processed. Does nothing unless the output
+//  goes to a regular file.
+
+- (void)beginCrossRefs
+{
+    [self freeCrossRefs];
+
+    char    outputPath[MAXPATHLEN];
+
+    if (iOutputFilePath)
+        strncpy(outputPath, [iOutputFilePath fileSystemRepresentation],
+            MAXPATHLEN - 1);
+    else if (!OutputIndexStreamPath(stdout, outputPath))
+        return;
+
+    outputPath[MAXPATHLEN - 1]  = 0;
+    iCrossRefs  = calloc(1, sizeof(CrossRefsState));
+
+    if (!iCrossRefs)
+    {
+        fprintf(stderr, "otx: not enough memory to allocate cross-references\n");
+        return;
+    }
+
+    strncpy(iCrossRefs->path, outputPath, MAXPATHLEN - 1);
+}
+
+//  beginCrossRefLine:function:
+// ----------------------------------------------------------------------------
+//  Call from processCodeLine: before the line is commented. References
+//  added from then on are from this line.
+
+- (void)beginCrossRefLine: (UInt64)inAddress
+                 function: (UInt64)inFuncAddress
+{
+    if (!iCrossRefs)
+        return;
+
+    iCrossRefs->haveLine    = YES;
+    iCrossRefs->lineAddress = inAddress;
+    iCrossRefs->funcAddress = inFuncAddress;
+}
+
+//  addCrossRef:name:
+// ----------------------------------------------------------------------------
+
+- (void)addCrossRef: (uint32_t)inKind
+               name: (const char*)inName
+{
+    if (!iCrossRefs || !iCrossRefs->haveLine || !inName || !inName[0])
+        return;
+
+    CrossRefsState* state   = iCrossRefs;
+    uint32_t        nameNumber;
+
+    if (!InternName(state, inName, &nameNumber) ||
+        !GrowArray((void**)&state->refs, &state->maxRefs, state->numRefs,
+        sizeof(CrossRef), 4096))
+    {
+        fprintf(stderr, "otx: not enough memory to grow cross-references\n");
+        [self freeCrossRefs];
+        return;
+    }
+
+    state->refs[state->numRefs++]   = (CrossRef)
+        {state->lineAddress, state->funcAddress, inKind, nameNumber};
+}
+
+//  addCrossRefForType:name:
+// ----------------------------------------------------------------------------
+//  For the comments commentForLine: finds with getPointer:type:. inName is
+//  the comment.
+
+- (void)addCrossRefForType: (UInt8)inType
+                      name: (const char*)inName
+{
+    switch (inType)
+    {
+        case PointerType:
+        case PStringType:
+        case CFStringType:
+        case NLSymType:
+        case ImpPtrType:
+        case OCStrObjectType:
+            [self addCrossRef: StringRef name: inName];
+            break;
+
+        case OCSelRefType:
+        case OCMsgRefType:
+            [self addCrossRef: SelectorRef name: inName];
+            break;
+
+        case OCClassType:
+        case OCClassRefType:
+        case OCSuperRefType:
+            [self addCrossRef: ClassRef name: inName];
+            break;
+
+        default:
+            break;
+    }
+}
+
+//  addCrossRefCall:target:
+// ----------------------------------------------------------------------------
+//  inTarget is the call's comment, or its operands if it has none.
+//  Addresses of functions are replaced with their names in
+//  finishCrossRefs.
+
+- (void)addCrossRefCall: (const char*)inMnemonic
+                 target: (const char*)inTarget
+{
+    if (!iCrossRefs)
+        return;
+
+    if (strncmp(inMnemonic, "call", 4) &&   // x86
+        strcmp(inMnemonic, "bl") && strcmp(inMnemonic, "bla"))  // ppc
+        return;
+
+    [self addCrossRef: CallRef name: inTarget];
+}
+
+//  addCrossRefFunction:name:length:
+// ----------------------------------------------------------------------------
+//  inChars is the function's name line.
+
+- (void)addCrossRefFunction: (UInt64)inAddress
+                       name: (const char*)inChars
+                     length: (size_t)inLength
+{
+    if (!iCrossRefs)
+        return;
+
+    const char* nameStart   = inChars;
+    const char* nameEnd     = inChars + inLength;
+    char        name[MAX_LINE_LENGTH];
+
+    while (nameStart < nameEnd && *nameStart == '\n')
+        nameStart++;
+
+    while (nameEnd > nameStart && nameEnd[-1] == '\n')
+        nameEnd--;
+
+    if (nameEnd > nameStart && nameEnd[-1] == ':')
+        nameEnd--;
+
+    if (nameEnd == nameStart || nameEnd - nameStart >= MAX_LINE_LENGTH)
+        return;
+
+    memcpy(name, nameStart, nameEnd - nameStart);
+    name[nameEnd - nameStart]   = 0;
+
+    CrossRefsState* state   = iCrossRefs;
+    uint32_t        nameNumber;
+
+    if (!InternName(state, name, &nameNumber) ||
+        !GrowArray((void**)&state->funcs, &state->maxFuncs, state->numFuncs,
+        sizeof(CrossRefFunction), 1024))
+    {
+        fprintf(stderr, "otx: not enough memory to grow cross-references\n");
+        [self freeCrossRefs];
+        return;
+    }
+
+    state->funcs[state->numFuncs++] = (CrossRefFunction)
+        {inAddress, nameNumber, 0};
+}
+
+//  finishCrossRefs
+// ----------------------------------------------------------------------------
+//  Call once the output file is complete. Writes to a temp file first so
+//  that readers never see a partial file. Failing to write it is not an
+//  error.
+
+- (BOOL)finishCrossRefs
+{
+    if (!iCrossRefs)
+        return YES;
+
+    CrossRefsState* state       = iCrossRefs;
+    NSString*       xrefPath    = CrossRefsPath(NSSTRING(state->path));
+    struct stat     fileStats;
+    uint32_t        i;
+
+    // Functions reused from the function cache were never commented, so
+    // there'd be holes. Better none than an incomplete one.
+    if ((iFuncCache && iFuncCache->numReused) ||
+        stat(state->path, &fileStats) != 0)
+    {
+        unlink([xrefPath fileSystemRepresentation]);
+        [self freeCrossRefs];
+        return YES;
+    }
+
+    qsort(state->funcs, state->numFuncs, sizeof(CrossRefFunction),
+        (COMPARISON_FUNC_TYPE)CrossRefFunction_Compare);
+
+    // Name calls to functions by address after the function.
+    for (i = 0; i < state->numRefs; i++)
+    {
+        const char* name    =
+            &state->names[state->nameOffsets[state->refs[i].nameOffset]];
+
+        if (state->refs[i].kind != CallRef || strncmp(name, "0x", 2))
+            continue;
+
+        CrossRefFunction    searchKey   = {strtoull(name, NULL, 16), 0, 0};
+        CrossRefFunction*   func        = bsearch(&searchKey, state->funcs,
+            state->numFuncs, sizeof(CrossRefFunction),
+            (COMPARISON_FUNC_TYPE)CrossRefFunction_Compare);
+
+        if (func)
+            state->refs[i].nameOffset   = func->nameOffset;
+    }
+
+    // Write the names in order, so that refs sort by name offset.
+    SortedName* sortedNames = malloc(state->numNames * sizeof(SortedName));
+    char*       names       = malloc(state->namesSize);
+    uint32_t*   newOffsets  = malloc(state->numNames * sizeof(uint32_t));
+    uint32_t    namesSize   = 0;
+
+    if ((state->numNames && (!sortedNames || !newOffsets)) ||
+        (state->namesSize && !names))
+    {
+        fprintf(stderr, "otx: not enough memory to sort cross-references\n");
+
+        if (sortedNames)
+            free(sortedNames);
+
+        if (names)
+            free(names);
+
+        if (newOffsets)
+            free(newOffsets);
+
+        unlink([xrefPath fileSystemRepresentation]);
+        [self freeCrossRefs];
+        return YES;
+    }
+
+    for (i = 0; i < state->numNames; i++)
+        sortedNames[i]  = (SortedName)
+            {&state->names[state->nameOffsets[i]], i};
+
+    qsort(sortedNames, state->numNames, sizeof(SortedName),
+        (COMPARISON_FUNC_TYPE)SortedName_Compare);
+
+    for (i = 0; i < state->numNames; i++)
+    {
+        size_t  nameSize    = strlen(sortedNames[i].name) + 1;
+
+        memcpy(&names[namesSize], sortedNames[i].name, nameSize);
+        newOffsets[sortedNames[i].number]   = namesSize;
+        namesSize                           += nameSize;
+    }
+
+    free(sortedNames);
+
+    for (i = 0; i < state->numRefs; i++)
+        state->refs[i].nameOffset   = newOffsets[state->refs[i].nameOffset];
+
+    for (i = 0; i < state->numFuncs; i++)
+        state->funcs[i].nameOffset  = newOffsets[state->funcs[i].nameOffset];
+
+    free(newOffsets);
+    free(state->names);
+    state->names        = names;
+    state->namesSize    = namesSize;
+
+    // Sort, and drop references found twice on the same line.
+    qsort(state->refs, state->numRefs, sizeof(CrossRef),
+        (COMPARISON_FUNC_TYPE)CrossRef_Compare);
+
+    uint32_t    numRefs = 0;
+
+    for (i = 0; i < state->numRefs; i++)
+        if (!numRefs || CrossRef_Compare(&state->refs[i],
+            &state->refs[numRefs - 1]) != 0)
+            state->refs[numRefs++]  = state->refs[i];
+
+    state->numRefs  = numRefs;
+
+    char    tempPath[MAXPATHLEN];
+
+    snprintf(tempPath, MAXPATHLEN, "%s.XXXXXX",
+        [xrefPath fileSystemRepresentation]);
+
+    int fd  = mkstemp(tempPath);
+
+    if (fd == -1)
+    {
+        perror("otx: unable to create cross-references");
+        [self freeCrossRefs];
+        return YES;
+    }
+
+    FILE*           xrefFile    = fdopen(fd, "w");
+    CrossRefsHeader header      =
+        {CROSS_REFS_MAGIC, CROSS_REFS_VERSION, fileStats.st_size,
+        state->numRefs, state->numFuncs, state->namesSize, 0};
+    BOOL            written     = NO;
+
+    if (xrefFile)
+    {
+        written = fwrite(&header, sizeof(header), 1, xrefFile) == 1 &&
+            fwrite(state->refs, sizeof(CrossRef),
+                state->numRefs, xrefFile) == state->numRefs &&
+            fwrite(state->funcs, sizeof(CrossRefFunction),
+                state->numFuncs, xrefFile) == state->numFuncs &&
+            fwrite(state->names, 1, state->namesSize, xrefFile) ==
+                state->namesSize;
+
+        if (fclose(xrefFile) != 0)
+            written = NO;
+    }
+    else
+        close(fd);
+
+    if (!written || rename(tempPath, [xrefPath fileSystemRepresentation]) != 0)
+    {
+        perror("otx: unable to write cross-references");
+        unlink(tempPath);
+    }
+
+    [self freeCrossRefs];
+
+    return YES;
+}
+
+//  freeCrossRefs
+// ----------------------------------------------------------------------------
+
+- (void)freeCrossRefs
+{
+    if (!iCrossRefs)
+        return;
+
+    if (iCrossRefs->refs)
+        free(iCrossRefs->refs);
+
+    if (iCrossRefs->funcs)
+        free(iCrossRefs->funcs);
+
+    if (iCrossRefs->names)
+        free(iCrossRefs->names);
+
+    if (iCrossRefs->nameOffsets)
+        free(iCrossRefs->nameOffsets);
+
+    if (iCrossRefs->nameTable)
+        free(iCrossRefs->nameTable);
+
+    free(iCrossRefs);
+    iCrossRefs  = NULL;
+}
+
+@end
+
+// ----------------------------------------------------------------------------
+
+NSString*
+CrossRefsPath(
+    NSString*   inOutputPath)
+{
+    return [inOutputPath stringByAppendingPathExtension: CROSS_REFS_FILE_EXT];
+}
+
+// ----------------------------------------------------------------------------
+//  Print the references that inSpec asks for, one per line: the address of
+//  the referring instruction, the function it's in, and what it refers to.
+//  inSpec is "kind:name", where the name may be a glob. Symbols match with
+//  or without their leading underscore. Returns NO if nothing was printed.
+
+BOOL
+PrintCrossRefs(
+    const char* inOutputPath,
+    const char* inSpec,
+    FILE*       outFile)
+{
+    const char* name    = strchr(inSpec, ':');
+    uint32_t    kind;
+
+    for (kind = 0; name && kind < NumCrossRefKinds; kind++)
+        if (strlen(gCrossRefKindNames[kind]) == (size_t)(name - inSpec) &&
+            !strncmp(inSpec, gCrossRefKindNames[kind], name - inSpec))
+            break;
+
+    if (!name || kind == NumCrossRefKinds || !name[1])
+    {
+        fprintf(stderr, "otx: \"%s\" should be call:, sel:, str:, class: "
+            "or ivar: followed by a name\n", inSpec);
+        return NO;
+    }
+
+    name++;
+
+    const char* xrefPath    = [CrossRefsPath(NSSTRING(inOutputPath))
+        fileSystemRepresentation];
+    struct stat outputStats;
+    struct stat xrefStats;
+    int         xrefFD      = open(xrefPath, O_RDONLY);
+
+    if (xrefFD == -1 || fstat(xrefFD, &xrefStats) != 0 ||
+        stat(inOutputPath, &outputStats) != 0 ||
+        xrefStats.st_size < (off_t)sizeof(CrossRefsHeader))
+    {
+        fprintf(stderr, "otx: no cross-references found for %s\n",
+            inOutputPath);
+
+        if (xrefFD != -1)
+            close(xrefFD);
+
+        return NO;
+    }
+
+    char*   xrefBytes   = mmap(NULL, xrefStats.st_size, PROT_READ,
+        MAP_PRIVATE, xrefFD, 0);
+
+    close(xrefFD);
+
+    if (xrefBytes == MAP_FAILED)
+    {
+        perror("otx: unable to map cross-references");
+        return NO;
+    }
+
+    CrossRefsHeader*    header  = (CrossRefsHeader*)xrefBytes;
+    CrossRef*           refs    =
+        (CrossRef*)(xrefBytes + sizeof(CrossRefsHeader));
+    CrossRefFunction*   funcs   =
+        (CrossRefFunction*)&refs[header->numRefs];
+    char*               names   =
+        (char*)&funcs[header->numFuncs];
+    uint32_t            i;
+
+    BOOL    valid   = header->magic == CROSS_REFS_MAGIC &&
+        header->version == CROSS_REFS_VERSION &&
+        (UInt64)xrefStats.st_size == sizeof(CrossRefsHeader) +
+            (UInt64)header->numRefs * sizeof(CrossRef) +
+            (UInt64)header->numFuncs * sizeof(CrossRefFunction) +
+            header->namesSize &&
+        (!header->namesSize || names[header->namesSize - 1] == 0);
+
+    for (i = 0; valid && i < header->numRefs; i++)
+        valid   = refs[i].nameOffset < header->namesSize;
+
+    for (i = 0; valid && i < header->numFuncs; i++)
+        valid   = funcs[i].nameOffset < header->namesSize;
+
+    if (!valid)
+    {
+        fprintf(stderr, "otx: invalid cross-references for %s\n",
+            inOutputPath);
+        munmap(xrefBytes, xrefStats.st_size);
+        return NO;
+    }
+
+    if (header->outputSize != (UInt64)outputStats.st_size)
+    {
+        fprintf(stderr, "otx: cross-references for %s are out of date\n",
+            inOutputPath);
+        munmap(xrefBytes, xrefStats.st_size);
+        return NO;
+    }
+
+    // The refs of this kind.
+    uint32_t    first       = FirstRefOfKind(refs, header->numRefs, kind);
+    uint32_t    last        = FirstRefOfKind(refs, header->numRefs, kind + 1);
+    uint32_t    numPrinted  = 0;
+
+    if (strpbrk(name, "*?["))
+    {
+        for (i = first; i < last; i++)
+        {
+            const char* refName = &names[refs[i].nameOffset];
+
+            if (fnmatch(name, refName, 0) != 0 &&
+                (refName[0] != '_' || fnmatch(name, refName + 1, 0) != 0))
+                continue;
+
+            PrintCrossRef(&refs[i], funcs, header->numFuncs, names, outFile);
+            numPrinted++;
+        }
+    }
+    else
+    {
+        char        underscoreName[MAX_LINE_LENGTH];
+        const char* searchNames[2]  = {name, underscoreName};
+        uint32_t    j;
+
+        snprintf(underscoreName, MAX_LINE_LENGTH, "_%s", name);
+
+        for (j = 0; j < 2; j++)
+        {
+            for (i = first + FirstRefWithName(&refs[first], last - first,
+                names, searchNames[j]); i < last &&
+                !strcmp(&names[refs[i].nameOffset], searchNames[j]); i++)
+            {
+                PrintCrossRef(&refs[i], funcs, header->numFuncs, names,
+                    outFile);
+                numPrinted++;
+            }
+        }
+    }
+
+    munmap(xrefBytes, xrefStats.st_size);
+
+    if (!numPrinted)
+        fprintf(stderr, "otx: no references match \"%s\"\n", inSpec);
+
+    return (numPrinted != 0);
+}
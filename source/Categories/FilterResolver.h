@@ -0,0 +1,27 @@
+/*
+    FilterResolver.h
+
+    A category on Exe32Processor that turns filter specs into address
+    ranges, see FunctionFilter.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "Exe32Processor.h"
+#import "FunctionFilter.h"
+
+@interface Exe32Processor(FilterResolver)
+
+- (uint32_t)copyFunctionStarts: (UInt64**)outStarts;
+- (BOOL)addressIsInText: (UInt64)inAddress;
+- (BOOL)getFunctionName: (char*)outName
+                 length: (size_t)inLength
+                address: (UInt64)inAddress;
+- (void)resolveFunctionFilters;
+- (void)addFilterRangesForMethods: (MethodPattern*)inPattern
+                           starts: (UInt64*)inStarts
+                            count: (uint32_t)inCount;
+
+@end
@@ -0,0 +1,224 @@
+/*
+    FilterResolver.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "FilterResolver.h"
+#import "ObjcAccessors.h"
+#import "Searchers.h"
+
+@implementation Exe32Processor(FilterResolver)
+
+//  resolveFunctionFilters
+// ----------------------------------------------------------------------------
+//  Call after loadLCommands and before populateLineLists.
+
+- (void)resolveFunctionFilters
+{
+    if (!iFilterSpecs)
+        return;
+
+    UInt64*     starts      = NULL;
+    uint32_t    numStarts   = [self copyFunctionStarts: &starts];
+    uint32_t    i;
+
+    if (!starts)
+        return;
+
+    NSUInteger  numSpecs    = [iFilterSpecs count];
+    NSUInteger  specIndex;
+
+    for (specIndex = 0; specIndex < numSpecs; specIndex++)
+    {
+        const char*     spec        =
+            UTF8STRING([iFilterSpecs objectAtIndex: specIndex]);
+        uint32_t        numRanges   = iNumFilterRanges;
+        AddressRange    range;
+        MethodPattern   pattern;
+
+        if ([self parseAddressRange: spec range: &range])
+        {
+            if (range.end == range.start + 1)
+                [self addFilterRangeForFunction: range.start
+                    starts: starts count: numStarts];
+            else
+                [self addFilterRange: range];
+        }
+        else if ([self parseMethodPattern: spec pattern: &pattern])
+            [self addFilterRangesForMethods: &pattern
+                starts: starts count: numStarts];
+        else
+        {   // Symbols, then classes.
+            for (i = 0; i < iNumFuncSyms; i++)
+            {
+                char*   symName = (char*)iMachHeaderPtr + iStringTableOffset +
+                    iFuncSyms[i].n_un.n_strx;
+
+                if ([self name: symName matchesPattern: spec])
+                    [self addFilterRangeForFunction: iFuncSyms[i].n_value
+                        starts: starts count: numStarts];
+            }
+
+            memset(&pattern, 0, sizeof(pattern));
+            strncpy(pattern.classPattern, spec, MAX_FILTER_PATTERN_LENGTH - 1);
+            [self addFilterRangesForMethods: &pattern
+                starts: starts count: numStarts];
+        }
+
+        if (iNumFilterRanges == numRanges)
+            fprintf(stderr, "otx: no functions match filter \"%s\"\n", spec);
+    }
+
+    free(starts);
+    [self finishFilterRanges];
+}
+
+//  copyFunctionStarts:
+// ----------------------------------------------------------------------------
+//  Every known function start, and the ends of the text sections, sorted and
+//  without duplicates. Call after loadLCommands. The caller frees
+//  *outStarts. Returns the count.
+
+- (uint32_t)copyFunctionStarts: (UInt64**)outStarts
+{
+    uint32_t    maxStarts   =
+        iNumFuncSyms + iNumClassMethodInfos + iNumCatMethodInfos + 6;
+    UInt64*     starts      = malloc(maxStarts * sizeof(UInt64));
+    uint32_t    numStarts   = 0;
+    uint32_t    i;
+
+    *outStarts  = NULL;
+
+    if (!starts)
+    {
+        fprintf(stderr, "otx: not enough memory to allocate function starts\n");
+        return 0;
+    }
+
+    for (i = 0; i < iNumFuncSyms; i++)
+        starts[numStarts++] = iFuncSyms[i].n_value;
+
+    for (i = 0; i < iNumClassMethodInfos; i++)
+        starts[numStarts++] = iClassMethodInfos[i].m.method_imp;
+
+    for (i = 0; i < iNumCatMethodInfos; i++)
+        starts[numStarts++] = iCatMethodInfos[i].m.method_imp;
+
+    section_info*   textSects[] = {&iTextSect, &iCoalTextSect, &iCoalTextNTSect};
+
+    for (i = 0; i < sizeof(textSects) / sizeof(section_info*); i++)
+    {
+        if (!textSects[i]->size)
+            continue;
+
+        starts[numStarts++] = textSects[i]->s.addr;
+        starts[numStarts++] = textSects[i]->s.addr + textSects[i]->size;
+    }
+
+    *outStarts  = starts;
+
+    return [self sortFunctionStarts: starts count: numStarts];
+}
+
+//  addressIsInText:
+// ----------------------------------------------------------------------------
+//  Whether inAddress lies in one of the sections otool disassembles. Not
+//  every start from copyFunctionStarts: does, symbols of data among them.
+
+- (BOOL)addressIsInText: (UInt64)inAddress
+{
+    section_info*   textSects[] = {&iTextSect, &iCoalTextSect, &iCoalTextNTSect};
+    uint32_t        i;
+
+    for (i = 0; i < sizeof(textSects) / sizeof(section_info*); i++)
+    {
+        if (textSects[i]->size && inAddress >= textSects[i]->s.addr &&
+            inAddress < textSects[i]->s.addr + textSects[i]->size)
+            return YES;
+    }
+
+    return NO;
+}
+
+//  getFunctionName:length:address:
+// ----------------------------------------------------------------------------
+//  The symbol of the function at inAddress, or "-[Class(Category) selector]"
+//  if it's a method. Returns NO if neither is known.
+
+- (BOOL)getFunctionName: (char*)outName
+                 length: (size_t)inLength
+                address: (UInt64)inAddress
+{
+    if (inAddress > UINT32_MAX)
+        return NO;
+
+    char*   symName = [self findSymbolByAddress: (uint32_t)inAddress];
+
+    if (symName)
+    {
+        strncpy(outName, symName, inLength - 1);
+        outName[inLength - 1]   = 0;
+        return YES;
+    }
+
+    MethodInfo* methodInfo  = NULL;
+    char*       className   = NULL;
+    char*       catName     = NULL;
+    char*       selName     = NULL;
+
+    if (![self getObjcMethod: &methodInfo fromAddress: (uint32_t)inAddress] ||
+        ![self getObjcClassName: &className categoryName: &catName
+        selector: &selName fromMethod: methodInfo])
+        return NO;
+
+    if (catName)
+        snprintf(outName, inLength, "%c[%s(%s) %s]",
+            (methodInfo->inst) ? '-' : '+', className, catName,
+            (selName) ? selName : "?");
+    else
+        snprintf(outName, inLength, "%c[%s %s]",
+            (methodInfo->inst) ? '-' : '+', className,
+            (selName) ? selName : "?");
+
+    return YES;
+}
+
+//  addFilterRangesForMethods:starts:count:
+// ----------------------------------------------------------------------------
+
+- (void)addFilterRangesForMethods: (MethodPattern*)inPattern
+                           starts: (UInt64*)inStarts
+                            count: (uint32_t)inCount
+{
+    MethodInfo* methodInfos[]       = {iClassMethodInfos, iCatMethodInfos};
+    uint32_t    numMethodInfos[]    = {iNumClassMethodInfos, iNumCatMethodInfos};
+    uint32_t    i, j;
+
+    for (i = 0; i < 2; i++)
+    {
+        for (j = 0; j < numMethodInfos[i]; j++)
+        {
+            MethodInfo* methodInfo  = &methodInfos[i][j];
+            char*       className   = NULL;
+            char*       catName     = NULL;
+            char*       selName     = NULL;
+
+            if (![self getObjcClassName: &className categoryName: &catName
+                selector: &selName fromMethod: methodInfo])
+                continue;
+
+            if (![self method: inPattern matchesClass: className
+                category: catName selector: selName
+                instance: methodInfo->inst])
+                continue;
+
+            [self addFilterRangeForFunction: methodInfo->m.method_imp
+                starts: inStarts count: inCount];
+        }
+    }
+}
+
+@end
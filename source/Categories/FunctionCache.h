@@ -0,0 +1,195 @@
+/*
+    FunctionCache.h
+
+    A category on ExeProcessor that remembers the finished text of each
+    function from one run to the next. Functions are identified by a
+    fingerprint of their code, with addresses inside the function reduced
+    to offsets, and addresses outside it replaced by what they refer to
+    whenever that's known, so that a function that merely moved, or whose
+    callees and data merely moved, still matches. When a new build of an
+    executable comes in, matching functions skip gatherFuncInfos and
+    processCodeLine: and reuse the stored text, with the address column,
+    code bytes, internal branch targets and otool's operand addresses
+    fixed up. Each stored line keeps the outside addresses otool printed
+    for it, in order, which pair up with the new line's to give their new
+    values.
+
+    Addresses outside the function whose referents aren't known go into
+    the fingerprint as they are, so a function using one only matches
+    while it stays put. Addresses otx works out for its comments rather
+    than copying from otool's operands, like PowerPC's ctr value, are kept
+    as stored; they follow from operands that went into the fingerprint
+    as they are.
+
+    The first line of every function is always processed normally, so
+    names, Anon numbering and the per-function machine state bookkeeping
+    stay in step with a full run.
+
+    Arch-specific subclasses supply the fingerprints, see FunctionMatcher
+    and FunctionMatcher64.
+
+    -diff uses the same fingerprints to compare two builds, without reading
+    or writing a cache file, and fingerprints the same way.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <CommonCrypto/CommonDigest.h>
+
+#import "ExeProcessor.h"
+
+#define FUNCTION_CACHE_MAGIC        0x6f747866  // 'otxf'
+#define FUNCTION_CACHE_VERSION      3
+#define FUNCTION_CACHE_FILE_EXT     @"otxf"
+
+/*  FunctionDigest
+
+    MD5 of a function's normalized code, its referents and its Obj-C
+    context. Wrapped in a struct so it can be copied by value.
+*/
+typedef struct
+{
+    unsigned char   bytes[CC_MD5_DIGEST_LENGTH];
+}
+FunctionDigest;
+
+/*  CachedFunction
+
+    One function's worth of stored text. 'linesOffset' locates the first
+    CachedLineHeader in the owning buffer. The first line of the function
+    is never stored.
+*/
+typedef struct
+{
+    FunctionDigest  digest;
+    UInt64          address;        // first instruction
+    UInt64          endAddress;     // just past the last instruction
+    UInt64          linesOffset;
+    uint32_t        numLines;
+}
+CachedFunction;
+
+/*  CachedLineHeader
+
+    Precedes the text of each stored line. The offsets locate the address
+    and code byte columns within the text, which are rewritten on reuse.
+    The text is followed by 'numOperands' UInt64's, the addresses outside
+    the function that otool printed for the line.
+*/
+typedef struct
+{
+    uint32_t    length;
+    UInt16      addressOffset;
+    UInt16      addressLength;
+    UInt16      codeOffset;
+    UInt16      codeLength;         // in hex digits
+    UInt16      numOperands;
+}
+CachedLineHeader;
+
+/*  FunctionCacheState
+
+    Everything the function cache needs during a single processing.
+*/
+struct FunctionCacheState
+{
+    // Functions from the previous run, sorted by digest.
+    char*               oldLines;
+    CachedFunction*     oldFuncs;
+    uint32_t            numOldFuncs;
+
+    // Per-FunctionInfo results of matching, indexed like iFuncInfos. Each
+    // match's stored lines are rewritten for their new addresses as soon
+    // as it's found, so that a match either reuses every line or none.
+    FunctionDigest*     digests;
+    CachedFunction**    matches;
+    char***             reusedLines;
+    UInt64*             addresses;
+    UInt64*             endAddresses;
+    uint32_t            numFuncs;
+    uint32_t            numReused;
+
+    // The addresses outside its function of each digested line, in line
+    // order: the line's address, their count, then the addresses. Only
+    // kept for -incremental.
+    UInt64*             operands;
+    UInt64              numOperands;
+    UInt64              operandsCapacity;
+    BOOL                operandsLost;   // ran out of memory
+
+    // The function currently being matched.
+    CachedFunction*     prepareFunc;
+    UInt64              prepareAddress;
+    char*               prepareCursor;
+    char**              prepareLines;
+    uint32_t            prepareLinesDone;
+    UInt64              prepareOperand; // into operands
+
+    // The function currently being generated.
+    SInt64              funcIndex;
+    char**              reuseLines;
+    uint32_t            reuseLinesLeft;
+    SInt64              recordIndex;    // into newFuncs, -1 if none
+    UInt64              recordOperand;  // into operands
+
+    // Output of this run.
+    CachedFunction*     newFuncs;
+    uint32_t            numNewFuncs;
+    char*               newLines;
+    UInt64              newLinesSize;
+    UInt64              newLinesCapacity;
+};
+
+// ----------------------------------------------------------------------------
+// Comparison function for qsort(3) and bsearch(3)
+
+static int
+CachedFunction_Compare(
+    CachedFunction* f1,
+    CachedFunction* f2)
+{
+    return memcmp(f1->digest.bytes, f2->digest.bytes, CC_MD5_DIGEST_LENGTH);
+}
+
+// ============================================================================
+
+@interface ExeProcessor(FunctionCache)
+
+- (NSString*)functionCachePath;
+- (BOOL)loadFunctionCache;
+- (BOOL)saveFunctionCache;
+- (void)freeFunctionCache;
+
+// matching
+- (void)allocateFunctionDigests: (uint32_t)inCount;
+- (void)digestCodeLine: (const char*)inText
+               address: (UInt64)inAddress
+            codeLength: (UInt8)inCodeLength
+         functionStart: (UInt64)inStart
+           functionEnd: (UInt64)inEnd
+               context: (CC_MD5_CTX*)ioContext;
+- (BOOL)digestReferent: (UInt64)inAddress
+               context: (CC_MD5_CTX*)ioContext;
+- (BOOL)matchFunction: (uint32_t)inIndex
+               digest: (FunctionDigest*)inDigest
+              address: (UInt64)inAddress
+           endAddress: (UInt64)inEndAddress
+             numLines: (uint32_t)inNumLines;
+- (BOOL)prepareCachedLine: (UInt64)inAddress
+                     code: (UInt8*)inCode
+               codeLength: (UInt8)inCodeLength;
+- (void)unmatchFunction: (uint32_t)inIndex;
+- (uint32_t)copyFunctionDigests: (CachedFunction**)outFuncs;
+
+// generating
+- (void)enterCachedFunction: (UInt64)inAddress;
+- (BOOL)reusedLine: (char**)outChars
+            length: (size_t*)outLength;
+- (void)recordLine: (const char*)inChars
+            length: (size_t)inLength
+           address: (UInt64)inAddress
+              code: (UInt8*)inCode
+        codeLength: (UInt8)inCodeLength;
+
+@end
@@ -0,0 +1,950 @@
+/*
+    FunctionCache.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <ctype.h>
+#import <unistd.h>
+
+#import "FunctionCache.h"
+#import "ResultCache.h"
+#import "SysUtils.h"
+
+/*  FunctionCacheFileHeader
+
+    Layout of a cache file: this header, 'numFuncs' CachedFunction's, then
+    'linesSize' bytes of CachedLineHeader's, each followed by its text and
+    operands.
+    Everything is in host byte order, the file never leaves this machine.
+*/
+typedef struct
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    numFuncs;
+    uint32_t    reserved;
+    UInt64      linesSize;
+}
+FunctionCacheFileHeader;
+
+// ----------------------------------------------------------------------------
+
+static void
+HexStringFromCode(
+    char*   outString,
+    UInt8*  inCode,
+    UInt8   inCodeLength)
+{
+    UInt8   i;
+
+    for (i = 0; i < inCodeLength; i++)
+        snprintf(&outString[i * 2], 3, "%02x", inCode[i]);
+
+    outString[inCodeLength * 2] = 0;
+}
+
+// ----------------------------------------------------------------------------
+//  Lines already handed over are NULL.
+
+static void
+FreeReusedLines(
+    char**      inLines,
+    uint32_t    inNumLines)
+{
+    uint32_t    i;
+
+    for (i = 0; i < inNumLines; i++)
+    {
+        if (inLines[i])
+            free(inLines[i]);
+    }
+
+    free(inLines);
+}
+
+// ----------------------------------------------------------------------------
+
+static BOOL
+AppendOperand(
+    FunctionCacheState* ioCache,
+    UInt64              inValue)
+{
+    if (ioCache->numOperands == ioCache->operandsCapacity)
+    {
+        UInt64  newCapacity = (ioCache->operandsCapacity) ?
+            ioCache->operandsCapacity * 2 : 64 * 1024;
+        UInt64* newOperands = realloc(ioCache->operands,
+            newCapacity * sizeof(UInt64));
+
+        if (!newOperands)
+            return NO;
+
+        ioCache->operands           = newOperands;
+        ioCache->operandsCapacity   = newCapacity;
+    }
+
+    ioCache->operands[ioCache->numOperands++]   = inValue;
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+//  The outside addresses digested for the line at inAddress, searching
+//  forward from *ioCursor. Lines are looked up in the order they were
+//  digested, so the cursor only moves on when the line is found. Returns
+//  NULL if it isn't.
+
+static UInt64*
+FindOperands(
+    FunctionCacheState* inCache,
+    UInt64*             ioCursor,
+    UInt64              inAddress,
+    UInt64*             outCount)
+{
+    UInt64  i   = *ioCursor;
+
+    while (i + 2 <= inCache->numOperands)
+    {
+        UInt64  count   = inCache->operands[i + 1];
+
+        if (count > inCache->numOperands - i - 2)
+            return NULL;
+
+        if (inCache->operands[i] == inAddress)
+        {
+            *ioCursor   = i + 2 + count;
+            *outCount   = count;
+            return &inCache->operands[i + 2];
+        }
+
+        i   += 2 + count;
+    }
+
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+//  The new value of an address outside the function, from the operands
+//  stored with the line and the operands of the new line, which pair up in
+//  order. An address not among the stored operands keeps its value.
+//  Returns NO if the pairs disagree about it.
+
+static BOOL
+RelocateOperand(
+    const char* inOldOperands,
+    UInt64*     inNewOperands,
+    UInt16      inNumOperands,
+    UInt64      inValue,
+    UInt64*     outValue)
+{
+    BOOL    found   = NO;
+    UInt16  i;
+
+    *outValue   = inValue;
+
+    for (i = 0; i < inNumOperands; i++)
+    {
+        UInt64  oldValue;
+
+        memcpy(&oldValue, inOldOperands + i * sizeof(UInt64),
+            sizeof(oldValue));
+
+        if (oldValue != inValue)
+            continue;
+
+        if (found && inNewOperands[i] != *outValue)
+            return NO;
+
+        *outValue   = inNewOperands[i];
+        found       = YES;
+    }
+
+    return YES;
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(FunctionCache)
+
+//  functionCachePath
+// ----------------------------------------------------------------------------
+//  One file per executable name, arch and set of options. Unlike the result
+//  cache, the contents of the executable are not part of the name, since
+//  the whole point is to match functions across builds.
+
+- (NSString*)functionCachePath
+{
+    NSString*   cacheDir    = [OTXCacheDirectory()
+        stringByAppendingPathComponent: @"Functions"];
+    NSError*    theError    = nil;
+
+    if (!cacheDir)
+        return nil;
+
+    if (![[NSFileManager defaultManager] createDirectoryAtPath: cacheDir
+        withIntermediateDirectories: YES attributes: nil error: &theError])
+    {
+        fprintf(stderr, "otx: unable to create function cache: %s\n",
+            UTF8STRING([theError localizedDescription]));
+        return nil;
+    }
+
+    NSString*   fileName    = [NSString stringWithFormat: @"%@-%s-%@",
+        [[iOFile path] lastPathComponent], iArchString,
+        [self optionsKeyString]];
+
+    return [[cacheDir stringByAppendingPathComponent: fileName]
+        stringByAppendingPathExtension: FUNCTION_CACHE_FILE_EXT];
+}
+
+//  loadFunctionCache
+// ----------------------------------------------------------------------------
+//  Set up iFuncCache and read the previous run's functions, if any. A
+//  missing or unreadable file just means nothing gets reused.
+
+- (BOOL)loadFunctionCache
+{
+    if (iFuncCache)
+        return YES;
+
+    iFuncCache  = calloc(1, sizeof(FunctionCacheState));
+
+    if (!iFuncCache)
+    {
+        fprintf(stderr, "otx: not enough memory to allocate iFuncCache\n");
+        return NO;
+    }
+
+    iFuncCache->funcIndex   = -1;
+    iFuncCache->recordIndex = -1;
+
+    // -diff only wants the digests.
+    if (!iOpts.functionCache)
+        return YES;
+
+    NSString*   cachePath   = [self functionCachePath];
+
+    if (!cachePath)
+        return YES;
+
+    NSData* fileData    = [NSData dataWithContentsOfFile: cachePath];
+
+    if (!fileData)
+        return YES;
+
+    const char*             fileBytes   = [fileData bytes];
+    NSUInteger              fileSize    = [fileData length];
+    FunctionCacheFileHeader header;
+
+    if (fileSize < sizeof(header))
+        return YES;
+
+    memcpy(&header, fileBytes, sizeof(header));
+
+    UInt64  funcsSize   = (UInt64)header.numFuncs * sizeof(CachedFunction);
+
+    if (header.magic != FUNCTION_CACHE_MAGIC    ||
+        header.version != FUNCTION_CACHE_VERSION ||
+        sizeof(header) + funcsSize + header.linesSize != fileSize)
+    {
+        fprintf(stderr, "otx: ignoring stale function cache %s\n",
+            UTF8STRING(cachePath));
+        return YES;
+    }
+
+    iFuncCache->oldFuncs    = malloc(funcsSize);
+    iFuncCache->oldLines    = malloc(header.linesSize);
+
+    if (!iFuncCache->oldFuncs || !iFuncCache->oldLines)
+    {
+        fprintf(stderr, "otx: not enough memory to load function cache\n");
+        [self freeFunctionCache];
+        return NO;
+    }
+
+    memcpy(iFuncCache->oldFuncs, fileBytes + sizeof(header), funcsSize);
+    memcpy(iFuncCache->oldLines, fileBytes + sizeof(header) + funcsSize,
+        header.linesSize);
+    iFuncCache->numOldFuncs = header.numFuncs;
+
+    qsort(iFuncCache->oldFuncs, iFuncCache->numOldFuncs,
+        sizeof(CachedFunction), (COMPARISON_FUNC_TYPE)CachedFunction_Compare);
+
+    return YES;
+}
+
+//  saveFunctionCache
+// ----------------------------------------------------------------------------
+//  Replace the cache file with this run's functions. Written to a temp file
+//  and renamed, so a concurrent run never reads half a cache.
+
+- (BOOL)saveFunctionCache
+{
+    if (!iFuncCache)
+        return NO;
+
+    NSString*   cachePath   = [self functionCachePath];
+
+    if (!cachePath)
+        return NO;
+
+    char    tempPath[MAXPATHLEN];
+
+    snprintf(tempPath, MAXPATHLEN, "%s.XXXXXX",
+        [cachePath fileSystemRepresentation]);
+
+    int fd  = mkstemp(tempPath);
+
+    if (fd == -1)
+    {
+        perror("otx: unable to create function cache temp file");
+        return NO;
+    }
+
+    FILE*   cacheFile   = fdopen(fd, "w");
+
+    if (!cacheFile)
+    {
+        perror("otx: unable to open function cache temp file");
+        close(fd);
+        unlink(tempPath);
+        return NO;
+    }
+
+    FunctionCacheFileHeader header  = {FUNCTION_CACHE_MAGIC,
+        FUNCTION_CACHE_VERSION, iFuncCache->numNewFuncs, 0,
+        iFuncCache->newLinesSize};
+    BOOL    success =
+        fwrite(&header, sizeof(header), 1, cacheFile) == 1 &&
+        fwrite(iFuncCache->newFuncs, sizeof(CachedFunction),
+            iFuncCache->numNewFuncs, cacheFile) == iFuncCache->numNewFuncs &&
+        fwrite(iFuncCache->newLines, 1, iFuncCache->newLinesSize,
+            cacheFile) == iFuncCache->newLinesSize;
+
+    if (fclose(cacheFile) != 0)
+        success = NO;
+
+    if (!success || rename(tempPath, [cachePath fileSystemRepresentation]) != 0)
+    {
+        perror("otx: unable to write function cache");
+        unlink(tempPath);
+        return NO;
+    }
+
+    return YES;
+}
+
+//  freeFunctionCache
+// ----------------------------------------------------------------------------
+
+- (void)freeFunctionCache
+{
+    if (!iFuncCache)
+        return;
+
+    // Whatever wasn't handed over to the output.
+    if (iFuncCache->reusedLines)
+    {
+        uint32_t    i;
+
+        for (i = 0; i < iFuncCache->numFuncs; i++)
+        {
+            if (iFuncCache->reusedLines[i])
+                FreeReusedLines(iFuncCache->reusedLines[i],
+                    iFuncCache->matches[i]->numLines);
+        }
+
+        free(iFuncCache->reusedLines);
+    }
+
+    if (iFuncCache->oldLines)
+        free(iFuncCache->oldLines);
+
+    if (iFuncCache->oldFuncs)
+        free(iFuncCache->oldFuncs);
+
+    if (iFuncCache->digests)
+        free(iFuncCache->digests);
+
+    if (iFuncCache->matches)
+        free(iFuncCache->matches);
+
+    if (iFuncCache->addresses)
+        free(iFuncCache->addresses);
+
+    if (iFuncCache->operands)
+        free(iFuncCache->operands);
+
+    if (iFuncCache->endAddresses)
+        free(iFuncCache->endAddresses);
+
+    if (iFuncCache->newFuncs)
+        free(iFuncCache->newFuncs);
+
+    if (iFuncCache->newLines)
+        free(iFuncCache->newLines);
+
+    free(iFuncCache);
+    iFuncCache  = NULL;
+}
+
+#pragma mark -
+//  allocateFunctionDigests:
+// ----------------------------------------------------------------------------
+
+- (void)allocateFunctionDigests: (uint32_t)inCount
+{
+    if (!iFuncCache)
+        return;
+
+    iFuncCache->digests         = calloc(inCount, sizeof(FunctionDigest));
+    iFuncCache->matches         = calloc(inCount, sizeof(CachedFunction*));
+    iFuncCache->reusedLines     = calloc(inCount, sizeof(char**));
+    iFuncCache->addresses       = calloc(inCount, sizeof(UInt64));
+    iFuncCache->endAddresses    = calloc(inCount, sizeof(UInt64));
+    iFuncCache->numFuncs        = inCount;
+
+    if (inCount && (!iFuncCache->digests || !iFuncCache->matches ||
+        !iFuncCache->reusedLines || !iFuncCache->addresses ||
+        !iFuncCache->endAddresses))
+    {
+        fprintf(stderr, "otx: not enough memory to allocate function digests\n");
+        iFuncCache->numFuncs    = 0;
+    }
+}
+
+//  digestCodeLine:address:codeLength:functionStart:functionEnd:context:
+// ----------------------------------------------------------------------------
+//  Feed one line of otool's verbose output into a function's digest. The
+//  address column is skipped, addresses inside the function are replaced
+//  by their offsets, and other addresses by what they point to when that's
+//  known. For -incremental, the other addresses are also kept, so that
+//  prepareCachedLine:... and recordLine:... can find them.
+
+- (void)digestCodeLine: (const char*)inText
+               address: (UInt64)inAddress
+            codeLength: (UInt8)inCodeLength
+         functionStart: (UInt64)inStart
+           functionEnd: (UInt64)inEnd
+               context: (CC_MD5_CTX*)ioContext
+{
+    CC_MD5_Update(ioContext, &inCodeLength, sizeof(inCodeLength));
+
+    BOOL    keepOperands    = iFuncCache && iOpts.functionCache &&
+        !iFuncCache->operandsLost;
+    UInt64  countIndex      = 0;
+
+    if (keepOperands)
+    {
+        countIndex      = iFuncCache->numOperands + 1;
+        keepOperands    = AppendOperand(iFuncCache, inAddress) &&
+            AppendOperand(iFuncCache, 0);
+    }
+
+    const char* textPtr = strchr(inText, '\t');
+
+    if (!textPtr)
+        textPtr = inText;
+
+    const char* tokenPtr;
+
+    while ((tokenPtr = strstr(textPtr, "0x")) != NULL)
+    {
+        CC_MD5_Update(ioContext, textPtr, (CC_LONG)(tokenPtr - textPtr));
+
+        if (!isxdigit(tokenPtr[2]))
+        {
+            CC_MD5_Update(ioContext, tokenPtr, 2);
+            textPtr = tokenPtr + 2;
+            continue;
+        }
+
+        char*   tokenEnd;
+        UInt64  value   = strtoull(tokenPtr + 2, &tokenEnd, 16);
+
+        if (value >= inStart && value < inEnd)
+        {
+            UInt64  offset  = value - inStart;
+
+            CC_MD5_Update(ioContext, "@", 1);
+            CC_MD5_Update(ioContext, &offset, sizeof(offset));
+        }
+        else
+        {
+            if (![self digestReferent: value context: ioContext])
+                CC_MD5_Update(ioContext, tokenPtr,
+                    (CC_LONG)(tokenEnd - tokenPtr));
+
+            if (keepOperands)
+            {
+                keepOperands    = AppendOperand(iFuncCache, value);
+
+                if (keepOperands)
+                    iFuncCache->operands[countIndex]++;
+            }
+        }
+
+        textPtr = tokenEnd;
+    }
+
+    CC_MD5_Update(ioContext, textPtr, (CC_LONG)strlen(textPtr));
+
+    // Without every line's operands, no line can be stored or reused.
+    if (iFuncCache && iOpts.functionCache && !iFuncCache->operandsLost &&
+        !keepOperands)
+    {
+        fprintf(stderr, "otx: not enough memory to keep operands, "
+            "nothing will be reused\n");
+        free(iFuncCache->operands);
+        iFuncCache->operands            = NULL;
+        iFuncCache->numOperands         = 0;
+        iFuncCache->operandsCapacity    = 0;
+        iFuncCache->operandsLost        = YES;
+    }
+}
+
+//  digestReferent:context:
+// ----------------------------------------------------------------------------
+//  Subclasses override to digest the data at inAddress, so that a function
+//  whose code is unchanged but whose strings or selectors are not, is not
+//  reused. Returns NO if inAddress refers to nothing known.
+
+- (BOOL)digestReferent: (UInt64)inAddress
+               context: (CC_MD5_CTX*)ioContext
+{
+    return NO;
+}
+
+//  matchFunction:digest:address:endAddress:numLines:
+// ----------------------------------------------------------------------------
+//  Remember the digest for recording, and look it up among the previous
+//  run's functions. inNumLines counts every code line in the function.
+//  A match isn't final until prepareCachedLine:... has succeeded for each
+//  line after the first, call unmatchFunction: if it fails for any.
+
+- (BOOL)matchFunction: (uint32_t)inIndex
+               digest: (FunctionDigest*)inDigest
+              address: (UInt64)inAddress
+           endAddress: (UInt64)inEndAddress
+             numLines: (uint32_t)inNumLines
+{
+    if (!iFuncCache || inIndex >= iFuncCache->numFuncs)
+        return NO;
+
+    iFuncCache->digests[inIndex]        = *inDigest;
+    iFuncCache->addresses[inIndex]      = inAddress;
+    iFuncCache->endAddresses[inIndex]   = inEndAddress;
+
+    if (!iFuncCache->numOldFuncs)
+        return NO;
+
+    CachedFunction  searchKey   = {*inDigest, 0, 0, 0, 0};
+    CachedFunction* oldFunc     = bsearch(&searchKey,
+        iFuncCache->oldFuncs, iFuncCache->numOldFuncs, sizeof(CachedFunction),
+        (COMPARISON_FUNC_TYPE)CachedFunction_Compare);
+
+    if (!oldFunc || oldFunc->numLines + 1 != inNumLines ||
+        oldFunc->endAddress - oldFunc->address != inEndAddress - inAddress)
+        return NO;
+
+    char**  lines   = calloc(oldFunc->numLines + 1, sizeof(char*));
+
+    if (!lines)
+        return NO;
+
+    iFuncCache->matches[inIndex]        = oldFunc;
+    iFuncCache->reusedLines[inIndex]    = lines;
+    iFuncCache->numReused++;
+
+    iFuncCache->prepareFunc         = oldFunc;
+    iFuncCache->prepareAddress      = inAddress;
+    iFuncCache->prepareCursor       =
+        iFuncCache->oldLines + oldFunc->linesOffset;
+    iFuncCache->prepareLines        = lines;
+    iFuncCache->prepareLinesDone    = 0;
+
+    return YES;
+}
+
+//  prepareCachedLine:code:codeLength:
+// ----------------------------------------------------------------------------
+//  Rewrite the next stored line of the function just matched for its new
+//  address. Returns NO when the stored line isn't the line we think it is
+//  or doesn't fit, in which case the whole function must be processed.
+
+- (BOOL)prepareCachedLine: (UInt64)inAddress
+                     code: (UInt8*)inCode
+               codeLength: (UInt8)inCodeLength
+{
+    if (!iFuncCache || !iFuncCache->prepareFunc ||
+        iFuncCache->prepareLinesDone >= iFuncCache->prepareFunc->numLines)
+        return NO;
+
+    CachedFunction*     oldFunc = iFuncCache->prepareFunc;
+    CachedLineHeader    header;
+
+    memcpy(&header, iFuncCache->prepareCursor, sizeof(header));
+
+    const char* oldChars    = iFuncCache->prepareCursor + sizeof(header);
+    const char* oldOperands = oldChars + header.length;
+
+    iFuncCache->prepareCursor   += sizeof(header) + header.length +
+        header.numOperands * sizeof(UInt64);
+
+    if (header.length >= MAX_LINE_LENGTH                    ||
+        header.codeLength != inCodeLength * 2               ||
+        header.addressOffset + header.addressLength > header.codeOffset ||
+        header.codeOffset + header.codeLength > header.length)
+        return NO;
+
+    // Verify that this is the line we think it is.
+    char    oldAddressString[20];
+
+    if (header.addressLength >= sizeof(oldAddressString))
+        return NO;
+
+    strncpy(oldAddressString, oldChars + header.addressOffset,
+        header.addressLength);
+    oldAddressString[header.addressLength]  = 0;
+
+    UInt64  oldAddress  = strtoull(oldAddressString, NULL, 16);
+    SInt64  delta       = (SInt64)(inAddress - oldAddress);
+
+    if (oldAddress - oldFunc->address !=
+        inAddress - iFuncCache->prepareAddress)
+        return NO;
+
+    // The new line's operands, which must pair up with the stored ones.
+    UInt64  numNewOperands  = 0;
+    UInt64* newOperands     = FindOperands(iFuncCache,
+        &iFuncCache->prepareOperand, inAddress, &numNewOperands);
+
+    if (!newOperands || numNewOperands != header.numOperands)
+        return NO;
+
+    char    newChars[MAX_LINE_LENGTH + MAX_FIELD_SPACING];
+    size_t  newLength   = 0;
+    char    scratch[40];
+
+    // Everything up to the address, then the new address.
+    memcpy(newChars, oldChars, header.addressOffset);
+    newLength   = header.addressOffset;
+
+    if (snprintf(scratch, sizeof(scratch), "%0*llx",
+        header.addressLength, inAddress) != header.addressLength)
+        return NO;
+
+    memcpy(&newChars[newLength], scratch, header.addressLength);
+    newLength   += header.addressLength;
+
+    // Up to the code bytes, then the new code bytes.
+    memcpy(&newChars[newLength], oldChars + newLength,
+        header.codeOffset - newLength);
+    newLength   = header.codeOffset;
+    HexStringFromCode(scratch, inCode, inCodeLength);
+    memcpy(&newChars[newLength], scratch, header.codeLength);
+    newLength   += header.codeLength;
+
+    // The rest, relocating addresses inside the function and otool's
+    // operands outside it.
+    const char* textPtr     = oldChars + newLength;
+    const char* textEnd     = oldChars + header.length;
+
+    while (textPtr < textEnd)
+    {
+        if (newLength >= MAX_LINE_LENGTH)
+            return NO;
+
+        if (textPtr + 2 < textEnd && textPtr[0] == '0' && textPtr[1] == 'x' &&
+            isxdigit(textPtr[2]))
+        {
+            const char* digitsPtr   = textPtr + 2;
+            const char* digitsEnd   = digitsPtr;
+            UInt64      value       = 0;
+
+            while (digitsEnd < textEnd && isxdigit(*digitsEnd))
+            {
+                value   = (value << 4) | (UInt64)(isdigit(*digitsEnd) ?
+                    *digitsEnd - '0' : (tolower(*digitsEnd) - 'a' + 10));
+                digitsEnd++;
+            }
+
+            int     numDigits   = (int)(digitsEnd - digitsPtr);
+            UInt64  newValue    = value + delta;
+
+            if ((value < oldFunc->address || value >= oldFunc->endAddress) &&
+                !RelocateOperand(oldOperands, newOperands,
+                header.numOperands, value, &newValue))
+                return NO;
+
+            if (newValue == value)
+            {
+                memcpy(&newChars[newLength], textPtr, digitsEnd - textPtr);
+                newLength   += digitsEnd - textPtr;
+                textPtr     = digitsEnd;
+                continue;
+            }
+
+            int newDigits   = snprintf(scratch, sizeof(scratch), "0x%0*llx",
+                numDigits, newValue) - 2;
+
+            memcpy(&newChars[newLength], scratch, newDigits + 2);
+            newLength   += newDigits + 2;
+            textPtr     = digitsEnd;
+
+            // Keep the following column where it was.
+            if (newDigits != numDigits && textPtr < textEnd && *textPtr == ' ')
+            {
+                const char* spacesEnd   = textPtr;
+
+                while (spacesEnd < textEnd && *spacesEnd == ' ')
+                    spacesEnd++;
+
+                int numSpaces   = (int)(spacesEnd - textPtr) -
+                    (newDigits - numDigits);
+
+                if (numSpaces < 1)
+                    numSpaces   = 1;
+
+                memset(&newChars[newLength], ' ', numSpaces);
+                newLength   += numSpaces;
+                textPtr     = spacesEnd;
+            }
+
+            continue;
+        }
+
+        newChars[newLength++]   = *textPtr++;
+    }
+
+    char*   lineChars   = malloc(newLength + 1);
+
+    if (!lineChars)
+        return NO;
+
+    memcpy(lineChars, newChars, newLength);
+    lineChars[newLength]    = 0;
+    iFuncCache->prepareLines[iFuncCache->prepareLinesDone++]    = lineChars;
+
+    return YES;
+}
+
+//  unmatchFunction:
+// ----------------------------------------------------------------------------
+//  Forget the match for a function whose stored lines didn't all fit, so
+//  that gatherFuncInfos and processCodeLine: see all of it.
+
+- (void)unmatchFunction: (uint32_t)inIndex
+{
+    if (!iFuncCache || inIndex >= iFuncCache->numFuncs ||
+        !iFuncCache->matches[inIndex])
+        return;
+
+    FreeReusedLines(iFuncCache->reusedLines[inIndex],
+        iFuncCache->matches[inIndex]->numLines);
+    iFuncCache->reusedLines[inIndex]    = NULL;
+    iFuncCache->matches[inIndex]        = NULL;
+    iFuncCache->prepareFunc             = NULL;
+    iFuncCache->numReused--;
+}
+
+
+//  copyFunctionDigests:
+// ----------------------------------------------------------------------------
+//  Hand back a malloc'd CachedFunction for every function that was
+//  digested, in address order. Only the digest and addresses are filled in.
+//  Returns the count, 0 if there are none or the allocation failed.
+
+- (uint32_t)copyFunctionDigests: (CachedFunction**)outFuncs
+{
+    *outFuncs   = NULL;
+
+    if (!iFuncCache || !iFuncCache->numFuncs)
+        return 0;
+
+    CachedFunction* funcs       =
+        malloc(iFuncCache->numFuncs * sizeof(CachedFunction));
+    uint32_t        numFuncs    = 0;
+    uint32_t        i;
+
+    if (!funcs)
+    {
+        fprintf(stderr, "otx: not enough memory to copy function digests\n");
+        return 0;
+    }
+
+    for (i = 0; i < iFuncCache->numFuncs; i++)
+    {
+        if (!iFuncCache->endAddresses[i])
+            continue;
+
+        funcs[numFuncs++]   = (CachedFunction){iFuncCache->digests[i],
+            iFuncCache->addresses[i], iFuncCache->endAddresses[i], 0, 0};
+    }
+
+    *outFuncs   = funcs;
+
+    return numFuncs;
+}
+
+#pragma mark -
+//  enterCachedFunction:
+// ----------------------------------------------------------------------------
+//  Called for the first line of each function as the output is generated,
+//  in the same order matchFunction:... was called.
+
+- (void)enterCachedFunction: (UInt64)inAddress
+{
+    if (!iFuncCache)
+        return;
+
+    iFuncCache->funcIndex++;
+    iFuncCache->reuseLines      = NULL;
+    iFuncCache->reuseLinesLeft  = 0;
+    iFuncCache->recordIndex     = -1;
+
+    if (iFuncCache->funcIndex >= iFuncCache->numFuncs)
+        return;
+
+    CachedFunction* match   = iFuncCache->matches[iFuncCache->funcIndex];
+
+    if (match)
+    {
+        iFuncCache->reuseLines      =
+            iFuncCache->reusedLines[iFuncCache->funcIndex];
+        iFuncCache->reuseLinesLeft  = match->numLines;
+    }
+
+    if (!iOpts.functionCache)
+        return;
+
+    // Start recording this function.
+    CachedFunction* newFuncs    = realloc(iFuncCache->newFuncs,
+        sizeof(CachedFunction) * (iFuncCache->numNewFuncs + 1));
+
+    if (!newFuncs)
+        return;
+
+    iFuncCache->newFuncs    = newFuncs;
+    iFuncCache->newFuncs[iFuncCache->numNewFuncs]   = (CachedFunction)
+        {iFuncCache->digests[iFuncCache->funcIndex], inAddress,
+        iFuncCache->endAddresses[iFuncCache->funcIndex],
+        iFuncCache->newLinesSize, 0};
+    iFuncCache->recordIndex = iFuncCache->numNewFuncs++;
+}
+
+//  reusedLine:length:
+// ----------------------------------------------------------------------------
+//  Hand over the next line of the function being reused, as rewritten by
+//  prepareCachedLine:... Returns NO when nothing is being reused. The
+//  returned chars are malloc'd and now belong to the caller.
+
+- (BOOL)reusedLine: (char**)outChars
+            length: (size_t*)outLength
+{
+    if (!iFuncCache || !iFuncCache->reuseLines || !iFuncCache->reuseLinesLeft)
+        return NO;
+
+    *outChars   = *iFuncCache->reuseLines;
+    *outLength  = strlen(*outChars);
+    *iFuncCache->reuseLines++   = NULL;
+    iFuncCache->reuseLinesLeft--;
+
+    return YES;
+}
+
+//  recordLine:length:address:code:codeLength:
+// ----------------------------------------------------------------------------
+//  Store a finished (not yet entabbed) line of the current function. A line
+//  whose columns or operands can't be found spoils the whole function.
+
+- (void)recordLine: (const char*)inChars
+            length: (size_t)inLength
+           address: (UInt64)inAddress
+              code: (UInt8*)inCode
+        codeLength: (UInt8)inCodeLength
+{
+    if (!iFuncCache || iFuncCache->recordIndex < 0)
+        return;
+
+    CachedFunction* newFunc =
+        &iFuncCache->newFuncs[iFuncCache->recordIndex];
+
+    // The first line is always processed, never stored.
+    if (inAddress == newFunc->address)
+        return;
+
+    char        addressString[20];
+    char        codeString[40];
+    const char* addressPtr  = NULL;
+    const char* codePtr     = NULL;
+
+    snprintf(addressString, sizeof(addressString), "%016llx", inAddress);
+    addressPtr  = strstr(inChars, addressString);
+
+    if (!addressPtr)
+    {
+        snprintf(addressString, sizeof(addressString), "%08llx", inAddress);
+        addressPtr  = strstr(inChars, addressString);
+    }
+
+    HexStringFromCode(codeString, inCode, inCodeLength);
+
+    if (addressPtr)
+        codePtr = strstr(addressPtr + strlen(addressString), codeString);
+
+    UInt64  numOperands = 0;
+    UInt64* operands    = (iFuncCache->operands) ? FindOperands(iFuncCache,
+        &iFuncCache->recordOperand, inAddress, &numOperands) : NULL;
+
+    if (!codePtr || inLength >= MAX_LINE_LENGTH || !operands ||
+        numOperands > UINT16_MAX)
+    {   // Forget the whole function.
+        iFuncCache->newLinesSize    = newFunc->linesOffset;
+        iFuncCache->numNewFuncs--;
+        iFuncCache->recordIndex     = -1;
+        return;
+    }
+
+    CachedLineHeader    header  = {(uint32_t)inLength,
+        (UInt16)(addressPtr - inChars), (UInt16)strlen(addressString),
+        (UInt16)(codePtr - inChars), (UInt16)strlen(codeString),
+        (UInt16)numOperands};
+    UInt64              needed  = iFuncCache->newLinesSize + sizeof(header) +
+        inLength + numOperands * sizeof(UInt64);
+
+    if (needed > iFuncCache->newLinesCapacity)
+    {
+        UInt64  newCapacity = iFuncCache->newLinesCapacity ?
+            iFuncCache->newLinesCapacity * 2 : 1024 * 1024;
+
+        while (newCapacity < needed)
+            newCapacity *= 2;
+
+        char*   newLines    = realloc(iFuncCache->newLines, newCapacity);
+
+        if (!newLines)
+        {
+            iFuncCache->newLinesSize    = newFunc->linesOffset;
+            iFuncCache->numNewFuncs--;
+            iFuncCache->recordIndex     = -1;
+            return;
+        }
+
+        iFuncCache->newLines            = newLines;
+        iFuncCache->newLinesCapacity    = newCapacity;
+    }
+
+    memcpy(iFuncCache->newLines + iFuncCache->newLinesSize,
+        &header, sizeof(header));
+    memcpy(iFuncCache->newLines + iFuncCache->newLinesSize + sizeof(header),
+        inChars, inLength);
+    memcpy(iFuncCache->newLines + iFuncCache->newLinesSize + sizeof(header) +
+        inLength, operands, numOperands * sizeof(UInt64));
+    iFuncCache->newLinesSize    = needed;
+    newFunc->numLines++;
+}
+
+@end
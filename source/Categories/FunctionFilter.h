@@ -0,0 +1,101 @@
+/*
+    FunctionFilter.h
+
+    A category on ExeProcessor that limits processing to the functions a
+    user asks for. Each filter spec is one of:
+
+        0x1f00-0x2000       an address range
+        0x1f00              the function containing an address
+        -[NSView draw*]     Obj-C methods, '+', '-' or neither, with an
+        [NSView(Cat) *]     optional category
+        NSView(Cat)         every method of a category
+        _main, *Helper*     functions whose symbols match, or every method
+                            of the classes whose names match
+
+    Names may contain fnmatch(3) wildcards. Arch-specific subclasses resolve
+    the specs to address ranges, see FilterResolver and FilterResolver64.
+    Lines outside the ranges are dropped as otool delivers them, sections
+    outside them aren't handed to otool at all, and otool is stopped once
+    it's past the last range.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+#define MAX_FILTER_PATTERN_LENGTH   256
+
+/*  MethodPattern
+
+    A parsed "-[Class(Category) selector]" filter spec. 'type' is '-', '+'
+    or 0 for either. Empty patterns match anything.
+*/
+typedef struct
+{
+    char    type;
+    char    classPattern[MAX_FILTER_PATTERN_LENGTH];
+    char    catPattern[MAX_FILTER_PATTERN_LENGTH];
+    char    selPattern[MAX_FILTER_PATTERN_LENGTH];
+}
+MethodPattern;
+
+// ----------------------------------------------------------------------------
+// Comparison functions for qsort(3)
+
+static int
+Address_Compare(
+    UInt64* a1,
+    UInt64* a2)
+{
+    if (*a1 < *a2)
+        return -1;
+
+    return (*a1 > *a2);
+}
+
+static int
+AddressRange_Compare(
+    AddressRange*   r1,
+    AddressRange*   r2)
+{
+    if (r1->start < r2->start)
+        return -1;
+
+    return (r1->start > r2->start);
+}
+
+// ============================================================================
+
+@interface ExeProcessor(FunctionFilter)
+
+- (void)setFunctionFilters: (NSArray*)inFilters;
+- (NSString*)filterKeyString;
+
+// resolving
+- (BOOL)parseAddressRange: (const char*)inSpec
+                    range: (AddressRange*)outRange;
+- (BOOL)parseMethodPattern: (const char*)inSpec
+                   pattern: (MethodPattern*)outPattern;
+- (BOOL)name: (const char*)inName
+matchesPattern: (const char*)inPattern;
+- (BOOL)method: (MethodPattern*)inPattern
+  matchesClass: (const char*)inClassName
+      category: (const char*)inCatName
+      selector: (const char*)inSelName
+      instance: (BOOL)inInstance;
+- (uint32_t)sortFunctionStarts: (UInt64*)ioStarts
+                         count: (uint32_t)inCount;
+- (void)addFilterRange: (AddressRange)inRange;
+- (BOOL)addFilterRangeForFunction: (UInt64)inAddress
+                           starts: (UInt64*)inStarts
+                            count: (uint32_t)inCount;
+- (void)finishFilterRanges;
+
+// filtering
+- (BOOL)addressPassesFilter: (UInt64)inAddress;
+- (BOOL)rangePassesFilter: (AddressRange)inRange;
+- (BOOL)addressIsPastFilter: (UInt64)inAddress;
+
+@end
@@ -0,0 +1,391 @@
+/*
+    FunctionFilter.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <CommonCrypto/CommonDigest.h>
+#import <fnmatch.h>
+
+#import "FunctionFilter.h"
+
+// ----------------------------------------------------------------------------
+//  Copy at most MAX_FILTER_PATTERN_LENGTH - 1 chars of a pattern, trimming
+//  spaces from both ends.
+
+static void
+CopyPattern(
+    char*       outPattern,
+    const char* inStart,
+    const char* inEnd)
+{
+    while (inStart < inEnd && *inStart == ' ')
+        inStart++;
+
+    while (inEnd > inStart && inEnd[-1] == ' ')
+        inEnd--;
+
+    size_t  length  = inEnd - inStart;
+
+    if (length >= MAX_FILTER_PATTERN_LENGTH)
+        length  = MAX_FILTER_PATTERN_LENGTH - 1;
+
+    strncpy(outPattern, inStart, length);
+    outPattern[length]  = 0;
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(FunctionFilter)
+
+//  setFunctionFilters:
+// ----------------------------------------------------------------------------
+//  An array of NSString filter specs. nil or empty means no filtering.
+//  Ranges resolved from earlier specs are dropped.
+
+- (void)setFunctionFilters: (NSArray*)inFilters
+{
+    if (iFilterSpecs)
+    {
+        [iFilterSpecs release];
+        iFilterSpecs    = nil;
+    }
+
+    if (iFilterRanges)
+    {
+        free(iFilterRanges);
+        iFilterRanges   = NULL;
+    }
+
+    iNumFilterRanges    = 0;
+
+    if ([inFilters count])
+        iFilterSpecs    = [inFilters copy];
+}
+
+//  filterKeyString
+// ----------------------------------------------------------------------------
+//  Filters change the output, so they're part of the cache keys.
+
+- (NSString*)filterKeyString
+{
+    if (!iFilterSpecs)
+        return @"";
+
+    const char*     specs   =
+        UTF8STRING([iFilterSpecs componentsJoinedByString: @"\n"]);
+    unsigned char   digest[CC_MD5_DIGEST_LENGTH];
+    char            hexString[CC_MD5_DIGEST_LENGTH * 2 + 1];
+    uint32_t        i;
+
+    CC_MD5(specs, (CC_LONG)strlen(specs), digest);
+
+    for (i = 0; i < CC_MD5_DIGEST_LENGTH; i++)
+        snprintf(&hexString[i * 2], 3, "%02x", digest[i]);
+
+    return [NSString stringWithFormat: @"f%s", hexString];
+}
+
+#pragma mark -
+//  parseAddressRange:range:
+// ----------------------------------------------------------------------------
+//  "0x1f00-0x2000", or "0x1f00" which yields a range of 1 byte. Returns NO
+//  if inSpec is something else.
+
+- (BOOL)parseAddressRange: (const char*)inSpec
+                    range: (AddressRange*)outRange
+{
+    if (strncmp(inSpec, "0x", 2))
+        return NO;
+
+    char*   specEnd;
+
+    outRange->start = strtoull(inSpec, &specEnd, 16);
+    outRange->end   = outRange->start + 1;
+
+    if (*specEnd == 0)
+        return YES;
+
+    if (*specEnd != '-' || strncmp(specEnd + 1, "0x", 2))
+        return NO;
+
+    outRange->end   = strtoull(specEnd + 1, &specEnd, 16);
+
+    return (*specEnd == 0 && outRange->end > outRange->start);
+}
+
+//  parseMethodPattern:pattern:
+// ----------------------------------------------------------------------------
+//  "-[Class(Category) selector]", with the type, category and selector
+//  optional, or "Class(Category)". Returns NO if inSpec is something else.
+
+- (BOOL)parseMethodPattern: (const char*)inSpec
+                   pattern: (MethodPattern*)outPattern
+{
+    const char* specPtr = inSpec;
+    const char* specEnd = inSpec + strlen(inSpec);
+    const char* catPtr;
+    const char* selPtr;
+
+    memset(outPattern, 0, sizeof(MethodPattern));
+
+    if (*specPtr == '-' || *specPtr == '+')
+        outPattern->type    = *specPtr++;
+
+    if (*specPtr == '[')
+    {
+        if (specEnd[-1] != ']')
+            return NO;
+
+        specPtr++;
+        specEnd--;
+        selPtr  = memchr(specPtr, ' ', specEnd - specPtr);
+
+        if (selPtr)
+            CopyPattern(outPattern->selPattern, selPtr + 1, specEnd);
+        else
+            selPtr  = specEnd;
+    }
+    else
+    {   // Class(Category)
+        if (outPattern->type || specEnd[-1] != ')')
+            return NO;
+
+        selPtr  = specEnd;
+    }
+
+    catPtr  = memchr(specPtr, '(', selPtr - specPtr);
+
+    if (catPtr)
+    {
+        const char* catEnd  = memchr(catPtr, ')', selPtr - catPtr);
+
+        if (!catEnd)
+            return NO;
+
+        CopyPattern(outPattern->catPattern, catPtr + 1, catEnd);
+    }
+    else
+        catPtr  = selPtr;
+
+    CopyPattern(outPattern->classPattern, specPtr, catPtr);
+
+    return YES;
+}
+
+//  name:matchesPattern:
+// ----------------------------------------------------------------------------
+//  Symbols match with or without their leading underscore.
+
+- (BOOL)name: (const char*)inName
+matchesPattern: (const char*)inPattern
+{
+    if (!inName)
+        return NO;
+
+    if (fnmatch(inPattern, inName, 0) == 0)
+        return YES;
+
+    return (inName[0] == '_' && fnmatch(inPattern, inName + 1, 0) == 0);
+}
+
+//  method:matchesClass:category:selector:instance:
+// ----------------------------------------------------------------------------
+
+- (BOOL)method: (MethodPattern*)inPattern
+  matchesClass: (const char*)inClassName
+      category: (const char*)inCatName
+      selector: (const char*)inSelName
+      instance: (BOOL)inInstance
+{
+    if ((inPattern->type == '-' && !inInstance) ||
+        (inPattern->type == '+' && inInstance))
+        return NO;
+
+    if (inPattern->classPattern[0] &&
+        ![self name: inClassName matchesPattern: inPattern->classPattern])
+        return NO;
+
+    if (inPattern->catPattern[0] &&
+        ![self name: inCatName matchesPattern: inPattern->catPattern])
+        return NO;
+
+    if (inPattern->selPattern[0] &&
+        ![self name: inSelName matchesPattern: inPattern->selPattern])
+        return NO;
+
+    return YES;
+}
+
+//  sortFunctionStarts:count:
+// ----------------------------------------------------------------------------
+//  Sort and remove duplicates, returning the new count.
+
+- (uint32_t)sortFunctionStarts: (UInt64*)ioStarts
+                         count: (uint32_t)inCount
+{
+    if (!inCount)
+        return 0;
+
+    qsort(ioStarts, inCount, sizeof(UInt64),
+        (COMPARISON_FUNC_TYPE)Address_Compare);
+
+    uint32_t    numStarts   = 1;
+    uint32_t    i;
+
+    for (i = 1; i < inCount; i++)
+    {
+        if (ioStarts[i] != ioStarts[numStarts - 1])
+            ioStarts[numStarts++]   = ioStarts[i];
+    }
+
+    return numStarts;
+}
+
+//  addFilterRange:
+// ----------------------------------------------------------------------------
+
+- (void)addFilterRange: (AddressRange)inRange
+{
+    AddressRange*   newRanges   = realloc(iFilterRanges,
+        sizeof(AddressRange) * (iNumFilterRanges + 1));
+
+    if (!newRanges)
+    {
+        fprintf(stderr, "otx: not enough memory to allocate iFilterRanges\n");
+        return;
+    }
+
+    iFilterRanges   = newRanges;
+    iFilterRanges[iNumFilterRanges++]   = inRange;
+}
+
+//  addFilterRangeForFunction:starts:count:
+// ----------------------------------------------------------------------------
+//  Add the range of the function containing inAddress. inStarts is a sorted
+//  list of every known function start, plus the ends of the text sections.
+
+- (BOOL)addFilterRangeForFunction: (UInt64)inAddress
+                           starts: (UInt64*)inStarts
+                            count: (uint32_t)inCount
+{
+    if (!inCount || inAddress < inStarts[0])
+        return NO;
+
+    // Find the last start at or before inAddress.
+    uint32_t    low     = 0;
+    uint32_t    high    = inCount - 1;
+
+    while (low < high)
+    {
+        uint32_t    mid = (low + high + 1) / 2;
+
+        if (inStarts[mid] <= inAddress)
+            low     = mid;
+        else
+            high    = mid - 1;
+    }
+
+    if (low + 1 >= inCount)
+        return NO;
+
+    [self addFilterRange: (AddressRange){inStarts[low], inStarts[low + 1]}];
+
+    return YES;
+}
+
+//  finishFilterRanges
+// ----------------------------------------------------------------------------
+//  Sort and coalesce the ranges for addressPassesFilter:.
+
+- (void)finishFilterRanges
+{
+    if (!iNumFilterRanges)
+        return;
+
+    qsort(iFilterRanges, iNumFilterRanges, sizeof(AddressRange),
+        (COMPARISON_FUNC_TYPE)AddressRange_Compare);
+
+    uint32_t    numRanges   = 1;
+    uint32_t    i;
+
+    for (i = 1; i < iNumFilterRanges; i++)
+    {
+        AddressRange*   lastRange   = &iFilterRanges[numRanges - 1];
+
+        if (iFilterRanges[i].start <= lastRange->end)
+        {
+            if (iFilterRanges[i].end > lastRange->end)
+                lastRange->end  = iFilterRanges[i].end;
+        }
+        else
+            iFilterRanges[numRanges++]  = iFilterRanges[i];
+    }
+
+    iNumFilterRanges    = numRanges;
+}
+
+#pragma mark -
+//  addressPassesFilter:
+// ----------------------------------------------------------------------------
+
+- (BOOL)addressPassesFilter: (UInt64)inAddress
+{
+    if (!iFilterSpecs)
+        return YES;
+
+    uint32_t    low     = 0;
+    uint32_t    high    = iNumFilterRanges;
+
+    while (low < high)
+    {
+        uint32_t    mid = (low + high) / 2;
+
+        if (inAddress < iFilterRanges[mid].start)
+            high    = mid;
+        else if (inAddress >= iFilterRanges[mid].end)
+            low     = mid + 1;
+        else
+            return YES;
+    }
+
+    return NO;
+}
+
+//  rangePassesFilter:
+// ----------------------------------------------------------------------------
+//  YES if any of inRange passes.
+
+- (BOOL)rangePassesFilter: (AddressRange)inRange
+{
+    if (!iFilterSpecs)
+        return YES;
+
+    uint32_t    i;
+
+    for (i = 0; i < iNumFilterRanges; i++)
+    {
+        if (iFilterRanges[i].start < inRange.end &&
+            iFilterRanges[i].end > inRange.start)
+            return YES;
+    }
+
+    return NO;
+}
+
+//  addressIsPastFilter:
+// ----------------------------------------------------------------------------
+//  YES if nothing at or after inAddress passes, so a reader going through
+//  a section in address order can stop.
+
+- (BOOL)addressIsPastFilter: (UInt64)inAddress
+{
+    if (!iFilterSpecs)
+        return NO;
+
+    return (!iNumFilterRanges ||
+        inAddress >= iFilterRanges[iNumFilterRanges - 1].end);
+}
+
+@end
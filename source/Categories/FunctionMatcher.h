@@ -0,0 +1,23 @@
+/*
+    FunctionMatcher.h
+
+    A category on Exe32Processor that fingerprints functions for the
+    function cache, and hands cached lines to the generate loop.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "Exe32Processor.h"
+#import "FunctionCache.h"
+
+@interface Exe32Processor(FunctionMatcher)
+
+- (void)matchCachedFunctions;
+- (void)digestFunctionContext: (uint32_t)inAddress
+                      context: (CC_MD5_CTX*)ioContext;
+- (BOOL)reuseCachedLine: (Line*)ioLine;
+- (void)recordCodeLine: (Line*)inLine;
+
+@end
@@ -0,0 +1,23 @@
+/*
+    FunctionMatcher64.h
+
+    A category on Exe64Processor that fingerprints functions for the
+    function cache, and hands cached lines to the generate loop.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "Exe64Processor.h"
+#import "FunctionCache.h"
+
+@interface Exe64Processor(FunctionMatcher64)
+
+- (void)matchCachedFunctions;
+- (void)digestFunctionContext: (UInt64)inAddress
+                      context: (CC_MD5_CTX*)ioContext;
+- (BOOL)reuseCachedLine: (Line64*)ioLine;
+- (void)recordCodeLine: (Line64*)inLine;
+
+@end
@@ -0,0 +1,252 @@
+/*
+    FunctionMatcher64.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "FunctionMatcher64.h"
+#import "Objc64Accessors.h"
+#import "Searchers64.h"
+#import "VerboseLines.h"
+
+// How much of a string a function refers to goes into its fingerprint.
+#define MAX_REFERENT_LENGTH     256
+
+@implementation Exe64Processor(FunctionMatcher64)
+
+//  matchCachedFunctions
+// ----------------------------------------------------------------------------
+//  Fingerprint every function and look it up in the function cache. Call
+//  after findFunctions and before gatherFuncInfos, which skips the
+//  functions that matched.
+
+- (void)matchCachedFunctions
+{
+    if (![self loadFunctionCache])
+        return;
+
+    [self allocateFunctionDigests: iNumFuncInfos];
+
+    uint32_t    funcIndex   = 0;
+    uint32_t    i           = 0;
+    uint32_t    j;
+
+    while (i < iNumCodeLines && funcIndex < iNumFuncInfos)
+    {
+        // Find the extent of this function.
+        for (j = i + 1; j < iNumCodeLines; j++)
+        {
+            if (iLineArray[j]->info.isFunction)
+                break;
+        }
+
+        // Code ahead of the first function belongs to no FunctionInfo.
+        if (!iLineArray[i]->info.isFunction)
+        {
+            i   = j;
+            continue;
+        }
+
+        Line64*     lastLine    = iLineArray[j - 1];
+        UInt64      start       = iLineArray[i]->info.address;
+        UInt64      end         =
+            lastLine->info.address + lastLine->info.codeLength;
+        CC_MD5_CTX      context;
+        FunctionDigest  digest;
+        uint32_t        k;
+
+        CC_MD5_Init(&context);
+        [self digestFunctionContext: start context: &context];
+
+        // The verbose lines carry the symbol names, for the instructions
+        // that have them.
+        for (k = i; k < j; k++)
+        {
+            Line64* theLine = iLineArray[k];
+            char*   theText = [self verboseLineAtAddress:
+                theLine->info.address];
+
+            [self digestCodeLine: (theText) ? theText : theLine->chars
+                address: theLine->info.address
+                codeLength: theLine->info.codeLength
+                functionStart: start functionEnd: end context: &context];
+        }
+
+        CC_MD5_Final(digest.bytes, &context);
+
+        // Reuse all of the function or none of it, since a cached function
+        // skips gatherFuncInfos.
+        if ([self matchFunction: funcIndex digest: &digest address: start
+            endAddress: end numLines: j - i])
+        {
+            for (k = i + 1; k < j; k++)
+            {
+                Line64* theLine = iLineArray[k];
+
+                if (![self prepareCachedLine: theLine->info.address
+                    code: theLine->info.code
+                    codeLength: theLine->info.codeLength])
+                    break;
+            }
+
+            if (k == j)
+                iFuncInfos[funcIndex].isCached  = YES;
+            else
+                [self unmatchFunction: funcIndex];
+        }
+
+        funcIndex++;
+        i   = j;
+    }
+}
+
+//  digestFunctionContext:context:
+// ----------------------------------------------------------------------------
+//  The function's symbol, and its class if it's an Obj-C method. The class
+//  determines how ivar accesses are commented.
+
+- (void)digestFunctionContext: (UInt64)inAddress
+                      context: (CC_MD5_CTX*)ioContext
+{
+    char*   symName = [self findSymbolByAddress: inAddress];
+
+    if (symName)
+        CC_MD5_Update(ioContext, symName, (CC_LONG)strlen(symName) + 1);
+
+    Method64Info*   methodInfoPtr   = NULL;
+
+    if (![self getObjcMethod: &methodInfoPtr fromAddress: inAddress])
+        return;
+
+    char*   className   = NULL;
+
+    [self getObjcClassName: &className selector: NULL
+        fromMethod: methodInfoPtr];
+
+    CC_MD5_Update(ioContext, &methodInfoPtr->inst, sizeof(methodInfoPtr->inst));
+
+    if (className)
+        CC_MD5_Update(ioContext, className, (CC_LONG)strnlen(className,
+            MAX_REFERENT_LENGTH) + 1);
+}
+
+//  digestReferent:context:
+// ----------------------------------------------------------------------------
+//  Whatever processCodeLine: would put in a comment for inAddress: the name
+//  of a function, or the data getPointer:type: finds. Returns NO if it
+//  finds neither.
+
+- (BOOL)digestReferent: (UInt64)inAddress
+               context: (CC_MD5_CTX*)ioContext
+{
+    UInt64          address     = inAddress;
+    Function64Info  searchKey   = {address, NULL, 0, 0};
+    Function64Info* funcInfo    = bsearch(&searchKey,
+        iFuncInfos, iNumFuncInfos, sizeof(Function64Info),
+        (COMPARISON_FUNC_TYPE)Function64_Info_Compare);
+
+    if (funcInfo)
+    {   // Anon functions are numbered in order, which can't be compared
+        // across builds.
+        char*   symName = [self findSymbolByAddress: address];
+
+        if (!iOpts.functionDigests)
+            CC_MD5_Update(ioContext, &funcInfo->genericFuncNum,
+                sizeof(funcInfo->genericFuncNum));
+
+        if (symName)
+            CC_MD5_Update(ioContext, symName, (CC_LONG)strlen(symName) + 1);
+
+        return YES;
+    }
+
+    UInt8   theType = PointerType;
+    char*   thePtr  = [self getPointer: address type: &theType];
+
+    CC_MD5_Update(ioContext, &theType, sizeof(theType));
+
+    if (!thePtr)
+        return NO;
+
+    switch (theType)
+    {
+        case FloatType:
+            CC_MD5_Update(ioContext, thePtr, sizeof(float));
+            break;
+
+        case DoubleType:
+            CC_MD5_Update(ioContext, thePtr, sizeof(double));
+            break;
+
+        case CFStringType:
+        case OCStrObjectType:
+        {
+            UInt64  chars   = (theType == CFStringType) ?
+                ((cfstring_object_64*)thePtr)->oc_string.chars :
+                ((nxstring_object_64*)thePtr)->chars;
+
+            if (iSwapped)
+                chars   = OSSwapInt64(chars);
+
+            thePtr  = [self getPointer: chars type: NULL];
+
+            if (thePtr)
+                CC_MD5_Update(ioContext, thePtr,
+                    (CC_LONG)strnlen(thePtr, MAX_REFERENT_LENGTH));
+
+            break;
+        }
+
+        default:
+            CC_MD5_Update(ioContext, thePtr,
+                (CC_LONG)strnlen(thePtr, MAX_REFERENT_LENGTH));
+            break;
+    }
+
+    return YES;
+}
+
+#pragma mark -
+//  reuseCachedLine:
+// ----------------------------------------------------------------------------
+//  Called from the generate loop for each code line. Returns YES if the
+//  line's text came from the function cache, in which case it needs no
+//  further processing. Every line but the first of a cached function comes
+//  from the cache, see matchCachedFunctions.
+
+- (BOOL)reuseCachedLine: (Line64*)ioLine
+{
+    if (ioLine->info.isFunction)
+    {
+        [self enterCachedFunction: ioLine->info.address];
+        return NO;
+    }
+
+    char*   newChars    = NULL;
+    size_t  newLength   = 0;
+
+    if (![self reusedLine: &newChars length: &newLength])
+        return NO;
+
+    free(ioLine->chars);
+    ioLine->chars   = newChars;
+    ioLine->length  = newLength;
+
+    return YES;
+}
+
+//  recordCodeLine:
+// ----------------------------------------------------------------------------
+//  Called from the generate loop for each finished code line, before it
+//  gets entabbed.
+
+- (void)recordCodeLine: (Line64*)inLine
+{
+    [self recordLine: inLine->chars length: inLine->length
+        address: inLine->info.address code: inLine->info.code
+        codeLength: inLine->info.codeLength];
+}
+
+@end
@@ -0,0 +1,23 @@
+/*
+    Instrumentation.h
+
+    A category on ExeProcessor that times the phases of processExe: with
+    the monotonic clock and reports them, along with the counts in
+    iStats, as text or JSON. Phases may be entered more than once, their
+    times accumulate.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+@interface ExeProcessor(Instrumentation)
+
+- (void)beginPhase: (uint32_t)inPhase;
+- (void)endPhase: (uint32_t)inPhase;
+- (void)printStats;
+- (void)printJSONSummary;
+
+@end
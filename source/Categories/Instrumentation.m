@@ -0,0 +1,163 @@
+/*
+    Instrumentation.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <mach/mach_time.h>
+
+#import "Instrumentation.h"
+#import "FunctionCache.h"
+
+#define MAX_MEMORY_NAME_LENGTH  32
+
+static const char*  gPhaseNames[NumPhases]  =
+{
+    "load",
+    "otool",
+    "gather_line_infos",
+    "find_functions",
+    "gather_func_infos_1",
+    "gather_func_infos_2",
+    "generate",
+    "write",
+    "data_sections"
+};
+
+static const char*  gCountNames[NumCounts]  =
+{
+    "lines",
+    "code_lines",
+    "functions",
+    "blocks",
+    "machine_states",
+    "get_pointer_calls",
+    "demangle_calls",
+    "bytes_written",
+    "spilled_bytes"
+};
+
+static const char*  gMemoryNames[NumMemoryKinds]    =
+{
+    "lines",
+    "line_array",
+    "func_infos",
+    "machine_states",
+    "tables"
+};
+
+// ----------------------------------------------------------------------------
+
+static double
+MillisecondsFromAbsolute(
+    UInt64  inTime)
+{
+    static mach_timebase_info_data_t    timebase    = {0, 0};
+
+    if (!timebase.denom)
+        mach_timebase_info(&timebase);
+
+    return (double)inTime * timebase.numer / timebase.denom / 1000000.0;
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(Instrumentation)
+
+//  beginPhase:
+// ----------------------------------------------------------------------------
+
+- (void)beginPhase: (uint32_t)inPhase
+{
+    iStats.phaseStarts[inPhase] = mach_absolute_time();
+}
+
+//  endPhase:
+// ----------------------------------------------------------------------------
+
+- (void)endPhase: (uint32_t)inPhase
+{
+    if (!iStats.phaseStarts[inPhase])
+        return;
+
+    iStats.phaseTimes[inPhase]  +=
+        mach_absolute_time() - iStats.phaseStarts[inPhase];
+    iStats.phaseStarts[inPhase] = 0;
+}
+
+//  printStats
+// ----------------------------------------------------------------------------
+//  Human-readable, for printSummary.
+
+- (void)printStats
+{
+    UInt64      totalTime   = 0;
+    uint32_t    i;
+
+    for (i = 0; i < NumPhases; i++)
+    {
+        totalTime   += iStats.phaseTimes[i];
+        fprintf(stderr, "%-20s %10.3f ms\n", gPhaseNames[i],
+            MillisecondsFromAbsolute(iStats.phaseTimes[i]));
+    }
+
+    fprintf(stderr, "%-20s %10.3f ms\n", "total",
+        MillisecondsFromAbsolute(totalTime));
+
+    for (i = 0; i < NumCounts; i++)
+        fprintf(stderr, "%-20s %10llu\n", gCountNames[i],
+            (unsigned long long)iStats.counts[i]);
+
+    char    memoryName[MAX_MEMORY_NAME_LENGTH];
+
+    for (i = 0; i < NumMemoryKinds; i++)
+    {
+        snprintf(memoryName, MAX_MEMORY_NAME_LENGTH, "%s_memory",
+            gMemoryNames[i]);
+        fprintf(stderr, "%-20s %10llu\n", memoryName,
+            (unsigned long long)iStats.memory[i]);
+    }
+
+    fprintf(stderr, "%-20s %10llu\n", "peak_memory",
+        (unsigned long long)iStats.peakMemory);
+}
+
+//  printJSONSummary
+// ----------------------------------------------------------------------------
+//  Everything printSummary prints, as one JSON object on one line.
+
+- (void)printJSONSummary
+{
+    uint32_t    i;
+
+    fprintf(stderr, "{\"selectors_matched\":%u,\"selectors_missed\":%u",
+        iMatchedSelectorCount, iMissedSelectorCount);
+
+    if (iFuncCache)
+        fprintf(stderr, ",\"functions_reused\":%u",
+            iFuncCache->numReused);
+
+    fprintf(stderr, ",\"phases_ms\":{");
+
+    for (i = 0; i < NumPhases; i++)
+        fprintf(stderr, "%s\"%s\":%.3f", (i) ? "," : "", gPhaseNames[i],
+            MillisecondsFromAbsolute(iStats.phaseTimes[i]));
+
+    fprintf(stderr, "},\"counts\":{");
+
+    for (i = 0; i < NumCounts; i++)
+        fprintf(stderr, "%s\"%s\":%llu", (i) ? "," : "", gCountNames[i],
+            (unsigned long long)iStats.counts[i]);
+
+    fprintf(stderr, "},\"memory_bytes\":{");
+
+    for (i = 0; i < NumMemoryKinds; i++)
+        fprintf(stderr, "\"%s\":%llu,", gMemoryNames[i],
+            (unsigned long long)iStats.memory[i]);
+
+    fprintf(stderr, "\"peak\":%llu}}\n",
+        (unsigned long long)iStats.peakMemory);
+}
+
+@end
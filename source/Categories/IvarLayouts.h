@@ -0,0 +1,76 @@
+/*
+    IvarLayouts.h
+
+    A category on Exe32Processor that keeps a flattened ivar layout for
+    each Obj-C 1 class an ivar is looked up in. A layout holds the class's
+    own ivars and every inherited one, sorted by offset, with pointers to
+    their names and @encode type strings already looked up. It's built the
+    first time it's needed, so each superclass chain is walked once per
+    class instead of once per 'self->ivar' access, see findIvar:inClass:
+    withOffset:.
+
+    The type strings are left encoded. TypeDecoder already decodes each
+    one once, keyed by the same pointer, and only when variable types are
+    shown.
+
+    Layouts are keyed by the class's ivar list and superclass, the only
+    fields they're built from, so a class and its metaclass get their own.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "Exe32Processor.h"
+
+// Guards against a superclass chain that loops.
+#define MAX_IVAR_LAYOUT_DEPTH   64
+
+/*  IvarLayoutEntry
+
+    One ivar of a layout, in host byte order. 'name' and 'type' point into
+    the executable, 'type' at the ivar's @encode string.
+*/
+typedef struct
+{
+    uint32_t    offset;
+    uint32_t    padding;
+    char*       name;
+    char*       type;
+}
+IvarLayoutEntry;
+
+/*  IvarLayout
+
+    A class's ivars, inherited ones included, sorted by offset. Where two
+    share an offset, the subclass's comes first.
+*/
+typedef struct
+{
+    UInt64              key;
+    IvarLayoutEntry*    entries;
+    uint32_t            numEntries;
+    uint32_t            padding;
+}
+IvarLayout;
+
+/*  IvarLayoutsState
+
+    An open-addressed table of the layouts built so far. A key of 0 marks
+    an empty slot.
+*/
+struct IvarLayoutsState
+{
+    IvarLayout* layouts;
+    uint32_t    numLayouts;
+    uint32_t    slotMask;
+};
+
+// ============================================================================
+
+@interface Exe32Processor(IvarLayouts)
+
+- (IvarLayout*)ivarLayoutForClass: (objc1_32_class*)inClass;
+- (void)freeIvarLayouts;
+
+@end
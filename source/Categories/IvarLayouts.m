@@ -0,0 +1,214 @@
+/*
+    IvarLayouts.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "IvarLayouts.h"
+#import "ObjcAccessors.h"
+#import "TableUtils.h"
+
+// ----------------------------------------------------------------------------
+
+static int
+IvarLayoutEntry_Compare(
+    IvarLayoutEntry*    e1,
+    IvarLayoutEntry*    e2)
+{
+    if (e1->offset < e2->offset)
+        return -1;
+
+    return (e1->offset > e2->offset);
+}
+
+// ----------------------------------------------------------------------------
+
+static uint32_t
+HashLayoutKey(
+    UInt64  inKey)
+{
+    return (uint32_t)((inKey * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+//  FindLayoutSlot
+// ----------------------------------------------------------------------------
+//  The slot holding inKey, or the empty slot where it would go.
+
+static IvarLayout*
+FindLayoutSlot(
+    IvarLayout* inLayouts,
+    uint32_t    inSlotMask,
+    UInt64      inKey)
+{
+    uint32_t    slot    = HashLayoutKey(inKey) & inSlotMask;
+
+    while (inLayouts[slot].key && inLayouts[slot].key != inKey)
+        slot    = (slot + 1) & inSlotMask;
+
+    return &inLayouts[slot];
+}
+
+// ============================================================================
+
+@implementation Exe32Processor(IvarLayouts)
+
+//  ivarLayoutForClass:
+// ----------------------------------------------------------------------------
+//  inClass is as it appears in the file, like the classes reached through
+//  its superclass chain. Returns NULL if the class has no ivars, inherited
+//  or not.
+
+- (IvarLayout*)ivarLayoutForClass: (objc1_32_class*)inClass
+{
+    objc1_32_class  theClass    = *inClass;
+
+    if (iSwapped)
+        swap_objc1_32_class(&theClass);
+
+    UInt64  key = ((UInt64)theClass.ivars << 32) | theClass.super_class;
+
+    if (!key)
+        return NULL;
+
+    if (!iIvarLayouts)
+    {
+        iIvarLayouts    = calloc(1, sizeof(IvarLayoutsState));
+
+        if (!iIvarLayouts)
+            return NULL;
+    }
+
+    IvarLayout* layout;
+
+    if (iIvarLayouts->layouts)
+    {
+        layout  = FindLayoutSlot(iIvarLayouts->layouts,
+            iIvarLayouts->slotMask, key);
+
+        if (layout->key)
+            return (layout->entries) ? layout : NULL;
+    }
+
+    // Keep the table at most half full.
+    uint32_t    numSlots    = (iIvarLayouts->layouts) ?
+        iIvarLayouts->slotMask + 1 : 0;
+
+    if ((iIvarLayouts->numLayouts + 1) * 2 > numSlots)
+    {
+        uint32_t    newNumSlots = (numSlots) ? numSlots * 2 : 256;
+        IvarLayout* newLayouts  = calloc(newNumSlots, sizeof(IvarLayout));
+        uint32_t    i;
+
+        if (!newLayouts)
+        {
+            fprintf(stderr, "otx: not enough memory for ivar layouts\n");
+            return NULL;
+        }
+
+        for (i = 0; i < numSlots; i++)
+        {
+            if (iIvarLayouts->layouts[i].key)
+                *FindLayoutSlot(newLayouts, newNumSlots - 1,
+                    iIvarLayouts->layouts[i].key) =
+                    iIvarLayouts->layouts[i];
+        }
+
+        if (iIvarLayouts->layouts)
+            free(iIvarLayouts->layouts);
+
+        iIvarLayouts->layouts   = newLayouts;
+        iIvarLayouts->slotMask  = newNumSlots - 1;
+    }
+
+    // Walk the class and its superclasses, subclass first.
+    IvarLayoutEntry*    entries     = NULL;
+    uint32_t            numEntries  = 0;
+    uint32_t            capacity    = 0;
+    objc1_32_ivar_list* theIvars;
+    objc1_32_ivar       theIvar;
+    char*               theSuperName;
+    uint32_t            depth, numIvars, i;
+
+    for (depth = 0; depth < MAX_IVAR_LAYOUT_DEPTH; depth++)
+    {
+        theIvars    = (objc1_32_ivar_list*)[self getPointer: theClass.ivars
+            type: NULL];
+
+        if (theIvars)
+        {
+            numIvars    = theIvars->ivar_count;
+
+            if (iSwapped)
+                numIvars    = OSSwapInt32(numIvars);
+
+            for (i = 0; i < numIvars; i++)
+            {
+                if (!GrowTable((void**)&entries, numEntries, &capacity,
+                    sizeof(IvarLayoutEntry)))
+                    break;
+
+                theIvar = theIvars->ivar_list[i];
+
+                if (iSwapped)
+                    swap_objc1_32_ivar(&theIvar);
+
+                entries[numEntries++]   = (IvarLayoutEntry){
+                    theIvar.ivar_offset, 0,
+                    [self getPointer: theIvar.ivar_name type: NULL],
+                    [self getPointer: theIvar.ivar_type type: NULL]};
+            }
+        }
+
+        theSuperName    = [self getPointer: theClass.super_class type: NULL];
+
+        if (!theSuperName ||
+            ![self getObjc1Class: &theClass fromName: theSuperName])
+            break;
+
+        // Classes from iClassMethodInfos are as they appear in the file,
+        // like inClass.
+        if (iSwapped)
+            swap_objc1_32_class(&theClass);
+    }
+
+    SortTableByKey(entries, numEntries, sizeof(IvarLayoutEntry),
+        offsetof(IvarLayoutEntry, offset), sizeof(entries->offset), NO,
+        (COMPARISON_FUNC_TYPE)IvarLayoutEntry_Compare);
+
+    // Classes without ivars are remembered too, with no entries.
+    layout  = FindLayoutSlot(iIvarLayouts->layouts,
+        iIvarLayouts->slotMask, key);
+    *layout = (IvarLayout){key, entries, numEntries, 0};
+    iIvarLayouts->numLayouts++;
+
+    return (entries) ? layout : NULL;
+}
+
+//  freeIvarLayouts
+// ----------------------------------------------------------------------------
+
+- (void)freeIvarLayouts
+{
+    if (!iIvarLayouts)
+        return;
+
+    if (iIvarLayouts->layouts)
+    {
+        uint32_t    i;
+
+        for (i = 0; i <= iIvarLayouts->slotMask; i++)
+        {
+            if (iIvarLayouts->layouts[i].entries)
+                free(iIvarLayouts->layouts[i].entries);
+        }
+
+        free(iIvarLayouts->layouts);
+    }
+
+    free(iIvarLayouts);
+    iIvarLayouts    = NULL;
+}
+
+@end
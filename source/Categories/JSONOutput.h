@@ -0,0 +1,64 @@
+/*
+    JSONOutput.h
+
+    A category on ExeProcessor that turns the listing into JSON Lines, for
+    -json. Each line of the text listing becomes one record, built from the
+    fields processCodeLine: already has apart, so nothing needs to parse
+    the text back:
+
+    {"type":"insn","address":"0x1f2c","function":"0x1f00","bytes":"89e5",
+        "mnemonic":"movl","operands":"%esp,%ebp","comment":"..."}
+    {"type":"function","address":"0x1f00","name":"-[Foo bar:]",
+        "class":"Foo","category":"Baz","selector":"bar:","returns":"void"}
+    {"type":"text","text":"(__TEXT,__text) section"}
+    {"type":"data","segment":"__DATA","section":"__data",
+        "address":"0x3000","bytes":"..."}
+
+    Empty fields are left out. Addresses are hex strings, since JSON
+    numbers can't be trusted with 64 bits. Bytes that aren't UTF-8 are
+    escaped as if they were Latin-1.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+/*  MethodNameParts
+
+    The pieces of an Obj-C method's name, for its function record.
+    'className' is NULL if the function isn't a method.
+*/
+typedef struct
+{
+    char*   className;
+    char*   catName;
+    char*   selName;
+    char    returnType[MAX_TYPE_STRING_LENGTH];
+    BOOL    isInstanceMethod;
+}
+MethodNameParts;
+
+@interface ExeProcessor(JSONOutput)
+
+- (char*)jsonCodeLine: (UInt64)inAddress
+             function: (UInt64)inFuncAddress
+                 code: (const char*)inCode
+             mnemonic: (const char*)inMnemonic
+             operands: (const char*)inOperands
+              comment: (const char*)inComment
+               length: (size_t*)outLength;
+- (void)makeJSONFunctionLine: (char**)ioChars
+                      length: (size_t*)ioLength
+                     address: (UInt64)inAddress
+                      method: (MethodNameParts*)inMethod;
+- (void)makeJSONTextLine: (char**)ioChars
+                  length: (size_t*)ioLength;
+- (BOOL)printJSONDataSection: (const char*)inSegName
+                     section: (const char*)inSectName
+                     address: (UInt64)inAddress
+                       bytes: (const UInt8*)inBytes
+                      length: (UInt64)inLength;
+
+@end
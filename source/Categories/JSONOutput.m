@@ -0,0 +1,427 @@
+/*
+    JSONOutput.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "JSONOutput.h"
+#import "OutputFile.h"
+
+#define DATA_CHUNK_SIZE     4096    // section bytes hexed per write
+
+/*  JSONBuffer
+
+    A record being built. Once an allocation fails, 'failed' sticks and
+    further appends do nothing.
+*/
+typedef struct
+{
+    char*   bytes;
+    size_t  length;
+    size_t  size;
+    BOOL    failed;
+}
+JSONBuffer;
+
+static const char   gHexDigits[]    = "0123456789abcdef";
+
+// ----------------------------------------------------------------------------
+
+static void
+AppendBytes(
+    JSONBuffer* ioBuffer,
+    const char* inBytes,
+    size_t      inLength)
+{
+    if (ioBuffer->failed)
+        return;
+
+    if (ioBuffer->length + inLength + 1 > ioBuffer->size)
+    {
+        size_t  newSize = (ioBuffer->size) ? ioBuffer->size * 2 : 256;
+
+        while (newSize < ioBuffer->length + inLength + 1)
+            newSize *= 2;
+
+        char*   newBytes    = realloc(ioBuffer->bytes, newSize);
+
+        if (!newBytes)
+        {
+            ioBuffer->failed    = YES;
+            return;
+        }
+
+        ioBuffer->bytes = newBytes;
+        ioBuffer->size  = newSize;
+    }
+
+    memcpy(ioBuffer->bytes + ioBuffer->length, inBytes, inLength);
+    ioBuffer->length    += inLength;
+    ioBuffer->bytes[ioBuffer->length]   = 0;
+}
+
+// ----------------------------------------------------------------------------
+//  Length of the UTF-8 sequence at inChars, or 0 if it isn't one.
+
+static size_t
+UTF8SequenceLength(
+    const UInt8*    inChars,
+    const UInt8*    inEnd)
+{
+    size_t  length;
+    size_t  i;
+
+    if (inChars[0] < 0x80)
+        return 1;
+    else if (inChars[0] >= 0xc2 && inChars[0] <= 0xdf)
+        length  = 2;
+    else if ((inChars[0] & 0xf0) == 0xe0)
+        length  = 3;
+    else if (inChars[0] >= 0xf0 && inChars[0] <= 0xf4)
+        length  = 4;
+    else
+        return 0;
+
+    if ((size_t)(inEnd - inChars) < length)
+        return 0;
+
+    for (i = 1; i < length; i++)
+        if ((inChars[i] & 0xc0) != 0x80)
+            return 0;
+
+    return length;
+}
+
+// ----------------------------------------------------------------------------
+//  Append inLength bytes of inChars as a quoted JSON string.
+
+static void
+AppendString(
+    JSONBuffer* ioBuffer,
+    const char* inChars,
+    size_t      inLength)
+{
+    const UInt8*    charsPtr    = (const UInt8*)inChars;
+    const UInt8*    charsEnd    = charsPtr + inLength;
+    const UInt8*    runStart    = charsPtr;
+
+    AppendBytes(ioBuffer, "\"", 1);
+
+    while (charsPtr < charsEnd)
+    {
+        UInt8   c           = *charsPtr;
+        size_t  seqLength   = UTF8SequenceLength(charsPtr, charsEnd);
+
+        // Runs of characters that need no escaping are copied whole.
+        if (seqLength > 1 ||
+            (seqLength == 1 && c >= 0x20 && c != '"' && c != '\\'))
+        {
+            charsPtr    += seqLength;
+            continue;
+        }
+
+        AppendBytes(ioBuffer, (const char*)runStart, charsPtr - runStart);
+
+        char    escape[7]       = {'\\', 0};
+        size_t  escapeLength    = 2;
+
+        switch (c)
+        {
+            case '"':
+            case '\\':
+                escape[1]   = c;
+                break;
+
+            case '\n':
+                escape[1]   = 'n';
+                break;
+
+            case '\r':
+                escape[1]   = 'r';
+                break;
+
+            case '\t':
+                escape[1]   = 't';
+                break;
+
+            default:
+                escape[1]       = 'u';
+                escape[2]       = '0';
+                escape[3]       = '0';
+                escape[4]       = gHexDigits[c >> 4];
+                escape[5]       = gHexDigits[c & 0xf];
+                escapeLength    = 6;
+                break;
+        }
+
+        AppendBytes(ioBuffer, escape, escapeLength);
+        charsPtr++;
+        runStart    = charsPtr;
+    }
+
+    AppendBytes(ioBuffer, (const char*)runStart, charsPtr - runStart);
+    AppendBytes(ioBuffer, "\"", 1);
+}
+
+// ----------------------------------------------------------------------------
+//  Append ',"inKey":"inValue"' unless inValue is empty.
+
+static void
+AppendField(
+    JSONBuffer* ioBuffer,
+    const char* inKey,
+    const char* inValue)
+{
+    if (!inValue || !inValue[0])
+        return;
+
+    AppendBytes(ioBuffer, ",", 1);
+    AppendString(ioBuffer, inKey, strlen(inKey));
+    AppendBytes(ioBuffer, ":", 1);
+    AppendString(ioBuffer, inValue, strlen(inValue));
+}
+
+// ----------------------------------------------------------------------------
+
+static void
+AppendAddressField(
+    JSONBuffer* ioBuffer,
+    const char* inKey,
+    UInt64      inAddress)
+{
+    char    addressString[20];
+
+    snprintf(addressString, sizeof(addressString), "0x%llx", inAddress);
+    AppendField(ioBuffer, inKey, addressString);
+}
+
+// ----------------------------------------------------------------------------
+//  Terminate the record and hand over its bytes. On failure, hands over an
+//  empty line instead, so the caller always gets malloc'd chars.
+
+static char*
+FinishRecord(
+    JSONBuffer* ioBuffer,
+    size_t*     outLength)
+{
+    AppendBytes(ioBuffer, "}\n", 2);
+
+    if (ioBuffer->failed)
+    {
+        fprintf(stderr, "otx: not enough memory to build JSON record\n");
+
+        if (ioBuffer->bytes)
+            free(ioBuffer->bytes);
+
+        *outLength  = 0;
+
+        return calloc(1, 1);
+    }
+
+    *outLength  = ioBuffer->length;
+
+    return ioBuffer->bytes;
+}
+
+// ----------------------------------------------------------------------------
+//  Trim inChars to the text between its leading and trailing newlines, and
+//  a trailing colon if inTrimColon.
+
+static void
+TrimLine(
+    const char**    ioChars,
+    size_t*         ioLength,
+    BOOL            inTrimColon)
+{
+    const char* start   = *ioChars;
+    const char* end     = start + *ioLength;
+
+    while (start < end && *start == '\n')
+        start++;
+
+    while (end > start && end[-1] == '\n')
+        end--;
+
+    if (inTrimColon && end > start && end[-1] == ':')
+        end--;
+
+    *ioChars    = start;
+    *ioLength   = end - start;
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(JSONOutput)
+
+//  jsonCodeLine:function:code:mnemonic:operands:comment:length:
+// ----------------------------------------------------------------------------
+//  Returns a malloc'd record for one instruction.
+
+- (char*)jsonCodeLine: (UInt64)inAddress
+             function: (UInt64)inFuncAddress
+                 code: (const char*)inCode
+             mnemonic: (const char*)inMnemonic
+             operands: (const char*)inOperands
+              comment: (const char*)inComment
+               length: (size_t*)outLength
+{
+    JSONBuffer  record  = {0};
+
+    AppendBytes(&record, "{\"type\":\"insn\"", 14);
+    AppendAddressField(&record, "address", inAddress);
+    AppendAddressField(&record, "function", inFuncAddress);
+    AppendField(&record, "bytes", inCode);
+    AppendField(&record, "mnemonic", inMnemonic);
+    AppendField(&record, "operands", inOperands);
+    AppendField(&record, "comment", inComment);
+
+    return FinishRecord(&record, outLength);
+}
+
+//  makeJSONFunctionLine:length:address:method:
+// ----------------------------------------------------------------------------
+//  Replace a function's name line with its record. Obj-C methods are named
+//  from inMethod, everything else keeps the name from the listing.
+
+- (void)makeJSONFunctionLine: (char**)ioChars
+                      length: (size_t*)ioLength
+                     address: (UInt64)inAddress
+                      method: (MethodNameParts*)inMethod
+{
+    JSONBuffer  record  = {0};
+
+    AppendBytes(&record, "{\"type\":\"function\"", 18);
+    AppendAddressField(&record, "address", inAddress);
+
+    if (inMethod && inMethod->className && inMethod->selName)
+    {
+        char    methodName[1000];
+
+        if (inMethod->catName)
+            snprintf(methodName, sizeof(methodName), "%c[%s(%s) %s]",
+                (inMethod->isInstanceMethod) ? '-' : '+',
+                inMethod->className, inMethod->catName, inMethod->selName);
+        else
+            snprintf(methodName, sizeof(methodName), "%c[%s %s]",
+                (inMethod->isInstanceMethod) ? '-' : '+',
+                inMethod->className, inMethod->selName);
+
+        AppendField(&record, "name", methodName);
+        AppendField(&record, "class", inMethod->className);
+        AppendField(&record, "category", inMethod->catName);
+        AppendField(&record, "selector", inMethod->selName);
+
+        if (iOpts.returnTypes)
+            AppendField(&record, "returns", inMethod->returnType);
+    }
+    else
+    {
+        const char* name        = *ioChars;
+        size_t      nameLength  = *ioLength;
+
+        TrimLine(&name, &nameLength, YES);
+
+        if (nameLength)
+        {
+            AppendBytes(&record, ",\"name\":", 8);
+            AppendString(&record, name, nameLength);
+        }
+    }
+
+    free(*ioChars);
+    *ioChars    = FinishRecord(&record, ioLength);
+}
+
+//  makeJSONTextLine:length:
+// ----------------------------------------------------------------------------
+//  Replace any other line with a text record, or nothing if it's blank.
+
+- (void)makeJSONTextLine: (char**)ioChars
+                  length: (size_t*)ioLength
+{
+    const char* text        = *ioChars;
+    size_t      textLength  = *ioLength;
+
+    TrimLine(&text, &textLength, NO);
+
+    if (!textLength)
+    {
+        (*ioChars)[0]   = 0;
+        *ioLength       = 0;
+        return;
+    }
+
+    JSONBuffer  record  = {0};
+
+    AppendBytes(&record, "{\"type\":\"text\",\"text\":", 22);
+    AppendString(&record, text, textLength);
+
+    free(*ioChars);
+    *ioChars    = FinishRecord(&record, ioLength);
+}
+
+//  printJSONDataSection:section:address:bytes:length:
+// ----------------------------------------------------------------------------
+//  Write one record for a whole data section. The bytes are hexed a chunk
+//  at a time, straight to the output.
+
+- (BOOL)printJSONDataSection: (const char*)inSegName
+                     section: (const char*)inSectName
+                     address: (UInt64)inAddress
+                       bytes: (const UInt8*)inBytes
+                      length: (UInt64)inLength
+{
+    JSONBuffer  record          = {0};
+    char        segName[17]     = {0};
+    char        sectName[17]    = {0};
+
+    // Section and segment names fill all 16 chars without a terminator.
+    strncpy(segName, inSegName, 16);
+    strncpy(sectName, inSectName, 16);
+
+    AppendBytes(&record, "{\"type\":\"data\"", 14);
+    AppendField(&record, "segment", segName);
+    AppendField(&record, "section", sectName);
+    AppendAddressField(&record, "address", inAddress);
+    AppendBytes(&record, ",\"bytes\":\"", 10);
+
+    if (record.failed)
+    {
+        fprintf(stderr, "otx: not enough memory to build JSON record\n");
+
+        if (record.bytes)
+            free(record.bytes);
+
+        return NO;
+    }
+
+    BOOL    written = [self writeOutput: record.bytes length: record.length];
+
+    free(record.bytes);
+
+    char    hexChunk[DATA_CHUNK_SIZE * 2];
+    UInt64  offset;
+
+    for (offset = 0; written && offset < inLength; offset += DATA_CHUNK_SIZE)
+    {
+        UInt64  numBytes    = inLength - offset;
+        UInt64  i;
+
+        if (numBytes > DATA_CHUNK_SIZE)
+            numBytes    = DATA_CHUNK_SIZE;
+
+        for (i = 0; i < numBytes; i++)
+        {
+            hexChunk[i * 2]     = gHexDigits[inBytes[offset + i] >> 4];
+            hexChunk[i * 2 + 1] = gHexDigits[inBytes[offset + i] & 0xf];
+        }
+
+        written = [self writeOutput: hexChunk length: numBytes * 2];
+    }
+
+    return written && [self writeOutput: "\"}\n" length: 3];
+}
+
+@end
@@ -26,5 +26,12 @@
 - (void)deleteLinesFromList: (Line64*)listHead;
 - (void)deleteLinesBefore: (Line64*)inLine
                  fromList: (Line64**)listHead;
+- (void)deleteLinesFrom: (Line64*)inLine
+               fromList: (Line64**)listHead;
+- (BOOL)spillLine: (Line64*)inLine;
+- (BOOL)reloadLine: (Line64*)inLine;
+- (void)beginLineBudget;
+- (BOOL)reachLine: (Line64*)inLine;
+- (void)finishLinesBefore: (Line64*)inLine;
 
 @end
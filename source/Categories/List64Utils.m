@@ -10,6 +10,22 @@
 #import <Cocoa/Cocoa.h>
 
 #import "List64Utils.h"
+#import "MemoryBudget.h"
+#import "OutputFile.h"
+#import "OutputIndex.h"
+
+// ----------------------------------------------------------------------------
+//  What a line holds in the heap, see MemoryBudget.
+
+static UInt64
+LineBytes(
+    Line64* inLine)
+{
+    return sizeof(Line64) +
+        ((inLine->info.isSpilled) ? 0 : inLine->length + 1);
+}
+
+// ============================================================================
 
 @implementation Exe64Processor(List64Utils)
 
@@ -81,7 +97,7 @@
     if (newLine->prev)
         newLine->prev->next = newLine;
 
-    if (inLine->chars)
+    if (inLine->chars && !inLine->info.isSpilled)
         free(inLine->chars);
 
     free(inLine);
@@ -89,60 +105,49 @@
 
 //  printLinesFromList:
 // ----------------------------------------------------------------------------
-//  Print our modified lines to a FILE*. The FILE* is a real file in the GUI
-//  target, and stdout in the CLI target.
+//  Print our modified lines to the output file, which stays open for
+//  printDataSections. See OutputFile.
 
 - (BOOL)printLinesFromList: (Line64*)listHead
 {
-    FILE* outFile = NULL;
-
-    // In the CLI target, mOutputFilePath is nil.
-    if (iOutputFilePath)
-    {
-        const char* outPath = UTF8STRING(iOutputFilePath);
-        outFile = fopen(outPath, "w");
-    }
-    else
-        outFile = stdout;
-
-    if (!outFile)
-    {
-        perror("otx: unable to open output file");
+    if (![self openOutputFile])
         return NO;
-    }
 
     Line64* theLine = listHead;
 
-    // Cache the fileno and use SYS_write for maximum speed.
-    SInt32  fileNum = fileno(outFile);
+    // Progress is shared with the controller, so report in batches.
+    UInt32  pendingLines    = 0;
+    UInt64  pendingBytes    = 0;
 
     while (theLine)
     {
-        if (syscall(SYS_write, fileNum, theLine->chars, theLine->length) == -1)
-        {
-            perror("otx: unable to write to output file");
-
-            if (iOutputFilePath)
-            {
-                if (fclose(outFile) != 0)
-                    perror("otx: unable to close output file");
-            }
+        [self indexLine: theLine->chars length: theLine->length
+            code: theLine->info.isCode function: theLine->info.isFunction
+            address: theLine->info.address
+            codeLength: theLine->info.codeLength];
 
+        if (![self writeOutput: theLine->chars length: theLine->length])
+        {
+            [self closeOutputFile];
             return NO;
         }
 
-        theLine = theLine->next;
-    }
+        pendingBytes    += theLine->length;
 
-    if (iOutputFilePath)
-    {
-        if (fclose(outFile) != 0)
+        if (++pendingLines == PROGRESS_FREQ)
         {
-            perror("otx: unable to close output file");
-            return NO;
+            ProgressAdvance(iProgress, pendingLines);
+            ProgressAddBytes(iProgress, pendingBytes);
+            pendingLines    = 0;
+            pendingBytes    = 0;
         }
+
+        theLine = theLine->next;
     }
 
+    ProgressAdvance(iProgress, pendingLines);
+    ProgressAddBytes(iProgress, pendingBytes);
+
     return YES;
 }
 
@@ -157,7 +162,9 @@
     {
         if (theLine->prev)              // If there's one behind us...
         {
-            free(theLine->prev->chars); // delete it.
+            if (!theLine->prev->info.isSpilled) // delete it.
+                free(theLine->prev->chars);
+
             free(theLine->prev);
         }
 
@@ -165,7 +172,9 @@
             theLine = theLine->next;    // jump to next one and continue.
         else
         {                               // This is the last one, delete it.
-            free(theLine->chars);
+            if (!theLine->info.isSpilled)
+                free(theLine->chars);
+
             free(theLine);
             theLine = NULL;
         }
@@ -184,7 +193,9 @@
     {
         if (theLine->prev)              // If there's one behind us...
         {
-            free(theLine->prev->chars); // delete it.
+            if (!theLine->prev->info.isSpilled) // delete it.
+                free(theLine->prev->chars);
+
             free(theLine->prev);
         }
 
@@ -192,7 +203,9 @@
             theLine = theLine->next;    // jump to next one and continue.
         else
         {                               // This is the last one, delete it.
-            free(theLine->chars);
+            if (!theLine->info.isSpilled)
+                free(theLine->chars);
+
             free(theLine);
             theLine = NULL;
         }
@@ -203,4 +216,147 @@
     (*listHead)->prev   = NULL;
 }
 
+//  deleteLinesFrom:fromList:
+// ----------------------------------------------------------------------------
+//  Delete inLine and everything after it.
+
+- (void)deleteLinesFrom: (Line64*)inLine
+               fromList: (Line64**)listHead
+{
+    if (!inLine)
+        return;
+
+    if (inLine == *listHead)
+        *listHead   = NULL;
+    else if (inLine->prev)
+        inLine->prev->next  = NULL;
+
+    inLine->prev    = NULL;
+    [self deleteLinesFromList: inLine];
+}
+
+//  spillLine:
+// ----------------------------------------------------------------------------
+//  Move inLine's text to the spill file. Returns NO if it stays where it is.
+
+- (BOOL)spillLine: (Line64*)inLine
+{
+    if (!inLine->chars || inLine->info.isSpilled)
+        return NO;
+
+    char*   theChars    = [self spillText: inLine->chars
+        length: inLine->length];
+
+    if (!theChars)
+        return NO;
+
+    free(inLine->chars);
+    inLine->chars           = theChars;
+    inLine->info.isSpilled  = YES;
+
+    return YES;
+}
+
+//  reloadLine:
+// ----------------------------------------------------------------------------
+//  Bring inLine's text back from the spill file, so it can be freed and
+//  replaced like any other. The spilled copy is left where it is. Returns
+//  NO if there's no memory for it, in which case the line stays spilled
+//  and its text must not be freed.
+
+- (BOOL)reloadLine: (Line64*)inLine
+{
+    if (!inLine->info.isSpilled)
+        return YES;
+
+    char*   theChars    = malloc(inLine->length + 1);
+
+    if (!theChars)
+    {
+        fprintf(stderr, "otx: not enough memory to reload line\n");
+        return NO;
+    }
+
+    memcpy(theChars, inLine->chars, inLine->length + 1);
+    inLine->chars           = theChars;
+    inLine->info.isSpilled  = NO;
+
+    return YES;
+}
+
+//  beginLineBudget
+// ----------------------------------------------------------------------------
+//  Called before the lines are generated. If they don't fit in -max-memory
+//  to begin with, keep those that come first in half of what the rest
+//  leaves, so there's room for them to grow as they're commented, and
+//  spill the others until they're reached.
+
+- (void)beginLineBudget
+{
+    iFinishedLine       = NULL;
+    iLineBytesAhead     = iStats.memory[LineMemory];
+    iLineBytesBehind    = 0;
+
+    if (![self overMemoryBudget])
+        return;
+
+    UInt64  otherBytes  = [self memoryInUse] - iStats.memory[LineMemory];
+    UInt64  hotBytes    = (iOpts.maxMemory > otherBytes) ?
+        (iOpts.maxMemory - otherBytes) / 2 : 0;
+    UInt64  lineBytes   = 0;
+    Line64* theLine;
+
+    for (theLine = iPlainLineListHead; theLine; theLine = theLine->next)
+    {
+        if (lineBytes >= hotBytes)
+            [self spillLine: theLine];
+
+        lineBytes   += LineBytes(theLine);
+    }
+
+    iLineBytesAhead = lineBytes;
+    [self setMemory: lineBytes kind: LineMemory];
+}
+
+//  reachLine:
+// ----------------------------------------------------------------------------
+//  Called before inLine is generated, which may free and replace its text.
+//  Returns NO if its text couldn't be reloaded, in which case it must not
+//  be generated.
+
+- (BOOL)reachLine: (Line64*)inLine
+{
+    UInt64  lineBytes   = LineBytes(inLine);
+
+    iLineBytesAhead = (iLineBytesAhead > lineBytes) ?
+        iLineBytesAhead - lineBytes : 0;
+
+    return [self reloadLine: inLine];
+}
+
+//  finishLinesBefore:
+// ----------------------------------------------------------------------------
+//  Called with the line just generated, or with NULL once they all are.
+//  Generating a line touches no line but itself and the one before it, and
+//  only inserts lines before it, so the lines before inLine won't change
+//  again. They're spilled while we're over budget.
+
+- (void)finishLinesBefore: (Line64*)inLine
+{
+    Line64* theLine = (iFinishedLine) ?
+        iFinishedLine->next : iPlainLineListHead;
+
+    while (theLine && theLine != inLine)
+    {
+        if ([self overMemoryBudget])
+            [self spillLine: theLine];
+
+        iLineBytesBehind    += LineBytes(theLine);
+        iFinishedLine       = theLine;
+        theLine             = theLine->next;
+    }
+
+    [self setMemory: iLineBytesAhead + iLineBytesBehind kind: LineMemory];
+}
+
 @end
@@ -26,5 +26,12 @@
 - (void)deleteLinesFromList: (Line*)listHead;
 - (void)deleteLinesBefore: (Line*)inLine
                  fromList: (Line**)listHead;
+- (void)deleteLinesFrom: (Line*)inLine
+               fromList: (Line**)listHead;
+- (BOOL)spillLine: (Line*)inLine;
+- (BOOL)reloadLine: (Line*)inLine;
+- (void)beginLineBudget;
+- (BOOL)reachLine: (Line*)inLine;
+- (void)finishLinesBefore: (Line*)inLine;
 
 @end
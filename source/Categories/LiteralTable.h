@@ -0,0 +1,78 @@
+/*
+    LiteralTable.h
+
+    A category on ExeProcessor that renders the literals once, at load:
+    the C strings in (__TEXT,__cstring), the floats and doubles in
+    (__TEXT,__literal4) and (__TEXT,__literal8), and the CFString and
+    NSString objects the arch-specific loaders add, see ObjectLoader and
+    Object64Loader. The commenting code looks a literal up by address and
+    copies its text, instead of resolving and formatting it again for
+    every instruction that refers to it.
+
+    C strings and string objects point into the file, so only the numbers
+    take any memory beyond the index. A miss means the address isn't the
+    start of a literal; callers fall back to getPointer:type:.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+// Big enough for "%G" and "%lG".
+#define LITERAL_NUMBER_LENGTH   16
+
+/*  Literal
+
+    One literal's comment text, and the pointer type getPointer:type:
+    would report for its address.
+*/
+typedef struct
+{
+    UInt64      address;
+    char*       text;
+    uint32_t    type;
+    uint32_t    padding;
+}
+Literal;
+
+/*  LiteralTableState
+
+    The literals in the order they were added, and an open-addressed
+    index of them by address. 'slots' holds index + 1, 0 if empty.
+*/
+struct LiteralTableState
+{
+    Literal*    literals;
+    uint32_t    numLiterals;
+    uint32_t    capacity;
+    uint32_t*   slots;
+    uint32_t    slotMask;
+    char**      numberBlocks;
+    uint32_t    numNumberBlocks;
+};
+
+// ============================================================================
+
+@interface ExeProcessor(LiteralTable)
+
+- (void)addLiteral: (UInt64)inAddr
+              text: (char*)inText
+              type: (UInt8)inType;
+- (void)addCStringLiterals: (char*)inContents
+                   address: (UInt64)inAddr
+                      size: (UInt64)inSize;
+- (void)addNumberLiterals: (char*)inContents
+                  address: (UInt64)inAddr
+                     size: (UInt64)inSize
+                     type: (UInt8)inType;
+- (void)indexLiterals;
+- (char*)literalAtAddress: (UInt64)inAddr
+                     type: (UInt8*)outType;
+- (BOOL)copyLiteralAtAddress: (UInt64)inAddr
+                        type: (UInt8)inType;
+- (BOOL)copyStringLiteralAtAddress: (UInt64)inAddr;
+- (void)freeLiteralTable;
+
+@end
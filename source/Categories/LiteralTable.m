@@ -0,0 +1,302 @@
+/*
+    LiteralTable.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "CrossRefs.h"
+#import "LiteralTable.h"
+#import "TableUtils.h"
+
+// ----------------------------------------------------------------------------
+
+static uint32_t
+HashAddress(
+    UInt64  inAddr)
+{
+    return (uint32_t)((inAddr * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(LiteralTable)
+
+//  addLiteral:text:type:
+// ----------------------------------------------------------------------------
+//  inText must outlive the table. Literals added after indexLiterals are
+//  not found.
+
+- (void)addLiteral: (UInt64)inAddr
+              text: (char*)inText
+              type: (UInt8)inType
+{
+    if (!iLiterals)
+    {
+        iLiterals   = calloc(1, sizeof(LiteralTableState));
+
+        if (!iLiterals)
+            return;
+    }
+
+    if (!GrowTable((void**)&iLiterals->literals, iLiterals->numLiterals,
+        &iLiterals->capacity, sizeof(Literal)))
+        return;
+
+    iLiterals->literals[iLiterals->numLiterals++]   =
+        (Literal){inAddr, inText, inType, 0};
+}
+
+//  addCStringLiterals:address:size:
+// ----------------------------------------------------------------------------
+//  Every non-empty string in a C string section, making the same tests
+//  getPointer:type: makes. An unterminated string at the end is left out.
+
+- (void)addCStringLiterals: (char*)inContents
+                   address: (UInt64)inAddr
+                      size: (UInt64)inSize
+{
+    UInt64  offset  = 0;
+
+    while (offset < inSize)
+    {
+        char*   string  = inContents + offset;
+        char*   end     = memchr(string, 0, (size_t)(inSize - offset));
+
+        if (!end)
+            break;
+
+        if (end != string)
+        {
+            // Check if this may be a Pascal string. Thanks, Metrowerks.
+            if (strlen(string) == string[0] + 1)
+                [self addLiteral: inAddr + offset text: string + 1
+                    type: PStringType];
+            else
+                [self addLiteral: inAddr + offset text: string
+                    type: PointerType];
+        }
+
+        offset  = end - inContents + 1;
+    }
+}
+
+//  addNumberLiterals:address:size:type:
+// ----------------------------------------------------------------------------
+//  Every float or double in a literal section, as the commenting code
+//  prints them.
+
+- (void)addNumberLiterals: (char*)inContents
+                  address: (UInt64)inAddr
+                     size: (UInt64)inSize
+                     type: (UInt8)inType
+{
+    size_t  itemSize    = (inType == FloatType) ?
+        sizeof(uint32_t) : sizeof(UInt64);
+    UInt64  numItems    = inSize / itemSize;
+
+    if (!numItems || numItems > UINT32_MAX)
+        return;
+
+    if (!iLiterals)
+    {
+        iLiterals   = calloc(1, sizeof(LiteralTableState));
+
+        if (!iLiterals)
+            return;
+    }
+
+    char*   block   = malloc((size_t)numItems * LITERAL_NUMBER_LENGTH);
+    char**  blocks  = realloc(iLiterals->numberBlocks,
+        (iLiterals->numNumberBlocks + 1) * sizeof(char*));
+
+    if (!block || !blocks)
+    {
+        if (block)
+            free(block);
+
+        if (blocks)
+            iLiterals->numberBlocks = blocks;
+
+        fprintf(stderr, "otx: not enough memory for literals\n");
+        return;
+    }
+
+    iLiterals->numberBlocks = blocks;
+    iLiterals->numberBlocks[iLiterals->numNumberBlocks++]   = block;
+
+    UInt64  i;
+
+    for (i = 0; i < numItems; i++)
+    {
+        char*   text    = block + i * LITERAL_NUMBER_LENGTH;
+
+        // dance around printf's type coersion
+        if (inType == FloatType)
+        {
+            uint32_t    theInt32;
+
+            memcpy(&theInt32, inContents + i * itemSize, sizeof(theInt32));
+
+            if (iSwapped)
+                theInt32    = OSSwapInt32(theInt32);
+
+            snprintf(text, LITERAL_NUMBER_LENGTH, "%G", *(float*)&theInt32);
+        }
+        else
+        {
+            UInt64  theInt64;
+
+            memcpy(&theInt64, inContents + i * itemSize, sizeof(theInt64));
+
+            if (iSwapped)
+                theInt64    = OSSwapInt64(theInt64);
+
+            snprintf(text, LITERAL_NUMBER_LENGTH, "%lG",
+                *(double*)&theInt64);
+        }
+
+        [self addLiteral: inAddr + i * itemSize text: text type: inType];
+    }
+}
+
+//  indexLiterals
+// ----------------------------------------------------------------------------
+//  Build the index once everything is added. Where two literals share an
+//  address, the first one added wins.
+
+- (void)indexLiterals
+{
+    if (!iLiterals || !iLiterals->numLiterals)
+        return;
+
+    uint32_t    numSlots    = 1;
+
+    while (numSlots < iLiterals->numLiterals * 2)
+        numSlots    <<= 1;
+
+    if (iLiterals->slots)
+        free(iLiterals->slots);
+
+    iLiterals->slots    = calloc(numSlots, sizeof(uint32_t));
+
+    if (!iLiterals->slots)
+    {
+        fprintf(stderr, "otx: not enough memory to index literals\n");
+        return;
+    }
+
+    iLiterals->slotMask = numSlots - 1;
+
+    uint32_t    i;
+
+    for (i = 0; i < iLiterals->numLiterals; i++)
+    {
+        UInt64      address = iLiterals->literals[i].address;
+        uint32_t    slot    = HashAddress(address) & iLiterals->slotMask;
+
+        while (iLiterals->slots[slot] &&
+            iLiterals->literals[iLiterals->slots[slot] - 1].address !=
+            address)
+            slot    = (slot + 1) & iLiterals->slotMask;
+
+        if (!iLiterals->slots[slot])
+            iLiterals->slots[slot]  = i + 1;
+    }
+}
+
+//  literalAtAddress:type:
+// ----------------------------------------------------------------------------
+//  The text of the literal starting at inAddr, or NULL.
+
+- (char*)literalAtAddress: (UInt64)inAddr
+                     type: (UInt8*)outType
+{
+    if (!iLiterals || !iLiterals->slots)
+        return NULL;
+
+    uint32_t    slot    = HashAddress(inAddr) & iLiterals->slotMask;
+
+    while (iLiterals->slots[slot])
+    {
+        Literal*    literal = &iLiterals->literals[iLiterals->slots[slot] - 1];
+
+        if (literal->address == inAddr)
+        {
+            if (outType)
+                *outType    = literal->type;
+
+            return literal->text;
+        }
+
+        slot    = (slot + 1) & iLiterals->slotMask;
+    }
+
+    return NULL;
+}
+
+//  copyLiteralAtAddress:type:
+// ----------------------------------------------------------------------------
+//  Make the literal at inAddr the line comment, if it's of type inType.
+
+- (BOOL)copyLiteralAtAddress: (UInt64)inAddr
+                        type: (UInt8)inType
+{
+    UInt8   type;
+    char*   text    = [self literalAtAddress: inAddr type: &type];
+
+    if (!text || type != inType)
+        return NO;
+
+    snprintf(iLineCommentCString, MAX_COMMENT_LENGTH, "%s", text);
+
+    return YES;
+}
+
+//  copyStringLiteralAtAddress:
+// ----------------------------------------------------------------------------
+//  Make the string literal at inAddr the line comment, and cross-reference
+//  it. Numbers are left to the float and double commenting code.
+
+- (BOOL)copyStringLiteralAtAddress: (UInt64)inAddr
+{
+    UInt8   type;
+    char*   text    = [self literalAtAddress: inAddr type: &type];
+
+    if (!text || type == FloatType || type == DoubleType)
+        return NO;
+
+    snprintf(iLineCommentCString, MAX_COMMENT_LENGTH, "%s", text);
+    [self addCrossRefForType: type name: iLineCommentCString];
+
+    return YES;
+}
+
+//  freeLiteralTable
+// ----------------------------------------------------------------------------
+
+- (void)freeLiteralTable
+{
+    if (!iLiterals)
+        return;
+
+    uint32_t    i;
+
+    for (i = 0; i < iLiterals->numNumberBlocks; i++)
+        free(iLiterals->numberBlocks[i]);
+
+    if (iLiterals->numberBlocks)
+        free(iLiterals->numberBlocks);
+
+    if (iLiterals->literals)
+        free(iLiterals->literals);
+
+    if (iLiterals->slots)
+        free(iLiterals->slots);
+
+    free(iLiterals);
+    iLiterals   = NULL;
+}
+
+@end
@@ -0,0 +1,52 @@
+/*
+    MemoryBudget.h
+
+    A category on ExeProcessor that keeps track of the memory held by the
+    big consumers, see the MemoryKind constants in ExeProcessor.h, and
+    keeps it under -max-memory by moving line text out of the heap.
+
+    Spilled text goes to an unlinked temp file, mapped a chunk at a time
+    and shared with the file, so the kernel can write it out and drop it
+    instead of running out of memory. The text stays where it's mapped
+    until the processor goes away, and is read in place when the lines
+    are printed. The lists decide which lines to spill, see ListUtils and
+    List64Utils.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+#define SPILL_CHUNK_SIZE    (64 * 1024 * 1024)
+
+/*  MemoryBudgetState
+
+    The spill file and its mapped chunks. Text is only ever appended, to
+    the last chunk.
+*/
+struct MemoryBudgetState
+{
+    int         spillFD;        // -1 until the first spill
+    char**      chunks;
+    uint32_t    numChunks;
+    uint32_t    chunkUsed;      // bytes used in the last chunk
+    BOOL        spillFailed;    // don't try again
+};
+
+// ============================================================================
+
+@interface ExeProcessor(MemoryBudget)
+
+- (void)setMemory: (UInt64)inBytes
+             kind: (uint32_t)inKind;
+- (void)addMemory: (SInt64)inBytes
+             kind: (uint32_t)inKind;
+- (UInt64)memoryInUse;
+- (BOOL)overMemoryBudget;
+- (char*)spillText: (const char*)inChars
+            length: (size_t)inLength;
+- (void)freeMemoryBudget;
+
+@end
@@ -0,0 +1,188 @@
+/*
+    MemoryBudget.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <sys/mman.h>
+#import <unistd.h>
+
+#import "MemoryBudget.h"
+
+@implementation ExeProcessor(MemoryBudget)
+
+//  setMemory:kind:
+// ----------------------------------------------------------------------------
+
+- (void)setMemory: (UInt64)inBytes
+             kind: (uint32_t)inKind
+{
+    iStats.memory[inKind]   = inBytes;
+
+    UInt64  inUse   = [self memoryInUse];
+
+    if (inUse > iStats.peakMemory)
+        iStats.peakMemory   = inUse;
+}
+
+//  addMemory:kind:
+// ----------------------------------------------------------------------------
+
+- (void)addMemory: (SInt64)inBytes
+             kind: (uint32_t)inKind
+{
+    if (inBytes < 0 && (UInt64)-inBytes > iStats.memory[inKind])
+        [self setMemory: 0 kind: inKind];
+    else
+        [self setMemory: iStats.memory[inKind] + inBytes kind: inKind];
+}
+
+//  memoryInUse
+// ----------------------------------------------------------------------------
+
+- (UInt64)memoryInUse
+{
+    UInt64      inUse   = 0;
+    uint32_t    i;
+
+    for (i = 0; i < NumMemoryKinds; i++)
+        inUse   += iStats.memory[i];
+
+    return inUse;
+}
+
+//  overMemoryBudget
+// ----------------------------------------------------------------------------
+
+- (BOOL)overMemoryBudget
+{
+    return (iOpts.maxMemory && [self memoryInUse] > iOpts.maxMemory);
+}
+
+//  spillText:length:
+// ----------------------------------------------------------------------------
+//  Copy inLength chars and a terminator to the spill file. Returns where
+//  the copy is mapped, or NULL if it couldn't be made, in which case the
+//  caller keeps the original. The caller frees the original otherwise.
+
+- (char*)spillText: (const char*)inChars
+            length: (size_t)inLength
+{
+    if (inLength + 1 > SPILL_CHUNK_SIZE)
+        return NULL;
+
+    if (!iMemoryBudget)
+    {
+        iMemoryBudget   = calloc(1, sizeof(MemoryBudgetState));
+
+        if (!iMemoryBudget)
+            return NULL;
+
+        iMemoryBudget->spillFD  = -1;
+    }
+
+    if (iMemoryBudget->spillFailed)
+        return NULL;
+
+    if (iMemoryBudget->spillFD == -1)
+    {
+        char    tempPath[MAXPATHLEN];
+
+        snprintf(tempPath, MAXPATHLEN, "%s/otx.spill.XXXXXX",
+            [NSTemporaryDirectory() fileSystemRepresentation]);
+
+        iMemoryBudget->spillFD  = mkstemp(tempPath);
+
+        if (iMemoryBudget->spillFD == -1)
+        {
+            perror("otx: unable to create spill file");
+            iMemoryBudget->spillFailed  = YES;
+            return NULL;
+        }
+
+        // Nobody else needs to see it, and it goes away with us.
+        unlink(tempPath);
+    }
+
+    if (!iMemoryBudget->numChunks ||
+        iMemoryBudget->chunkUsed + inLength + 1 > SPILL_CHUNK_SIZE)
+    {
+        // Get the full chunk on its way to disk.
+        if (iMemoryBudget->numChunks)
+            msync(iMemoryBudget->chunks[iMemoryBudget->numChunks - 1],
+                SPILL_CHUNK_SIZE, MS_ASYNC);
+
+        off_t   fileSize    =
+            (off_t)(iMemoryBudget->numChunks + 1) * SPILL_CHUNK_SIZE;
+        char**  chunks      = realloc(iMemoryBudget->chunks,
+            (iMemoryBudget->numChunks + 1) * sizeof(char*));
+
+        if (!chunks)
+        {
+            fprintf(stderr, "otx: not enough memory for spill file\n");
+            iMemoryBudget->spillFailed  = YES;
+            return NULL;
+        }
+
+        iMemoryBudget->chunks   = chunks;
+
+        if (ftruncate(iMemoryBudget->spillFD, fileSize) != 0)
+        {
+            perror("otx: unable to grow spill file");
+            iMemoryBudget->spillFailed  = YES;
+            return NULL;
+        }
+
+        char*   chunk   = mmap(NULL, SPILL_CHUNK_SIZE,
+            PROT_READ | PROT_WRITE, MAP_SHARED, iMemoryBudget->spillFD,
+            fileSize - SPILL_CHUNK_SIZE);
+
+        if (chunk == MAP_FAILED)
+        {
+            perror("otx: unable to map spill file");
+            iMemoryBudget->spillFailed  = YES;
+            return NULL;
+        }
+
+        iMemoryBudget->chunks[iMemoryBudget->numChunks++]   = chunk;
+        iMemoryBudget->chunkUsed    = 0;
+    }
+
+    char*   text    = iMemoryBudget->chunks[iMemoryBudget->numChunks - 1] +
+        iMemoryBudget->chunkUsed;
+
+    memcpy(text, inChars, inLength);
+    text[inLength]  = 0;
+
+    iMemoryBudget->chunkUsed    += inLength + 1;
+    iStats.counts[SpilledBytesCount]    += inLength + 1;
+
+    return text;
+}
+
+//  freeMemoryBudget
+// ----------------------------------------------------------------------------
+//  Call after the lines are deleted, since spilled text lives here.
+
+- (void)freeMemoryBudget
+{
+    if (!iMemoryBudget)
+        return;
+
+    uint32_t    i;
+
+    for (i = 0; i < iMemoryBudget->numChunks; i++)
+        munmap(iMemoryBudget->chunks[i], SPILL_CHUNK_SIZE);
+
+    if (iMemoryBudget->chunks)
+        free(iMemoryBudget->chunks);
+
+    if (iMemoryBudget->spillFD != -1)
+        close(iMemoryBudget->spillFD);
+
+    free(iMemoryBudget);
+    iMemoryBudget   = NULL;
+}
+
+@end
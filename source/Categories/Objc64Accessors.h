@@ -16,6 +16,9 @@
              fromMethod: (UInt64)inAddress;
 - (BOOL)getObjcMethod: (Method64Info**)outMI
           fromAddress: (UInt64)inAddress;
+- (BOOL)getObjcClassName: (char**)outClassName
+                selector: (char**)outSelName
+              fromMethod: (Method64Info*)inMI;
 - (BOOL)getObjcMethodList: (objc2_64_method_list_t*)outList
                   methods: (objc2_64_method_t**)outMethods
               fromAddress: (UInt64)inAddress;
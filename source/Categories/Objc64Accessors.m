@@ -51,6 +51,39 @@
     return (*outMI != NULL);
 }
 
+//  getObjcClassName:selector:fromMethod:
+// ----------------------------------------------------------------------------
+//  The names that make up a method's "-[Class selector]". Either out param
+//  may be NULL. Returns NO if the class name is unavailable.
+
+- (BOOL)getObjcClassName: (char**)outClassName
+                selector: (char**)outSelName
+              fromMethod: (Method64Info*)inMI
+{
+    char*   className   = NULL;
+
+    if (inMI->oc_class.data)
+    {
+        objc2_64_class_ro_t* roData = (objc2_64_class_ro_t*)(iDataSect.contents +
+            (uintptr_t)(inMI->oc_class.data - iDataSect.s.addr));
+
+        UInt64 name = roData->name;
+
+        if (iSwapped)
+            name = OSSwapInt64(name);
+
+        className = [self getPointer:name type:NULL];
+    }
+
+    if (outClassName)
+        *outClassName   = className;
+
+    if (outSelName)
+        *outSelName = [self getPointer:inMI->m.name type:NULL];
+
+    return (className != NULL);
+}
+
 //  getObjcMethodList:methods:fromAddress: (was get_method_list)
 // ----------------------------------------------------------------------------
 //  Removed the truncation flag. 'left' is no longer used by the caller.
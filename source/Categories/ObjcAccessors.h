@@ -18,6 +18,10 @@
                fromName: (const char*)inName;
 - (BOOL)getObjcMethod: (MethodInfo**)outMI
           fromAddress: (uint32_t)inAddress;
+- (BOOL)getObjcClassName: (char**)outClassName
+            categoryName: (char**)outCatName
+                selector: (char**)outSelName
+              fromMethod: (MethodInfo*)inMI;
 
 // Obj-C 1 Only
 - (BOOL)getObjc1CatPtr: (objc1_32_category**)outCat
@@ -112,6 +112,65 @@
     return (*outMI != NULL);
 }
 
+//  getObjcClassName:categoryName:selector:fromMethod:
+// ----------------------------------------------------------------------------
+//  The names that make up a method's "-[Class(Category) selector]". Any of
+//  the out params may be NULL. Returns NO if the class name is unavailable.
+
+- (BOOL)getObjcClassName: (char**)outClassName
+            categoryName: (char**)outCatName
+                selector: (char**)outSelName
+              fromMethod: (MethodInfo*)inMI
+{
+    MethodInfo  theSwappedInfo  = *inMI;
+    char*       className       = NULL;
+    char*       catName         = NULL;
+
+    if (iObjcVersion < 2)
+    {
+        // The method is in host order already.
+        if (iSwapped)
+        {
+            swap_objc1_32_class(&theSwappedInfo.oc_class);
+            swap_objc1_32_category(&theSwappedInfo.oc_cat);
+        }
+
+        if (theSwappedInfo.oc_cat.category_name)
+        {
+            className   = [self getPointer:theSwappedInfo.oc_cat.class_name type:NULL];
+            catName     = [self getPointer:theSwappedInfo.oc_cat.category_name type:NULL];
+        }
+        else if (theSwappedInfo.oc_class.name)
+            className   = [self getPointer:theSwappedInfo.oc_class.name type:NULL];
+    }
+    else if (iObjcVersion == 2)
+    {
+        if (theSwappedInfo.oc_class2.data)
+        {
+            objc2_32_class_ro_t* roData = (objc2_32_class_ro_t*)(iObjcConstSect.contents +
+                (uintptr_t)(theSwappedInfo.oc_class2.data - iObjcConstSect.s.addr));
+
+            UInt32 name = roData->name;
+
+            if (iSwapped)
+                name = OSSwapInt32(name);
+
+            className = [self getPointer:name type:NULL];
+        }
+    }
+
+    if (outClassName)
+        *outClassName   = className;
+
+    if (outCatName)
+        *outCatName = catName;
+
+    if (outSelName)
+        *outSelName = [self getPointer:theSwappedInfo.m.method_name type:NULL];
+
+    return (className != NULL);
+}
+
 //  getObjc1CatPtr:fromMethod:
 // ----------------------------------------------------------------------------
 //  Given a method imp address, return the category to which it belongs.
@@ -0,0 +1,82 @@
+/*
+    ObjcIndex.h
+
+    A category on ExeProcessor that keeps the Obj-C tables loadLCommands
+    builds, the sorted method infos and ivars, in the result cache
+    directory. They hold values and addresses only, never pointers, so the
+    file can be mapped and used as is. Later runs on the same slice map the
+    file instead of walking the Obj-C metadata again.
+
+    Files are named by the slice digest, so a changed executable never
+    picks up a stale one. Like the result cache, this only happens with
+    -cache, and old files are trimmed along with the results.
+
+    Arch-specific subclasses say which tables they have, see ObjectLoader
+    and Object64Loader.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+#define OBJC_INDEX_MAGIC        0x6f74786f  // 'otxo'
+#define OBJC_INDEX_VERSION      2
+#define OBJC_INDEX_FILE_EXT     @"otxo"
+#define MAX_OBJC_INDEX_TABLES   4
+
+/*  ObjcIndexTable
+
+    Where one table lives in the processor, and the size of its items.
+*/
+typedef struct
+{
+    void**      items;
+    uint32_t*   count;
+    uint32_t    itemSize;
+}
+ObjcIndexTable;
+
+/*  ObjcIndexHeader
+
+    The file is this header followed by the tables, each starting at its
+    offset from the start of the file, aligned to 8 bytes. Everything is in
+    host byte order; the items are exactly as the loaders left them.
+*/
+typedef struct
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    numTables;
+    uint32_t    padding;
+    uint32_t    itemSizes[MAX_OBJC_INDEX_TABLES];
+    uint32_t    counts[MAX_OBJC_INDEX_TABLES];
+    UInt64      offsets[MAX_OBJC_INDEX_TABLES];
+}
+ObjcIndexHeader;
+
+/*  ObjcIndexState
+
+    A mapped index. While it exists, the tables point into it and must not
+    be freed.
+*/
+struct ObjcIndexState
+{
+    char*   bytes;
+    size_t  size;
+};
+
+// ============================================================================
+
+@interface ExeProcessor(ObjcIndex)
+
+- (NSString*)objcIndexPath;
+- (BOOL)loadObjcIndex: (ObjcIndexTable*)ioTables
+                count: (uint32_t)inNumTables;
+- (BOOL)saveObjcIndex: (ObjcIndexTable*)inTables
+                count: (uint32_t)inNumTables;
+- (BOOL)objcTablesMapped;
+- (void)freeObjcIndex;
+
+@end
@@ -0,0 +1,244 @@
+/*
+    ObjcIndex.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <fcntl.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <sys/time.h>
+#import <unistd.h>
+
+#import "ObjcIndex.h"
+#import "ResultCache.h"
+
+#define OBJC_INDEX_ALIGNMENT    8
+
+// ============================================================================
+
+@implementation ExeProcessor(ObjcIndex)
+
+//  objcIndexPath
+// ----------------------------------------------------------------------------
+//  Next to the cached results. The slice digest alone identifies the
+//  tables, the options and the executable's path don't matter.
+
+- (NSString*)objcIndexPath
+{
+    NSString*   cacheDir    = [self resultCacheDirectory];
+    NSString*   sliceDigest = [self sliceDigestString];
+
+    if (!cacheDir || !sliceDigest)
+        return nil;
+
+    NSString*   fileName    = [NSString stringWithFormat: @"%@-%s",
+        sliceDigest, iArchString];
+
+    return [[cacheDir stringByAppendingPathComponent: fileName]
+        stringByAppendingPathExtension: OBJC_INDEX_FILE_EXT];
+}
+
+//  loadObjcIndex:count:
+// ----------------------------------------------------------------------------
+//  Map an earlier run's index and point ioTables into it. Returns NO if
+//  there's no usable index, in which case the tables are untouched.
+
+- (BOOL)loadObjcIndex: (ObjcIndexTable*)ioTables
+                count: (uint32_t)inNumTables
+{
+    if (iObjcIndex || inNumTables > MAX_OBJC_INDEX_TABLES)
+        return NO;
+
+    NSString*   indexPath   = [self objcIndexPath];
+
+    if (!indexPath)
+        return NO;
+
+    const char* indexCPath  = [indexPath fileSystemRepresentation];
+    int         indexFD     = open(indexCPath, O_RDONLY);
+    struct stat indexStats;
+
+    if (indexFD == -1)
+        return NO;
+
+    if (fstat(indexFD, &indexStats) != 0 ||
+        indexStats.st_size < (off_t)sizeof(ObjcIndexHeader))
+    {
+        close(indexFD);
+        return NO;
+    }
+
+    // Private and writable, in case anybody writes through a pointer into
+    // the tables.
+    char*   indexBytes  = mmap(NULL, indexStats.st_size,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE, indexFD, 0);
+
+    close(indexFD);
+
+    if (indexBytes == MAP_FAILED)
+        return NO;
+
+    ObjcIndexHeader*    header  = (ObjcIndexHeader*)indexBytes;
+    BOOL                valid   = header->magic == OBJC_INDEX_MAGIC &&
+        header->version == OBJC_INDEX_VERSION &&
+        header->numTables == inNumTables;
+    uint32_t            i;
+
+    for (i = 0; valid && i < inNumTables; i++)
+    {
+        UInt64  tableSize   =
+            (UInt64)header->counts[i] * ioTables[i].itemSize;
+
+        valid   = header->itemSizes[i] == ioTables[i].itemSize &&
+            !(header->offsets[i] % OBJC_INDEX_ALIGNMENT) &&
+            header->offsets[i] >= sizeof(ObjcIndexHeader) &&
+            header->offsets[i] + tableSize <= (UInt64)indexStats.st_size;
+    }
+
+    if (!valid)
+    {
+        fprintf(stderr, "otx: ignoring stale Obj-C index %s\n", indexCPath);
+        munmap(indexBytes, indexStats.st_size);
+        return NO;
+    }
+
+    iObjcIndex  = malloc(sizeof(ObjcIndexState));
+
+    if (!iObjcIndex)
+    {
+        munmap(indexBytes, indexStats.st_size);
+        return NO;
+    }
+
+    iObjcIndex->bytes   = indexBytes;
+    iObjcIndex->size    = indexStats.st_size;
+
+    for (i = 0; i < inNumTables; i++)
+    {
+        *ioTables[i].items  = (header->counts[i]) ?
+            indexBytes + header->offsets[i] : NULL;
+        *ioTables[i].count  = header->counts[i];
+    }
+
+    // Mark the index as recently used.
+    utimes(indexCPath, NULL);
+
+    return YES;
+}
+
+//  saveObjcIndex:count:
+// ----------------------------------------------------------------------------
+//  Write the tables as they are now. Written to a temp file and renamed, so
+//  a concurrent run never maps half an index. Nothing is written when
+//  there are no Obj-C tables to speak of.
+
+- (BOOL)saveObjcIndex: (ObjcIndexTable*)inTables
+                count: (uint32_t)inNumTables
+{
+    if (inNumTables > MAX_OBJC_INDEX_TABLES)
+        return NO;
+
+    ObjcIndexHeader header      = {OBJC_INDEX_MAGIC, OBJC_INDEX_VERSION,
+        inNumTables, 0};
+    UInt64          offset      = sizeof(header);
+    UInt64          numItems    = 0;
+    uint32_t        i;
+
+    for (i = 0; i < inNumTables; i++)
+    {
+        offset  = (offset + OBJC_INDEX_ALIGNMENT - 1) &
+            ~(UInt64)(OBJC_INDEX_ALIGNMENT - 1);
+
+        header.itemSizes[i] = inTables[i].itemSize;
+        header.counts[i]    = *inTables[i].count;
+        header.offsets[i]   = offset;
+        offset              += (UInt64)header.counts[i] * header.itemSizes[i];
+        numItems            += header.counts[i];
+    }
+
+    if (!numItems)
+        return NO;
+
+    NSString*   indexPath   = [self objcIndexPath];
+
+    if (!indexPath)
+        return NO;
+
+    char    tempPath[MAXPATHLEN];
+
+    snprintf(tempPath, MAXPATHLEN, "%s.XXXXXX",
+        [indexPath fileSystemRepresentation]);
+
+    int fd  = mkstemp(tempPath);
+
+    if (fd == -1)
+    {
+        perror("otx: unable to create Obj-C index temp file");
+        return NO;
+    }
+
+    FILE*   indexFile   = fdopen(fd, "w");
+
+    if (!indexFile)
+    {
+        perror("otx: unable to open Obj-C index temp file");
+        close(fd);
+        unlink(tempPath);
+        return NO;
+    }
+
+    static const char   zeros[OBJC_INDEX_ALIGNMENT]   = {0};
+    BOOL                success =
+        fwrite(&header, sizeof(header), 1, indexFile) == 1;
+
+    offset  = sizeof(header);
+
+    for (i = 0; success && i < inNumTables; i++)
+    {
+        size_t  padSize = (size_t)(header.offsets[i] - offset);
+
+        success = fwrite(zeros, 1, padSize, indexFile) == padSize &&
+            fwrite(*inTables[i].items, header.itemSizes[i], header.counts[i],
+                indexFile) == header.counts[i];
+        offset  = header.offsets[i] +
+            (UInt64)header.counts[i] * header.itemSizes[i];
+    }
+
+    if (fclose(indexFile) != 0)
+        success = NO;
+
+    if (!success || rename(tempPath, [indexPath fileSystemRepresentation]) != 0)
+    {
+        perror("otx: unable to write Obj-C index");
+        unlink(tempPath);
+        return NO;
+    }
+
+    return YES;
+}
+
+//  objcTablesMapped
+// ----------------------------------------------------------------------------
+//  YES if the tables came from an index, and belong to it.
+
+- (BOOL)objcTablesMapped
+{
+    return (iObjcIndex != NULL);
+}
+
+//  freeObjcIndex
+// ----------------------------------------------------------------------------
+
+- (void)freeObjcIndex
+{
+    if (!iObjcIndex)
+        return;
+
+    munmap(iObjcIndex->bytes, iObjcIndex->size);
+    free(iObjcIndex);
+    iObjcIndex  = NULL;
+}
+
+@end
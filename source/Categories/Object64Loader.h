@@ -15,6 +15,8 @@
 - (BOOL)loadMachHeader;
 - (void)loadLCommands;
 - (void)loadObjcClassList;
+- (void)loadObjcRefs;
+- (void)loadLiterals;
 - (void)loadSegment: (segment_command_64*)inSegPtr;
 - (void)loadSymbols: (symtab_command*)inSymPtr;
 - (void)loadCStringSection: (section_64*)inSect;
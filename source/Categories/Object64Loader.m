@@ -10,6 +10,10 @@
 
 #import "Object64Loader.h"
 #import "Objc64Accessors.h"
+#import "LiteralTable.h"
+#import "ObjcIndex.h"
+#import "RefTable.h"
+#import "TableUtils.h"
 
 @implementation Exe64Processor(Object64Loader)
 
@@ -47,6 +51,8 @@
             if (fa.cputype == iArchSelector)
             {
                 iMachHeaderPtr  = (mach_header_64*)(iRAMFile + fa.offset);
+                iSliceOffset    = fa.offset;
+                iSliceSize      = fa.size;
 //                iFileArchMagic      = *(uint32_t*)iMachHeaderPtr;
 //                iSwapped        = iFileArchMagic == MH_CIGAM || iFileArchMagic == MH_CIGAM_64;
                 uint32_t  targetArchMagic = *(uint32_t*)iMachHeaderPtr;
@@ -71,6 +77,8 @@
             case MH_MAGIC:
             case MH_MAGIC_64:
                 iMachHeaderPtr  =  (mach_header_64*)iRAMFile;
+                iSliceOffset    = 0;
+                iSliceSize      = iRAMFileSize;
                 break;
 
             default:
@@ -135,7 +143,22 @@
         ptr += theCommandCopy.cmdsize;
     }   // for(i = 0; i < mMachHeaderPtr->ncmds; i++)
 
+    [self loadObjcRefs];
+    [self loadLiterals];
+
+    // Load the objc classes, unless an earlier run saved the results.
+    ObjcIndexTable  objcTables[]    = {
+        {(void**)&iClassMethodInfos, &iNumClassMethodInfos,
+            sizeof(Method64Info)},
+        {(void**)&iClassIvars, &iNumClassIvars, sizeof(objc2_64_ivar_t)}};
+
+    if (iOpts.resultCache && [self loadObjcIndex: objcTables count: 2])
+        return;
+
     [self loadObjcClassList];
+
+    if (iOpts.resultCache)
+        [self saveObjcIndex: objcTables count: 2];
 }
 
 //  loadObjcClassList
@@ -150,6 +173,8 @@
     uint64_t* classList = (uint64_t*)iObjcClassListSect.contents;
     uint64_t fileClassPtr;
     uint32_t i;
+    uint32_t classMethodInfoCapacity = iNumClassMethodInfos;
+    uint32_t classIvarCapacity = iNumClassIvars;
 
     for (i = 0; i < numClasses; i++)
     {
@@ -205,10 +230,10 @@
 
                     Method64Info methodInfo = {swappedMethod, workingClass, YES};
 
-                    iNumClassMethodInfos++;
-                    iClassMethodInfos   = realloc(iClassMethodInfos,
-                        iNumClassMethodInfos * sizeof(Method64Info));
-                    iClassMethodInfos[iNumClassMethodInfos - 1] = methodInfo;
+                    if (GrowTable((void**)&iClassMethodInfos,
+                        iNumClassMethodInfos, &classMethodInfoCapacity,
+                        sizeof(Method64Info)))
+                        iClassMethodInfos[iNumClassMethodInfos++] = methodInfo;
                 }
             }
 
@@ -229,10 +254,9 @@
                     if (iSwapped)
                         swap_objc2_64_ivar(&swappedIvar);
 
-                    iNumClassIvars++;
-                    iClassIvars = realloc(iClassIvars,
-                        iNumClassIvars * sizeof(objc2_64_ivar_t));
-                    iClassIvars[iNumClassIvars - 1] = swappedIvar;
+                    if (GrowTable((void**)&iClassIvars, iNumClassIvars,
+                        &classIvarCapacity, sizeof(objc2_64_ivar_t)))
+                        iClassIvars[iNumClassIvars++] = swappedIvar;
                 }
             }
         }
@@ -275,22 +299,69 @@
 
                         Method64Info methodInfo = {swappedMethod, workingClass, NO};
 
-                        iNumClassMethodInfos++;
-                        iClassMethodInfos   = realloc(iClassMethodInfos,
-                            iNumClassMethodInfos * sizeof(Method64Info));
-                        iClassMethodInfos[iNumClassMethodInfos - 1] = methodInfo;
+                        if (GrowTable((void**)&iClassMethodInfos,
+                            iNumClassMethodInfos, &classMethodInfoCapacity,
+                            sizeof(Method64Info)))
+                            iClassMethodInfos[iNumClassMethodInfos++] =
+                                methodInfo;
                     }
                 }
             }
         }
     }
 
-    qsort(iClassMethodInfos, iNumClassMethodInfos, sizeof(Method64Info),
-        (COMPARISON_FUNC_TYPE)
-        (iSwapped ? Method64Info_Compare_Swapped : Method64Info_Compare));
-    qsort(iClassIvars, iNumClassIvars, sizeof(objc2_64_ivar_t),
+    SortTableByKey(iClassMethodInfos, iNumClassMethodInfos,
+        sizeof(Method64Info), offsetof(Method64Info, m.imp),
+        sizeof(iClassMethodInfos->m.imp), NO,
+        (COMPARISON_FUNC_TYPE)Method64Info_Compare);
+    SortTableByKey(iClassIvars, iNumClassIvars, sizeof(objc2_64_ivar_t),
+        offsetof(objc2_64_ivar_t, offset), sizeof(iClassIvars->offset), NO,
         (COMPARISON_FUNC_TYPE)objc2_64_ivar_t_Compare);
 }
+//  loadObjcRefs
+// ----------------------------------------------------------------------------
+//  Resolve every selector and class reference up front, see RefTable.
+//  getPointer:type: has to know about all the sections by now.
+
+- (void)loadObjcRefs
+{
+    struct {
+        section_info_64*    sect;
+        uint32_t            slotSize;
+        uint32_t            kind;
+        UInt8               type;
+    } refs[]    = {
+        {&iObjcSelRefsSect, sizeof(UInt64), SelectorRefSection,
+            OCSelRefType},
+        {&iObjcMsgRefsSect, sizeof(objc2_64_message_ref_t),
+            SelectorRefSection, OCMsgRefType},
+        {&iObjcClassRefsSect, sizeof(UInt64), ClassRefSection,
+            OCClassRefType}};
+    RefSection* refSect;
+    uint32_t    i;
+    UInt64      j;
+
+    for (i = 0; i < sizeof(refs) / sizeof(refs[0]); i++)
+    {
+        section_info_64*    sect    = refs[i].sect;
+
+        refSect = [self addRefSection: sect->s.addr size: sect->size
+            slotSize: refs[i].slotSize kind: refs[i].kind];
+
+        if (!refSect)
+            continue;
+
+        for (j = 0; j < sect->size / refs[i].slotSize; j++)
+        {
+            UInt8   type    = PointerType;
+            char*   string  = [self getPointer: sect->s.addr +
+                j * refs[i].slotSize type: &type];
+
+            if (type == refs[i].type)
+                refSect->strings[j] = string;
+        }
+    }
+}
 
 //  loadSegment:
 // ----------------------------------------------------------------------------
@@ -403,43 +474,100 @@
 
     iStringTableOffset     = swappedSymTab.stroff;
     nlist_64*  theSymPtr   = (nlist_64*)((char*)iMachHeaderPtr + swappedSymTab.symoff);
-    nlist_64   theSym      = {0};
+    uint32_t  numKept     = 0;
     uint32_t  i;
 
-    // loop thru symbols
+    // Count the symbols we keep, then copy them in one go. n_type is a
+    // byte, and a zero n_value is zero either way, so nothing needs
+    // swapping yet.
     for (i = 0; i < swappedSymTab.nsyms; i++)
     {
-        theSym  = theSymPtr[i];
+        if (theSymPtr[i].n_value != 0 &&
+            (theSymPtr[i].n_type & N_STAB) == 0 &&  // not a STAB
+            (theSymPtr[i].n_type & N_SECT) == N_SECT)
+            numKept++;
+    }
 
-        if (iSwapped)
-            swap_nlist_64(&theSym, 1, OSHostByteOrder());
+    if (!numKept)
+        return;
 
-        if (theSym.n_value == 0)
-            continue;
+    nlist_64*  newSyms = realloc(iFuncSyms,
+        (iNumFuncSyms + numKept) * sizeof(nlist_64));
 
-        if ((theSym.n_type & N_STAB) == 0)  // not a STAB
-        {
-            if ((theSym.n_type & N_SECT) != N_SECT)
-                continue;
+    if (!newSyms)
+    {
+        fprintf(stderr, "otx: not enough memory for symbols\n");
+        return;
+    }
+
+    nlist_64*  theKeptSyms = newSyms + iNumFuncSyms;
+    uint32_t  k           = 0;
 
-            iNumFuncSyms++;
-            iFuncSyms   = realloc(iFuncSyms,
-                iNumFuncSyms * sizeof(nlist_64));
-            iFuncSyms[iNumFuncSyms - 1] = theSym;
+    for (i = 0; i < swappedSymTab.nsyms; i++)
+    {
+        if (theSymPtr[i].n_value != 0 &&
+            (theSymPtr[i].n_type & N_STAB) == 0 &&
+            (theSymPtr[i].n_type & N_SECT) == N_SECT)
+            theKeptSyms[k++]    = theSymPtr[i];
+    }
+
+    // Swap them all at once.
+    if (iSwapped)
+        swap_nlist_64(theKeptSyms, numKept, OSHostByteOrder());
+
+    iFuncSyms       = newSyms;
+    iNumFuncSyms    += numKept;
 
 #ifdef OTX_DEBUG
 #if _OTX_DEBUG_SYMBOLS_
-            [self printSymbol: theSym];
+    for (i = 0; i < numKept; i++)
+        [self printSymbol: theKeptSyms[i]];
 #endif
 #endif
-        }
-    }   // for (i = 0; i < swappedSymTab.nsyms; i++)
 
     // Sort the symbols so we can use binary searches later.
-    qsort(iFuncSyms, iNumFuncSyms, sizeof(nlist_64),
+    SortTableByKey(iFuncSyms, iNumFuncSyms, sizeof(nlist_64),
+        offsetof(nlist_64, n_value), sizeof(iFuncSyms->n_value), NO,
         (COMPARISON_FUNC_TYPE)Sym_Compare_64);
 }
 
+//  loadLiterals
+// ----------------------------------------------------------------------------
+//  Render the literals up front, see LiteralTable. The CFStrings are only
+//  added where getPointer:type: agrees on their type.
+
+- (void)loadLiterals
+{
+    UInt8   type;
+    char*   text;
+    UInt64  i;
+
+    [self addCStringLiterals: iCStringSect.contents
+        address: iCStringSect.s.addr size: iCStringSect.size];
+    [self addNumberLiterals: iLit4Sect.contents
+        address: iLit4Sect.s.addr size: iLit4Sect.size type: FloatType];
+    [self addNumberLiterals: iLit8Sect.contents
+        address: iLit8Sect.s.addr size: iLit8Sect.size type: DoubleType];
+
+    // (__DATA,__cfstring)
+    for (i = 0; i + sizeof(cfstring_object_64) <= iCFStringSect.size;
+        i += sizeof(cfstring_object_64))
+    {
+        type    = PointerType;
+
+        if (![self getPointer: iCFStringSect.s.addr + i type: &type] ||
+            type != CFStringType)
+            continue;
+
+        if ([self getObjcDescription: &text
+            fromObject: iCFStringSect.contents + i type: CFStringType])
+            [self addLiteral: iCFStringSect.s.addr + i text: text
+                type: CFStringType];
+    }
+
+    [self indexLiterals];
+}
+
 //  loadCStringSection:
 // ----------------------------------------------------------------------------
 
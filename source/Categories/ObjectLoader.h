@@ -19,6 +19,8 @@
 - (void)loadObjcSection: (section*)inSect;
 - (void)loadObjcModules;
 - (void)loadObjcClassList;
+- (void)loadObjcRefs;
+- (void)loadLiterals;
 - (void)loadCStringSection: (section*)inSect;
 - (void)loadNSStringSection: (section*)inSect;
 - (void)loadClassSection: (section*)inSect;
@@ -10,6 +10,10 @@
 
 #import "ObjectLoader.h"
 #import "ObjcAccessors.h"
+#import "LiteralTable.h"
+#import "ObjcIndex.h"
+#import "RefTable.h"
+#import "TableUtils.h"
 
 @implementation Exe32Processor(ObjectLoader)
 
@@ -47,6 +51,8 @@
             if (fa.cputype == iArchSelector)
             {
                 iMachHeaderPtr  = (mach_header*)(iRAMFile + fa.offset);
+                iSliceOffset    = fa.offset;
+                iSliceSize      = fa.size;
 //                iFileArchMagic      = *(uint32_t*)iMachHeaderPtr;
 //                iSwapped        = iFileArchMagic == MH_CIGAM || iFileArchMagic == MH_CIGAM_64;
                 uint32_t  targetArchMagic = *(uint32_t*)iMachHeaderPtr;
@@ -71,6 +77,8 @@
             case MH_MAGIC:
             case MH_MAGIC_64:
                 iMachHeaderPtr  =  (mach_header*)iRAMFile;
+                iSliceOffset    = 0;
+                iSliceSize      = iRAMFileSize;
                 break;
 
             default:
@@ -141,9 +149,24 @@
         iObjcVersion = 1;
     }
 
-    // Now that we have all the objc sections, we can load the objc modules.
+    [self loadObjcRefs];
+    [self loadLiterals];
+
+    // Now that we have all the objc sections, we can load the objc modules,
+    // unless an earlier run saved the results.
+    ObjcIndexTable  objcTables[]    = {
+        {(void**)&iClassMethodInfos, &iNumClassMethodInfos, sizeof(MethodInfo)},
+        {(void**)&iCatMethodInfos, &iNumCatMethodInfos, sizeof(MethodInfo)},
+        {(void**)&iClassIvars, &iNumClassIvars, sizeof(objc2_32_ivar_t)}};
+
+    if (iOpts.resultCache && [self loadObjcIndex: objcTables count: 3])
+        return;
+
     [self loadObjcModules];
     [self loadObjcClassList];
+
+    if (iOpts.resultCache)
+        [self saveObjcIndex: objcTables count: 3];
 }
 
 //  loadSegment:
@@ -262,40 +285,60 @@
 
     iStringTableOffset  = swappedSymTab.stroff;
     nlist*  theSymPtr   = (nlist*)((char*)iMachHeaderPtr + swappedSymTab.symoff);
-    nlist   theSym      = {0};
+    uint32_t  numKept     = 0;
     uint32_t  i;
 
-    // loop thru symbols
+    // Count the symbols we keep, then copy them in one go. n_type is a
+    // byte, and a zero n_value is zero either way, so nothing needs
+    // swapping yet.
     for (i = 0; i < swappedSymTab.nsyms; i++)
     {
-        theSym  = theSymPtr[i];
+        if (theSymPtr[i].n_value != 0 &&
+            (theSymPtr[i].n_type & N_STAB) == 0 &&  // not a STAB
+            (theSymPtr[i].n_type & N_SECT) == N_SECT)
+            numKept++;
+    }
 
-        if (iSwapped)
-            swap_nlist(&theSym, 1, OSHostByteOrder());
+    if (!numKept)
+        return;
 
-        if (theSym.n_value == 0)
-            continue;
+    nlist*  newSyms = realloc(iFuncSyms,
+        (iNumFuncSyms + numKept) * sizeof(nlist));
 
-        if ((theSym.n_type & N_STAB) == 0)  // not a STAB
-        {
-            if ((theSym.n_type & N_SECT) != N_SECT)
-                continue;
+    if (!newSyms)
+    {
+        fprintf(stderr, "otx: not enough memory for symbols\n");
+        return;
+    }
+
+    nlist*  theKeptSyms = newSyms + iNumFuncSyms;
+    uint32_t  k           = 0;
+
+    for (i = 0; i < swappedSymTab.nsyms; i++)
+    {
+        if (theSymPtr[i].n_value != 0 &&
+            (theSymPtr[i].n_type & N_STAB) == 0 &&
+            (theSymPtr[i].n_type & N_SECT) == N_SECT)
+            theKeptSyms[k++]    = theSymPtr[i];
+    }
 
-            iNumFuncSyms++;
-            iFuncSyms   = realloc(iFuncSyms,
-                iNumFuncSyms * sizeof(nlist));
-            iFuncSyms[iNumFuncSyms - 1] = theSym;
+    // Swap them all at once.
+    if (iSwapped)
+        swap_nlist(theKeptSyms, numKept, OSHostByteOrder());
+
+    iFuncSyms       = newSyms;
+    iNumFuncSyms    += numKept;
 
 #ifdef OTX_DEBUG
 #if _OTX_DEBUG_SYMBOLS_
-            [self printSymbol: theSym];
+    for (i = 0; i < numKept; i++)
+        [self printSymbol: theKeptSyms[i]];
 #endif
 #endif
-        }
-    }   // for (i = 0; i < swappedSymTab.nsyms; i++)
 
     // Sort the symbols so we can use binary searches later.
-    qsort(iFuncSyms, iNumFuncSyms, sizeof(nlist),
+    SortTableByKey(iFuncSyms, iNumFuncSyms, sizeof(nlist),
+        offsetof(nlist, n_value), sizeof(iFuncSyms->n_value), NO,
         (COMPARISON_FUNC_TYPE)Sym_Compare);
 }
 
@@ -347,6 +390,8 @@
     uint32_t*           theDefs;
     uint32_t            theOffset;
     uint32_t            i, j, k;
+    uint32_t            classMethodInfoCapacity = iNumClassMethodInfos;
+    uint32_t            catMethodInfoCapacity   = iNumCatMethodInfos;
 
     // Loop thru objc sections.
     for (i = 0; i < iNumObjcSects; i++)
@@ -436,12 +481,13 @@
                             swap_objc1_32_method(&theSwappedMethod);
 
                         MethodInfo  theMethInfo =
-                            {theMethod, theClass, {0}, YES};
+                            {theSwappedMethod, theClass, {0}, YES};
 
-                        iNumClassMethodInfos++;
-                        iClassMethodInfos   = realloc(iClassMethodInfos,
-                            iNumClassMethodInfos * sizeof(MethodInfo));
-                        iClassMethodInfos[iNumClassMethodInfos - 1] = theMethInfo;
+                        if (GrowTable((void**)&iClassMethodInfos,
+                            iNumClassMethodInfos, &classMethodInfoCapacity,
+                            sizeof(MethodInfo)))
+                            iClassMethodInfos[iNumClassMethodInfos++] =
+                                theMethInfo;
                     }
                 }
 
@@ -472,14 +518,13 @@
                                 swap_objc1_32_method(&theSwappedMethod);
 
                             MethodInfo  theMethInfo =
-                                {theMethod, theClass, {0}, NO};
+                                {theSwappedMethod, theClass, {0}, NO};
 
-                            iNumClassMethodInfos++;
-                            iClassMethodInfos   = realloc(
-                                iClassMethodInfos, iNumClassMethodInfos *
-                                sizeof(MethodInfo));
-                            iClassMethodInfos[iNumClassMethodInfos - 1] =
-                                theMethInfo;
+                            if (GrowTable((void**)&iClassMethodInfos,
+                                iNumClassMethodInfos, &classMethodInfoCapacity,
+                                sizeof(MethodInfo)))
+                                iClassMethodInfos[iNumClassMethodInfos++] =
+                                    theMethInfo;
                         }
                     }
                 }   // theMetaClass != nil
@@ -536,12 +581,12 @@
                             swap_objc1_32_method(&theSwappedMethod);
 
                         MethodInfo  theMethInfo =
-                            {theMethod, theClass, theCat, YES};
+                            {theSwappedMethod, theClass, theCat, YES};
 
-                        iNumCatMethodInfos++;
-                        iCatMethodInfos = realloc(iCatMethodInfos,
-                            iNumCatMethodInfos * sizeof(MethodInfo));
-                        iCatMethodInfos[iNumCatMethodInfos - 1] = theMethInfo;
+                        if (GrowTable((void**)&iCatMethodInfos,
+                            iNumCatMethodInfos, &catMethodInfoCapacity,
+                            sizeof(MethodInfo)))
+                            iCatMethodInfos[iNumCatMethodInfos++] = theMethInfo;
                     }
                 }
 
@@ -564,12 +609,12 @@
                             swap_objc1_32_method(&theSwappedMethod);
 
                         MethodInfo  theMethInfo =
-                            {theMethod, theClass, theCat, NO};
+                            {theSwappedMethod, theClass, theCat, NO};
 
-                        iNumCatMethodInfos++;
-                        iCatMethodInfos = realloc(iCatMethodInfos,
-                            iNumCatMethodInfos * sizeof(MethodInfo));
-                        iCatMethodInfos[iNumCatMethodInfos - 1] = theMethInfo;
+                        if (GrowTable((void**)&iCatMethodInfos,
+                            iNumCatMethodInfos, &catMethodInfoCapacity,
+                            sizeof(MethodInfo)))
+                            iCatMethodInfos[iNumCatMethodInfos++] = theMethInfo;
                     }
                 }
             }   // for (; j < theSymTab.cat_def_cnt; j++)
@@ -586,12 +631,14 @@
     }   // for (i = 0; i < mNumObjcSects; i++)
 
     // Sort MethodInfos.
-    qsort(iClassMethodInfos, iNumClassMethodInfos, sizeof(MethodInfo),
-        (COMPARISON_FUNC_TYPE)
-        (iSwapped ? MethodInfo_Compare_Swapped : MethodInfo_Compare));
-    qsort(iCatMethodInfos, iNumCatMethodInfos, sizeof(MethodInfo),
-        (COMPARISON_FUNC_TYPE)
-        (iSwapped ? MethodInfo_Compare_Swapped : MethodInfo_Compare));
+    SortTableByKey(iClassMethodInfos, iNumClassMethodInfos,
+        sizeof(MethodInfo), offsetof(MethodInfo, m.method_imp),
+        sizeof(iClassMethodInfos->m.method_imp), NO,
+        (COMPARISON_FUNC_TYPE)MethodInfo_Compare);
+    SortTableByKey(iCatMethodInfos, iNumCatMethodInfos,
+        sizeof(MethodInfo), offsetof(MethodInfo, m.method_imp),
+        sizeof(iCatMethodInfos->m.method_imp), NO,
+        (COMPARISON_FUNC_TYPE)MethodInfo_Compare);
 }
 
 //  loadObjcClassList
@@ -606,6 +653,8 @@
     uint32_t* classList = (uint32_t*)iObjcClassListSect.contents;
     uint32_t fileClassPtr;
     uint32_t i;
+    uint32_t classMethodInfoCapacity = iNumClassMethodInfos;
+    uint32_t classIvarCapacity = iNumClassIvars;
 
     for (i = 0; i < numClasses; i++)
     {
@@ -664,10 +713,10 @@
                     methodInfo.m2 = swappedMethod;
                     methodInfo.oc_class2 = workingClass;
 
-                    iNumClassMethodInfos++;
-                    iClassMethodInfos   = realloc(iClassMethodInfos,
-                        iNumClassMethodInfos * sizeof(MethodInfo));
-                    iClassMethodInfos[iNumClassMethodInfos - 1] = methodInfo;
+                    if (GrowTable((void**)&iClassMethodInfos,
+                        iNumClassMethodInfos, &classMethodInfoCapacity,
+                        sizeof(MethodInfo)))
+                        iClassMethodInfos[iNumClassMethodInfos++] = methodInfo;
                 }
             }
 
@@ -688,10 +737,9 @@
                     if (iSwapped)
                         swap_objc2_32_ivar(&swappedIvar);
 
-                    iNumClassIvars++;
-                    iClassIvars = realloc(iClassIvars,
-                        iNumClassIvars * sizeof(objc2_32_ivar_t));
-                    iClassIvars[iNumClassIvars - 1] = swappedIvar;
+                    if (GrowTable((void**)&iClassIvars, iNumClassIvars,
+                        &classIvarCapacity, sizeof(objc2_32_ivar_t)))
+                        iClassIvars[iNumClassIvars++] = swappedIvar;
                 }
             }
         }
@@ -736,23 +784,167 @@
                         methodInfo.m2 = swappedMethod;
                         methodInfo.oc_class2 = workingClass;
 
-                        iNumClassMethodInfos++;
-                        iClassMethodInfos   = realloc(iClassMethodInfos,
-                            iNumClassMethodInfos * sizeof(MethodInfo));
-                        iClassMethodInfos[iNumClassMethodInfos - 1] = methodInfo;
+                        if (GrowTable((void**)&iClassMethodInfos,
+                            iNumClassMethodInfos, &classMethodInfoCapacity,
+                            sizeof(MethodInfo)))
+                            iClassMethodInfos[iNumClassMethodInfos++] =
+                                methodInfo;
                     }
                 }
             }
         }
     }
 
-    qsort(iClassMethodInfos, iNumClassMethodInfos, sizeof(MethodInfo),
-        (COMPARISON_FUNC_TYPE)
-        (iSwapped ? MethodInfo_Compare_Swapped : MethodInfo_Compare));
-    qsort(iClassIvars, iNumClassIvars, sizeof(objc2_32_ivar_t),
+    SortTableByKey(iClassMethodInfos, iNumClassMethodInfos,
+        sizeof(MethodInfo), offsetof(MethodInfo, m.method_imp),
+        sizeof(iClassMethodInfos->m.method_imp), NO,
+        (COMPARISON_FUNC_TYPE)MethodInfo_Compare);
+    SortTableByKey(iClassIvars, iNumClassIvars, sizeof(objc2_32_ivar_t),
+        offsetof(objc2_32_ivar_t, offset), sizeof(iClassIvars->offset), NO,
         (COMPARISON_FUNC_TYPE)objc2_32_ivar_t_Compare);
 }
 
+//  loadObjcRefs
+// ----------------------------------------------------------------------------
+//  Resolve every selector and class reference up front, see RefTable.
+//  getPointer:type: has to know about all the sections by now.
+
+- (void)loadObjcRefs
+{
+    RefSection* refSect;
+    uint32_t    i, j;
+
+    // Obj-C 1 references hold the address of a C string.
+    for (i = 0; i < iNumObjcSects; i++)
+    {
+        section_info*   sect    = &iObjcSects[i];
+        uint32_t        kind;
+
+        if (!strcmp(sect->s.sectname, "__message_refs"))
+            kind    = SelectorRefSection;
+        else if (!strcmp(sect->s.sectname, "__cls_refs"))
+            kind    = ClassRefSection;
+        else
+            continue;
+
+        refSect = [self addRefSection: sect->s.addr size: sect->size
+            slotSize: sizeof(uint32_t) kind: kind];
+
+        if (!refSect)
+            continue;
+
+        uint32_t*   refs    = (uint32_t*)sect->contents;
+
+        for (j = 0; j < sect->size / sizeof(uint32_t); j++)
+        {
+            uint32_t    ref = refs[j];
+
+            if (iSwapped)
+                ref = OSSwapInt32(ref);
+
+            refSect->strings[j] = [self getPointer: ref type: NULL];
+        }
+    }
+
+    // getPointer:type: resolves Obj-C 2 references itself.
+    struct {
+        section_info*   sect;
+        uint32_t        slotSize;
+        uint32_t        kind;
+        UInt8           type;
+    } objc2Refs[]   = {
+        {&iObjcSelRefsSect, sizeof(uint32_t), SelectorRefSection,
+            OCSelRefType},
+        {&iObjcMsgRefsSect, sizeof(objc2_32_message_ref_t),
+            SelectorRefSection, OCMsgRefType},
+        {&iObjcClassRefsSect, sizeof(uint32_t), ClassRefSection,
+            OCClassRefType}};
+
+    for (i = 0; i < sizeof(objc2Refs) / sizeof(objc2Refs[0]); i++)
+    {
+        section_info*   sect    = objc2Refs[i].sect;
+
+        refSect = [self addRefSection: sect->s.addr size: sect->size
+            slotSize: objc2Refs[i].slotSize kind: objc2Refs[i].kind];
+
+        if (!refSect)
+            continue;
+
+        for (j = 0; j < sect->size / objc2Refs[i].slotSize; j++)
+        {
+            UInt8   type    = PointerType;
+            char*   string  = [self getPointer: sect->s.addr +
+                j * objc2Refs[i].slotSize type: &type];
+
+            if (type == objc2Refs[i].type)
+                refSect->strings[j] = string;
+        }
+    }
+}
+
+//  loadLiterals
+// ----------------------------------------------------------------------------
+//  Render the literals up front, see LiteralTable. The string objects are
+//  only added where getPointer:type: agrees on their type.
+
+- (void)loadLiterals
+{
+    UInt8       type;
+    char*       text;
+    uint32_t    i;
+
+    [self addCStringLiterals: iCStringSect.contents
+        address: iCStringSect.s.addr size: iCStringSect.size];
+    [self addNumberLiterals: iLit4Sect.contents
+        address: iLit4Sect.s.addr size: iLit4Sect.size type: FloatType];
+    [self addNumberLiterals: iLit8Sect.contents
+        address: iLit8Sect.s.addr size: iLit8Sect.size type: DoubleType];
+
+    // (__OBJC,__cstring_object)
+    for (i = 0; i + sizeof(nxstring_object) <= iNSStringSect.size;
+        i += sizeof(nxstring_object))
+    {
+        type    = PointerType;
+
+        if (![self getPointer: iNSStringSect.s.addr + i type: &type] ||
+            type != OCStrObjectType)
+            continue;
+
+        if ([self getObjc1Description: &text
+            fromObject: iNSStringSect.contents + i type: OCStrObjectType])
+            [self addLiteral: iNSStringSect.s.addr + i text: text
+                type: OCStrObjectType];
+    }
+
+    // (__DATA,__cfstring)
+    for (i = 0; i + sizeof(cfstring_object) <= iCFStringSect.size;
+        i += sizeof(cfstring_object))
+    {
+        type    = PointerType;
+
+        if (![self getPointer: iCFStringSect.s.addr + i type: &type] ||
+            type != CFStringType)
+            continue;
+
+        cfstring_object theCFString =
+            *(cfstring_object*)(iCFStringSect.contents + i);
+
+        if (theCFString.oc_string.length == 0)
+            continue;
+
+        if (iSwapped)
+            theCFString.oc_string.chars =
+                OSSwapInt32(theCFString.oc_string.chars);
+
+        text    = [self getPointer: theCFString.oc_string.chars type: NULL];
+
+        if (text)
+            [self addLiteral: iCFStringSect.s.addr + i text: text
+                type: CFStringType];
+    }
+
+    [self indexLiterals];
+}
 
 //  loadCStringSection:
 // ----------------------------------------------------------------------------
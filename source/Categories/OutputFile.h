@@ -0,0 +1,25 @@
+/*
+    OutputFile.h
+
+    A category on ExeProcessor that owns the output file while it's being
+    written. printLinesFromList: opens it, printDataSections appends to it,
+    and processExe: closes it. Everything goes through an OutputWriter, so
+    writing and compression happen on the writer's thread.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+#define COMPRESSED_OUTPUT_FILE_EXT  @"gz"
+
+@interface ExeProcessor(OutputFile)
+
+- (BOOL)openOutputFile;
+- (BOOL)writeOutput: (const char*)inBytes
+             length: (size_t)inLength;
+- (BOOL)closeOutputFile;
+
+@end
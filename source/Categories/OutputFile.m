@@ -0,0 +1,112 @@
+/*
+    OutputFile.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "OutputFile.h"
+#import "OutputIndex.h"
+
+@implementation ExeProcessor(OutputFile)
+
+//  openOutputFile
+// ----------------------------------------------------------------------------
+//  Open iOutputFilePath, or stdout in the CLI target where iOutputFilePath
+//  is nil, and start the output index.
+
+- (BOOL)openOutputFile
+{
+    if (iOutputWriter)
+        return YES;
+
+    if (iOutputFilePath)
+        iOutputFile = fopen(UTF8STRING(iOutputFilePath), "w");
+    else
+    {
+        iOutputFile = stdout;
+        fflush(stdout);
+    }
+
+    if (!iOutputFile)
+    {
+        perror("otx: unable to open output file");
+        return NO;
+    }
+
+    [self beginOutputIndex: iOutputFile];
+
+    iOutputWriter   = OutputWriterOpen(fileno(iOutputFile),
+        (iOpts.compressOutput) ? GzipCompression : NoCompression,
+        !iOpts.serial);
+
+    if (!iOutputWriter)
+    {
+        [self freeOutputIndex];
+
+        if (iOutputFilePath)
+            fclose(iOutputFile);
+
+        iOutputFile = NULL;
+
+        return NO;
+    }
+
+    return YES;
+}
+
+//  writeOutput:length:
+// ----------------------------------------------------------------------------
+
+- (BOOL)writeOutput: (const char*)inBytes
+             length: (size_t)inLength
+{
+    if (!OutputWriterWrite(iOutputWriter, inBytes, inLength))
+        return NO;
+
+    iStats.counts[BytesWrittenCount]    += inLength;
+
+    return YES;
+}
+
+//  closeOutputFile
+// ----------------------------------------------------------------------------
+//  Wait for the writer to finish, and hand its frames to the output index.
+//  Does nothing if the output file isn't open.
+
+- (BOOL)closeOutputFile
+{
+    if (!iOutputWriter)
+        return YES;
+
+    OutputFrame*    frames      = NULL;
+    uint32_t        numFrames   = 0;
+    BOOL            written     =
+        OutputWriterClose(iOutputWriter, &frames, &numFrames);
+
+    iOutputWriter   = NULL;
+
+    if (written && iOpts.compressOutput)
+        [self setOutputIndexFrames: frames count: numFrames];
+    else if (frames)
+        free(frames);
+
+    if (!written)
+        [self freeOutputIndex];
+
+    if (iOutputFilePath)
+    {
+        if (fclose(iOutputFile) != 0)
+        {
+            perror("otx: unable to close output file");
+            written = NO;
+        }
+    }
+
+    iOutputFile = NULL;
+
+    return written;
+}
+
+@end
@@ -0,0 +1,177 @@
+/*
+    OutputIndex.h
+
+    A category on ExeProcessor that writes a sidecar index next to each
+    output file, "foo.txt" -> "foo.txt.idx". The index maps every function
+    in the output to the byte offset and line number where its text
+    begins, so that viewers can seek straight to it.
+
+    The index is written whenever the output goes to a regular file,
+    including stdout redirected to one. Its header records the size of the
+    output file, and a stale index is ignored.
+
+    Offsets are into the output text. When the output is compressed, the
+    index also lists the OutputFrames the text was compressed in, so a
+    function can be read by decompressing from the frame that contains it.
+
+    PrintIndexedFunction implements 'otx -lookup', and MapOutputIndex lets
+    -diff read functions back the same way. CopyOutputIndex and
+    RemoveOutputIndex also take care of the CrossRefs sidecar.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+#define OUTPUT_INDEX_MAGIC          0x6f747869  // 'otxi'
+#define OUTPUT_INDEX_VERSION        3
+#define OUTPUT_INDEX_FILE_EXT       @"idx"
+#define MAX_INDEX_NAME_LENGTH       1024
+
+/*  OutputIndexHeader
+
+    The index file is a header, 'numEntries' OutputIndexEntry's in output
+    order, 'numFrames' OutputFrame's, and 'namesSize' bytes of
+    null-terminated names. All in host byte order.
+*/
+typedef struct
+{
+    uint32_t    magic;
+    uint32_t    version;
+    UInt64      outputSize;     // of the finished output file
+    UInt64      textEnd;        // offset just past the last code line
+    uint32_t    numEntries;
+    uint32_t    namesSize;
+    uint32_t    compression;    // NoCompression or GzipCompression
+    uint32_t    numFrames;      // 0 unless compressed
+}
+OutputIndexHeader;
+
+/*  OutputIndexEntry
+
+    One function. 'offset' and 'line' locate its name line, or its first
+    code line if it has no name. 'line' is 1-based. Entries are in output
+    order, which is also address order.
+*/
+typedef struct
+{
+    UInt64      address;
+    UInt64      endAddress;     // just past the last instruction
+    UInt64      offset;
+    uint32_t    line;
+    uint32_t    nameOffset;     // into the names
+}
+OutputIndexEntry;
+
+/*  OutputIndexState
+
+    Entries gathered by indexLine:..., waiting for finishOutputIndex.
+*/
+struct OutputIndexState
+{
+    char                path[MAXPATHLEN];   // the output file
+    OutputIndexEntry*   entries;
+    uint32_t            numEntries;
+    uint32_t            maxEntries;
+    char*               names;
+    uint32_t            namesSize;
+    uint32_t            maxNamesSize;
+    UInt64              offset;             // of the next line
+    uint32_t            line;               // of the next line
+    UInt64              textEnd;
+    uint32_t            compression;
+    OutputFrame*        frames;             // from the OutputWriter
+    uint32_t            numFrames;
+
+    // The last line, if it was a function name.
+    BOOL                haveLabel;
+    UInt64              labelOffset;
+    uint32_t            labelLine;
+    char                label[MAX_INDEX_NAME_LENGTH];
+};
+
+/*  OutputIndexMap
+
+    An index mapped for reading, and its output file opened for reading.
+*/
+typedef struct
+{
+    char*               bytes;
+    size_t              size;
+    OutputIndexHeader*  header;
+    OutputIndexEntry*   entries;
+    OutputFrame*        frames;
+    char*               names;
+    int                 outputFD;
+}
+OutputIndexMap;
+
+// ============================================================================
+
+@interface ExeProcessor(OutputIndex)
+
+- (void)beginOutputIndex: (FILE*)inOutFile;
+- (void)indexLine: (const char*)inChars
+           length: (size_t)inLength
+             code: (BOOL)inIsCode
+         function: (BOOL)inIsFunction
+          address: (UInt64)inAddress
+       codeLength: (UInt8)inCodeLength;
+- (void)addIndexEntry: (UInt64)inAddress
+               offset: (UInt64)inOffset
+                 line: (uint32_t)inLine
+                 name: (const char*)inName;
+- (void)setOutputIndexFrames: (OutputFrame*)inFrames
+                       count: (uint32_t)inNumFrames;
+- (BOOL)finishOutputIndex;
+- (void)freeOutputIndex;
+
+@end
+
+// ----------------------------------------------------------------------------
+
+NSString*
+OutputIndexPath(
+    NSString*   inOutputPath);
+
+BOOL
+OutputIndexStreamPath(
+    FILE*   inFile,
+    char*   outPath);
+
+void
+CopyOutputIndex(
+    const char* inSrcOutputPath,
+    const char* inDestOutputPath);
+
+void
+RemoveOutputIndex(
+    const char* inOutputPath);
+
+BOOL
+MapOutputIndex(
+    const char*         inOutputPath,
+    OutputIndexMap*     outMap);
+
+void
+UnmapOutputIndex(
+    OutputIndexMap* ioMap);
+
+const char*
+IndexedFunctionName(
+    const OutputIndexMap*   inMap,
+    uint32_t                inIndex);
+
+BOOL
+CopyIndexedFunction(
+    const OutputIndexMap*   inMap,
+    uint32_t                inIndex,
+    FILE*                   outFile);
+
+BOOL
+PrintIndexedFunction(
+    const char* inOutputPath,
+    const char* inSpec,
+    FILE*       outFile);
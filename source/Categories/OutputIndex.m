@@ -0,0 +1,754 @@
+/*
+    OutputIndex.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <copyfile.h>
+#import <fcntl.h>
+#import <fnmatch.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+#import <zlib.h>
+
+#import "OutputIndex.h"
+#import "CrossRefs.h"
+
+// ----------------------------------------------------------------------------
+//  Symbols match with or without their leading underscore, same as
+//  function filters.
+
+static BOOL
+NameMatchesSpec(
+    const char* inName,
+    const char* inSpec)
+{
+    if (fnmatch(inSpec, inName, 0) == 0)
+        return YES;
+
+    return (inName[0] == '_' && fnmatch(inSpec, inName + 1, 0) == 0);
+}
+
+// ----------------------------------------------------------------------------
+
+static BOOL
+CopyFileRange(
+    int     inFD,
+    UInt64  inStart,
+    UInt64  inEnd,
+    FILE*   outFile)
+{
+    char    buffer[64 * 1024];
+
+    while (inStart < inEnd)
+    {
+        size_t  chunkSize   = (inEnd - inStart > sizeof(buffer)) ?
+            sizeof(buffer) : (size_t)(inEnd - inStart);
+        ssize_t numRead     = pread(inFD, buffer, chunkSize, (off_t)inStart);
+
+        if (numRead <= 0)
+        {
+            perror("otx: unable to read output file");
+            return NO;
+        }
+
+        if (fwrite(buffer, 1, numRead, outFile) != (size_t)numRead)
+        {
+            perror("otx: unable to write function");
+            return NO;
+        }
+
+        inStart += numRead;
+    }
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+//  Decompress from the frame containing inStart until inEnd. Frames are
+//  whole gzip members, so inflate starts afresh at each one.
+
+static BOOL
+CopyCompressedRange(
+    int                 inFD,
+    const OutputFrame*  inFrames,
+    uint32_t            inNumFrames,
+    UInt64              inStart,
+    UInt64              inEnd,
+    FILE*               outFile)
+{
+    if (!inNumFrames)
+        return NO;
+
+    // The last frame that starts at or before inStart.
+    uint32_t    low     = 0;
+    uint32_t    high    = inNumFrames;
+
+    while (high - low > 1)
+    {
+        uint32_t    mid = (low + high) / 2;
+
+        if (inFrames[mid].textOffset <= inStart)
+            low     = mid;
+        else
+            high    = mid;
+    }
+
+    z_stream    zstream;
+
+    memset(&zstream, 0, sizeof(zstream));
+
+    if (inflateInit2(&zstream, MAX_WBITS + 16) != Z_OK)
+    {
+        fprintf(stderr, "otx: unable to decompress output file\n");
+        return NO;
+    }
+
+    char    inBuffer[32 * 1024];
+    char    outBuffer[64 * 1024];
+    UInt64  fileOffset  = inFrames[low].fileOffset;
+    UInt64  textOffset  = inFrames[low].textOffset;
+    BOOL    copied      = YES;
+
+    while (textOffset < inEnd)
+    {
+        if (!zstream.avail_in)
+        {
+            ssize_t numRead = pread(inFD, inBuffer, sizeof(inBuffer),
+                (off_t)fileOffset);
+
+            if (numRead <= 0)
+            {
+                perror("otx: unable to read output file");
+                copied  = NO;
+                break;
+            }
+
+            fileOffset          += numRead;
+            zstream.next_in     = (Bytef*)inBuffer;
+            zstream.avail_in    = (uInt)numRead;
+        }
+
+        zstream.next_out    = (Bytef*)outBuffer;
+        zstream.avail_out   = sizeof(outBuffer);
+
+        int result  = inflate(&zstream, Z_NO_FLUSH);
+
+        if (result != Z_OK && result != Z_STREAM_END)
+        {
+            fprintf(stderr, "otx: unable to decompress output file\n");
+            copied  = NO;
+            break;
+        }
+
+        // Keep the part of this chunk that falls in the range.
+        UInt64  numBytes    = sizeof(outBuffer) - zstream.avail_out;
+        UInt64  from        = (textOffset > inStart) ? textOffset : inStart;
+        UInt64  to          = (textOffset + numBytes < inEnd) ?
+            textOffset + numBytes : inEnd;
+
+        if (from < to && fwrite(outBuffer + (from - textOffset), 1,
+            (size_t)(to - from), outFile) != (size_t)(to - from))
+        {
+            perror("otx: unable to write function");
+            copied  = NO;
+            break;
+        }
+
+        textOffset  += numBytes;
+
+        if (result == Z_STREAM_END)
+            inflateReset(&zstream);
+    }
+
+    inflateEnd(&zstream);
+
+    return copied;
+}
+
+// ----------------------------------------------------------------------------
+
+static BOOL
+CopyTextRange(
+    int                         inFD,
+    const OutputIndexHeader*    inHeader,
+    const OutputFrame*          inFrames,
+    UInt64                      inStart,
+    UInt64                      inEnd,
+    FILE*                       outFile)
+{
+    if (inHeader->compression == GzipCompression)
+        return CopyCompressedRange(inFD, inFrames, inHeader->numFrames,
+            inStart, inEnd, outFile);
+
+    return CopyFileRange(inFD, inStart, inEnd, outFile);
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(OutputIndex)
+
+//  beginOutputIndex:
+// ----------------------------------------------------------------------------
+//  Call from printLinesFromList: once inOutFile is open. Does nothing
+//  unless inOutFile is a regular file. JSON output isn't indexed, since
+//  indexLine: finds function names in name lines.
+
+- (void)beginOutputIndex: (FILE*)inOutFile
+{
+    [self freeOutputIndex];
+
+    if (iOpts.jsonOutput)
+        return;
+
+    char    outputPath[MAXPATHLEN];
+
+    if (!OutputIndexStreamPath(inOutFile, outputPath))
+        return;
+
+    iOutputIndex    = calloc(1, sizeof(OutputIndexState));
+
+    if (!iOutputIndex)
+    {
+        fprintf(stderr, "otx: not enough memory to allocate output index\n");
+        return;
+    }
+
+    // stdout may have been redirected with '>>'. Compressed text starts
+    // at 0, and the frames say where it is in the file.
+    off_t   startOffset = lseek(fileno(inOutFile), 0, SEEK_CUR);
+
+    strncpy(iOutputIndex->path, outputPath, MAXPATHLEN - 1);
+    iOutputIndex->line  = 1;
+
+    if (iOpts.compressOutput)
+        iOutputIndex->compression   = GzipCompression;
+    else
+        iOutputIndex->offset    = (startOffset > 0) ? startOffset : 0;
+}
+
+//  indexLine:length:code:function:address:codeLength:
+// ----------------------------------------------------------------------------
+//  Call for every line printLinesFromList: writes, before writing it.
+
+- (void)indexLine: (const char*)inChars
+           length: (size_t)inLength
+             code: (BOOL)inIsCode
+         function: (BOOL)inIsFunction
+          address: (UInt64)inAddress
+       codeLength: (UInt8)inCodeLength
+{
+    if (!iOutputIndex)
+        return;
+
+    OutputIndexState*   state       = iOutputIndex;
+    const char*         charsPtr    = inChars;
+    const char*         charsEnd    = inChars + inLength;
+    UInt64              offset      = state->offset;
+    uint32_t            line        = state->line;
+
+    // Leading newlines separate this line from the last one.
+    while (charsPtr < charsEnd && *charsPtr == '\n')
+    {
+        charsPtr++;
+        offset++;
+        line++;
+    }
+
+    if (inIsFunction)
+    {
+        if (state->haveLabel)
+            [self addIndexEntry: inAddress offset: state->labelOffset
+                line: state->labelLine name: state->label];
+        else
+            [self addIndexEntry: inAddress offset: offset
+                line: line name: ""];
+
+        if (!iOutputIndex)
+            return;
+    }
+
+    state->haveLabel    = NO;
+
+    // Function names are the non-code lines that end with a colon.
+    if (!inIsCode)
+    {
+        const char* nameEnd = charsEnd;
+
+        while (nameEnd > charsPtr && nameEnd[-1] == '\n')
+            nameEnd--;
+
+        if (nameEnd > charsPtr && nameEnd[-1] == ':' &&
+            !memchr(charsPtr, '\n', nameEnd - charsPtr))
+        {
+            size_t  nameLength  = nameEnd - charsPtr - 1;
+
+            if (nameLength >= MAX_INDEX_NAME_LENGTH)
+                nameLength  = MAX_INDEX_NAME_LENGTH - 1;
+
+            memcpy(state->label, charsPtr, nameLength);
+            state->label[nameLength]    = 0;
+            state->labelOffset          = offset;
+            state->labelLine            = line;
+            state->haveLabel            = YES;
+        }
+    }
+
+    while ((charsPtr = memchr(charsPtr, '\n', charsEnd - charsPtr)))
+    {
+        charsPtr++;
+        line++;
+    }
+
+    state->offset   += inLength;
+    state->line     = line;
+
+    if (inIsCode)
+    {
+        state->textEnd  = state->offset;
+
+        // Code ahead of the first function belongs to no entry.
+        if (state->numEntries)
+            state->entries[state->numEntries - 1].endAddress   =
+                inAddress + inCodeLength;
+    }
+}
+
+//  addIndexEntry:offset:line:name:
+// ----------------------------------------------------------------------------
+
+- (void)addIndexEntry: (UInt64)inAddress
+               offset: (UInt64)inOffset
+                 line: (uint32_t)inLine
+                 name: (const char*)inName
+{
+    OutputIndexState*   state       = iOutputIndex;
+    uint32_t            nameSize    = (uint32_t)strlen(inName) + 1;
+
+    if (state->numEntries == state->maxEntries)
+    {
+        uint32_t            newMax      = (state->maxEntries) ?
+            state->maxEntries * 2 : 1024;
+        OutputIndexEntry*   newEntries  = realloc(state->entries,
+            newMax * sizeof(OutputIndexEntry));
+
+        if (!newEntries)
+        {
+            fprintf(stderr, "otx: not enough memory to grow output index\n");
+            [self freeOutputIndex];
+            return;
+        }
+
+        state->entries      = newEntries;
+        state->maxEntries   = newMax;
+    }
+
+    if (state->namesSize + nameSize > state->maxNamesSize)
+    {
+        uint32_t    newMax      = (state->maxNamesSize) ?
+            state->maxNamesSize * 2 : 32 * 1024;
+
+        while (state->namesSize + nameSize > newMax)
+            newMax  *= 2;
+
+        char*   newNames    = realloc(state->names, newMax);
+
+        if (!newNames)
+        {
+            fprintf(stderr, "otx: not enough memory to grow output index\n");
+            [self freeOutputIndex];
+            return;
+        }
+
+        state->names        = newNames;
+        state->maxNamesSize = newMax;
+    }
+
+    memcpy(&state->names[state->namesSize], inName, nameSize);
+    state->entries[state->numEntries++] = (OutputIndexEntry)
+        {inAddress, inAddress, inOffset, inLine, state->namesSize};
+    state->namesSize    += nameSize;
+}
+
+//  setOutputIndexFrames:count:
+// ----------------------------------------------------------------------------
+//  Takes ownership of inFrames.
+
+- (void)setOutputIndexFrames: (OutputFrame*)inFrames
+                       count: (uint32_t)inNumFrames
+{
+    if (!iOutputIndex)
+    {
+        free(inFrames);
+        return;
+    }
+
+    if (iOutputIndex->frames)
+        free(iOutputIndex->frames);
+
+    iOutputIndex->frames    = inFrames;
+    iOutputIndex->numFrames = inNumFrames;
+}
+
+//  finishOutputIndex
+// ----------------------------------------------------------------------------
+//  Call once the output file is complete, data sections and all. Writes to
+//  a temp file first so that readers never see a partial index. Failing to
+//  write the index is not an error.
+
+- (BOOL)finishOutputIndex
+{
+    if (!iOutputIndex)
+        return YES;
+
+    OutputIndexState*   state   = iOutputIndex;
+    struct stat         fileStats;
+
+    if (stat(state->path, &fileStats) != 0)
+    {
+        [self freeOutputIndex];
+        return YES;
+    }
+
+    NSString*   indexPath   = OutputIndexPath(NSSTRING(state->path));
+    char        tempPath[MAXPATHLEN];
+
+    snprintf(tempPath, MAXPATHLEN, "%s.XXXXXX",
+        [indexPath fileSystemRepresentation]);
+
+    int fd  = mkstemp(tempPath);
+
+    if (fd == -1)
+    {
+        perror("otx: unable to create output index");
+        [self freeOutputIndex];
+        return YES;
+    }
+
+    FILE*               indexFile   = fdopen(fd, "w");
+    OutputIndexHeader   header      =
+        {OUTPUT_INDEX_MAGIC, OUTPUT_INDEX_VERSION, fileStats.st_size,
+        state->textEnd, state->numEntries, state->namesSize,
+        state->compression, state->numFrames};
+    BOOL                written     = NO;
+
+    if (indexFile)
+    {
+        written = fwrite(&header, sizeof(header), 1, indexFile) == 1 &&
+            fwrite(state->entries, sizeof(OutputIndexEntry),
+                state->numEntries, indexFile) == state->numEntries &&
+            fwrite(state->frames, sizeof(OutputFrame),
+                state->numFrames, indexFile) == state->numFrames &&
+            fwrite(state->names, 1, state->namesSize, indexFile) ==
+                state->namesSize;
+
+        if (fclose(indexFile) != 0)
+            written = NO;
+    }
+    else
+        close(fd);
+
+    if (!written || rename(tempPath, [indexPath fileSystemRepresentation]) != 0)
+    {
+        perror("otx: unable to write output index");
+        unlink(tempPath);
+    }
+
+    [self freeOutputIndex];
+
+    return YES;
+}
+
+//  freeOutputIndex
+// ----------------------------------------------------------------------------
+
+- (void)freeOutputIndex
+{
+    if (!iOutputIndex)
+        return;
+
+    if (iOutputIndex->entries)
+        free(iOutputIndex->entries);
+
+    if (iOutputIndex->names)
+        free(iOutputIndex->names);
+
+    if (iOutputIndex->frames)
+        free(iOutputIndex->frames);
+
+    free(iOutputIndex);
+    iOutputIndex    = NULL;
+}
+
+@end
+
+// ----------------------------------------------------------------------------
+
+NSString*
+OutputIndexPath(
+    NSString*   inOutputPath)
+{
+    return [inOutputPath stringByAppendingPathExtension: OUTPUT_INDEX_FILE_EXT];
+}
+
+// ----------------------------------------------------------------------------
+//  The path of inFile if it's a regular file, which it isn't when stdout
+//  goes to a terminal or a pipe.
+
+BOOL
+OutputIndexStreamPath(
+    FILE*   inFile,
+    char*   outPath)
+{
+    int         fileNum = fileno(inFile);
+    struct stat fileStats;
+
+    if (fstat(fileNum, &fileStats) != 0 || !S_ISREG(fileStats.st_mode))
+        return NO;
+
+    return (fcntl(fileNum, F_GETPATH, outPath) != -1);
+}
+
+// ----------------------------------------------------------------------------
+//  Give inDestOutputPath a copy of inSrcOutputPath's index and
+//  cross-references, or none if it has none, so that it never keeps a
+//  stale one.
+
+void
+CopyOutputIndex(
+    const char* inSrcOutputPath,
+    const char* inDestOutputPath)
+{
+    NSString*   srcOutputPath   = NSSTRING(inSrcOutputPath);
+    NSString*   destOutputPath  = NSSTRING(inDestOutputPath);
+    const char* srcPaths[2]     = {
+        [OutputIndexPath(srcOutputPath) fileSystemRepresentation],
+        [CrossRefsPath(srcOutputPath) fileSystemRepresentation]};
+    const char* destPaths[2]    = {
+        [OutputIndexPath(destOutputPath) fileSystemRepresentation],
+        [CrossRefsPath(destOutputPath) fileSystemRepresentation]};
+    uint32_t    i;
+
+    for (i = 0; i < 2; i++)
+    {
+        unlink(destPaths[i]);
+
+        if (access(srcPaths[i], R_OK) == 0)
+            copyfile(srcPaths[i], destPaths[i], NULL, COPYFILE_DATA);
+    }
+}
+
+// ----------------------------------------------------------------------------
+//  Remove inOutputPath's index and cross-references.
+
+void
+RemoveOutputIndex(
+    const char* inOutputPath)
+{
+    NSString*   outputPath  = NSSTRING(inOutputPath);
+
+    unlink([OutputIndexPath(outputPath) fileSystemRepresentation]);
+    unlink([CrossRefsPath(outputPath) fileSystemRepresentation]);
+}
+
+// ----------------------------------------------------------------------------
+//  Map inOutputPath's index and open the output file for reading. Complains
+//  and returns NO if there's no index, or it's invalid or out of date.
+
+BOOL
+MapOutputIndex(
+    const char*         inOutputPath,
+    OutputIndexMap*     outMap)
+{
+    const char* indexPath   = [OutputIndexPath(NSSTRING(inOutputPath))
+        fileSystemRepresentation];
+    struct stat outputStats;
+    struct stat indexStats;
+    int         indexFD     = open(indexPath, O_RDONLY);
+
+    *outMap = (OutputIndexMap){0};
+
+    if (indexFD == -1 || fstat(indexFD, &indexStats) != 0 ||
+        stat(inOutputPath, &outputStats) != 0 ||
+        indexStats.st_size < (off_t)sizeof(OutputIndexHeader))
+    {
+        fprintf(stderr, "otx: no index found for %s\n", inOutputPath);
+
+        if (indexFD != -1)
+            close(indexFD);
+
+        return NO;
+    }
+
+    char*   indexBytes  = mmap(NULL, indexStats.st_size, PROT_READ,
+        MAP_PRIVATE, indexFD, 0);
+
+    close(indexFD);
+
+    if (indexBytes == MAP_FAILED)
+    {
+        perror("otx: unable to map output index");
+        return NO;
+    }
+
+    OutputIndexHeader*  header  = (OutputIndexHeader*)indexBytes;
+    OutputIndexEntry*   entries =
+        (OutputIndexEntry*)(indexBytes + sizeof(OutputIndexHeader));
+    OutputFrame*        frames  =
+        (OutputFrame*)&entries[header->numEntries];
+    char*               names   =
+        (char*)&frames[header->numFrames];
+
+    if (header->magic != OUTPUT_INDEX_MAGIC ||
+        header->version != OUTPUT_INDEX_VERSION ||
+        header->compression > GzipCompression ||
+        (UInt64)indexStats.st_size != sizeof(OutputIndexHeader) +
+            (UInt64)header->numEntries * sizeof(OutputIndexEntry) +
+            (UInt64)header->numFrames * sizeof(OutputFrame) +
+            header->namesSize ||
+        (header->namesSize && names[header->namesSize - 1] != 0))
+    {
+        fprintf(stderr, "otx: invalid index for %s\n", inOutputPath);
+        munmap(indexBytes, indexStats.st_size);
+        return NO;
+    }
+
+    if (header->outputSize != (UInt64)outputStats.st_size)
+    {
+        fprintf(stderr, "otx: index for %s is out of date\n", inOutputPath);
+        munmap(indexBytes, indexStats.st_size);
+        return NO;
+    }
+
+    int outputFD    = open(inOutputPath, O_RDONLY);
+
+    if (outputFD == -1)
+    {
+        perror("otx: unable to open output file");
+        munmap(indexBytes, indexStats.st_size);
+        return NO;
+    }
+
+    *outMap = (OutputIndexMap){indexBytes, indexStats.st_size,
+        header, entries, frames, names, outputFD};
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+UnmapOutputIndex(
+    OutputIndexMap* ioMap)
+{
+    // The output file is open whenever the index is mapped.
+    if (ioMap->bytes)
+    {
+        close(ioMap->outputFD);
+        munmap(ioMap->bytes, ioMap->size);
+    }
+
+    *ioMap  = (OutputIndexMap){0};
+}
+
+// ----------------------------------------------------------------------------
+//  The name of entry inIndex, or "" if it has none.
+
+const char*
+IndexedFunctionName(
+    const OutputIndexMap*   inMap,
+    uint32_t                inIndex)
+{
+    uint32_t    nameOffset  = inMap->entries[inIndex].nameOffset;
+
+    return (nameOffset < inMap->header->namesSize) ?
+        &inMap->names[nameOffset] : "";
+}
+
+// ----------------------------------------------------------------------------
+//  Copy the text of entry inIndex, which runs to the next entry or the end
+//  of the code.
+
+BOOL
+CopyIndexedFunction(
+    const OutputIndexMap*   inMap,
+    uint32_t                inIndex,
+    FILE*                   outFile)
+{
+    const OutputIndexHeader*    header  = inMap->header;
+    UInt64                      start   = inMap->entries[inIndex].offset;
+    UInt64                      end     = (inIndex + 1 < header->numEntries) ?
+        inMap->entries[inIndex + 1].offset : header->textEnd;
+
+    if (end > header->textEnd)
+        end = header->textEnd;
+
+    return CopyTextRange(inMap->outputFD, header, inMap->frames,
+        start, end, outFile);
+}
+
+// ----------------------------------------------------------------------------
+//  Print the functions whose names match inSpec, or the one containing the
+//  address if inSpec begins with "0x". Returns NO if nothing was printed,
+//  which an address outside every function also gets.
+
+BOOL
+PrintIndexedFunction(
+    const char* inOutputPath,
+    const char* inSpec,
+    FILE*       outFile)
+{
+    OutputIndexMap  map;
+
+    if (!MapOutputIndex(inOutputPath, &map))
+        return NO;
+
+    BOOL        byAddress   = !strncmp(inSpec, "0x", 2);
+    UInt64      address     = (byAddress) ? strtoull(inSpec, NULL, 16) : 0;
+    uint32_t    numEntries  = map.header->numEntries;
+    uint32_t    numPrinted  = 0;
+    uint32_t    i;
+
+    if (byAddress)
+    {   // The last start at or below the address.
+        uint32_t    begin   = 0;
+        uint32_t    end     = numEntries;
+        uint32_t    split;
+
+        while (begin < end)
+        {
+            split   = begin + (end - begin) / 2;
+
+            if (map.entries[split].address <= address)
+                begin   = split + 1;
+            else
+                end     = split;
+        }
+
+        if (begin && address < map.entries[begin - 1].endAddress &&
+            CopyIndexedFunction(&map, begin - 1, outFile))
+            numPrinted++;
+    }
+    else
+    {
+        for (i = 0; i < numEntries; i++)
+        {
+            if (!NameMatchesSpec(IndexedFunctionName(&map, i), inSpec))
+                continue;
+
+            if (!CopyIndexedFunction(&map, i, outFile))
+                break;
+
+            numPrinted++;
+        }
+    }
+
+    UnmapOutputIndex(&map);
+
+    if (!numPrinted)
+        fprintf(stderr, "otx: no functions match \"%s\"\n", inSpec);
+
+    return (numPrinted != 0);
+}
@@ -0,0 +1,67 @@
+/*
+    RefTable.h
+
+    A category on ExeProcessor that keeps the Obj-C selector and class
+    references resolved to their strings. Each reference section gets one
+    string per slot, filled once by the arch-specific loaders after all
+    sections are loaded, see ObjectLoader and Object64Loader. The msgSend
+    commenting code then finds a selector or receiver with a range check
+    and an index, instead of going through getPointer:type: twice for
+    every call site.
+
+    A miss means the address isn't a reference slot, or the reference
+    couldn't be resolved at load; callers fall back to getPointer:type:.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+#define MAX_REF_SECTIONS    8
+
+// What the slots of a reference section refer to.
+enum {
+    SelectorRefSection,
+    ClassRefSection
+};
+
+/*  RefSection
+
+    One reference section. 'strings' has size / slotSize entries, NULL
+    where the slot didn't resolve.
+*/
+typedef struct
+{
+    UInt64      addr;
+    UInt64      size;
+    uint32_t    slotSize;
+    uint32_t    kind;
+    char**      strings;
+}
+RefSection;
+
+/*  RefTableState
+
+    The reference sections, in the order they were added.
+*/
+struct RefTableState
+{
+    RefSection  sections[MAX_REF_SECTIONS];
+    uint32_t    numSections;
+};
+
+// ============================================================================
+
+@interface ExeProcessor(RefTable)
+
+- (RefSection*)addRefSection: (UInt64)inAddr
+                        size: (UInt64)inSize
+                    slotSize: (uint32_t)inSlotSize
+                        kind: (uint32_t)inKind;
+- (char*)refStringAtAddress: (UInt64)inAddr
+                       kind: (uint32_t)inKind;
+- (void)freeRefTable;
+
+@end
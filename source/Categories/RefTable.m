@@ -0,0 +1,102 @@
+/*
+    RefTable.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "RefTable.h"
+
+// ============================================================================
+
+@implementation ExeProcessor(RefTable)
+
+//  addRefSection:size:slotSize:kind:
+// ----------------------------------------------------------------------------
+//  Returns the new section, whose strings the caller fills, or NULL if
+//  there's nothing to add or no room for it.
+
+- (RefSection*)addRefSection: (UInt64)inAddr
+                        size: (UInt64)inSize
+                    slotSize: (uint32_t)inSlotSize
+                        kind: (uint32_t)inKind
+{
+    if (!inSize || !inSlotSize || inSize / inSlotSize > UINT32_MAX)
+        return NULL;
+
+    if (!iRefTable)
+    {
+        iRefTable   = calloc(1, sizeof(RefTableState));
+
+        if (!iRefTable)
+            return NULL;
+    }
+
+    if (iRefTable->numSections >= MAX_REF_SECTIONS)
+        return NULL;
+
+    char**  strings = calloc((size_t)(inSize / inSlotSize), sizeof(char*));
+
+    if (!strings)
+    {
+        fprintf(stderr, "otx: not enough memory for Obj-C references\n");
+        return NULL;
+    }
+
+    RefSection* section = &iRefTable->sections[iRefTable->numSections++];
+
+    *section    = (RefSection){inAddr, inSize, inSlotSize, inKind, strings};
+
+    return section;
+}
+
+//  refStringAtAddress:kind:
+// ----------------------------------------------------------------------------
+//  The string the reference slot at inAddr resolved to, or NULL.
+
+- (char*)refStringAtAddress: (UInt64)inAddr
+                       kind: (uint32_t)inKind
+{
+    if (!iRefTable)
+        return NULL;
+
+    uint32_t    i;
+
+    for (i = 0; i < iRefTable->numSections; i++)
+    {
+        RefSection* section = &iRefTable->sections[i];
+
+        if (section->kind != inKind ||
+            inAddr < section->addr || inAddr >= section->addr + section->size)
+            continue;
+
+        UInt64  offset  = inAddr - section->addr;
+
+        if (offset % section->slotSize)
+            return NULL;
+
+        return section->strings[offset / section->slotSize];
+    }
+
+    return NULL;
+}
+
+//  freeRefTable
+// ----------------------------------------------------------------------------
+
+- (void)freeRefTable
+{
+    if (!iRefTable)
+        return;
+
+    uint32_t    i;
+
+    for (i = 0; i < iRefTable->numSections; i++)
+        free(iRefTable->sections[i].strings);
+
+    free(iRefTable);
+    iRefTable   = NULL;
+}
+
+@end
@@ -0,0 +1,42 @@
+/*
+    ResultCache.h
+
+    A category on ExeProcessor that stores finished output files on disk,
+    keyed by a digest of the selected Mach-O slice, the executable's path
+    and the options that affect output. Reprocessing an unchanged
+    executable with the same options then costs a file copy instead of
+    an otool run and a full analysis.
+
+    Each entry keeps the OutputIndex and CrossRefs sidecars of the run that
+    stored it, and delivers them along with the output. While stdout is
+    diverted, those sidecars are written next to the temp file, so
+    finishCachingResult moves them into the entry and to the stdout file.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+// Bump this whenever a change to otx alters the output for a given input,
+// to keep stale entries from being served.
+#define RESULT_CACHE_VERSION        1
+
+// Least recently used entries are deleted when the cache grows beyond this.
+#define RESULT_CACHE_MAX_SIZE       (512 * 1024 * 1024)     // bytes
+
+#define RESULT_CACHE_ENTRY_EXT      @"txt"
+
+@interface ExeProcessor(ResultCache)
+
+- (NSString*)resultCacheDirectory;
+- (NSString*)resultCacheKey;
+- (NSString*)optionsKeyString;
+- (NSString*)sliceDigestString;
+- (BOOL)fetchCachedResult;
+- (BOOL)beginCachingResult;
+- (BOOL)finishCachingResult;
+- (void)trimResultCache;
+
+@end
@@ -0,0 +1,498 @@
+/*
+    ResultCache.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <CommonCrypto/CommonDigest.h>
+#import <copyfile.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <sys/time.h>
+#import <unistd.h>
+
+#import "CrossRefs.h"
+#import "FunctionFilter.h"
+#import "ObjcIndex.h"
+#import "OutputIndex.h"
+#import "ResultCache.h"
+#import "SysUtils.h"
+
+/*  ResultCacheEntry
+
+    One finished output file, as seen by trimResultCache.
+*/
+typedef struct
+{
+    time_t  accessTime;     // mtime, bumped on every hit
+    off_t   size;           // including the index and cross-references
+    char    path[MAXPATHLEN];
+}
+ResultCacheEntry;
+
+// ----------------------------------------------------------------------------
+// Comparison function for qsort(3). Oldest entries sort first.
+
+static int
+ResultCacheEntry_Compare(
+    ResultCacheEntry*   e1,
+    ResultCacheEntry*   e2)
+{
+    if (e1->accessTime < e2->accessTime)
+        return -1;
+
+    return (e1->accessTime > e2->accessTime);
+}
+
+// ----------------------------------------------------------------------------
+
+static NSString*
+HexStringFromDigest(
+    unsigned char*  inDigest)
+{
+    char    hexString[CC_MD5_DIGEST_LENGTH * 2 + 1];
+    uint32_t  i;
+
+    for (i = 0; i < CC_MD5_DIGEST_LENGTH; i++)
+        snprintf(&hexString[i * 2], 3, "%02x", inDigest[i]);
+
+    return NSSTRING(hexString);
+}
+
+// ----------------------------------------------------------------------------
+//  Clone the file where the filesystem allows it, copy it otherwise.
+
+static BOOL
+CopyResultFile(
+    const char* inSrcPath,
+    const char* inDestPath)
+{
+    unlink(inDestPath);
+
+#ifdef COPYFILE_CLONE
+    if (copyfile(inSrcPath, inDestPath, NULL, COPYFILE_CLONE) == 0)
+        return YES;
+#endif
+
+    return (copyfile(inSrcPath, inDestPath, NULL, COPYFILE_DATA) == 0);
+}
+
+// ----------------------------------------------------------------------------
+
+static BOOL
+StreamResultFile(
+    const char* inPath,
+    FILE*       outFile)
+{
+    int fd  = open(inPath, O_RDONLY);
+
+    if (fd == -1)
+    {
+        perror("otx: unable to open cached output file");
+        return NO;
+    }
+
+    SInt32  fileNum = fileno(outFile);
+    char    buffer[64 * 1024];
+    ssize_t numRead;
+
+    fflush(outFile);
+
+    while ((numRead = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        if (syscall(SYS_write, fileNum, buffer, numRead) == -1)
+        {
+            perror("otx: unable to write to output file");
+            close(fd);
+            return NO;
+        }
+    }
+
+    if (numRead == -1)
+        perror("otx: unable to read cached output file");
+
+    close(fd);
+
+    return (numRead == 0);
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(ResultCache)
+
+//  resultCacheDirectory
+// ----------------------------------------------------------------------------
+//  Results in OTXCacheDirectory(), created on demand. Returns nil if it can't
+//  be created, in which case caching is silently skipped.
+
+- (NSString*)resultCacheDirectory
+{
+    NSString*   cacheDir    = [OTXCacheDirectory()
+        stringByAppendingPathComponent: @"Results"];
+    NSError*    theError    = nil;
+
+    if (!cacheDir)
+        return nil;
+
+    if (![[NSFileManager defaultManager] createDirectoryAtPath: cacheDir
+        withIntermediateDirectories: YES attributes: nil error: &theError])
+    {
+        fprintf(stderr, "otx: unable to create result cache: %s\n",
+            UTF8STRING([theError localizedDescription]));
+        return nil;
+    }
+
+    return cacheDir;
+}
+
+//  resultCacheKey
+// ----------------------------------------------------------------------------
+//  The output names the executable on its first line, so the path is part
+//  of the key along with the slice contents.
+
+- (NSString*)resultCacheKey
+{
+    NSString*   sliceDigest = [self sliceDigestString];
+
+    if (!sliceDigest)
+        return nil;
+
+    const char*     path    = [[iOFile path] fileSystemRepresentation];
+    unsigned char   pathDigest[CC_MD5_DIGEST_LENGTH];
+
+    CC_MD5(path, (CC_LONG)strlen(path), pathDigest);
+
+    return [NSString stringWithFormat: @"%d-%@-%s-%@-%@",
+        RESULT_CACHE_VERSION, sliceDigest, iArchString,
+        [self optionsKeyString], HexStringFromDigest(pathDigest)];
+}
+
+//  optionsKeyString
+// ----------------------------------------------------------------------------
+//  A canonical encoding of the options that change the output file. Options
+//  that only change how otx goes about producing it are left out.
+
+- (NSString*)optionsKeyString
+{
+    return [NSString stringWithFormat: @"l%de%dd%dc%dm%db%dn%dr%dv%dR%dz%dj%d%@",
+        iOpts.localOffsets, iOpts.entabOutput, iOpts.dataSections,
+        iOpts.checksum, iOpts.verboseMsgSends, iOpts.separateLogicalBlocks,
+        iOpts.demangleCppNames, iOpts.returnTypes, iOpts.variableTypes,
+        iOpts.returnStatements, iOpts.compressOutput, iOpts.jsonOutput,
+        [self filterKeyString]];
+}
+
+//  sliceDigestString
+// ----------------------------------------------------------------------------
+//  MD5 of the bytes of the slice being processed. Unlike generateMD5String,
+//  this runs in-process and ignores the other slices of a unibin. Computed
+//  once, since both the result cache and ObjcIndex want it.
+
+- (NSString*)sliceDigestString
+{
+    if (iSliceDigest)
+        return iSliceDigest;
+
+    if (iSliceOffset > iRAMFileSize)
+        return nil;
+
+    NSUInteger      bytesLeft   = iRAMFileSize - iSliceOffset;
+    unsigned char*  slicePtr    = (unsigned char*)iRAMFile + iSliceOffset;
+    unsigned char   digest[CC_MD5_DIGEST_LENGTH];
+    CC_MD5_CTX      context;
+
+    if (iSliceSize && iSliceSize < bytesLeft)
+        bytesLeft   = iSliceSize;
+
+    CC_MD5_Init(&context);
+
+    // CC_LONG is 32 bits wide.
+    while (bytesLeft)
+    {
+        CC_LONG chunkSize   = (bytesLeft > 0x40000000) ?
+            0x40000000 : (CC_LONG)bytesLeft;
+
+        CC_MD5_Update(&context, slicePtr, chunkSize);
+        slicePtr    += chunkSize;
+        bytesLeft   -= chunkSize;
+    }
+
+    CC_MD5_Final(digest, &context);
+
+    iSliceDigest    = [HexStringFromDigest(digest) retain];
+
+    return iSliceDigest;
+}
+
+#pragma mark -
+//  fetchCachedResult
+// ----------------------------------------------------------------------------
+//  Deliver a cached result to iOutputFilePath, or to stdout if that's nil.
+//  Returns NO on a miss.
+
+- (BOOL)fetchCachedResult
+{
+    NSString*   cacheDir    = [self resultCacheDirectory];
+    NSString*   cacheKey    = [self resultCacheKey];
+
+    if (!cacheDir || !cacheKey)
+        return NO;
+
+    NSString*   entryPath   = [[cacheDir stringByAppendingPathComponent:
+        cacheKey] stringByAppendingPathExtension: RESULT_CACHE_ENTRY_EXT];
+    const char* entryCPath  = [entryPath fileSystemRepresentation];
+
+    if (access(entryCPath, R_OK) != 0)
+        return NO;
+
+    // Mark the entry as recently used.
+    utimes(entryCPath, NULL);
+
+    if (iOutputFilePath)
+    {
+        const char* outputCPath = [iOutputFilePath fileSystemRepresentation];
+
+        if (!CopyResultFile(entryCPath, outputCPath))
+            return NO;
+
+        CopyOutputIndex(entryCPath, outputCPath);
+
+        return YES;
+    }
+
+    // The index is only good for a file that the output starts.
+    char    stdoutPath[MAXPATHLEN];
+    BOOL    indexStdout = OutputIndexStreamPath(stdout, stdoutPath) &&
+        ftello(stdout) == 0;
+
+    if (!StreamResultFile(entryCPath, stdout))
+        return NO;
+
+    if (indexStdout)
+        CopyOutputIndex(entryCPath, stdoutPath);
+
+    return YES;
+}
+
+//  beginCachingResult
+// ----------------------------------------------------------------------------
+//  When writing to stdout, divert the output into a temp file in the cache
+//  directory. finishCachingResult moves it into place and streams it out,
+//  which saves a copy.
+
+- (BOOL)beginCachingResult
+{
+    if (iOutputFilePath)
+        return YES;
+
+    NSString*   cacheDir    = [self resultCacheDirectory];
+
+    if (!cacheDir)
+        return NO;
+
+    char    tempPath[MAXPATHLEN];
+
+    snprintf(tempPath, MAXPATHLEN, "%s/otx.XXXXXX",
+        [cacheDir fileSystemRepresentation]);
+
+    int fd  = mkstemp(tempPath);
+
+    if (fd == -1)
+    {
+        perror("otx: unable to create result cache temp file");
+        return NO;
+    }
+
+    close(fd);
+
+    iCacheTempPath  = [[NSString alloc] initWithUTF8String: tempPath];
+    iOutputFilePath = iCacheTempPath;
+
+    return YES;
+}
+
+//  finishCachingResult
+// ----------------------------------------------------------------------------
+//  Store the finished output in the cache. If beginCachingResult diverted
+//  stdout, deliver the output there too. Failing to store is not an error,
+//  failing to deliver is.
+
+- (BOOL)finishCachingResult
+{
+    NSString*   cacheDir    = [self resultCacheDirectory];
+    NSString*   cacheKey    = [self resultCacheKey];
+    NSString*   entryPath   = nil;
+
+    if (cacheDir && cacheKey)
+        entryPath   = [[cacheDir stringByAppendingPathComponent: cacheKey]
+            stringByAppendingPathExtension: RESULT_CACHE_ENTRY_EXT];
+
+    if (iCacheTempPath)
+    {
+        const char* tempCPath   = [iCacheTempPath fileSystemRepresentation];
+        const char* deliverPath = tempCPath;
+        char        stdoutPath[MAXPATHLEN];
+        BOOL        indexStdout = OutputIndexStreamPath(stdout, stdoutPath) &&
+            ftello(stdout) == 0;
+        BOOL        delivered;
+
+        iOutputFilePath = nil;
+
+        // The index and cross-references were written for the temp file.
+        // CopyOutputIndex takes both along, and RemoveOutputIndex below
+        // removes both, so neither is left behind in the cache.
+        if (entryPath &&
+            rename(tempCPath, [entryPath fileSystemRepresentation]) == 0)
+        {
+            deliverPath = [entryPath fileSystemRepresentation];
+            CopyOutputIndex(tempCPath, deliverPath);
+        }
+
+        delivered   = StreamResultFile(deliverPath, stdout);
+
+        if (delivered && indexStdout)
+            CopyOutputIndex(deliverPath, stdoutPath);
+
+        if (deliverPath == tempCPath)
+            unlink(tempCPath);
+
+        RemoveOutputIndex([iCacheTempPath fileSystemRepresentation]);
+
+        [iCacheTempPath release];
+        iCacheTempPath  = nil;
+
+        if (entryPath)
+            [self trimResultCache];
+
+        return delivered;
+    }
+
+    if (!entryPath || !iOutputFilePath)
+        return YES;
+
+    // Copy to a temp file first so a concurrent fetch never sees a
+    // partial entry.
+    char    tempPath[MAXPATHLEN];
+
+    snprintf(tempPath, MAXPATHLEN, "%s/otx.XXXXXX",
+        [cacheDir fileSystemRepresentation]);
+
+    int fd  = mkstemp(tempPath);
+
+    if (fd == -1)
+        return YES;
+
+    close(fd);
+
+    if (CopyResultFile([iOutputFilePath fileSystemRepresentation], tempPath) &&
+        rename(tempPath, [entryPath fileSystemRepresentation]) == 0)
+    {
+        CopyOutputIndex([iOutputFilePath fileSystemRepresentation],
+            [entryPath fileSystemRepresentation]);
+        [self trimResultCache];
+    }
+    else
+        unlink(tempPath);
+
+    return YES;
+}
+
+//  trimResultCache
+// ----------------------------------------------------------------------------
+//  Delete least recently used entries until the cache fits in
+//  RESULT_CACHE_MAX_SIZE. ObjcIndex files count as entries. An output
+//  file's index and cross-references count toward its size and go with
+//  it. Sidecars whose output is gone, left by a run that died, are deleted
+//  on the way.
+
+- (void)trimResultCache
+{
+    NSString*   cacheDir    = [self resultCacheDirectory];
+
+    if (!cacheDir)
+        return;
+
+    NSArray*    fileNames   = [[NSFileManager defaultManager]
+        contentsOfDirectoryAtPath: cacheDir error: nil];
+    NSUInteger  numFiles    = [fileNames count];
+
+    if (!numFiles)
+        return;
+
+    ResultCacheEntry*   entries     =
+        malloc(numFiles * sizeof(ResultCacheEntry));
+    uint32_t            numEntries  = 0;
+    off_t               totalSize   = 0;
+    struct stat         fileStats;
+    NSUInteger          i;
+
+    if (!entries)
+        return;
+
+    for (i = 0; i < numFiles; i++)
+    {
+        NSString*   fileName    = [fileNames objectAtIndex: i];
+        NSString*   fileExt     = [fileName pathExtension];
+
+        if ([fileExt isEqualToString: OUTPUT_INDEX_FILE_EXT] ||
+            [fileExt isEqualToString: CROSS_REFS_FILE_EXT])
+        {
+            NSString*   outputPath  = [cacheDir stringByAppendingPathComponent:
+                [fileName stringByDeletingPathExtension]];
+
+            if (access([outputPath fileSystemRepresentation], F_OK) != 0)
+                unlink([[cacheDir stringByAppendingPathComponent: fileName]
+                    fileSystemRepresentation]);
+
+            continue;
+        }
+
+        if (![fileExt isEqualToString: RESULT_CACHE_ENTRY_EXT] &&
+            ![fileExt isEqualToString: OBJC_INDEX_FILE_EXT])
+            continue;
+
+        ResultCacheEntry*   entry   = &entries[numEntries];
+
+        snprintf(entry->path, MAXPATHLEN, "%s/%s",
+            [cacheDir fileSystemRepresentation],
+            [fileName fileSystemRepresentation]);
+
+        if (stat(entry->path, &fileStats) != 0)
+            continue;
+
+        entry->accessTime   = fileStats.st_mtime;
+        entry->size         = fileStats.st_size;
+
+        NSString*   entryPath   = NSSTRING(entry->path);
+
+        if (stat([OutputIndexPath(entryPath) fileSystemRepresentation],
+            &fileStats) == 0)
+            entry->size += fileStats.st_size;
+
+        if (stat([CrossRefsPath(entryPath) fileSystemRepresentation],
+            &fileStats) == 0)
+            entry->size += fileStats.st_size;
+
+        totalSize   += entry->size;
+        numEntries++;
+    }
+
+    if (totalSize > RESULT_CACHE_MAX_SIZE)
+    {
+        qsort(entries, numEntries, sizeof(ResultCacheEntry),
+            (COMPARISON_FUNC_TYPE)ResultCacheEntry_Compare);
+
+        for (i = 0; i < numEntries && totalSize > RESULT_CACHE_MAX_SIZE; i++)
+        {
+            if (unlink(entries[i].path) == 0)
+                totalSize   -= entries[i].size;
+
+            RemoveOutputIndex(entries[i].path);
+        }
+    }
+
+    free(entries);
+}
+
+@end
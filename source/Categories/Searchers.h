@@ -10,6 +10,7 @@
 #import <Cocoa/Cocoa.h>
 
 #import "Exe32Processor.h"
+#import "IvarLayouts.h"
 
 @interface Exe32Processor(Searchers)
 
@@ -18,7 +19,7 @@
               byAddress: (uint32_t)inAddress;
 - (BOOL)findCatMethod: (MethodInfo**)outMI
             byAddress: (uint32_t)inAddress;
-- (BOOL)findIvar: (objc1_32_ivar*)outIvar
+- (BOOL)findIvar: (IvarLayoutEntry**)outIvar
          inClass: (objc1_32_class*)inClass
       withOffset: (uint32_t)inOffset;
 - (BOOL)findIvar: (objc2_32_ivar_t**)outIvar
@@ -10,6 +10,7 @@
 #import <Cocoa/Cocoa.h>
 
 #import "Searchers.h"
+#import "CrossRefs.h"
 #import "ObjcAccessors.h"
 
 @implementation Exe32Processor(Searchers)
@@ -48,18 +49,13 @@
         return NO;
     }
 
-    uint32_t  swappedAddress  = inAddress;
-
-    if (iSwapped)
-        swappedAddress  = OSSwapInt32(swappedAddress);
-
     MethodInfo  searchKey   = {0};
-    searchKey.m.method_imp = swappedAddress;
+
+    searchKey.m.method_imp  = inAddress;
 
     *outMI  = bsearch(&searchKey,
         iClassMethodInfos, iNumClassMethodInfos, sizeof(MethodInfo),
-            (COMPARISON_FUNC_TYPE)
-            (iSwapped ? MethodInfo_Compare_Swapped : MethodInfo_Compare));
+            (COMPARISON_FUNC_TYPE)MethodInfo_Compare);
 
     return (*outMI != NULL);
 }
@@ -79,111 +75,60 @@
         return NO;
     }
 
-    uint32_t  swappedAddress  = inAddress;
-
-    if (iSwapped)
-        swappedAddress  = OSSwapInt32(swappedAddress);
+    MethodInfo  searchKey   = {0};
 
-    MethodInfo searchKey = {0};
-    searchKey.m.method_imp = swappedAddress;
+    searchKey.m.method_imp  = inAddress;
 
     *outMI  = bsearch(&searchKey,
         iCatMethodInfos, iNumCatMethodInfos, sizeof(MethodInfo),
-            (COMPARISON_FUNC_TYPE)
-            (iSwapped ? MethodInfo_Compare_Swapped : MethodInfo_Compare));
+            (COMPARISON_FUNC_TYPE)MethodInfo_Compare);
 
     return (*outMI != NULL);
 }
 
 //  findIvar:inClass:withOffset:
 // ----------------------------------------------------------------------------
+//  Search inClass's flattened layout, see IvarLayouts. inClass is as it
+//  appears in the file.
 
-- (BOOL)findIvar: (objc1_32_ivar*)outIvar
+- (BOOL)findIvar: (IvarLayoutEntry**)outIvar
          inClass: (objc1_32_class*)inClass
       withOffset: (uint32_t)inOffset
 {
     if (!inClass || !outIvar)
         return NO;
 
-    // Loop thru inClass and all superclasses.
-    objc1_32_class*         theClassPtr     = inClass;
-    objc1_32_class          theSwappedClass = *theClassPtr;
-    objc1_32_class          theDummyClass   = {0};
-    char*                   theSuperName    = NULL;
-    objc1_32_ivar_list*     theIvars;
-
-    while (theClassPtr)
-    {
-//      if (mSwapped)
-//          swap_objc_class(&theSwappedClass);
-
-        theIvars    = (objc1_32_ivar_list*)[self getPointer:theSwappedClass.ivars type:NULL];
-
-        if (!theIvars)
-        {   // Try again with the superclass.
-            theSuperName    = [self getPointer:theClassPtr->super_class type:NULL];
-
-            if (!theSuperName)
-                break;
-
-            if (![self getObjc1Class:&theDummyClass fromName:theSuperName])
-                break;
-
-            theClassPtr = &theDummyClass;
-
-            continue;
-        }
+    IvarLayout* layout  = [self ivarLayoutForClass: inClass];
 
-        uint32_t  numIvars    = theIvars->ivar_count;
-
-        if (iSwapped)
-            numIvars    = OSSwapInt32(numIvars);
-
-        // It would be nice to use bsearch(3) here, but there's too much
-        // swapping.
-        SInt64  begin   = 0;
-        SInt64  end     = numIvars - 1;
-        SInt64  split   = numIvars / 2;
-        uint32_t  offset;
-
-        while (end >= begin)
-        {
-            offset  = theIvars->ivar_list[split].ivar_offset;
-
-            if (iSwapped)
-                offset  = OSSwapInt32(offset);
-
-            if (offset == inOffset)
-            {
-                *outIvar    = theIvars->ivar_list[split];
-
-                if (iSwapped)
-                    swap_objc1_32_ivar(outIvar);
-
-                return YES;
-            }
+    if (!layout)
+        return NO;
 
-            if (offset > inOffset)
-                end     = split - 1;
-            else
-                begin   = split + 1;
+    // Find the first ivar at inOffset, the subclass's if there's more than
+    // one.
+    uint32_t    begin   = 0;
+    uint32_t    end     = layout->numEntries;
+    uint32_t    split;
 
-            split   = (begin + end) / 2;
-        }
+    while (begin < end)
+    {
+        split   = begin + (end - begin) / 2;
 
-        // Try again with the superclass.
-        theSuperName    = [self getPointer:theClassPtr->super_class type:NULL];
+        if (layout->entries[split].offset < inOffset)
+            begin   = split + 1;
+        else
+            end     = split;
+    }
 
-        if (!theSuperName)
-            break;
+    if (begin == layout->numEntries ||
+        layout->entries[begin].offset != inOffset)
+        return NO;
 
-        if (![self getObjc1Class:&theDummyClass fromName:theSuperName])
-            break;
+    *outIvar    = &layout->entries[begin];
 
-        theClassPtr = &theDummyClass;
-    }
+    if (iCrossRefs)
+        [self addCrossRef: IvarRef name: (*outIvar)->name];
 
-    return NO;
+    return YES;
 }
 
 //  findIvar:inClass:withOffset:
@@ -201,6 +146,10 @@
     *outIvar = bsearch(&searchKey, iClassIvars, iNumClassIvars, sizeof(objc2_32_ivar_t),
         (COMPARISON_FUNC_TYPE)objc2_32_ivar_t_Compare);
 
+    if (*outIvar && iCrossRefs)
+        [self addCrossRef: IvarRef
+            name: [self getPointer:(*outIvar)->name type:NULL]];
+
     return (*outIvar != NULL);
 }
 
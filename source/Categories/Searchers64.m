@@ -10,6 +10,7 @@
 #import <Cocoa/Cocoa.h>
 
 #import "Searchers64.h"
+#import "CrossRefs.h"
 
 @implementation Exe64Processor(Searchers64)
 
@@ -51,8 +52,7 @@
 
     *outMI  = bsearch(&searchKey,
         iClassMethodInfos, iNumClassMethodInfos, sizeof(Method64Info),
-            (COMPARISON_FUNC_TYPE)
-            (iSwapped ? Method64Info_Compare_Swapped : Method64Info_Compare));
+            (COMPARISON_FUNC_TYPE)Method64Info_Compare);
 
     return (*outMI != NULL);
 }
@@ -74,6 +74,10 @@
     *outIvar = bsearch(&searchKey, iClassIvars, iNumClassIvars, sizeof(objc2_64_ivar_t),
         (COMPARISON_FUNC_TYPE)objc2_64_ivar_t_Compare);
 
+    if (*outIvar && iCrossRefs)
+        [self addCrossRef: IvarRef
+            name: [self getPointer:(*outIvar)->name type:NULL]];
+
     return (*outIvar != NULL);
 }
 
@@ -6,9 +6,14 @@
 
 #import <Cocoa/Cocoa.h>
 
+// Where otx keeps its caches, ~/Library/Caches/otx unless OTX_CACHE_DIR
+// says otherwise. Not created, returns nil if there's no caches dir.
+NSString*   OTXCacheDirectory(void);
+
 @interface NSObject(SysUtils)
 
 - (BOOL)checkOtool: (NSString*)filePath;
 - (NSString*)pathForTool: (NSString*)toolName;
+- (NSString*)findToolWithXcrun: (NSString*)toolName;
 
 @end
\ No newline at end of file
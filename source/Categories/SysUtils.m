@@ -6,35 +6,172 @@
 
 #import <Cocoa/Cocoa.h>
 #import <Foundation/NSCharacterSet.h>
+#import <pthread.h>
 
 #import "SystemIncludes.h"  // for UTF8STRING()
 #import "SysUtils.h"
 
+// Resolved tool paths, keyed by the developer-dir setting and then by tool
+// name. Loaded from disk on first use, see ToolPathsFile.
+static NSMutableDictionary* gToolPaths      = nil;
+static pthread_mutex_t      gToolPathsLock  = PTHREAD_MUTEX_INITIALIZER;
+
+//  DeveloperDirSetting
+// ----------------------------------------------------------------------------
+//  What xcrun looks at to pick a toolchain: DEVELOPER_DIR and TOOLCHAINS if
+//  they're set, otherwise the developer dir chosen with xcode-select.
+
+static NSString*
+DeveloperDirSetting(void)
+{
+    const char* devDir      = getenv("DEVELOPER_DIR");
+    const char* toolchains  = getenv("TOOLCHAINS");
+    NSString*   setting     = nil;
+
+    if (devDir && devDir[0])
+        setting = [NSString stringWithUTF8String: devDir];
+    else
+        setting = [[NSFileManager defaultManager]
+            destinationOfSymbolicLinkAtPath: @"/var/db/xcode_select_link"
+            error: NULL];
+
+    if (!setting)
+        setting = @"";
+
+    if (toolchains && toolchains[0])
+        setting = [NSString stringWithFormat: @"%@:%s", setting, toolchains];
+
+    return setting;
+}
+
+//  OTXCacheDirectory
+// ----------------------------------------------------------------------------
+//  OTX_CACHE_DIR lets bench/golden.sh give each run caches of its own.
+
+NSString*
+OTXCacheDirectory(void)
+{
+    const char* cacheDir    = getenv("OTX_CACHE_DIR");
+
+    if (cacheDir && cacheDir[0])
+        return [[NSFileManager defaultManager]
+            stringWithFileSystemRepresentation: cacheDir
+            length: strlen(cacheDir)];
+
+    NSArray*    cachesDirs  = NSSearchPathForDirectoriesInDomains(
+        NSCachesDirectory, NSUserDomainMask, YES);
+
+    if (![cachesDirs count])
+        return nil;
+
+    return [[cachesDirs objectAtIndex: 0]
+        stringByAppendingPathComponent: @"otx"];
+}
+
+//  ToolPathsFile
+// ----------------------------------------------------------------------------
+//  ~/Library/Caches/otx/ToolPaths.plist, or nil.
+
+static NSString*
+ToolPathsFile(void)
+{
+    NSString*   cacheDir    = OTXCacheDirectory();
+    NSError*    theError    = nil;
+
+    if (!cacheDir)
+        return nil;
+
+    if (![[NSFileManager defaultManager] createDirectoryAtPath: cacheDir
+        withIntermediateDirectories: YES attributes: nil error: &theError])
+    {
+        fprintf(stderr, "otx: unable to create tool path cache: %s\n",
+            UTF8STRING([theError localizedDescription]));
+        return nil;
+    }
+
+    return [cacheDir stringByAppendingPathComponent: @"ToolPaths.plist"];
+}
+
+// ============================================================================
+
 @implementation NSObject(SysUtils)
 
 //  checkOtool:
 // ----------------------------------------------------------------------------
+//  Rather than launching otool to see if it runs, just make sure there's
+//  something to launch. xcrun gives us an empty path when otool isn't
+//  installed.
 
 - (BOOL)checkOtool: (NSString*)filePath
 {
     NSString* otoolPath = [self pathForTool: @"otool"];
-    NSTask* otoolTask = [[[NSTask alloc] init] autorelease];
-    NSPipe* silence = [NSPipe pipe];
-
-    [otoolTask setLaunchPath: otoolPath];
-    [otoolTask setStandardInput: [NSPipe pipe]];
-    [otoolTask setStandardOutput: silence];
-    [otoolTask setStandardError: silence];
-    [otoolTask launch];
-    [otoolTask waitUntilExit];
 
-    return ([otoolTask terminationStatus] == 1);
+    return ([otoolPath length] &&
+        [[NSFileManager defaultManager] isExecutableFileAtPath: otoolPath]);
 }
 
 //  pathForTool:
 // ----------------------------------------------------------------------------
+//  xcrun is asked once per tool and developer-dir setting. Its answers are
+//  kept for this process and on disk for the next one, and are used only
+//  while they still point to an executable.
 
 - (NSString*)pathForTool: (NSString*)toolName
+{
+    NSString*   setting = DeveloperDirSetting();
+    NSString*   toolPath;
+
+    pthread_mutex_lock(&gToolPathsLock);
+
+    if (!gToolPaths)
+    {
+        NSString*   pathsFile   = ToolPathsFile();
+
+        if (pathsFile)
+            gToolPaths  = [[NSMutableDictionary alloc]
+                initWithContentsOfFile: pathsFile];
+
+        if (!gToolPaths)
+            gToolPaths  = [[NSMutableDictionary alloc] init];
+    }
+
+    toolPath    = [[[[gToolPaths objectForKey: setting]
+        objectForKey: toolName] retain] autorelease];
+
+    pthread_mutex_unlock(&gToolPathsLock);
+
+    if (toolPath &&
+        [[NSFileManager defaultManager] isExecutableFileAtPath: toolPath])
+        return toolPath;
+
+    toolPath    = [self findToolWithXcrun: toolName];
+
+    // Don't remember failures, the tool may be installed later.
+    if (![toolPath length])
+        return toolPath;
+
+    pthread_mutex_lock(&gToolPathsLock);
+
+    NSMutableDictionary*    settingPaths    = [NSMutableDictionary
+        dictionaryWithDictionary: [gToolPaths objectForKey: setting]];
+
+    [settingPaths setObject: toolPath forKey: toolName];
+    [gToolPaths setObject: settingPaths forKey: setting];
+
+    NSString*   pathsFile   = ToolPathsFile();
+
+    if (pathsFile && ![gToolPaths writeToFile: pathsFile atomically: YES])
+        fprintf(stderr, "otx: unable to write tool path cache\n");
+
+    pthread_mutex_unlock(&gToolPathsLock);
+
+    return toolPath;
+}
+
+//  findToolWithXcrun:
+// ----------------------------------------------------------------------------
+
+- (NSString*)findToolWithXcrun: (NSString*)toolName
 {
     NSString* relToolBase = [NSString pathWithComponents:
         [NSArray arrayWithObjects: @"/", @"usr", @"bin", nil]];
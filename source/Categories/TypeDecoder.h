@@ -0,0 +1,60 @@
+/*
+    TypeDecoder.h
+
+    A category on ExeProcessor that decodes Obj-C type encodings, the
+    @encode strings of ivars and method return types, into C
+    declarations. The decoder keeps no state between calls beyond what's
+    passed to it, so it can be called from more than one thread.
+
+    Decoded types are kept in a table keyed by the address of the encoded
+    string, which lives in the executable in RAM for as long as the
+    processor does. Each distinct encoding is decoded once per image, no
+    matter how many lines refer to it. Strings from anywhere else are
+    decoded every time.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <pthread.h>
+
+#import "ExeProcessor.h"
+
+/*  DecodedType
+
+    One decoded encoding. 'returnType' says whether it was decoded as a
+    method's return type, with any type specifier, or as a plain type.
+*/
+typedef struct
+{
+    const char* typeCode;
+    char*       text;
+    uint32_t    returnType;
+    uint32_t    padding;
+}
+DecodedType;
+
+/*  TypeDecoderState
+
+    An open-addressed table of the types decoded so far. A NULL typeCode
+    marks an empty slot. 'lock' guards the table, not the decoding.
+*/
+struct TypeDecoderState
+{
+    pthread_mutex_t lock;
+    DecodedType*    types;
+    uint32_t        numTypes;
+    uint32_t        slotMask;
+};
+
+// ============================================================================
+
+@interface ExeProcessor(TypeDecoder)
+
+- (void)setupTypeDecoder;
+- (void)decodeType: (const char*)inTypeCode
+        returnType: (BOOL)inReturnType
+            output: (char*)outCString;
+- (void)freeTypeDecoder;
+
+@end
@@ -0,0 +1,449 @@
+/*
+    TypeDecoder.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "TypeDecoder.h"
+
+// ----------------------------------------------------------------------------
+
+static uint32_t
+HashTypeCode(
+    const char* inTypeCode,
+    BOOL        inReturnType)
+{
+    UInt64  key = (UInt64)(uintptr_t)inTypeCode ^ (inReturnType != NO);
+
+    return (uint32_t)((key * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+//  FindTypeSlot
+// ----------------------------------------------------------------------------
+//  The slot holding inTypeCode, or the empty slot where it would go.
+
+static DecodedType*
+FindTypeSlot(
+    DecodedType*    inTypes,
+    uint32_t        inSlotMask,
+    const char*     inTypeCode,
+    BOOL            inReturnType)
+{
+    uint32_t    slot    = HashTypeCode(inTypeCode, inReturnType) & inSlotMask;
+
+    while (inTypes[slot].typeCode &&
+        (inTypes[slot].typeCode != inTypeCode ||
+        inTypes[slot].returnType != (inReturnType != NO)))
+        slot    = (slot + 1) & inSlotMask;
+
+    return &inTypes[slot];
+}
+
+//  DecodeType
+// ----------------------------------------------------------------------------
+//  "filer types" defined in objc/objc-class.h, NSCoder.h, and
+// http://developer.apple.com/documentation/DeveloperTools/gcc-3.3/gcc/Type-encoding.html
+//  outCString must hold MAX_TYPE_STRING_LENGTH chars.
+
+static void
+DecodeType(
+    char*       outCString,
+    const char* inTypeCode,
+    BOOL        inArrayElement)
+{
+    char        theSuffixCString[50];
+    uint32_t    theNextChar = 0;
+    UInt16      i           = 0;
+
+/*
+    char vs. BOOL
+
+    data type       encoding
+    ---------       --------
+    char            c
+    BOOL            c
+    char[100]       [100c]
+    BOOL[100]       [100c]
+
+    from <objc/objc.h>:
+        typedef signed char     BOOL;
+        // BOOL is explicitly signed so @encode(BOOL) == "c" rather than "C"
+        // even if -funsigned-char is used.
+
+    Ok, so BOOL is just a synonym for signed char, and the @encode directive
+    can't be expected to desynonize that. Fair enough, but for our purposes,
+    it would be nicer if BOOL was synonized to unsigned char instead.
+
+    So, any occurence of 'c' may be a char or a BOOL. The best option I can
+    see is to treat arrays as char arrays and atomic values as BOOL, and maybe
+    let the user disagree via preferences. Since the data type of an array is
+    decoded with a recursive call, the caller says whether we're decoding an
+    array's elements in inArrayElement.
+
+    As of otx 0.14b, letting the user override this behavior with a pref is
+    left as an exercise for the reader.
+*/
+
+    // Convert '^^' prefix to '**' suffix.
+    while (inTypeCode[theNextChar] == '^' &&
+        i < sizeof(theSuffixCString) - 1)
+    {
+        theSuffixCString[i++]   = '*';
+        theNextChar++;
+    }
+
+    // Add the null terminator.
+    theSuffixCString[i] = 0;
+    i   = 0;
+
+    char    theTypeCString[MAX_TYPE_STRING_LENGTH];
+
+    theTypeCString[0]   = 0;
+
+    // Now we can get at the basic type.
+    switch (inTypeCode[theNextChar])
+    {
+        case '@':
+        {
+            if (inTypeCode[theNextChar + 1] == '"')
+            {
+                size_t classNameLength = strlen(&inTypeCode[theNextChar + 2]);
+
+                if (classNameLength > MAX_TYPE_STRING_LENGTH)
+                    classNameLength = MAX_TYPE_STRING_LENGTH;
+
+                if (classNameLength)
+                {
+                    memcpy(theTypeCString, &inTypeCode[theNextChar + 2],
+                        classNameLength - 1);
+
+                    // Add the null terminator.
+                    theTypeCString[classNameLength - 1] = 0;
+                }
+            }
+            else
+                strncpy(theTypeCString, "id", 3);
+
+            break;
+        }
+
+        case '#':
+            strncpy(theTypeCString, "Class", 6);
+            break;
+        case ':':
+            strncpy(theTypeCString, "SEL", 4);
+            break;
+        case '*':
+            strncpy(theTypeCString, "char*", 6);
+            break;
+        case '?':
+            strncpy(theTypeCString, "undefined", 10);
+            break;
+        case 'i':
+            strncpy(theTypeCString, "int", 4);
+            break;
+        case 'I':
+            strncpy(theTypeCString, "unsigned int", 13);
+            break;
+        // bitfield according to objc-class.h, C++ bool according to NSCoder.h.
+        // The above URL expands on obj-class.h's definition of 'b' when used
+        // in structs/unions, but NSCoder.h's definition seems to take
+        // priority in return values.
+        case 'B':
+        case 'b':
+            strncpy(theTypeCString, "bool", 5);
+            break;
+        case 'c':
+            strncpy(theTypeCString, (inArrayElement) ? "char" : "BOOL", 5);
+            break;
+        case 'C':
+            strncpy(theTypeCString, "unsigned char", 14);
+            break;
+        case 'd':
+            strncpy(theTypeCString, "double", 7);
+            break;
+        case 'f':
+            strncpy(theTypeCString, "float", 6);
+            break;
+        case 'l':
+            strncpy(theTypeCString, "long", 5);
+            break;
+        case 'L':
+            strncpy(theTypeCString, "unsigned long", 14);
+            break;
+        case 'q':   // not in objc-class.h
+            strncpy(theTypeCString, "long long", 10);
+            break;
+        case 'Q':   // not in objc-class.h
+            strncpy(theTypeCString, "unsigned long long", 19);
+            break;
+        case 's':
+            strncpy(theTypeCString, "short", 6);
+            break;
+        case 'S':
+            strncpy(theTypeCString, "unsigned short", 15);
+            break;
+        case 'v':
+            strncpy(theTypeCString, "void", 5);
+            break;
+        case '(':   // union- just copy the name
+            while (inTypeCode[++theNextChar] != '=' &&
+                   inTypeCode[theNextChar]   != ')' &&
+                   inTypeCode[theNextChar]   != '<' &&
+                   inTypeCode[theNextChar]   != 0   &&
+                   theNextChar < MAX_TYPE_STRING_LENGTH)
+                theTypeCString[i++] = inTypeCode[theNextChar];
+
+                // Add the null terminator.
+                theTypeCString[i]   = 0;
+
+            break;
+
+        case '{':   // struct- just copy the name
+            while (inTypeCode[++theNextChar] != '=' &&
+                   inTypeCode[theNextChar]   != '}' &&
+                   inTypeCode[theNextChar]   != '<' &&
+                   inTypeCode[theNextChar]   != 0   &&
+                   theNextChar < MAX_TYPE_STRING_LENGTH)
+                theTypeCString[i++] = inTypeCode[theNextChar];
+
+                // Add the null terminator.
+                theTypeCString[i]   = 0;
+
+            break;
+
+        case '[':   // array    [12^f] <-> float*[12]
+        {
+            char    theArrayCCount[10]  = {0};
+
+            while (inTypeCode[++theNextChar] >= '0' &&
+                   inTypeCode[theNextChar]   <= '9')
+            {
+                if (i < sizeof(theArrayCCount) - 1)
+                    theArrayCCount[i++] = inTypeCode[theNextChar];
+            }
+
+            // Recursive madness. See 'char vs. BOOL' note above.
+            char    theCType[MAX_TYPE_STRING_LENGTH];
+
+            DecodeType(theCType, &inTypeCode[theNextChar], YES);
+
+            snprintf(theTypeCString, MAX_TYPE_STRING_LENGTH, "%s[%s]",
+                theCType, theArrayCCount);
+
+            break;
+        }
+
+        default:
+            strncpy(theTypeCString, "?", 2);
+
+            break;
+    }
+
+    snprintf(outCString, MAX_TYPE_STRING_LENGTH, "%s%s",
+        theTypeCString, theSuffixCString);
+}
+
+//  DecodeReturnType
+// ----------------------------------------------------------------------------
+//  outCString must hold MAX_TYPE_STRING_LENGTH chars.
+
+static void
+DecodeReturnType(
+    char*       outCString,
+    const char* inTypeCode)
+{
+    const char* theSpecifier    = "";
+    uint32_t    theNextChar     = 0;
+
+    // Check for type specifiers.
+    // r* <-> const char* ... VI <-> oneway unsigned int
+    switch (inTypeCode[theNextChar++])
+    {
+        case 'r':
+            theSpecifier    = "const ";
+            break;
+        case 'n':
+            theSpecifier    = "in ";
+            break;
+        case 'N':
+            theSpecifier    = "inout ";
+            break;
+        case 'o':
+            theSpecifier    = "out ";
+            break;
+        case 'O':
+            theSpecifier    = "bycopy ";
+            break;
+        case 'V':
+            theSpecifier    = "oneway ";
+            break;
+
+        // No specifier found, roll back the marker.
+        default:
+            theNextChar--;
+            break;
+    }
+
+    char    theTypeCString[MAX_TYPE_STRING_LENGTH];
+
+    DecodeType(theTypeCString, &inTypeCode[theNextChar], NO);
+    snprintf(outCString, MAX_TYPE_STRING_LENGTH, "%s%s",
+        theSpecifier, theTypeCString);
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(TypeDecoder)
+
+//  setupTypeDecoder
+// ----------------------------------------------------------------------------
+//  Called once, before anything is decoded. Without the table, types are
+//  decoded every time.
+
+- (void)setupTypeDecoder
+{
+    if (iTypeDecoder)
+        return;
+
+    iTypeDecoder    = calloc(1, sizeof(TypeDecoderState));
+
+    if (!iTypeDecoder)
+        return;
+
+    if (pthread_mutex_init(&iTypeDecoder->lock, NULL) != 0)
+    {
+        free(iTypeDecoder);
+        iTypeDecoder    = NULL;
+    }
+}
+
+//  decodeType:returnType:output:
+// ----------------------------------------------------------------------------
+//  outCString must hold MAX_TYPE_STRING_LENGTH chars. If inReturnType,
+//  inTypeCode may start with a type specifier like 'r' for const.
+
+- (void)decodeType: (const char*)inTypeCode
+        returnType: (BOOL)inReturnType
+            output: (char*)outCString
+{
+    BOOL            cacheable   = iTypeDecoder &&
+        inTypeCode >= iRAMFile && inTypeCode < iRAMFile + iRAMFileSize;
+    DecodedType*    type;
+
+    if (cacheable)
+    {
+        pthread_mutex_lock(&iTypeDecoder->lock);
+
+        if (iTypeDecoder->types)
+        {
+            type    = FindTypeSlot(iTypeDecoder->types,
+                iTypeDecoder->slotMask, inTypeCode, inReturnType);
+
+            if (type->typeCode)
+            {
+                strncpy(outCString, type->text, MAX_TYPE_STRING_LENGTH);
+                pthread_mutex_unlock(&iTypeDecoder->lock);
+
+                return;
+            }
+        }
+
+        pthread_mutex_unlock(&iTypeDecoder->lock);
+    }
+
+    // Decode outside the lock.
+    if (inReturnType)
+        DecodeReturnType(outCString, inTypeCode);
+    else
+        DecodeType(outCString, inTypeCode, NO);
+
+    if (!cacheable)
+        return;
+
+    char*   text    = strdup(outCString);
+
+    if (!text)
+        return;
+
+    pthread_mutex_lock(&iTypeDecoder->lock);
+
+    // Keep the table at most half full.
+    uint32_t    numSlots    = (iTypeDecoder->types) ?
+        iTypeDecoder->slotMask + 1 : 0;
+
+    if ((iTypeDecoder->numTypes + 1) * 2 > numSlots)
+    {
+        uint32_t        newNumSlots = (numSlots) ? numSlots * 2 : 256;
+        DecodedType*    newTypes    =
+            calloc(newNumSlots, sizeof(DecodedType));
+        uint32_t        i;
+
+        if (!newTypes)
+        {
+            pthread_mutex_unlock(&iTypeDecoder->lock);
+            free(text);
+
+            return;
+        }
+
+        for (i = 0; i < numSlots; i++)
+        {
+            type    = &iTypeDecoder->types[i];
+
+            if (type->typeCode)
+                *FindTypeSlot(newTypes, newNumSlots - 1, type->typeCode,
+                    type->returnType) = *type;
+        }
+
+        if (iTypeDecoder->types)
+            free(iTypeDecoder->types);
+
+        iTypeDecoder->types     = newTypes;
+        iTypeDecoder->slotMask  = newNumSlots - 1;
+    }
+
+    type    = FindTypeSlot(iTypeDecoder->types, iTypeDecoder->slotMask,
+        inTypeCode, inReturnType);
+
+    // Another thread may have decoded it meanwhile.
+    if (type->typeCode)
+        free(text);
+    else
+    {
+        *type   = (DecodedType){inTypeCode, text, (inReturnType != NO), 0};
+        iTypeDecoder->numTypes++;
+    }
+
+    pthread_mutex_unlock(&iTypeDecoder->lock);
+}
+
+//  freeTypeDecoder
+// ----------------------------------------------------------------------------
+
+- (void)freeTypeDecoder
+{
+    if (!iTypeDecoder)
+        return;
+
+    if (iTypeDecoder->types)
+    {
+        uint32_t    i;
+
+        for (i = 0; i <= iTypeDecoder->slotMask; i++)
+        {
+            if (iTypeDecoder->types[i].text)
+                free(iTypeDecoder->types[i].text);
+        }
+
+        free(iTypeDecoder->types);
+    }
+
+    pthread_mutex_destroy(&iTypeDecoder->lock);
+    free(iTypeDecoder);
+    iTypeDecoder    = NULL;
+}
+
+@end
@@ -0,0 +1,77 @@
+/*
+    VerboseLines.h
+
+    A category on ExeProcessor that keeps the few lines of otool's verbose
+    (-V) output that chooseLine: may use, see Exe32Processor.h. The
+    processors say which instructions those are, see
+    mayChooseVerboseLineAtAddress:, and every other verbose line is
+    dropped as it's read, instead of being kept in a second line list for
+    the length of the run.
+
+    Each otool reader fills a VerboseLineBatch of its own on its own
+    thread. The batches are added to the table once the readers are done,
+    and the lines are then looked up by address.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ExeProcessor.h"
+
+/*  VerboseLine
+
+    One line of verbose output, newline and all, and the address of its
+    instruction.
+*/
+typedef struct
+{
+    UInt64      address;
+    char*       chars;
+    uint32_t    length;
+    uint32_t    padding;
+}
+VerboseLine;
+
+/*  VerboseLineBatch
+
+    The lines read from one otool pipe.
+*/
+typedef struct
+{
+    VerboseLine*    lines;
+    uint32_t        numLines;
+    uint32_t        capacity;
+}
+VerboseLineBatch;
+
+/*  VerboseLinesState
+
+    The lines in the order their batches were added, and an open-addressed
+    index of them by address. 'slots' holds index + 1, 0 if empty.
+*/
+struct VerboseLinesState
+{
+    VerboseLine*    lines;
+    uint32_t        numLines;
+    uint32_t        capacity;
+    uint32_t*       slots;
+    uint32_t        slotMask;
+};
+
+// ============================================================================
+
+@interface ExeProcessor(VerboseLines)
+
+- (BOOL)addVerboseLine: (const char*)inChars
+                length: (size_t)inLength
+               address: (UInt64)inAddr
+               toBatch: (VerboseLineBatch*)ioBatch;
+- (void)addVerboseLineBatch: (VerboseLineBatch*)ioBatch;
+- (void)indexVerboseLines;
+- (char*)verboseLineAtAddress: (UInt64)inAddr;
+- (char*)takeVerboseLineAtAddress: (UInt64)inAddr
+                           length: (size_t*)outLength;
+- (void)freeVerboseLines;
+
+@end
@@ -0,0 +1,233 @@
+/*
+    VerboseLines.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "TableUtils.h"
+#import "VerboseLines.h"
+
+// ----------------------------------------------------------------------------
+
+static uint32_t
+HashAddress(
+    UInt64  inAddr)
+{
+    return (uint32_t)((inAddr * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+// ============================================================================
+
+@implementation ExeProcessor(VerboseLines)
+
+//  addVerboseLine:length:address:toBatch:
+// ----------------------------------------------------------------------------
+//  Called from the otool reader threads, so this touches nothing but
+//  ioBatch.
+
+- (BOOL)addVerboseLine: (const char*)inChars
+                length: (size_t)inLength
+               address: (UInt64)inAddr
+               toBatch: (VerboseLineBatch*)ioBatch
+{
+    if (!GrowTable((void**)&ioBatch->lines, ioBatch->numLines,
+        &ioBatch->capacity, sizeof(VerboseLine)))
+        return NO;
+
+    char*   chars   = malloc(inLength + 1);
+
+    if (!chars)
+    {
+        fprintf(stderr, "otx: not enough memory for verbose lines\n");
+        return NO;
+    }
+
+    memcpy(chars, inChars, inLength + 1);
+    ioBatch->lines[ioBatch->numLines++] =
+        (VerboseLine){inAddr, chars, (uint32_t)inLength, 0};
+
+    return YES;
+}
+
+//  addVerboseLineBatch:
+// ----------------------------------------------------------------------------
+//  Take over ioBatch's lines, leaving it empty. Lines added after
+//  indexVerboseLines are not found.
+
+- (void)addVerboseLineBatch: (VerboseLineBatch*)ioBatch
+{
+    if (!ioBatch->numLines)
+    {
+        if (ioBatch->lines)
+            free(ioBatch->lines);
+
+        *ioBatch    = (VerboseLineBatch){NULL, 0, 0};
+        return;
+    }
+
+    if (!iVerboseLines)
+        iVerboseLines   = calloc(1, sizeof(VerboseLinesState));
+
+    VerboseLine*    lines   = NULL;
+    uint32_t        i;
+
+    if (iVerboseLines)
+        lines   = realloc(iVerboseLines->lines,
+            (iVerboseLines->numLines + ioBatch->numLines) *
+            sizeof(VerboseLine));
+
+    if (!lines)
+    {
+        fprintf(stderr, "otx: not enough memory for verbose lines\n");
+
+        for (i = 0; i < ioBatch->numLines; i++)
+            free(ioBatch->lines[i].chars);
+    }
+    else
+    {
+        memcpy(lines + iVerboseLines->numLines, ioBatch->lines,
+            ioBatch->numLines * sizeof(VerboseLine));
+        iVerboseLines->lines    = lines;
+        iVerboseLines->numLines += ioBatch->numLines;
+        iVerboseLines->capacity = iVerboseLines->numLines;
+    }
+
+    free(ioBatch->lines);
+    *ioBatch    = (VerboseLineBatch){NULL, 0, 0};
+}
+
+//  indexVerboseLines
+// ----------------------------------------------------------------------------
+//  Build the index once every batch is added. Where two lines share an
+//  address, the first one added wins.
+
+- (void)indexVerboseLines
+{
+    if (!iVerboseLines || !iVerboseLines->numLines)
+        return;
+
+    uint32_t    numSlots    = 1;
+
+    while (numSlots < iVerboseLines->numLines * 2)
+        numSlots    <<= 1;
+
+    if (iVerboseLines->slots)
+        free(iVerboseLines->slots);
+
+    iVerboseLines->slots    = calloc(numSlots, sizeof(uint32_t));
+
+    if (!iVerboseLines->slots)
+    {
+        fprintf(stderr, "otx: not enough memory to index verbose lines\n");
+        return;
+    }
+
+    iVerboseLines->slotMask = numSlots - 1;
+
+    uint32_t    i;
+
+    for (i = 0; i < iVerboseLines->numLines; i++)
+    {
+        UInt64      address = iVerboseLines->lines[i].address;
+        uint32_t    slot    = HashAddress(address) & iVerboseLines->slotMask;
+
+        while (iVerboseLines->slots[slot] &&
+            iVerboseLines->lines[iVerboseLines->slots[slot] - 1].address !=
+            address)
+            slot    = (slot + 1) & iVerboseLines->slotMask;
+
+        if (!iVerboseLines->slots[slot])
+            iVerboseLines->slots[slot]  = i + 1;
+    }
+}
+
+//  verboseLineAtAddress:
+// ----------------------------------------------------------------------------
+//  The verbose line for the instruction at inAddr, or NULL if it wasn't
+//  kept or was already taken.
+
+- (char*)verboseLineAtAddress: (UInt64)inAddr
+{
+    if (!iVerboseLines || !iVerboseLines->slots)
+        return NULL;
+
+    uint32_t    slot    = HashAddress(inAddr) & iVerboseLines->slotMask;
+
+    while (iVerboseLines->slots[slot])
+    {
+        VerboseLine*    line    =
+            &iVerboseLines->lines[iVerboseLines->slots[slot] - 1];
+
+        if (line->address == inAddr)
+            return line->chars;
+
+        slot    = (slot + 1) & iVerboseLines->slotMask;
+    }
+
+    return NULL;
+}
+
+//  takeVerboseLineAtAddress:length:
+// ----------------------------------------------------------------------------
+//  Like verboseLineAtAddress:, but the caller becomes the owner of the
+//  line and must free it. Each line is used once, so it's not copied.
+
+- (char*)takeVerboseLineAtAddress: (UInt64)inAddr
+                           length: (size_t*)outLength
+{
+    if (!iVerboseLines || !iVerboseLines->slots)
+        return NULL;
+
+    uint32_t    slot    = HashAddress(inAddr) & iVerboseLines->slotMask;
+
+    while (iVerboseLines->slots[slot])
+    {
+        VerboseLine*    line    =
+            &iVerboseLines->lines[iVerboseLines->slots[slot] - 1];
+
+        if (line->address == inAddr)
+        {
+            char*   chars   = line->chars;
+
+            if (outLength)
+                *outLength  = line->length;
+
+            line->chars = NULL;
+            return chars;
+        }
+
+        slot    = (slot + 1) & iVerboseLines->slotMask;
+    }
+
+    return NULL;
+}
+
+//  freeVerboseLines
+// ----------------------------------------------------------------------------
+
+- (void)freeVerboseLines
+{
+    if (!iVerboseLines)
+        return;
+
+    uint32_t    i;
+
+    for (i = 0; i < iVerboseLines->numLines; i++)
+    {
+        if (iVerboseLines->lines[i].chars)
+            free(iVerboseLines->lines[i].chars);
+    }
+
+    if (iVerboseLines->lines)
+        free(iVerboseLines->lines);
+
+    if (iVerboseLines->slots)
+        free(iVerboseLines->slots);
+
+    free(iVerboseLines);
+    iVerboseLines   = NULL;
+}
+
+@end
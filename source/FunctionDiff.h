@@ -0,0 +1,32 @@
+/*
+    FunctionDiff.h
+
+    Compares two builds of an executable function by function, for
+    'otx -diff'. Both builds are processed into temp files, each reporting
+    to its own ProgressState, and each function's FunctionCache fingerprint
+    is kept. Functions are paired by name, which is the symbol or the Obj-C
+    method, and what's left over is paired by fingerprint, so that an
+    anonymous function that didn't change still finds its partner. Both
+    pairings use hash tables.
+
+    Only the functions that were added, removed or changed are printed,
+    each with its full annotated text: the new text for added and changed
+    functions, the old text for removed ones. Fingerprints leave out the
+    addresses of whatever a function refers to, so a function that merely
+    moved, or whose callees moved, is not reported.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "SharedDefs.h"
+
+BOOL
+PrintFunctionDiff(
+    Class               inProcClass,
+    NSURL*              inOldFile,
+    NSURL*              inNewFile,
+    const ProcOptions*  inOptions,
+    NSArray*            inFunctionFilters,
+    FILE*               outFile);
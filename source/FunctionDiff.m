@@ -0,0 +1,605 @@
+/*
+    FunctionDiff.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <ctype.h>
+#import <pthread.h>
+#import <unistd.h>
+
+#import "FunctionDiff.h"
+#import "FunctionCache.h"
+#import "OutputIndex.h"
+#import "ProgressReporter.h"
+
+#define NO_MATCH    UINT32_MAX
+
+/*  DiffProgress
+
+    The controller each build's processor reports to, so the two builds
+    never share a ProgressState.
+*/
+@interface DiffProgress : NSObject<ProgressReporter>
+{
+@private
+    ProgressState   iProgress;
+}
+
+@end
+
+/*  DiffFunction
+
+    One function of one build, from its output index entry. 'name' is NULL
+    for anonymous functions, which have nothing to be matched by but their
+    fingerprints.
+*/
+typedef struct
+{
+    UInt64          address;
+    const char*     name;           // in the index's names
+    uint32_t        nameHash;
+    FunctionDigest  digest;
+    BOOL            hasDigest;
+    uint32_t        match;          // into the other build's functions
+}
+DiffFunction;
+
+/*  DiffBuild
+
+    Everything about one of the two builds. The processing half runs on its
+    own thread for the old build.
+*/
+typedef struct
+{
+    Class           procClass;
+    NSURL*          file;
+    DiffProgress*   progress;
+    ProcOptions     opts;
+    NSArray*        filters;
+    BOOL            processed;
+    char            path[MAXPATHLEN];   // the temp output file
+
+    // Results of processing, sorted by address.
+    CachedFunction* digests;
+    uint32_t        numDigests;
+
+    // The output, read back through its index.
+    OutputIndexMap  map;
+    DiffFunction*   funcs;
+    uint32_t        numFuncs;
+}
+DiffBuild;
+
+/*  DiffTable
+
+    An open-addressed hash table of function numbers + 1.
+*/
+typedef struct
+{
+    uint32_t*   slots;
+    uint32_t    size;       // a power of 2
+}
+DiffTable;
+
+// ----------------------------------------------------------------------------
+//  FNV-1a.
+
+static uint32_t
+HashName(
+    const char* inName)
+{
+    uint32_t    hash    = 2166136261U;
+
+    while (*inName)
+    {
+        hash    ^= (UInt8)*inName++;
+        hash    *= 16777619U;
+    }
+
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+//  MD5 is already as well mixed as it gets.
+
+static uint32_t
+HashDigest(
+    const FunctionDigest*   inDigest)
+{
+    uint32_t    hash;
+
+    memcpy(&hash, inDigest->bytes, sizeof(hash));
+
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+// Comparison function for bsearch(3)
+
+static int
+CachedFunction_CompareAddress(
+    CachedFunction* f1,
+    CachedFunction* f2)
+{
+    if (f1->address < f2->address)
+        return -1;
+
+    return (f1->address > f2->address);
+}
+
+// ----------------------------------------------------------------------------
+//  Anon functions are numbered in order of appearance, so their names say
+//  nothing about which function is which.
+
+static BOOL
+IsAnonymousName(
+    const char* inName)
+{
+    return !inName[0] ||
+        (!strncmp(inName, ANON_FUNC_BASE, ANON_FUNC_BASE_LENGTH) &&
+        (isdigit(inName[ANON_FUNC_BASE_LENGTH]) ||
+        inName[ANON_FUNC_BASE_LENGTH] == '?'));
+}
+
+#pragma mark -
+// ----------------------------------------------------------------------------
+//  Process one build into a temp file, keeping its fingerprints.
+
+static void
+ProcessBuild(
+    DiffBuild*  ioBuild)
+{
+    @autoreleasepool
+    {
+        snprintf(ioBuild->path, MAXPATHLEN, "%s/otx.XXXXXX",
+            [NSTemporaryDirectory() fileSystemRepresentation]);
+
+        int fd  = mkstemp(ioBuild->path);
+
+        if (fd == -1)
+        {
+            perror("otx: unable to create temp file");
+            ioBuild->path[0]    = 0;
+            return;
+        }
+
+        close(fd);
+
+        id  theProcessor    = [[ioBuild->procClass alloc]
+            initWithURL: ioBuild->file controller: ioBuild->progress
+            options: &ioBuild->opts];
+
+        if (!theProcessor)
+        {
+            fprintf(stderr, "otx: unable to create processor for %s\n",
+                [[ioBuild->file path] fileSystemRepresentation]);
+            return;
+        }
+
+        [theProcessor setFunctionFilters: ioBuild->filters];
+
+        ioBuild->processed  = [theProcessor processExe:
+            [NSString stringWithUTF8String: ioBuild->path]];
+
+        if (ioBuild->processed)
+            ioBuild->numDigests =
+                [theProcessor copyFunctionDigests: &ioBuild->digests];
+
+        [theProcessor release];
+    }
+}
+
+// ----------------------------------------------------------------------------
+//  Body of the thread that processes the old build.
+
+static void*
+ProcessBuildThread(
+    void*   inBuild)
+{
+    ProcessBuild(inBuild);
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+//  Read back the functions of a processed build and give them their
+//  fingerprints.
+
+static BOOL
+LoadBuildFunctions(
+    DiffBuild*  ioBuild)
+{
+    if (!MapOutputIndex(ioBuild->path, &ioBuild->map))
+        return NO;
+
+    uint32_t    numEntries  = ioBuild->map.header->numEntries;
+    uint32_t    i;
+
+    ioBuild->funcs  = calloc((numEntries) ? numEntries : 1,
+        sizeof(DiffFunction));
+
+    if (!ioBuild->funcs)
+    {
+        fprintf(stderr, "otx: not enough memory to compare functions\n");
+        return NO;
+    }
+
+    ioBuild->numFuncs   = numEntries;
+
+    for (i = 0; i < numEntries; i++)
+    {
+        DiffFunction*   func    = &ioBuild->funcs[i];
+        const char*     name    = IndexedFunctionName(&ioBuild->map, i);
+        CachedFunction  searchKey;
+
+        func->address   = ioBuild->map.entries[i].address;
+        func->match     = NO_MATCH;
+
+        if (!IsAnonymousName(name))
+        {
+            func->name      = name;
+            func->nameHash  = HashName(name);
+        }
+
+        searchKey.address   = func->address;
+
+        CachedFunction* digestFunc  = bsearch(&searchKey,
+            ioBuild->digests, ioBuild->numDigests, sizeof(CachedFunction),
+            (COMPARISON_FUNC_TYPE)CachedFunction_CompareAddress);
+
+        if (digestFunc)
+        {
+            func->digest    = digestFunc->digest;
+            func->hasDigest = YES;
+        }
+    }
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+
+static void
+FreeBuild(
+    DiffBuild*  ioBuild)
+{
+    if (ioBuild->progress)
+        [ioBuild->progress release];
+
+    UnmapOutputIndex(&ioBuild->map);
+
+    if (ioBuild->funcs)
+        free(ioBuild->funcs);
+
+    if (ioBuild->digests)
+        free(ioBuild->digests);
+
+    if (ioBuild->path[0])
+    {
+        unlink(ioBuild->path);
+        RemoveOutputIndex(ioBuild->path);
+    }
+}
+
+#pragma mark -
+// ----------------------------------------------------------------------------
+//  A table big enough for inCount functions at no more than half full.
+
+static BOOL
+AllocateTable(
+    DiffTable*  outTable,
+    uint32_t    inCount)
+{
+    outTable->size  = 16;
+
+    while (outTable->size < inCount * 2)
+        outTable->size  *= 2;
+
+    outTable->slots = calloc(outTable->size, sizeof(uint32_t));
+
+    if (!outTable->slots)
+    {
+        fprintf(stderr, "otx: not enough memory to compare functions\n");
+        return NO;
+    }
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+
+static void
+InsertFunction(
+    DiffTable*  ioTable,
+    uint32_t    inHash,
+    uint32_t    inFuncNum)
+{
+    uint32_t    mask    = ioTable->size - 1;
+    uint32_t    slot    = inHash & mask;
+
+    while (ioTable->slots[slot])
+        slot    = (slot + 1) & mask;
+
+    ioTable->slots[slot]    = inFuncNum + 1;
+}
+
+// ----------------------------------------------------------------------------
+//  Pair each new function with the first unpaired old function of the same
+//  name. Functions that share a name, like static functions from different
+//  files, pair up in order.
+
+static void
+MatchByName(
+    DiffBuild*  ioOld,
+    DiffBuild*  ioNew,
+    DiffTable*  ioTable)
+{
+    uint32_t    mask    = ioTable->size - 1;
+    uint32_t    i;
+
+    for (i = 0; i < ioOld->numFuncs; i++)
+        if (ioOld->funcs[i].name)
+            InsertFunction(ioTable, ioOld->funcs[i].nameHash, i);
+
+    for (i = 0; i < ioNew->numFuncs; i++)
+    {
+        DiffFunction*   newFunc = &ioNew->funcs[i];
+
+        if (!newFunc->name)
+            continue;
+
+        uint32_t    slot;
+
+        for (slot = newFunc->nameHash & mask; ioTable->slots[slot];
+            slot = (slot + 1) & mask)
+        {
+            DiffFunction*   oldFunc =
+                &ioOld->funcs[ioTable->slots[slot] - 1];
+
+            if (oldFunc->match == NO_MATCH &&
+                oldFunc->nameHash == newFunc->nameHash &&
+                !strcmp(oldFunc->name, newFunc->name))
+            {
+                oldFunc->match  = i;
+                newFunc->match  = ioTable->slots[slot] - 1;
+                break;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+//  Pair what's left by fingerprint. A pair found this way is unchanged by
+//  definition.
+
+static void
+MatchByDigest(
+    DiffBuild*  ioOld,
+    DiffBuild*  ioNew,
+    DiffTable*  ioTable)
+{
+    uint32_t    mask    = ioTable->size - 1;
+    uint32_t    i;
+
+    for (i = 0; i < ioOld->numFuncs; i++)
+        if (ioOld->funcs[i].match == NO_MATCH && ioOld->funcs[i].hasDigest)
+            InsertFunction(ioTable, HashDigest(&ioOld->funcs[i].digest), i);
+
+    for (i = 0; i < ioNew->numFuncs; i++)
+    {
+        DiffFunction*   newFunc = &ioNew->funcs[i];
+
+        if (newFunc->match != NO_MATCH || !newFunc->hasDigest)
+            continue;
+
+        uint32_t    slot;
+
+        for (slot = HashDigest(&newFunc->digest) & mask; ioTable->slots[slot];
+            slot = (slot + 1) & mask)
+        {
+            DiffFunction*   oldFunc =
+                &ioOld->funcs[ioTable->slots[slot] - 1];
+
+            if (oldFunc->match == NO_MATCH &&
+                !memcmp(oldFunc->digest.bytes, newFunc->digest.bytes,
+                    CC_MD5_DIGEST_LENGTH))
+            {
+                oldFunc->match  = i;
+                newFunc->match  = ioTable->slots[slot] - 1;
+                break;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+//  A function that can't be fingerprinted is never assumed unchanged.
+
+static BOOL
+FunctionChanged(
+    const DiffFunction* inOld,
+    const DiffFunction* inNew)
+{
+    return !inOld->hasDigest || !inNew->hasDigest ||
+        memcmp(inOld->digest.bytes, inNew->digest.bytes,
+            CC_MD5_DIGEST_LENGTH);
+}
+
+// ----------------------------------------------------------------------------
+
+static BOOL
+PrintFunction(
+    const char*         inWhat,
+    DiffBuild*          inBuild,
+    uint32_t            inFuncNum,
+    const DiffFunction* inOldFunc,
+    FILE*               outFile)
+{
+    const DiffFunction* func    = &inBuild->funcs[inFuncNum];
+    const char*         name    = IndexedFunctionName(&inBuild->map, inFuncNum);
+
+    if (!name[0])
+        name    = "(unnamed)";
+
+    if (inOldFunc)
+        fprintf(outFile, "\n%s: %s\t0x%llx -> 0x%llx\n", inWhat, name,
+            inOldFunc->address, func->address);
+    else
+        fprintf(outFile, "\n%s: %s\t0x%llx\n", inWhat, name, func->address);
+
+    return CopyIndexedFunction(&inBuild->map, inFuncNum, outFile);
+}
+
+// ----------------------------------------------------------------------------
+//  Pair up the functions of both builds and print the differences.
+
+static BOOL
+PrintDifferences(
+    DiffBuild*  ioOld,
+    DiffBuild*  ioNew,
+    FILE*       outFile)
+{
+    DiffTable   table;
+
+    // One table serves both passes, emptied in between.
+    if (!AllocateTable(&table, (ioOld->numFuncs > ioNew->numFuncs) ?
+        ioOld->numFuncs : ioNew->numFuncs))
+        return NO;
+
+    MatchByName(ioOld, ioNew, &table);
+    memset(table.slots, 0, table.size * sizeof(uint32_t));
+    MatchByDigest(ioOld, ioNew, &table);
+    free(table.slots);
+
+    BOOL        success     = YES;
+    uint32_t    numChanged  = 0;
+    uint32_t    numAdded    = 0;
+    uint32_t    numRemoved  = 0;
+    uint32_t    i;
+
+    // New functions in output order, then what's gone.
+    for (i = 0; success && i < ioNew->numFuncs; i++)
+    {
+        DiffFunction*   newFunc = &ioNew->funcs[i];
+
+        if (newFunc->match == NO_MATCH)
+        {
+            success = PrintFunction("added", ioNew, i, NULL, outFile);
+            numAdded++;
+        }
+        else if (FunctionChanged(&ioOld->funcs[newFunc->match], newFunc))
+        {
+            success = PrintFunction("changed", ioNew, i,
+                &ioOld->funcs[newFunc->match], outFile);
+            numChanged++;
+        }
+    }
+
+    for (i = 0; success && i < ioOld->numFuncs; i++)
+    {
+        if (ioOld->funcs[i].match != NO_MATCH)
+            continue;
+
+        success = PrintFunction("removed", ioOld, i, NULL, outFile);
+        numRemoved++;
+    }
+
+    if (success)
+        fprintf(outFile, "\n%u changed, %u added, %u removed, "
+            "%u unchanged\n", numChanged, numAdded, numRemoved,
+            ioNew->numFuncs - numAdded - numChanged);
+
+    return success;
+}
+
+#pragma mark -
+//  PrintFunctionDiff
+// ----------------------------------------------------------------------------
+//  Process inOldFile and inNewFile, which must have the same arch, and
+//  print their differences to outFile. Returns NO if either couldn't be
+//  processed.
+
+BOOL
+PrintFunctionDiff(
+    Class               inProcClass,
+    NSURL*              inOldFile,
+    NSURL*              inNewFile,
+    const ProcOptions*  inOptions,
+    NSArray*            inFunctionFilters,
+    FILE*               outFile)
+{
+    DiffBuild   oldBuild    = {0};
+    DiffBuild   newBuild    = {0};
+    BOOL        success     = NO;
+
+    oldBuild.procClass  = inProcClass;
+    oldBuild.file       = inOldFile;
+    oldBuild.opts       = *inOptions;
+    oldBuild.filters    = inFunctionFilters;
+
+    // Fingerprints, and plain uncompressed text to copy from.
+    oldBuild.opts.functionDigests   = YES;
+    oldBuild.opts.functionCache     = NO;
+    oldBuild.opts.resultCache       = NO;
+    oldBuild.opts.compressOutput    = NO;
+    oldBuild.opts.jsonOutput        = NO;
+    oldBuild.opts.dataSections      = NO;
+
+    newBuild        = oldBuild;
+    newBuild.file   = inNewFile;
+
+    oldBuild.progress   = [[DiffProgress alloc] init];
+    newBuild.progress   = [[DiffProgress alloc] init];
+
+    // The old build on its own thread, the new one on this one.
+    pthread_t   oldThread;
+    BOOL        threaded    =
+        (pthread_create(&oldThread, NULL, ProcessBuildThread, &oldBuild) == 0);
+
+    if (!threaded)
+        ProcessBuild(&oldBuild);
+
+    ProcessBuild(&newBuild);
+
+    if (threaded)
+        pthread_join(oldThread, NULL);
+
+    if (oldBuild.processed && newBuild.processed &&
+        LoadBuildFunctions(&oldBuild) && LoadBuildFunctions(&newBuild))
+        success = PrintDifferences(&oldBuild, &newBuild, outFile);
+
+    FreeBuild(&oldBuild);
+    FreeBuild(&newBuild);
+
+    return success;
+}
+
+// ============================================================================
+
+@implementation DiffProgress
+
+//  init
+// ----------------------------------------------------------------------------
+
+- (id)init
+{
+    if (!(self = [super init]))
+        return nil;
+
+    ProgressReset(&iProgress);
+
+    return self;
+}
+
+#pragma mark -
+#pragma mark ProgressReporter protocol
+//  progressState
+// ----------------------------------------------------------------------------
+
+- (ProgressState*)progressState
+{
+    return &iProgress;
+}
+
+@end
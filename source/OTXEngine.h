@@ -0,0 +1,128 @@
+/*
+    OTXEngine.h
+
+    A C interface to otx for programs that want to embed it. Open an image,
+    list its functions, and ask for the annotated lines of one function at
+    a time:
+
+        OTXImageRef     image   = OTXImageOpen(path, NULL, kOTXDefaultOptions);
+        OTXFunction*    funcs   = NULL;
+        uint32_t        numFuncs, numLines, i;
+
+        numFuncs    = OTXImageCopyFunctions(image, &funcs);
+
+        for (i = 0; i < numFuncs; i++)
+        {
+            char**  lines   = OTXImageCopyFunctionLines(image,
+                funcs[i].address, &numLines);
+
+            ...
+            OTXLinesFree(lines, numLines);
+        }
+
+        OTXFunctionsFree(funcs, numFuncs);
+        OTXImageClose(image);
+
+    Opening an image loads its load commands, symbols and Obj-C metadata,
+    nothing more. Each call to OTXImageCopyFunctionLines reuses that
+    metadata and analyses only the requested function: otool sees only its
+    section and is stopped once past it, see FunctionFilter. The functions
+    are not thread-safe with respect to one image, but separate images may
+    be used from separate threads.
+
+    Errors are reported on stderr, and NULL or 0 is returned.
+
+    This file is in the public domain.
+*/
+
+#ifndef OTX_ENGINE_H
+#define OTX_ENGINE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*  OTXOptions
+
+    The output options of the CLI, see SharedDefs.h.
+*/
+typedef uint32_t OTXOptions;
+
+enum {
+    kOTXLocalOffsets            = 1 << 0,   // l
+    kOTXEntabOutput             = 1 << 1,   // e
+    kOTXVerboseMsgSends         = 1 << 2,   // m
+    kOTXSeparateLogicalBlocks   = 1 << 3,   // b
+    kOTXDemangleCppNames        = 1 << 4,   // n
+    kOTXReturnTypes             = 1 << 5,   // r
+    kOTXVariableTypes           = 1 << 6,   // v
+    kOTXReturnStatements        = 1 << 7    // R
+};
+
+// Same as the CLI's defaults.
+#define kOTXDefaultOptions                                          \
+    (kOTXLocalOffsets | kOTXVerboseMsgSends | kOTXDemangleCppNames |  \
+     kOTXReturnTypes | kOTXVariableTypes | kOTXReturnStatements)
+
+/*  OTXFunction
+
+    A function whose start is known without disassembling: one that has a
+    symbol, or is the implementation of an Obj-C method, and lies in a text
+    section.
+*/
+typedef struct
+{
+    uint64_t    address;
+    char*       name;       // symbol or "-[Class(Category) selector]"
+}
+OTXFunction;
+
+typedef struct OTXImage* OTXImageRef;
+
+// inArch is "ppc", "ppc64", "i386" or "x86_64". NULL selects the arch of a
+// thin file, or the host arch of a unibin.
+OTXImageRef
+OTXImageOpen(
+    const char* inPath,
+    const char* inArch,
+    OTXOptions  inOptions);
+
+void
+OTXImageClose(
+    OTXImageRef inImage);
+
+// Sorted by address. Free *outFunctions with OTXFunctionsFree.
+uint32_t
+OTXImageCopyFunctions(
+    OTXImageRef     inImage,
+    OTXFunction**   outFunctions);
+
+void
+OTXFunctionsFree(
+    OTXFunction*    inFunctions,
+    uint32_t        inCount);
+
+// The lines of the function containing inAddress, as 'otx -filter' would
+// print them for that address, which differs from the CLI's full output in
+// two ways. Functions without a symbol are numbered from Anon1 within each
+// call, not across the image. On i386, PIC thunks outside the function
+// aren't recognised, so PIC references lose their comments. Free the
+// result with OTXLinesFree.
+char**
+OTXImageCopyFunctionLines(
+    OTXImageRef inImage,
+    uint64_t    inAddress,
+    uint32_t*   outCount);
+
+void
+OTXLinesFree(
+    char**      inLines,
+    uint32_t    inCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OTX_ENGINE_H
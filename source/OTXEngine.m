@@ -0,0 +1,468 @@
+/*
+    OTXEngine.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <mach/mach_host.h>
+
+#import "SystemIncludes.h"
+
+#import "OTXEngine.h"
+#import "ErrorReporter.h"
+#import "ObjectLoader.h"
+#import "Object64Loader.h"
+#import "PPCProcessor.h"
+#import "PPC64Processor.h"
+#import "ProgressReporter.h"
+#import "SysUtils.h"
+#import "X86Processor.h"
+#import "X8664Processor.h"
+
+#define MAX_FUNCTION_NAME_LENGTH    1024
+
+/*  EngineController
+
+    The processors report to a controller. The engine has nobody to report
+    progress to, and errors go to stderr like everything else.
+*/
+@interface EngineController : NSObject<ProgressReporter, ErrorReporter>
+{
+    ProgressState   iProgress;  // written, never sampled
+}
+@end
+
+@implementation EngineController
+
+//  reportError:suggestion:
+// ----------------------------------------------------------------------------
+
+- (void)reportError: (NSString*)inMessageText
+         suggestion: (NSString*)inInformativeText
+{
+    fprintf(stderr, "otx: %s\n     %s\n",
+        UTF8STRING(inMessageText), UTF8STRING(inInformativeText));
+}
+
+//  progressState
+// ----------------------------------------------------------------------------
+
+- (ProgressState*)progressState
+{
+    return &iProgress;
+}
+
+@end
+
+// ============================================================================
+
+struct OTXImage
+{
+    NSURL*              url;
+    ProcOptions         opts;
+    EngineController*   controller;
+    id                  processor;      // lines freed after each query
+};
+
+// ----------------------------------------------------------------------------
+//  The processor class for inArch, or for the file's own arch if inArch is
+//  NULL. Same rules as -[CLIController initWithArgs:count:].
+
+static Class
+ProcessorClass(
+    const char* inPath,
+    const char* inArch)
+{
+    cpu_type_t  archSelector    = 0;
+
+    if (inArch)
+    {
+        if (!strcmp(inArch, "ppc"))
+            archSelector    = CPU_TYPE_POWERPC;
+        else if (!strcmp(inArch, "ppc64"))
+            archSelector    = CPU_TYPE_POWERPC64;
+        else if (!strcmp(inArch, "i386") || !strcmp(inArch, "x86"))
+            archSelector    = CPU_TYPE_I386;
+        else if (!strcmp(inArch, "x86_64"))
+            archSelector    = CPU_TYPE_X86_64;
+        else
+        {
+            fprintf(stderr, "otx: unknown architecture: \"%s\"\n", inArch);
+            return nil;
+        }
+    }
+    else
+    {
+        host_basic_info_data_t  hostInfo    = {0};
+        mach_msg_type_number_t  infoCount   = HOST_BASIC_INFO_COUNT;
+
+        host_info(mach_host_self(), HOST_BASIC_INFO,
+            (host_info_t)&hostInfo, &infoCount);
+
+        archSelector    = hostInfo.cpu_type;
+    }
+
+    FILE*       theFile     = fopen(inPath, "r");
+    uint32_t    fileMagic   = 0;
+
+    if (!theFile)
+    {
+        perror("otx: unable to open executable");
+        return nil;
+    }
+
+    if (fread(&fileMagic, sizeof(fileMagic), 1, theFile) != 1)
+    {
+        fprintf(stderr, "otx: truncated executable file\n");
+        fclose(theFile);
+        return nil;
+    }
+
+    fclose(theFile);
+
+    // Thin files have only one arch to offer.
+    switch (fileMagic)
+    {
+        case MH_MAGIC:
+#if TARGET_RT_LITTLE_ENDIAN
+            archSelector    = CPU_TYPE_I386;
+#else
+            archSelector    = CPU_TYPE_POWERPC;
+#endif
+            break;
+
+        case MH_MAGIC_64:
+#if TARGET_RT_LITTLE_ENDIAN
+            archSelector    = CPU_TYPE_X86_64;
+#else
+            archSelector    = CPU_TYPE_POWERPC64;
+#endif
+            break;
+
+        case MH_CIGAM:
+#if TARGET_RT_LITTLE_ENDIAN
+            archSelector    = CPU_TYPE_POWERPC;
+#else
+            archSelector    = CPU_TYPE_I386;
+#endif
+            break;
+
+        case MH_CIGAM_64:
+#if TARGET_RT_LITTLE_ENDIAN
+            archSelector    = CPU_TYPE_POWERPC64;
+#else
+            archSelector    = CPU_TYPE_X86_64;
+#endif
+            break;
+
+        case FAT_MAGIC:
+        case FAT_CIGAM:
+            break;
+
+        default:
+            fprintf(stderr, "otx: %s is not a Mach-O file\n", inPath);
+            return nil;
+    }
+
+    switch (archSelector)
+    {
+        case CPU_TYPE_POWERPC:
+            return [PPCProcessor class];
+
+        case CPU_TYPE_I386:
+            return [X86Processor class];
+
+        case CPU_TYPE_POWERPC64:
+            return [PPC64Processor class];
+
+        case CPU_TYPE_X86_64:
+            return [X8664Processor class];
+
+        default:
+            fprintf(stderr, "otx: unknown arch type: %d\n", archSelector);
+            return nil;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+static ProcOptions
+ProcOptionsFromOTXOptions(
+    OTXOptions  inOptions)
+{
+    ProcOptions opts    = {0};
+
+    opts.localOffsets           = (inOptions & kOTXLocalOffsets) != 0;
+    opts.entabOutput            = (inOptions & kOTXEntabOutput) != 0;
+    opts.verboseMsgSends        = (inOptions & kOTXVerboseMsgSends) != 0;
+    opts.separateLogicalBlocks  = (inOptions & kOTXSeparateLogicalBlocks) != 0;
+    opts.demangleCppNames       = (inOptions & kOTXDemangleCppNames) != 0;
+    opts.returnTypes            = (inOptions & kOTXReturnTypes) != 0;
+    opts.variableTypes          = (inOptions & kOTXVariableTypes) != 0;
+    opts.returnStatements       = (inOptions & kOTXReturnStatements) != 0;
+
+    return opts;
+}
+
+// ----------------------------------------------------------------------------
+//  Split the text of one function's lines into C strings. Everything up to
+//  the first section header is about the file, not the function. Section
+//  headers and the empty lines around the function are dropped too.
+
+static char**
+CopyFunctionLines(
+    const char* inText,
+    uint32_t*   outCount)
+{
+    char**      lines       = NULL;
+    uint32_t    numLines    = 0;
+    uint32_t    maxLines    = 0;
+    BOOL        pastHeader  = NO;
+    const char* linePtr     = inText;
+
+    while (*linePtr)
+    {
+        const char* lineEnd = strchr(linePtr, '\n');
+        size_t      length  = (lineEnd) ?
+            (size_t)(lineEnd - linePtr) : strlen(linePtr);
+        const char* nextPtr = linePtr + length + ((lineEnd) ? 1 : 0);
+
+        if (!strncmp(linePtr, "(__TEXT,", 8))
+        {
+            pastHeader  = YES;
+            linePtr     = nextPtr;
+            continue;
+        }
+
+        if (!pastHeader || (!length && !numLines))
+        {
+            linePtr = nextPtr;
+            continue;
+        }
+
+        if (numLines == maxLines)
+        {
+            maxLines    = (maxLines) ? maxLines * 2 : 64;
+
+            char**  newLines    = realloc(lines, maxLines * sizeof(char*));
+
+            if (!newLines)
+            {
+                fprintf(stderr, "otx: not enough memory to allocate lines\n");
+                OTXLinesFree(lines, numLines);
+                return NULL;
+            }
+
+            lines   = newLines;
+        }
+
+        lines[numLines++]   = strndup(linePtr, length);
+        linePtr             = nextPtr;
+    }
+
+    while (numLines && !lines[numLines - 1][0])
+        free(lines[--numLines]);
+
+    *outCount   = numLines;
+
+    return lines;
+}
+
+#pragma mark -
+// ----------------------------------------------------------------------------
+
+OTXImageRef
+OTXImageOpen(
+    const char* inPath,
+    const char* inArch,
+    OTXOptions  inOptions)
+{
+    if (!inPath)
+        return NULL;
+
+    OTXImageRef image   = NULL;
+
+    @autoreleasepool
+    {
+        Class   procClass   = ProcessorClass(inPath, inArch);
+
+        if (!procClass)
+            return NULL;
+
+        image   = calloc(1, sizeof(struct OTXImage));
+
+        if (!image)
+        {
+            fprintf(stderr, "otx: not enough memory to allocate image\n");
+            return NULL;
+        }
+
+        image->url          = [[NSURL alloc] initFileURLWithPath:
+            [NSString stringWithUTF8String: inPath]];
+        image->opts         = ProcOptionsFromOTXOptions(inOptions);
+        image->controller   = [[EngineController alloc] init];
+        image->processor    = [[procClass alloc] initWithURL: image->url
+            controller: image->controller options: &image->opts];
+
+        if (!image->processor || ![image->processor loadMachHeader])
+        {
+            fprintf(stderr, "otx: failed to load mach header\n");
+            OTXImageClose(image);
+            return NULL;
+        }
+
+        [image->processor loadLCommands];
+    }
+
+    return image;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+OTXImageClose(
+    OTXImageRef inImage)
+{
+    if (!inImage)
+        return;
+
+    @autoreleasepool
+    {
+        [inImage->processor release];
+        [inImage->controller release];
+        [inImage->url release];
+    }
+
+    free(inImage);
+}
+
+// ----------------------------------------------------------------------------
+
+uint32_t
+OTXImageCopyFunctions(
+    OTXImageRef     inImage,
+    OTXFunction**   outFunctions)
+{
+    *outFunctions   = NULL;
+
+    if (!inImage)
+        return 0;
+
+    UInt64*     starts      = NULL;
+    uint32_t    numStarts   = [inImage->processor copyFunctionStarts: &starts];
+    uint32_t    numFuncs    = 0;
+    uint32_t    i;
+
+    if (!starts)
+        return 0;
+
+    OTXFunction*    funcs   = calloc(numStarts, sizeof(OTXFunction));
+
+    if (!funcs)
+    {
+        fprintf(stderr, "otx: not enough memory to allocate functions\n");
+        free(starts);
+        return 0;
+    }
+
+    // Section ends, unnamed section starts and data symbols are not
+    // functions.
+    for (i = 0; i < numStarts; i++)
+    {
+        char    name[MAX_FUNCTION_NAME_LENGTH];
+
+        if (![inImage->processor addressIsInText: starts[i]] ||
+            ![inImage->processor getFunctionName: name
+            length: MAX_FUNCTION_NAME_LENGTH address: starts[i]])
+            continue;
+
+        funcs[numFuncs].address = starts[i];
+        funcs[numFuncs].name    = strdup(name);
+        numFuncs++;
+    }
+
+    free(starts);
+
+    if (!numFuncs)
+    {
+        free(funcs);
+        return 0;
+    }
+
+    *outFunctions   = funcs;
+
+    return numFuncs;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+OTXFunctionsFree(
+    OTXFunction*    inFunctions,
+    uint32_t        inCount)
+{
+    uint32_t    i;
+
+    if (!inFunctions)
+        return;
+
+    for (i = 0; i < inCount; i++)
+        free(inFunctions[i].name);
+
+    free(inFunctions);
+}
+
+// ----------------------------------------------------------------------------
+//  The image's processor generates just the one function, with the
+//  metadata it loaded when the image was opened.
+
+char**
+OTXImageCopyFunctionLines(
+    OTXImageRef inImage,
+    uint64_t    inAddress,
+    uint32_t*   outCount)
+{
+    *outCount   = 0;
+
+    if (!inImage)
+        return NULL;
+
+    char**  lines   = NULL;
+
+    @autoreleasepool
+    {
+        size_t  length  = 0;
+        char*   text    = [inImage->processor copyFunctionText: inAddress
+            length: &length];
+
+        if (text)
+        {
+            lines   = CopyFunctionLines(text, outCount);
+            free(text);
+        }
+
+        // Nothing is kept between queries.
+        [inImage->processor freeLines];
+    }
+
+    return lines;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+OTXLinesFree(
+    char**      inLines,
+    uint32_t    inCount)
+{
+    uint32_t    i;
+
+    if (!inLines)
+        return;
+
+    for (i = 0; i < inCount; i++)
+        free(inLines[i]);
+
+    free(inLines);
+}
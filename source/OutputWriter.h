@@ -0,0 +1,64 @@
+/*
+    OutputWriter.h
+
+    Writes a processor's output file on a dedicated thread. The processor
+    fills buffers of OUTPUT_FRAME_SIZE bytes and hands them over through a
+    queue of OUTPUT_QUEUE_LENGTH buffers, blocking only when the writer has
+    fallen that far behind.
+
+    With compression, each buffer becomes one gzip member, and members are
+    concatenated as gzip(1) allows. Every member starts a fresh deflate
+    stream, so output can be decompressed starting at any member. The
+    writer records where each member starts, in the output text and in the
+    file, for the output index.
+
+    A writer opened without a thread writes each buffer as soon as it's
+    full, on the caller's thread, for -serial.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#define OUTPUT_FRAME_SIZE       (256 * 1024)    // output text per member
+#define OUTPUT_QUEUE_LENGTH     8
+
+// Compression methods, as stored in the output index.
+enum {
+    NoCompression,
+    GzipCompression
+};
+
+/*  OutputFrame
+
+    Where one gzip member starts. 'textOffset' is its offset in the
+    uncompressed output text, 'fileOffset' its offset in the output file.
+*/
+typedef struct
+{
+    UInt64  textOffset;
+    UInt64  fileOffset;
+}
+OutputFrame;
+
+typedef struct OutputWriter OutputWriter;
+
+// ----------------------------------------------------------------------------
+
+OutputWriter*
+OutputWriterOpen(
+    int         inFileNum,
+    uint32_t    inCompression,
+    BOOL        inThreaded);
+
+BOOL
+OutputWriterWrite(
+    OutputWriter*   ioWriter,
+    const void*     inBytes,
+    size_t          inLength);
+
+BOOL
+OutputWriterClose(
+    OutputWriter*   inWriter,
+    OutputFrame**   outFrames,
+    uint32_t*       outNumFrames);
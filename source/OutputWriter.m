@@ -0,0 +1,428 @@
+/*
+    OutputWriter.m
+
+    This file is in the public domain.
+*/
+
+#import <errno.h>
+#import <pthread.h>
+#import <unistd.h>
+#import <zlib.h>
+
+#import "OutputWriter.h"
+
+/*  OutputBuffer
+
+    One slot in the queue.
+*/
+typedef struct
+{
+    char*   bytes;
+    size_t  length;
+}
+OutputBuffer;
+
+/*  OutputWriter
+
+    The queue is a ring of OUTPUT_QUEUE_LENGTH buffers. The writer thread
+    owns the 'numQueued' buffers starting at 'head', the caller owns the
+    rest and fills the first of them, 'fill'.
+*/
+struct OutputWriter
+{
+    int             fileNum;
+    uint32_t        compression;
+    BOOL            threaded;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  queued;         // a buffer was queued, or closing
+    pthread_cond_t  written;        // a buffer was written
+    OutputBuffer    buffers[OUTPUT_QUEUE_LENGTH];
+    uint32_t        head;
+    uint32_t        numQueued;
+    uint32_t        fill;
+    BOOL            closing;
+    volatile BOOL   failed;
+
+    // Used only by the writer thread.
+    z_stream        zstream;
+    char*           zbuffer;
+    size_t          zbufferSize;
+    UInt64          textOffset;
+    UInt64          fileOffset;
+    OutputFrame*    frames;
+    uint32_t        numFrames;
+    uint32_t        maxFrames;
+};
+
+// ----------------------------------------------------------------------------
+
+static BOOL
+WriteAll(
+    int         inFileNum,
+    const char* inBytes,
+    size_t      inLength)
+{
+    while (inLength)
+    {
+        ssize_t numWritten  = write(inFileNum, inBytes, inLength);
+
+        if (numWritten == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            perror("otx: unable to write to output file");
+            return NO;
+        }
+
+        inBytes     += numWritten;
+        inLength    -= numWritten;
+    }
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+//  Compress inBuffer into one gzip member and write it.
+
+static BOOL
+WriteFrame(
+    OutputWriter*   ioWriter,
+    OutputBuffer*   inBuffer)
+{
+    if (ioWriter->numFrames == ioWriter->maxFrames)
+    {
+        uint32_t        newMax      = (ioWriter->maxFrames) ?
+            ioWriter->maxFrames * 2 : 64;
+        OutputFrame*    newFrames   = realloc(ioWriter->frames,
+            newMax * sizeof(OutputFrame));
+
+        if (!newFrames)
+        {
+            fprintf(stderr, "otx: not enough memory to compress output\n");
+            return NO;
+        }
+
+        ioWriter->frames    = newFrames;
+        ioWriter->maxFrames = newMax;
+    }
+
+    ioWriter->frames[ioWriter->numFrames++] = (OutputFrame)
+        {ioWriter->textOffset, ioWriter->fileOffset};
+
+    z_stream*   zstream = &ioWriter->zstream;
+    int         result;
+
+    if (deflateReset(zstream) != Z_OK)
+    {
+        fprintf(stderr, "otx: unable to compress output\n");
+        return NO;
+    }
+
+    zstream->next_in    = (Bytef*)inBuffer->bytes;
+    zstream->avail_in   = (uInt)inBuffer->length;
+
+    do
+    {
+        zstream->next_out   = (Bytef*)ioWriter->zbuffer;
+        zstream->avail_out  = (uInt)ioWriter->zbufferSize;
+
+        result  = deflate(zstream, Z_FINISH);
+
+        if (result != Z_OK && result != Z_STREAM_END)
+        {
+            fprintf(stderr, "otx: unable to compress output\n");
+            return NO;
+        }
+
+        size_t  numBytes    = ioWriter->zbufferSize - zstream->avail_out;
+
+        if (!WriteAll(ioWriter->fileNum, ioWriter->zbuffer, numBytes))
+            return NO;
+
+        ioWriter->fileOffset    += numBytes;
+    } while (result != Z_STREAM_END);
+
+    ioWriter->textOffset    += inBuffer->length;
+
+    return YES;
+}
+
+// ----------------------------------------------------------------------------
+//  Write one buffer and empty it. After a failure, buffers are dropped
+//  unwritten.
+
+static void
+WriteBuffer(
+    OutputWriter*   ioWriter,
+    OutputBuffer*   ioBuffer)
+{
+    if (!ioWriter->failed)
+    {
+        BOOL    written = (ioWriter->compression == GzipCompression) ?
+            WriteFrame(ioWriter, ioBuffer) :
+            WriteAll(ioWriter->fileNum, ioBuffer->bytes, ioBuffer->length);
+
+        if (!written)
+            ioWriter->failed    = YES;
+    }
+
+    ioBuffer->length    = 0;
+}
+
+// ----------------------------------------------------------------------------
+//  Body of the writer thread. Runs until the writer is closing and the
+//  queue is empty.
+
+static void*
+WriterThread(
+    void*   inWriter)
+{
+    OutputWriter*   writer  = inWriter;
+    OutputBuffer*   buffer;
+
+    while (1)
+    {
+        pthread_mutex_lock(&writer->lock);
+
+        while (!writer->numQueued && !writer->closing)
+            pthread_cond_wait(&writer->queued, &writer->lock);
+
+        if (!writer->numQueued)
+        {
+            pthread_mutex_unlock(&writer->lock);
+            break;
+        }
+
+        buffer  = &writer->buffers[writer->head];
+        pthread_mutex_unlock(&writer->lock);
+
+        WriteBuffer(writer, buffer);
+
+        pthread_mutex_lock(&writer->lock);
+        writer->head    = (writer->head + 1) % OUTPUT_QUEUE_LENGTH;
+        writer->numQueued--;
+        pthread_cond_signal(&writer->written);
+        pthread_mutex_unlock(&writer->lock);
+    }
+
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+//  Queue the buffer being filled, then wait for a free one. Without a
+//  thread, just write it.
+
+static void
+QueueBuffer(
+    OutputWriter*   ioWriter)
+{
+    if (!ioWriter->threaded)
+    {
+        WriteBuffer(ioWriter, &ioWriter->buffers[ioWriter->fill]);
+        return;
+    }
+
+    pthread_mutex_lock(&ioWriter->lock);
+
+    ioWriter->numQueued++;
+    pthread_cond_signal(&ioWriter->queued);
+
+    while (ioWriter->numQueued == OUTPUT_QUEUE_LENGTH)
+        pthread_cond_wait(&ioWriter->written, &ioWriter->lock);
+
+    pthread_mutex_unlock(&ioWriter->lock);
+
+    ioWriter->fill  = (ioWriter->fill + 1) % OUTPUT_QUEUE_LENGTH;
+}
+
+// ----------------------------------------------------------------------------
+
+static void
+FreeWriter(
+    OutputWriter*   inWriter)
+{
+    uint32_t    i;
+
+    for (i = 0; i < OUTPUT_QUEUE_LENGTH; i++)
+        if (inWriter->buffers[i].bytes)
+            free(inWriter->buffers[i].bytes);
+
+    if (inWriter->compression == GzipCompression)
+        deflateEnd(&inWriter->zstream);
+
+    if (inWriter->zbuffer)
+        free(inWriter->zbuffer);
+
+    if (inWriter->frames)
+        free(inWriter->frames);
+
+    free(inWriter);
+}
+
+//  OutputWriterOpen
+// ----------------------------------------------------------------------------
+//  Start a writer for inFileNum, which stays open and positioned after the
+//  output when the writer is closed. Without a thread, only one buffer is
+//  needed.
+
+OutputWriter*
+OutputWriterOpen(
+    int         inFileNum,
+    uint32_t    inCompression,
+    BOOL        inThreaded)
+{
+    OutputWriter*   writer      = calloc(1, sizeof(OutputWriter));
+    uint32_t        numBuffers  = (inThreaded) ? OUTPUT_QUEUE_LENGTH : 1;
+    uint32_t        i;
+
+    if (!writer)
+    {
+        fprintf(stderr, "otx: not enough memory to allocate output writer\n");
+        return NULL;
+    }
+
+    writer->fileNum     = inFileNum;
+    writer->compression = inCompression;
+    writer->threaded    = inThreaded;
+
+    // Frame offsets are relative to the start of the file, which may
+    // already have something in it.
+    off_t   startOffset = lseek(inFileNum, 0, SEEK_CUR);
+
+    writer->fileOffset  = (startOffset > 0) ? startOffset : 0;
+
+    for (i = 0; i < numBuffers; i++)
+    {
+        writer->buffers[i].bytes    = malloc(OUTPUT_FRAME_SIZE);
+
+        if (!writer->buffers[i].bytes)
+        {
+            fprintf(stderr,
+                "otx: not enough memory to allocate output writer\n");
+            FreeWriter(writer);
+            return NULL;
+        }
+    }
+
+    if (inCompression == GzipCompression)
+    {
+        // windowBits + 16 asks for a gzip wrapper.
+        if (deflateInit2(&writer->zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+            MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            fprintf(stderr, "otx: unable to compress output\n");
+            writer->compression = NoCompression;
+            FreeWriter(writer);
+            return NULL;
+        }
+
+        writer->zbufferSize = deflateBound(&writer->zstream,
+            OUTPUT_FRAME_SIZE);
+        writer->zbuffer     = malloc(writer->zbufferSize);
+
+        if (!writer->zbuffer)
+        {
+            fprintf(stderr, "otx: not enough memory to compress output\n");
+            FreeWriter(writer);
+            return NULL;
+        }
+    }
+
+    if (!inThreaded)
+        return writer;
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->queued, NULL);
+    pthread_cond_init(&writer->written, NULL);
+
+    if (pthread_create(&writer->thread, NULL, WriterThread, writer) != 0)
+    {
+        perror("otx: unable to create output thread");
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->queued);
+        pthread_cond_destroy(&writer->written);
+        FreeWriter(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+//  OutputWriterWrite
+// ----------------------------------------------------------------------------
+//  Returns NO once the writer thread has failed.
+
+BOOL
+OutputWriterWrite(
+    OutputWriter*   ioWriter,
+    const void*     inBytes,
+    size_t          inLength)
+{
+    const char* bytes   = inBytes;
+
+    while (inLength)
+    {
+        if (ioWriter->failed)
+            return NO;
+
+        OutputBuffer*   buffer      = &ioWriter->buffers[ioWriter->fill];
+        size_t          numBytes    = OUTPUT_FRAME_SIZE - buffer->length;
+
+        if (numBytes > inLength)
+            numBytes    = inLength;
+
+        memcpy(buffer->bytes + buffer->length, bytes, numBytes);
+        buffer->length  += numBytes;
+        bytes           += numBytes;
+        inLength        -= numBytes;
+
+        if (buffer->length == OUTPUT_FRAME_SIZE)
+            QueueBuffer(ioWriter);
+    }
+
+    return YES;
+}
+
+//  OutputWriterClose
+// ----------------------------------------------------------------------------
+//  Write what's left, stop the thread if any and free inWriter. With
+//  compression, hands back the frames, which the caller must free. Returns
+//  NO if anything failed to be written.
+
+BOOL
+OutputWriterClose(
+    OutputWriter*   inWriter,
+    OutputFrame**   outFrames,
+    uint32_t*       outNumFrames)
+{
+    if (inWriter->buffers[inWriter->fill].length)
+        QueueBuffer(inWriter);
+
+    if (inWriter->threaded)
+    {
+        pthread_mutex_lock(&inWriter->lock);
+        inWriter->closing   = YES;
+        pthread_cond_signal(&inWriter->queued);
+        pthread_mutex_unlock(&inWriter->lock);
+
+        pthread_join(inWriter->thread, NULL);
+        pthread_mutex_destroy(&inWriter->lock);
+        pthread_cond_destroy(&inWriter->queued);
+        pthread_cond_destroy(&inWriter->written);
+    }
+
+    BOOL    written = !inWriter->failed;
+
+    if (outFrames && outNumFrames && written)
+    {
+        *outFrames          = inWriter->frames;
+        *outNumFrames       = inWriter->numFrames;
+        inWriter->frames    = NULL;
+    }
+
+    FreeWriter(inWriter);
+
+    return written;
+}
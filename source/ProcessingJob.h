@@ -0,0 +1,76 @@
+/*
+    ProcessingJob.h
+
+    One executable queued for processing in the GUI. A job runs its
+    processor on its own thread and owns the ProgressState that processor
+    reports to, which doubles as the job's cancellation token. Each job has
+    its own progress row, built from the main window's prog view.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "ErrorReporter.h"
+#import "ProgressReporter.h"
+#import "SharedDefs.h"
+
+// ============================================================================
+
+@interface ProcessingJob : NSObject<ProgressReporter, ErrorReporter>
+{
+@private
+    id                      iDelegate;          // not retained
+    NSURL*                  iObjectFile;
+    NSString*               iOutputFilePath;
+    NSString*               iExeName;
+    cpu_type_t              iCPUType;
+    ProcOptions             iOpts;
+    NSArray*                iFunctionFilters;
+    ProgressState           iProgress;
+    UInt32                  iProgressSequence;  // last stage shown
+    BOOL                    iStarted;
+    NSString*               iErrorText;         // nil unless processing failed
+
+    // progress row
+    NSView*                 iRowView;
+    NSTextField*            iRowText;
+    NSProgressIndicator*    iRowBar;
+    NSButton*               iRowCancelButton;
+}
+
+- (id)initWithFile: (NSURL*)inObjectFile
+        outputPath: (NSString*)inOutputFilePath
+           exeName: (NSString*)inExeName
+           cpuType: (cpu_type_t)inCPUType
+           options: (ProcOptions*)inOpts
+   functionFilters: (NSArray*)inFunctionFilters
+          delegate: (id)inDelegate;
+
+- (NSString*)outputFilePath;
+- (NSString*)errorText;
+- (BOOL)isStarted;
+- (BOOL)isCancelled;
+
+- (NSView*)rowLike: (NSView*)inTemplate;
+- (NSView*)rowView;
+- (void)setRowText: (NSString*)inText;
+- (void)sampleProgress;
+
+- (void)start;
+- (void)run;
+- (void)threadDidFinish: (NSString*)inErrorText;
+- (IBAction)cancel: (id)sender;
+- (void)reportErrorWithStrings: (NSArray*)inStrings;
+
+@end
+
+// ----------------------------------------------------------------------------
+//  Sent on the main thread.
+
+@interface NSObject(ProcessingJobDelegate)
+
+- (void)processingJobDidFinish: (ProcessingJob*)inJob;
+- (void)applyShadowToText: (NSTextField*)inText;
+
+@end
@@ -0,0 +1,390 @@
+/*
+    ProcessingJob.m
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+#import "SystemIncludes.h"
+
+#import "ProcessingJob.h"
+#import "PPCProcessor.h"
+#import "PPC64Processor.h"
+#import "X86Processor.h"
+#import "X8664Processor.h"
+
+@implementation ProcessingJob
+
+//  initWithFile:outputPath:exeName:cpuType:options:functionFilters:delegate:
+// ----------------------------------------------------------------------------
+
+- (id)initWithFile: (NSURL*)inObjectFile
+        outputPath: (NSString*)inOutputFilePath
+           exeName: (NSString*)inExeName
+           cpuType: (cpu_type_t)inCPUType
+           options: (ProcOptions*)inOpts
+   functionFilters: (NSArray*)inFunctionFilters
+          delegate: (id)inDelegate
+{
+    if ((self = [super init]) == nil)
+        return nil;
+
+    iDelegate           = inDelegate;
+    iObjectFile         = [inObjectFile retain];
+    iOutputFilePath     = [inOutputFilePath copy];
+    iExeName            = [inExeName copy];
+    iCPUType            = inCPUType;
+    iOpts               = *inOpts;
+    iFunctionFilters    = [inFunctionFilters retain];
+    iProgressSequence   = UINT32_MAX;
+
+    ProgressReset(&iProgress);
+
+    return self;
+}
+
+//  dealloc
+// ----------------------------------------------------------------------------
+
+- (void)dealloc
+{
+    if (iObjectFile)
+        [iObjectFile release];
+
+    if (iOutputFilePath)
+        [iOutputFilePath release];
+
+    if (iExeName)
+        [iExeName release];
+
+    if (iFunctionFilters)
+        [iFunctionFilters release];
+
+    if (iErrorText)
+        [iErrorText release];
+
+    if (iRowView)
+        [iRowView release];
+
+    [super dealloc];
+}
+
+//  outputFilePath
+// ----------------------------------------------------------------------------
+
+- (NSString*)outputFilePath
+{
+    return iOutputFilePath;
+}
+
+//  errorText
+// ----------------------------------------------------------------------------
+
+- (NSString*)errorText
+{
+    return iErrorText;
+}
+
+//  isStarted
+// ----------------------------------------------------------------------------
+
+- (BOOL)isStarted
+{
+    return iStarted;
+}
+
+//  isCancelled
+// ----------------------------------------------------------------------------
+
+- (BOOL)isCancelled
+{
+    return ProgressCancelled(&iProgress);
+}
+
+#pragma mark -
+//  rowLike:
+// ----------------------------------------------------------------------------
+//  Build our progress row from the controls in inTemplate, which is laid out
+//  in the nib with one text field, one progress bar and one cancel button.
+
+- (NSView*)rowLike: (NSView*)inTemplate
+{
+    if (iRowView)
+        return iRowView;
+
+    NSRect  rowFrame    = [inTemplate frame];
+
+    rowFrame.origin = NSZeroPoint;
+    iRowView        = [[NSView alloc] initWithFrame: rowFrame];
+
+    [iRowView setAutoresizingMask: NSViewWidthSizable | NSViewMinYMargin];
+
+    NSEnumerator*   controls    = [[inTemplate subviews] objectEnumerator];
+    NSView*         control;
+
+    while ((control = [controls nextObject]))
+    {
+        if ([control isKindOfClass: [NSProgressIndicator class]] && !iRowBar)
+        {
+            NSProgressIndicator*    bar = (NSProgressIndicator*)control;
+
+            iRowBar = [[NSProgressIndicator alloc]
+                initWithFrame: [bar frame]];
+            [iRowBar setStyle: [bar style]];
+            [iRowBar setControlSize: [bar controlSize]];
+            [iRowBar setAutoresizingMask: [bar autoresizingMask]];
+            [iRowBar setIndeterminate: YES];
+            [iRowBar setUsesThreadedAnimation: YES];
+            [iRowView addSubview: iRowBar];
+            [iRowBar release];
+        }
+        else if ([control isKindOfClass: [NSTextField class]] && !iRowText)
+        {
+            NSTextField*    text    = (NSTextField*)control;
+
+            iRowText    = [[NSTextField alloc] initWithFrame: [text frame]];
+            [iRowText setFont: [text font]];
+            [iRowText setAlignment: [text alignment]];
+            [iRowText setTextColor: [text textColor]];
+            [iRowText setAutoresizingMask: [text autoresizingMask]];
+            [iRowText setBordered: NO];
+            [iRowText setEditable: NO];
+            [iRowText setSelectable: NO];
+            [iRowText setDrawsBackground: NO];
+            [[iRowText cell] setLineBreakMode: NSLineBreakByTruncatingMiddle];
+
+            if (OS_IS_POST_TIGER)
+                [[iRowText cell] setBackgroundStyle: NSBackgroundStyleRaised];
+
+            [iRowView addSubview: iRowText];
+            [iRowText release];
+        }
+        else if ([control isKindOfClass: [NSButton class]] && !iRowCancelButton)
+        {
+            NSButton*   button  = (NSButton*)control;
+
+            iRowCancelButton    = [[NSButton alloc]
+                initWithFrame: [button frame]];
+            [iRowCancelButton setTitle: [button title]];
+            [iRowCancelButton setImage: [button image]];
+            [iRowCancelButton setBezelStyle: [button bezelStyle]];
+            [iRowCancelButton setBordered: [button isBordered]];
+            [iRowCancelButton setFont: [button font]];
+            [iRowCancelButton setAutoresizingMask: [button autoresizingMask]];
+            [[iRowCancelButton cell] setControlSize:
+                [[button cell] controlSize]];
+            [iRowCancelButton setTarget: self];
+            [iRowCancelButton setAction: @selector(cancel:)];
+            [iRowView addSubview: iRowCancelButton];
+            [iRowCancelButton release];
+        }
+    }
+
+    [self setRowText: @"Waiting"];
+
+    return iRowView;
+}
+
+//  rowView
+// ----------------------------------------------------------------------------
+
+- (NSView*)rowView
+{
+    return iRowView;
+}
+
+//  setRowText:
+// ----------------------------------------------------------------------------
+
+- (void)setRowText: (NSString*)inText
+{
+    [iRowText setStringValue:
+        [NSString stringWithFormat: @"%@: %@", iExeName, inText]];
+    [iDelegate applyShadowToText: iRowText];
+}
+
+//  sampleProgress
+// ----------------------------------------------------------------------------
+//  Called on the main thread by the delegate's timer. The processing thread
+//  only updates iProgress, so this is the one place our row changes.
+
+- (void)sampleProgress
+{
+    if (!iStarted || !iRowView)
+        return;
+
+    ProgressSnapshot    snapshot;
+
+    ProgressSample(&iProgress, &snapshot);
+
+    // cancel: already said so.
+    if (snapshot.cancelled)
+        return;
+
+    if (snapshot.sequence != iProgressSequence)
+    {
+        iProgressSequence   = snapshot.sequence;
+
+        [self setRowText: [NSString stringWithUTF8String:
+            ProgressStageDescription(snapshot.stage)]];
+        [iRowBar setIndeterminate: snapshot.total == 0];
+    }
+
+    if (snapshot.total)
+        [iRowBar setDoubleValue:
+            ((double)snapshot.done / snapshot.total) * 100.0];
+    else
+        [iRowBar startAnimation: self];
+}
+
+#pragma mark -
+//  start
+// ----------------------------------------------------------------------------
+
+- (void)start
+{
+    if (iStarted)
+        return;
+
+    iStarted    = YES;
+    ProgressBeginStage(&iProgress, LoadingStage, 0);
+    [self sampleProgress];
+
+    [NSThread detachNewThreadSelector: @selector(run)
+        toTarget: self withObject: nil];
+}
+
+//  run
+// ----------------------------------------------------------------------------
+//  Body of the job's thread. NSThread retains us until we're done.
+
+- (void)run
+{
+    NSAutoreleasePool*  pool        = [[NSAutoreleasePool alloc] init];
+    NSString*           errorText   = nil;
+    Class               procClass   = nil;
+
+    switch (iCPUType)
+    {
+        case CPU_TYPE_POWERPC:
+            procClass = [PPCProcessor class];
+            break;
+
+        case CPU_TYPE_POWERPC64:
+            procClass = [PPC64Processor class];
+            break;
+
+        case CPU_TYPE_I386:
+            procClass = [X86Processor class];
+            break;
+
+        case CPU_TYPE_X86_64:
+            procClass = [X8664Processor class];
+            break;
+
+        default:
+            fprintf(stderr, "otx: [ProcessingJob run]: "
+                "unknown arch type: %d", iCPUType);
+            break;
+    }
+
+    if (!procClass)
+        errorText   = @"Unsupported architecture.";
+    else
+    {
+        id  theProcessor    = [[procClass alloc] initWithURL: iObjectFile
+            controller: self options: &iOpts];
+
+        if (!theProcessor)
+            errorText   = @"Unable to create processor.";
+        else
+        {
+            [theProcessor setFunctionFilters: iFunctionFilters];
+
+            if (![theProcessor processExe: iOutputFilePath] &&
+                !ProgressCancelled(&iProgress))
+                errorText   = [NSString stringWithFormat:
+                    @"Unable to process %@.", [iObjectFile path]];
+
+            [theProcessor release];
+        }
+    }
+
+    [self performSelectorOnMainThread: @selector(threadDidFinish:)
+                           withObject: errorText
+                        waitUntilDone: NO];
+    [pool release];
+}
+
+//  threadDidFinish:
+// ----------------------------------------------------------------------------
+
+- (void)threadDidFinish: (NSString*)inErrorText
+{
+    if (inErrorText)
+        iErrorText  = [inErrorText retain];
+
+    [iDelegate processingJobDidFinish: self];
+}
+
+//  cancel:
+// ----------------------------------------------------------------------------
+//  A job that hasn't started yet is simply dropped.
+
+- (IBAction)cancel: (id)sender
+{
+    ProgressCancel(&iProgress);
+
+    if (!iStarted)
+    {
+        [iDelegate processingJobDidFinish: self];
+        return;
+    }
+
+    [self setRowText: @"Cancelling"];
+    [iRowBar setIndeterminate: YES];
+    [iRowBar startAnimation: self];
+    [iRowCancelButton setEnabled: NO];
+}
+
+#pragma mark -
+#pragma mark ErrorReporter protocol
+//  reportError:suggestion:
+// ----------------------------------------------------------------------------
+
+- (void)reportError: (NSString*)inMessageText
+         suggestion: (NSString*)inInformativeText
+{
+    if (![NSThread isMainThread])
+    {
+        [self performSelectorOnMainThread: @selector(reportErrorWithStrings:)
+            withObject: [NSArray arrayWithObjects:
+            inMessageText, inInformativeText, nil]
+            waitUntilDone: NO];
+        return;
+    }
+
+    [iDelegate reportError: inMessageText suggestion: inInformativeText];
+}
+
+//  reportErrorWithStrings:
+// ----------------------------------------------------------------------------
+
+- (void)reportErrorWithStrings: (NSArray*)inStrings
+{
+    [self reportError: [inStrings objectAtIndex: 0]
+           suggestion: [inStrings objectAtIndex: 1]];
+}
+
+#pragma mark -
+#pragma mark ProgressReporter protocol
+//  progressState
+// ----------------------------------------------------------------------------
+
+- (ProgressState*)progressState
+{
+    return &iProgress;
+}
+
+@end
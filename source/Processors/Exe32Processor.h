@@ -7,10 +7,14 @@
 #import <Cocoa/Cocoa.h>
 
 #import "ExeProcessor.h"
+#import "VerboseLines.h"
 
 /*  MethodInfo
 
-    Additional info pertaining to an Obj-C method.
+    Additional info pertaining to an Obj-C method. The method is in host
+    byte order, so the tables can be searched without swapping. Obj-C 1
+    classes and categories are as they appear in the file, like the other
+    class pointers the processors keep.
 */
 typedef struct
 {
@@ -79,6 +83,7 @@ typedef struct
     UInt8   codeLength;
     BOOL    isCode;         // NO for function and section names etc.
     BOOL    isFunction;     // YES if this is the first instruction in a function.
+    BOOL    isSpilled;      // chars are in the spill file, see MemoryBudget.
 }
 LineInfo;
 
@@ -86,18 +91,19 @@ LineInfo;
 
     Represents a line of text from otool's output. For each __text section,
     otool is called twice- with symbolic operands(-V) and without(-v). The
-    resulting 2 text files are each read into a doubly-linked list of Line's.
-    Each Line contains a pointer to the corresponding Line in the other list.
-    The reason for this approach is due to otool's inaccuracy in guessing
-    symbols. From comments in ofile_print.c:
+    plain output is read into a doubly-linked list of Line's. The reason for
+    this approach is due to otool's inaccuracy in guessing symbols. From
+    comments in ofile_print.c:
 
         "Both a verbose (symbolic) and non-verbose modes are supported to aid
         in seeing the values even if they are not correct."
 
     With both versions on hand, we can choose the better one for each Line.
-    The criteria for choosing is defined in chooseLine:. This does result in a
-    slight loss of info, in the rare case that otool guesses correctly for
-    any instruction that is not a function call.
+    The criteria for choosing is defined in chooseLine:. Only the verbose
+    lines that chooseLine: may choose are kept, by address, see
+    VerboseLines. This does result in a slight loss of info, in the rare
+    case that otool guesses correctly for any instruction that is not a
+    function call.
 */
 struct Line
 {
@@ -105,7 +111,6 @@ struct Line
     size_t          length;     // C string length
     struct Line*    next;       // next line in this list
     struct Line*    prev;       // previous line in this list
-    struct Line*    alt;        // "this" line in the other list
     LineInfo        info;       // details
 };
 
@@ -153,9 +158,13 @@ typedef struct
     BlockInfo*  blocks;
     uint32_t    numBlocks;
     uint32_t    genericFuncNum; // 'AnonX' if > 0
+    BOOL        isCached;       // output reused from the function cache
 }
 FunctionInfo;
 
+// Defined in IvarLayouts.h
+typedef struct IvarLayoutsState IvarLayoutsState;
+
 // ============================================================================
 
 @interface Exe32Processor : ExeProcessor
@@ -164,11 +173,13 @@ FunctionInfo;
     // guts
     mach_header*        iMachHeaderPtr;         // ptr to the orig header
     mach_header         iMachHeader;            // (swapped?) copy of the header
-    Line*               iVerboseLineListHead;   // linked list the first
-    Line*               iPlainLineListHead;     // linked list the second
+    Line*               iPlainLineListHead;     // linked list of lines
     Line**              iLineArray;
     uint32_t              iNumLines;
     uint32_t              iNumCodeLines;
+    Line*               iFinishedLine;          // see MemoryBudget
+    UInt64              iLineBytesAhead;
+    UInt64              iLineBytesBehind;
     cpu_type_t          iArchSelector;
     uint32_t            iCurrentFunctionStart;
 
@@ -199,6 +210,7 @@ FunctionInfo;
     objc1_32_category*  iCurrentCat;
     MethodInfo*         iCatMethodInfos;
     uint32_t              iNumCatMethodInfos;
+    IvarLayoutsState*   iIvarLayouts;       // see IvarLayouts
 
     // Only valid when iObjcVersion=2
     objc2_32_ivar_t*    iClassIvars;
@@ -250,16 +262,23 @@ FunctionInfo;
 
 // processors
 - (BOOL)processExe: (NSString*)inOutputFilePath;
+- (char*)copyFunctionText: (UInt64)inAddress
+                   length: (size_t*)outLength;
+- (void)freeLines;
+- (BOOL)generateLines;
 - (BOOL)populateLineLists;
-- (BOOL)populateLineList: (Line**)inList
-               verbosely: (BOOL)inVerbose
-             fromSection: (char*)inSectionName
-               afterLine: (Line**)inLine
-           includingPath: (BOOL)inIncludePath;
+- (FILE*)openOtoolPipe: (BOOL)inVerbose
+           fromSection: (char*)inSectionName
+         includingPath: (BOOL)inIncludePath;
+- (BOOL)readLineList: (Line**)inList
+            fromPipe: (FILE*)otoolPipe
+           afterLine: (Line**)inLine;
+- (BOOL)readVerboseLines: (VerboseLineBatch*)ioBatch
+                fromPipe: (FILE*)otoolPipe;
 - (BOOL)printDataSections;
-- (void)printDataSection: (section_info*)inSect
-                  toFile: (FILE*)outFile;
+- (BOOL)printDataSection: (section_info*)inSect;
 - (BOOL)lineIsCode: (const char*)inLine;
+- (UInt64)tableMemory;
 
 // customizers
 - (void)gatherLineInfos;
@@ -268,6 +287,7 @@ FunctionInfo;
 - (void)processLine: (Line*)ioLine;
 - (void)processCodeLine: (Line**)ioLine;
 - (void)chooseLine: (Line**)ioLine;
+- (BOOL)mayChooseVerboseLineAtAddress: (uint32_t)inAddress;
 - (void)entabLine: (Line*)ioLine;
 - (BOOL)getIvarName:(char **)outName type:(char **)outType withOffset:(uint32_t)offset inClass:(objc_32_class_ptr)classPtr;
 - (char*)getPointer: (uint32_t)inAddr
@@ -320,20 +340,3 @@ MethodInfo_Compare(
 
     return (mi1->m.method_imp > mi2->m.method_imp);
 }
-
-static int
-MethodInfo_Compare_Swapped(
-    MethodInfo* mi1,
-    MethodInfo* mi2)
-{
-    uint32_t  imp1 = mi1->m.method_imp;
-    uint32_t  imp2 = mi2->m.method_imp;
-
-    imp1    = OSSwapInt32(imp1);
-    imp2    = OSSwapInt32(imp2);
-
-    if (imp1 < imp2)
-        return -1;
-
-    return (imp1 > imp2);
-}
@@ -7,6 +7,7 @@
 #import <Cocoa/Cocoa.h>
 
 #import "ExeProcessor.h"
+#import "VerboseLines.h"
 
 /*  MethodInfo
 
@@ -72,6 +73,7 @@ typedef struct
     BOOL    isCode;         // NO for function names, section names etc.
     BOOL    isFunction;     // YES if this is the first instruction in a function.
     BOOL    isFunctionEnd;  // YES if this is the last instruction in a function.
+    BOOL    isSpilled;      // chars are in the spill file, see MemoryBudget.
 }
 Line64Info;
 
@@ -79,18 +81,19 @@ Line64Info;
 
     Represents a line of text from otool's output. For each __text section,
     otool is called twice- with symbolic operands(-V) and without(-v). The
-    resulting 2 text files are each read into a doubly-linked list of Line64's.
-    Each Line64 contains a pointer to the corresponding Line64 in the other list.
-    The reason for this approach is due to otool's inaccuracy in guessing
-    symbols. From comments in ofile_print.c:
+    plain output is read into a doubly-linked list of Line64's. The reason for
+    this approach is due to otool's inaccuracy in guessing symbols. From
+    comments in ofile_print.c:
 
         "Both a verbose (symbolic) and non-verbose modes are supported to aid
         in seeing the values even if they are not correct."
 
     With both versions on hand, we can choose the better one for each Line64.
-    The criteria for choosing is defined in chooseLine:. This does result in a
-    slight loss of info, in the rare case that otool guesses correctly for
-    any instruction that is not a function call.
+    The criteria for choosing is defined in chooseLine:. Only the verbose
+    lines that chooseLine: may choose are kept, by address, see
+    VerboseLines. This does result in a slight loss of info, in the rare
+    case that otool guesses correctly for any instruction that is not a
+    function call.
 */
 struct Line64
 {
@@ -98,7 +101,6 @@ struct Line64
     size_t          length;     // C string length
     struct Line64*  next;       // next line in this list
     struct Line64*  prev;       // previous line in this list
-    struct Line64*  alt;        // "this" line in the other list
     Line64Info      info;       // details
 };
 
@@ -146,6 +148,7 @@ typedef struct
     Block64Info*    blocks;
     uint32_t          numBlocks;
     uint32_t          genericFuncNum; // 'AnonX' if > 0
+    BOOL            isCached;       // output reused from the function cache
 }
 Function64Info;
 
@@ -157,11 +160,13 @@ Function64Info;
     // guts
     mach_header_64*     iMachHeaderPtr;         // ptr to the orig header
     mach_header_64      iMachHeader;            // (swapped?) copy of the header
-    Line64*             iVerboseLineListHead;   // linked list the first
-    Line64*             iPlainLineListHead;     // linked list the second
+    Line64*             iPlainLineListHead;     // linked list of lines
     Line64**            iLineArray;
     uint32_t              iNumLines;
     uint32_t              iNumCodeLines;
+    Line64*             iFinishedLine;          // see MemoryBudget
+    UInt64              iLineBytesAhead;
+    UInt64              iLineBytesBehind;
     cpu_type_t          iArchSelector;
     uint64_t            iCurrentFunctionStart;
 
@@ -226,16 +231,23 @@ Function64Info;
 
 // processors
 - (BOOL)processExe: (NSString*)inOutputFilePath;
+- (char*)copyFunctionText: (UInt64)inAddress
+                   length: (size_t*)outLength;
+- (void)freeLines;
+- (BOOL)generateLines;
 - (BOOL)populateLineLists;
-- (BOOL)populateLineList: (Line64**)inList
-               verbosely: (BOOL)inVerbose
-             fromSection: (char*)inSectionName
-               afterLine: (Line64**)inLine
-           includingPath: (BOOL)inIncludePath;
+- (FILE*)openOtoolPipe: (BOOL)inVerbose
+           fromSection: (char*)inSectionName
+         includingPath: (BOOL)inIncludePath;
+- (BOOL)readLineList: (Line64**)inList
+            fromPipe: (FILE*)otoolPipe
+           afterLine: (Line64**)inLine;
+- (BOOL)readVerboseLines: (VerboseLineBatch*)ioBatch
+                fromPipe: (FILE*)otoolPipe;
 - (BOOL)printDataSections;
-- (void)printDataSection: (section_info_64*)inSect
-                  toFile: (FILE*)outFile;
+- (BOOL)printDataSection: (section_info_64*)inSect;
 - (BOOL)lineIsCode: (const char*)inLine;
+- (UInt64)tableMemory;
 
 // customizers
 - (void)gatherLineInfos;
@@ -244,6 +256,7 @@ Function64Info;
 - (void)processLine: (Line64*)ioLine;
 - (void)processCodeLine: (Line64**)ioLine;
 - (void)chooseLine: (Line64**)ioLine;
+- (BOOL)mayChooseVerboseLineAtAddress: (UInt64)inAddress;
 - (void)entabLine: (Line64*)ioLine;
 - (char*)getPointer: (UInt64)inAddr
                type: (UInt8*)outType;
@@ -285,20 +298,6 @@ Method64Info_Compare(
     return (mi1->m.imp > mi2->m.imp);
 }
 
-static int
-Method64Info_Compare_Swapped(
-    Method64Info* mi1,
-    Method64Info* mi2)
-{
-    UInt64 imp1 = OSSwapInt64(mi1->m.imp);
-    UInt64 imp2 = OSSwapInt64(mi2->m.imp);
-
-    if (imp1 < imp2)
-        return -1;
-
-    return (imp1 > imp2);
-}
-
 static int
 objc2_64_ivar_t_Compare(
     objc2_64_ivar_t* i1,
@@ -8,14 +8,66 @@
 */
 
 #import <Cocoa/Cocoa.h>
+#import <pthread.h>
 
 #import "Exe64Processor.h"
 #import "Arch64Specifics.h"
+#import "CrossRefs.h"
+#import "FilterResolver64.h"
+#import "FunctionMatcher64.h"
+#import "Instrumentation.h"
+#import "JSONOutput.h"
 #import "List64Utils.h"
+#import "MemoryBudget.h"
 #import "Objc64Accessors.h"
+#import "ObjcIndex.h"
 #import "Object64Loader.h"
+#import "OutputFile.h"
+#import "OutputIndex.h"
+#import "ResultCache.h"
 #import "SysUtils.h"
 #import "UserDefaultKeys.h"
+#import "VerboseLines.h"
+
+/*  OtoolReader
+
+    One otool invocation, read on a thread of its own. Plain output goes
+    into a list of its own, and populateLineLists chains the lists. Verbose
+    output goes into a batch of its own, see VerboseLines.
+*/
+typedef struct
+{
+    Exe64Processor*     processor;
+    FILE*               pipe;
+    BOOL                verbose;
+    Line64*             head;
+    Line64*             tail;
+    VerboseLineBatch    verboseLines;
+}
+OtoolReader;
+
+// ----------------------------------------------------------------------------
+//  Body of the threads that read otool pipes.
+
+static void*
+ReadOtoolThread(
+    void*   inReader)
+{
+    NSAutoreleasePool*  pool    = [[NSAutoreleasePool alloc] init];
+    OtoolReader*        reader  = inReader;
+
+    if (reader->verbose)
+        [reader->processor readVerboseLines: &reader->verboseLines
+            fromPipe: reader->pipe];
+    else
+        [reader->processor readLineList: &reader->head fromPipe: reader->pipe
+            afterLine: &reader->tail];
+
+    [pool release];
+    return NULL;
+}
+
+// ============================================================================
 
 @implementation Exe64Processor
 
@@ -55,12 +107,25 @@
         iFuncSyms   = NULL;
     }
 
+    // Tables mapped from an ObjcIndex go away with it.
+    if ([self objcTablesMapped])
+    {
+        iClassMethodInfos   = NULL;
+        iClassIvars         = NULL;
+    }
+
     if (iClassMethodInfos)
     {
         free(iClassMethodInfos);
         iClassMethodInfos   = NULL;
     }
 
+    if (iClassIvars)
+    {
+        free(iClassIvars);
+        iClassIvars = NULL;
+    }
+
     if (iLineArray)
     {
         free(iLineArray);
@@ -69,7 +134,6 @@
 
     [self deleteFuncInfos];
     [self deleteLinesFromList: iPlainLineListHead];
-    [self deleteLinesFromList: iVerboseLineListHead];
 
     [super dealloc];
 }
@@ -119,6 +183,23 @@
     iFuncInfos  = NULL;
 }
 
+//  tableMemory
+// ----------------------------------------------------------------------------
+//  What the symbol, method and ivar tables hold in the heap, see
+//  MemoryBudget.
+
+- (UInt64)tableMemory
+{
+    UInt64  bytes   = (UInt64)iNumFuncSyms * sizeof(nlist_64);
+
+    // Tables mapped from an ObjcIndex are the kernel's to page.
+    if (![self objcTablesMapped])
+        bytes   += (UInt64)iNumClassMethodInfos * sizeof(Method64Info) +
+            (UInt64)iNumClassIvars * sizeof(objc2_64_ivar_t);
+
+    return bytes;
+}
+
 #pragma mark -
 //  processExe:
 // ----------------------------------------------------------------------------
@@ -135,90 +216,252 @@
     iOutputFilePath = inOutputFilePath;
     iMachHeaderPtr  = NULL;
 
+    memset(&iStats, 0, sizeof(iStats));
+    [self beginPhase: LoadPhase];
+
     if (![self loadMachHeader])
     {
         fprintf(stderr, "otx: failed to load mach header\n");
         return NO;
     }
 
+    [self endPhase: LoadPhase];
+
+    // An unchanged slice processed with the same options needs no otool.
+    if (iOpts.resultCache)
+    {
+        if ([self fetchCachedResult])
+        {
+            ProgressBeginStage(iProgress, CompleteStage, 0);
+
+            return YES;
+        }
+
+        if (![self beginCachingResult])
+            iOpts.resultCache   = NO;
+    }
+
+    [self beginPhase: LoadPhase];
     [self loadLCommands];
+    [self endPhase: LoadPhase];
 
-    NSMutableDictionary*    progDict    =
-        [[NSMutableDictionary alloc] initWithObjectsAndKeys:
-        [NSNumber numberWithBool: YES], PRNewLineKey,
-        @"Calling otool", PRDescriptionKey,
-        nil];
-
-#ifdef OTX_CLI
-    [iController reportProgress: progDict];
-#else
-    [iController performSelectorOnMainThread: @selector(reportProgress:)
-        withObject: progDict waitUntilDone: NO];
-#endif
+    [self setMemory: [self tableMemory] kind: TableMemory];
 
-    [progDict release];
+    // Turn filter specs into address ranges before otool runs.
+    [self resolveFunctionFilters];
 
-    [self populateLineLists];
+    // Collect cross-references while lines are commented.
+    [self beginCrossRefs];
 
-    if (gCancel == YES)
+    if (![self generateLines])
         return NO;
 
-    progDict    = [[NSMutableDictionary alloc] initWithObjectsAndKeys:
-        [NSNumber numberWithBool: YES], PRNewLineKey,
-        @"Gathering info", PRDescriptionKey,
-        nil];
+    if (ProgressCancelled(iProgress))
+        return NO;
 
-#ifdef OTX_CLI
-    [iController reportProgress: progDict];
-#else
-    [iController performSelectorOnMainThread: @selector(reportProgress:)
-        withObject: progDict waitUntilDone: NO];
-#endif
+    ProgressBeginStage(iProgress, WritingStage, iNumLines);
+
+    // Create output file.
+    [self beginPhase: WritePhase];
+
+    if (![self printLinesFromList: iPlainLineListHead])
+    {
+        return NO;
+    }
+
+    [self endPhase: WritePhase];
+
+    if (iOpts.dataSections)
+    {
+        [self beginPhase: DataSectionsPhase];
+
+        if (![self printDataSections])
+        {
+            [self closeOutputFile];
+            return NO;
+        }
+
+        [self endPhase: DataSectionsPhase];
+    }
+
+    if (![self closeOutputFile])
+        return NO;
+
+    if (iFuncCache && iOpts.functionCache)
+        [self saveFunctionCache];
+
+    [self finishOutputIndex];
+    [self finishCrossRefs];
+
+    if (iOpts.resultCache)
+    {
+        if (![self finishCachingResult])
+            return NO;
+    }
+
+    ProgressBeginStage(iProgress, CompleteStage, 0);
+
+    return YES;
+}
+
+//  copyFunctionText:length:
+// ----------------------------------------------------------------------------
+//  Generate only the function containing inAddress, with the load commands
+//  and Obj-C metadata already loaded, see OTXEngine. Returns the text of
+//  its lines, as processExe: would write them, malloc'd. The lines of any
+//  earlier call are freed first.
+
+- (char*)copyFunctionText: (UInt64)inAddress
+                   length: (size_t*)outLength
+{
+    *outLength  = 0;
+
+    [self freeLines];
+    memset(&iStats, 0, sizeof(iStats));
+
+    [self setFunctionFilters: [NSArray arrayWithObject:
+        [NSString stringWithFormat: @"0x%llx", inAddress]]];
+    [self resolveFunctionFilters];
+
+    if (![self generateLines])
+        return NULL;
+
+    size_t  length  = 0;
+    Line64* theLine;
+
+    for (theLine = iPlainLineListHead; theLine; theLine = theLine->next)
+        length  += theLine->length;
+
+    char*   text    = malloc(length + 1);
+
+    if (!text)
+    {
+        fprintf(stderr, "otx: not enough memory to copy function text\n");
+        return NULL;
+    }
+
+    length  = 0;
+
+    for (theLine = iPlainLineListHead; theLine; theLine = theLine->next)
+    {
+        memcpy(&text[length], theLine->chars, theLine->length);
+        length  += theLine->length;
+    }
+
+    text[length]    = 0;
+    *outLength      = length;
 
-    [progDict release];
+    return text;
+}
+
+//  freeLines
+// ----------------------------------------------------------------------------
+//  Everything generateLines leaves behind, so that it can run again. Thunks
+//  are found among the lines, so they go too.
+
+- (void)freeLines
+{
+    [self deleteLinesFromList: iPlainLineListHead];
+    iPlainLineListHead  = NULL;
+
+    if (iLineArray)
+    {
+        free(iLineArray);
+        iLineArray  = NULL;
+    }
+
+    iNumLines       = 0;
+    iNumCodeLines   = 0;
+
+    [self deleteFuncInfos];
+    iNumFuncInfos           = 0;
+    iCurrentGenericFuncNum  = 0;
+
+    [self freeVerboseLines];
+
+    if (iThunks)
+    {
+        free(iThunks);
+        iThunks = NULL;
+    }
+
+    iNumThunks  = 0;
+}
+
+//  generateLines
+// ----------------------------------------------------------------------------
+//  Run otool and comment its lines, leaving them in iPlainLineListHead.
+//  Call after loadLCommands and resolveFunctionFilters.
+
+- (BOOL)generateLines
+{
+    ProgressBeginStage(iProgress, OtoolStage, 0);
+
+    [self populateLineLists];
+
+    if (ProgressCancelled(iProgress))
+        return NO;
+
+    ProgressBeginStage(iProgress, GatheringStage, 0);
 
     // Gather info about lines while they're virgin.
+    [self beginPhase: LineInfoPhase];
     [self gatherLineInfos];
+    [self endPhase: LineInfoPhase];
+
+    iStats.counts[LineCount]        = iNumLines;
+    iStats.counts[CodeLineCount]    = iNumCodeLines;
 
-    if (gCancel == YES)
+    if (ProgressCancelled(iProgress))
         return NO;
 
     // Find functions and allocate funcInfo's.
+    [self beginPhase: FindFunctionsPhase];
     [self findFunctions];
+    [self endPhase: FindFunctionsPhase];
 
-    if (gCancel == YES)
+    if (ProgressCancelled(iProgress))
         return NO;
 
+    // Look for functions that haven't changed since the last build, or
+    // fingerprint them for -diff.
+    if (iOpts.functionCache || iOpts.functionDigests)
+        [self matchCachedFunctions];
+
     // Gather info about logical blocks. The second pass applies info
     // for backward branches.
+    [self beginPhase: FuncInfoPhase1];
     [self gatherFuncInfos];
+    [self endPhase: FuncInfoPhase1];
 
-    if (gCancel == YES)
+    if (ProgressCancelled(iProgress))
         return NO;
 
+    [self beginPhase: FuncInfoPhase2];
     [self gatherFuncInfos];
+    [self endPhase: FuncInfoPhase2];
+
+    uint32_t    funcIndex;
 
-    if (gCancel == YES)
+    iStats.counts[FunctionCount]    = iNumFuncInfos;
+
+    for (funcIndex = 0; funcIndex < iNumFuncInfos; funcIndex++)
+        iStats.counts[BlockCount]   += iFuncInfos[funcIndex].numBlocks;
+
+    [self setMemory: (UInt64)iNumFuncInfos * sizeof(Function64Info) +
+        iStats.counts[BlockCount] * sizeof(Block64Info) kind: FuncInfoMemory];
+
+    if (ProgressCancelled(iProgress))
         return NO;
 
     uint32_t  progCounter = 0;
-    double  progValue   = 0.0;
-
-    progDict    = [[NSMutableDictionary alloc] initWithObjectsAndKeys:
-        [NSNumber numberWithBool: NO], PRIndeterminateKey,
-        [NSNumber numberWithDouble: progValue], PRValueKey,
-        [NSNumber numberWithBool: YES], PRNewLineKey,
-        @"Generating file", PRDescriptionKey,
-        nil];
-
-#ifdef OTX_CLI
-    [iController reportProgress: progDict];
-#else
-    [iController performSelectorOnMainThread: @selector(reportProgress:)
-        withObject: progDict waitUntilDone: NO];
-#endif
 
-    [progDict release];
+    ProgressBeginStage(iProgress, GeneratingStage, iNumLines);
+
+    [self beginPhase: GeneratePhase];
+
+    // Spill lines to stay under -max-memory as we go, see MemoryBudget.
+    [self beginLineBudget];
 
     Line64* theLine = iPlainLineListHead;
 
@@ -227,82 +470,48 @@
     {
         if (!(progCounter % PROGRESS_FREQ))
         {
-            if (gCancel == YES)
+            if (ProgressCancelled(iProgress))
                 return NO;
 
-            progValue   = (double)progCounter / iNumLines * 100;
-            progDict    = [[NSMutableDictionary alloc] initWithObjectsAndKeys:
-                [NSNumber numberWithDouble: progValue], PRValueKey,
-                nil];
-
-#ifdef OTX_CLI
-            [iController reportProgress: progDict];
-#else
-            [iController performSelectorOnMainThread: @selector(reportProgress:)
-                withObject: progDict waitUntilDone: NO];
-#endif
-
-            [progDict release];
+            if (progCounter)
+                ProgressAdvance(iProgress, PROGRESS_FREQ);
         }
 
+        // A line left spilled keeps its text in the spill file, where
+        // generating it would free it.
+        if (![self reachLine: theLine])
+            return NO;
+
         if (theLine->info.isCode)
         {
-            [self processCodeLine:&theLine];
+            if (!iFuncCache || ![self reuseCachedLine: theLine])
+                [self processCodeLine:&theLine];
+
+            if (iFuncCache)
+                [self recordCodeLine: theLine];
 
             if (iOpts.entabOutput)
                 [self entabLine:theLine];
         }
         else
+        {
             [self processLine:theLine];
 
-        theLine = theLine->next;
-        progCounter++;
-    }
-
-    if (gCancel == YES)
-        return NO;
-
-    progDict    = [[NSMutableDictionary alloc] initWithObjectsAndKeys:
-        [NSNumber numberWithBool: YES], PRIndeterminateKey,
-        [NSNumber numberWithBool: YES], PRNewLineKey,
-        @"Writing file", PRDescriptionKey,
-        nil];
-
-#ifdef OTX_CLI
-    [iController reportProgress: progDict];
-#else
-    [iController performSelectorOnMainThread: @selector(reportProgress:)
-        withObject: progDict waitUntilDone: NO];
-#endif
-
-    [progDict release];
-
-    // Create output file.
-    if (![self printLinesFromList: iPlainLineListHead])
-    {
-        return NO;
-    }
-
-    if (iOpts.dataSections)
-    {
-        if (![self printDataSections])
-        {
-            return NO;
+            // A function's name line becomes its record in processCodeLine:.
+            if (iOpts.jsonOutput &&
+                !(theLine->next && theLine->next->info.isFunction))
+                [self makeJSONTextLine: &theLine->chars
+                    length: &theLine->length];
         }
-    }
 
-    progDict = [[NSMutableDictionary alloc] initWithObjectsAndKeys:
-        [NSNumber numberWithBool: YES], PRCompleteKey,
-        nil];
+        [self finishLinesBefore: theLine];
 
-#ifdef OTX_CLI
-    [iController reportProgress: progDict];
-#else
-    [iController performSelectorOnMainThread: @selector(reportProgress:)
-        withObject: progDict waitUntilDone: NO];
-#endif
+        theLine = theLine->next;
+        progCounter++;
+    }
 
-    [progDict release];
+    [self finishLinesBefore: NULL];
+    [self endPhase: GeneratePhase];
 
     return YES;
 }
@@ -312,60 +521,103 @@
 
 - (BOOL)populateLineLists
 {
-    Line64* thePrevVerboseLine  = NULL;
-    Line64* thePrevPlainLine    = NULL;
+    // __text first, then the coalesced sections, each read verbosely and
+    // plainly. The otools all run at once, and are read as they go. The
+    // lists are only handed on once every reader is done. With -serial,
+    // each otool is started and read to the end before the next. Sections
+    // the filters leave nothing of are skipped, see FunctionFilter.
+    char*       sectionNames[MAX_OTOOL_READERS / 2];
+    uint32_t    numSections = 0;
+    uint32_t    numReaders;
+    uint32_t    i;
+
+    if ([self rangePassesFilter: (AddressRange){iTextSect.s.addr,
+        iTextSect.s.addr + iTextSect.s.size}])
+        sectionNames[numSections++] = "__text";
+
+    if (iCoalTextSect.size && [self rangePassesFilter: (AddressRange)
+        {iCoalTextSect.s.addr, iCoalTextSect.s.addr + iCoalTextSect.s.size}])
+        sectionNames[numSections++] = "__coalesced_text";
+
+    if (iCoalTextNTSect.size && [self rangePassesFilter: (AddressRange)
+        {iCoalTextNTSect.s.addr,
+        iCoalTextNTSect.s.addr + iCoalTextNTSect.s.size}])
+        sectionNames[numSections++] = "__textcoal_nt";
 
-    // Read __text lines.
-    [self populateLineList: &iVerboseLineListHead verbosely: YES
-        fromSection: "__text" afterLine: &thePrevVerboseLine
-        includingPath: YES];
+    OtoolReader readers[MAX_OTOOL_READERS];
+    pthread_t   threads[MAX_OTOOL_READERS];
+    BOOL        threaded[MAX_OTOOL_READERS];
 
-    [self populateLineList: &iPlainLineListHead verbosely: NO
-        fromSection: "__text" afterLine: &thePrevPlainLine
-        includingPath: YES];
+    memset(readers, 0, sizeof(readers));
+    numReaders  = numSections * 2;
 
-    // Read __coalesced_text lines.
-    if (iCoalTextSect.size)
+    for (i = 0; i < numReaders; i++)
     {
-        [self populateLineList: &iVerboseLineListHead verbosely: YES
-            fromSection: "__coalesced_text" afterLine: &thePrevVerboseLine
-            includingPath: NO];
+        readers[i].processor    = self;
+        readers[i].verbose      = (i % 2 == 0);
 
-        [self populateLineList: &iPlainLineListHead verbosely: NO
-            fromSection: "__coalesced_text" afterLine: &thePrevPlainLine
-            includingPath: NO];
+        if (!iOpts.serial)
+            readers[i].pipe = [self openOtoolPipe: readers[i].verbose
+                fromSection: sectionNames[i / 2] includingPath: (i / 2 == 0)];
     }
 
-    // Read __textcoal_nt lines.
-    if (iCoalTextNTSect.size)
+    [self beginPhase: OtoolPhase];
+
+    for (i = 0; i < numReaders; i++)
     {
-        [self populateLineList: &iVerboseLineListHead verbosely: YES
-            fromSection: "__textcoal_nt" afterLine: &thePrevVerboseLine
-            includingPath: NO];
+        threaded[i] = NO;
+
+        if (iOpts.serial)
+            readers[i].pipe = [self openOtoolPipe: readers[i].verbose
+                fromSection: sectionNames[i / 2] includingPath: (i / 2 == 0)];
+
+        if (!readers[i].pipe)
+            continue;
+
+        if (!iOpts.serial)
+            threaded[i] = (pthread_create(&threads[i], NULL,
+                ReadOtoolThread, &readers[i]) == 0);
 
-        [self populateLineList: &iPlainLineListHead verbosely: NO
-            fromSection: "__textcoal_nt" afterLine: &thePrevPlainLine
-            includingPath: NO];
+        if (!threaded[i])
+            ReadOtoolThread(&readers[i]);
     }
 
-    // Connect the 2 lists.
-    Line64* verboseLine = iVerboseLineListHead;
-    Line64* plainLine   = iPlainLineListHead;
+    for (i = 0; i < numReaders; i++)
+    {
+        if (threaded[i])
+            pthread_join(threads[i], NULL);
+    }
+
+    [self endPhase: OtoolPhase];
+
+    // Chain each section's plain lines after the previous section's, and
+    // keep the verbose lines chooseLine: may want.
+    Line64* thePrevLine = NULL;
 
-    while (verboseLine && plainLine)
+    for (i = 0; i < numReaders; i++)
     {
-        // skip any extra text or empty lines in the verbose output
-        if (strncmp(verboseLine->chars, plainLine->chars, 16)) {
-            verboseLine = verboseLine->next;
+        if (readers[i].verbose)
+        {
+            [self addVerboseLineBatch: &readers[i].verboseLines];
             continue;
         }
-        verboseLine->alt    = plainLine;
-        plainLine->alt      = verboseLine;
 
-        verboseLine = verboseLine->next;
-        plainLine   = plainLine->next;
+        if (!readers[i].head)
+            continue;
+
+        if (thePrevLine)
+        {
+            thePrevLine->next       = readers[i].head;
+            readers[i].head->prev   = thePrevLine;
+        }
+        else
+            iPlainLineListHead  = readers[i].head;
+
+        thePrevLine = readers[i].tail;
     }
 
+    [self indexVerboseLines];
+
     // Optionally insert md5.
     if (iOpts.checksum)
         [self insertMD5];
@@ -373,14 +625,13 @@
     return YES;
 }
 
-//  populateLineList:verbosely:fromSection:afterLine:includingPath:
+//  openOtoolPipe:fromSection:includingPath:
 // ----------------------------------------------------------------------------
+//  Start otool on one section. Returns NULL if it couldn't be started.
 
-- (BOOL)populateLineList: (Line64**)inList
-               verbosely: (BOOL)inVerbose
-             fromSection: (char*)inSectionName
-               afterLine: (Line64**)inLine
-           includingPath: (BOOL)inIncludePath
+- (FILE*)openOtoolPipe: (BOOL)inVerbose
+           fromSection: (char*)inSectionName
+         includingPath: (BOOL)inIncludePath
 {
     char cmdString[MAX_UNIBIN_OTOOL_CMD_SIZE] = "";
     NSString* otoolPath = [NSString stringWithFormat:@"\"%@\"", [self pathForTool: @"otool"]];
@@ -392,7 +643,7 @@
     {
         // Bail if it won't fit.
         if ((otoolPathLength + archStringLength + 7 /* strlen(" -arch ") */) >= MAX_UNIBIN_OTOOL_CMD_SIZE)
-            return NO;
+            return NULL;
 
         snprintf(cmdString, MAX_UNIBIN_OTOOL_CMD_SIZE,
             "%s -arch %s", [otoolPath UTF8String], iArchString);
@@ -401,7 +652,7 @@
     {
         // Bail if it won't fit.
         if (otoolPathLength >= MAX_UNIBIN_OTOOL_CMD_SIZE)
-            return NO;
+            return NULL;
 
         strncpy(cmdString, [otoolPath UTF8String], otoolPathLength);
     }
@@ -417,13 +668,65 @@
     {
         fprintf(stderr, "otx: unable to open %s otool pipe\n",
             (inVerbose) ? "verbose" : "plain");
-        return NO;
+        return NULL;
     }
 
+    // Big reads, instead of one pipe buffer's worth at a time.
+    setvbuf(otoolPipe, NULL, _IOFBF, OTOOL_PIPE_BUFFER_SIZE);
+
+    return otoolPipe;
+}
+
+//  readLineList:fromPipe:afterLine:
+// ----------------------------------------------------------------------------
+//  Read a plain otool pipe into inList, and close it. Called on a thread of
+//  its own, so this touches nothing but inList and the pipe.
+
+- (BOOL)readLineList: (Line64**)inList
+            fromPipe: (FILE*)otoolPipe
+           afterLine: (Line64**)inLine
+{
     char theCLine[MAX_LINE_LENGTH];
+    Line64* firstHeldLine   = NULL;     // labels of a function not yet seen
+    BOOL    pastHeader      = NO;
 
     while (fgets(theCLine, MAX_LINE_LENGTH, otoolPipe))
     {
+        BOOL    holdLine    = NO;
+
+        // Drop functions that don't pass the filters, labels and all.
+        if (iFilterSpecs)
+        {
+            if ([self lineIsCode:theCLine])
+            {
+                pastHeader  = YES;
+
+                UInt64  theAddress  = [self addressFromLine:theCLine];
+
+                if (![self addressPassesFilter: theAddress])
+                {
+                    if (firstHeldLine)
+                    {
+                        *inLine = firstHeldLine->prev;
+                        [self deleteLinesFrom:firstHeldLine fromList:inList];
+                        firstHeldLine   = NULL;
+                    }
+
+                    // Closing the pipe early stops otool.
+                    if ([self addressIsPastFilter: theAddress])
+                        break;
+
+                    continue;
+                }
+
+                firstHeldLine   = NULL;
+            }
+            else if (strstr(theCLine, "(__TEXT,"))
+                pastHeader  = YES;
+            else if (pastHeader && !firstHeldLine)
+                holdLine    = YES;
+        }
+
         // Many thanx to Peter Hosey for the calloc speed test.
         // http://boredzo.org/blog/archives/2006-11-26/calloc-vs-malloc
 
@@ -438,12 +741,72 @@
         [self insertLine:theNewLine after:*inLine inList:inList];
 
         *inLine = theNewLine;
+
+        if (holdLine)
+            firstHeldLine   = theNewLine;
+    }
+
+    // Labels with no code after them.
+    if (firstHeldLine)
+    {
+        *inLine = firstHeldLine->prev;
+        [self deleteLinesFrom:firstHeldLine fromList:inList];
+    }
+
+    // pclose waits for otool to exit.
+    int closeResult = pclose(otoolPipe);
+
+    if (closeResult == -1)
+    {
+        perror("otx: unable to close plain otool pipe");
+        return NO;
+    }
+
+    return YES;
+}
+
+//  readVerboseLines:fromPipe:
+// ----------------------------------------------------------------------------
+//  Read a verbose otool pipe, and close it. Only the lines of instructions
+//  chooseLine: may swap in go into ioBatch, the rest are dropped here.
+//  Called on a thread of its own, so this touches nothing but ioBatch and
+//  the pipe.
+
+- (BOOL)readVerboseLines: (VerboseLineBatch*)ioBatch
+                fromPipe: (FILE*)otoolPipe
+{
+    char    theCLine[MAX_LINE_LENGTH];
+    UInt64  theAddress;
+
+    while (fgets(theCLine, MAX_LINE_LENGTH, otoolPipe))
+    {
+        if (![self lineIsCode: theCLine])
+            continue;
+
+        theAddress  = [self addressFromLine: theCLine];
+
+        if (iFilterSpecs && ![self addressPassesFilter: theAddress])
+        {
+            if ([self addressIsPastFilter: theAddress])
+                break;
+
+            continue;
+        }
+
+        if (![self mayChooseVerboseLineAtAddress: theAddress])
+            continue;
+
+        if (![self addVerboseLine: theCLine length: strlen(theCLine)
+            address: theAddress toBatch: ioBatch])
+            break;
     }
 
-    if (pclose(otoolPipe) == -1)
+    // pclose waits for otool to exit.
+    int closeResult = pclose(otoolPipe);
+
+    if (closeResult == -1)
     {
-        perror((inVerbose) ? "otx: unable to close verbose otool pipe" :
-            "otx: unable to close plain otool pipe");
+        perror("otx: unable to close verbose otool pipe");
         return NO;
     }
 
@@ -460,12 +823,13 @@
 {
     Line64*         theLine     = iPlainLineListHead;
     uint32_t          progCounter = 0;
+    UInt64          lineBytes   = 0;
 
     while (theLine)
     {
         if (!(progCounter % (PROGRESS_FREQ * 5)))
         {
-            if (gCancel == YES)
+            if (ProgressCancelled(iProgress))
                 return;
 
 //            [NSThread sleepForTimeInterval: 0.0];
@@ -477,15 +841,6 @@
             theLine->info.address = [self addressFromLine:theLine->chars];
             [self codeFromLine:theLine];
 
-            if (theLine->alt)
-            {
-                theLine->alt->info.isCode = theLine->info.isCode;
-                theLine->alt->info.address = theLine->info.address;
-                theLine->alt->info.codeLength = theLine->info.codeLength;
-                memcpy(theLine->alt->info.code, theLine->info.code,
-                    sizeof(theLine->info.code));
-            }
-
             [self checkThunk:theLine];
         }
         else    // not code...
@@ -496,11 +851,15 @@
                 iEndOfText  = iCoalTextNTSect.s.addr + iCoalTextNTSect.s.size;
         }
 
+        lineBytes   += sizeof(Line64) + theLine->length + 1;
+
         theLine = theLine->next;
         progCounter++;
         iNumLines++;
     }
 
+    [self setMemory: lineBytes kind: LineMemory];
+
     iEndOfText  = iTextSect.s.addr + iTextSect.s.size;
 }
 
@@ -516,9 +875,6 @@
     {
         theLine->info.isFunction    = [self lineIsFunction:theLine];
 
-        if (theLine->alt)
-            theLine->alt->info.isFunction   = theLine->info.isFunction;
-
         theLine = theLine->next;
     }
 
@@ -527,6 +883,8 @@
     iLineArray = calloc(iNumLines, sizeof(Line64*));
     iNumCodeLines = 0;
 
+    [self setMemory: (UInt64)iNumLines * sizeof(Line64*) kind: LineArrayMemory];
+
     while (theLine)
     {
         if (theLine->info.isFunction)
@@ -612,7 +970,8 @@
     // If we got here, we have a symbol name.
     if (iOpts.demangleCppNames)
     {
-        if (strstr(ioLine->chars, "__Z") == ioLine->chars)
+        if (strstr(ioLine->chars, "__Z") == ioLine->chars &&
+            [self startDemangler])
         {
             char demangledName[MAX_LINE_LENGTH];
 
@@ -630,6 +989,8 @@
             [dataToWrite appendBytes: "\n"
                               length: 1];
 
+            iStats.counts[DemangleCount]++;
+
             @try {
                 [filtWrite writeData: dataToWrite];
             }
@@ -811,8 +1172,9 @@
             snprintf(theCommentCString, MAX_COMMENT_LENGTH, "%s", theOrigCommentCString);
     }
 
-    BOOL    needFuncName = NO;
-    char    theMethCName[1000];
+    BOOL            needFuncName = NO;
+    char            theMethCName[1000];
+    MethodNameParts theMethParts = {0};     // for JSON output
 
     theMethCName[0] = 0;
 
@@ -889,6 +1251,12 @@
                         methNameFormat,
                         (methodInfo.inst) ? '-' : '+',
                         className, selName, returnCType);
+
+                    theMethParts.className          = className;
+                    theMethParts.selName            = selName;
+                    theMethParts.isInstanceMethod   = methodInfo.inst;
+                    strncpy(theMethParts.returnType, returnCType,
+                        MAX_TYPE_STRING_LENGTH - 1);
                 }
             }
         }   // if ([self getObjcMethod:&theSwappedInfoPtr fromAddress:mCurrentFuncPtr])
@@ -898,7 +1266,7 @@
         {
             if (theMethCName[0])
             {
-                Line64* theNewLine  = malloc(sizeof(Line64));
+                Line64* theNewLine  = calloc(1, sizeof(Line64));
 
                 theNewLine->length  = strlen(theMethCName);
                 theNewLine->chars   = malloc(theNewLine->length + 1);
@@ -909,7 +1277,7 @@
             }
             else if ((*ioLine)->info.address == iAddrDyldStubBindingHelper)
             {
-                Line64* theNewLine  = malloc(sizeof(Line64));
+                Line64* theNewLine  = calloc(1, sizeof(Line64));
                 char*   theDyldName = "\ndyld_stub_binding_helper:\n";
 
                 theNewLine->length  = strlen(theDyldName);
@@ -920,7 +1288,7 @@
             }
             else if ((*ioLine)->info.address == iAddrDyldFuncLookupPointer)
             {
-                Line64* theNewLine  = malloc(sizeof(Line64));
+                Line64* theNewLine  = calloc(1, sizeof(Line64));
                 char*   theDyldName = "\n__dyld_func_lookup:\n";
 
                 theNewLine->length  = strlen(theDyldName);
@@ -936,7 +1304,7 @@
         {
             if (theMethCName[0])
             {
-                Line64* theNewLine  = malloc(sizeof(Line64));
+                Line64* theNewLine  = calloc(1, sizeof(Line64));
 
                 theNewLine->length  = strlen(theMethCName);
                 theNewLine->chars   = malloc(theNewLine->length + 1);
@@ -971,6 +1339,9 @@
         [self resetRegisters:*ioLine];
     }   // if ((*ioLine)->info.isFunction)
 
+    [self beginCrossRefLine: (*ioLine)->info.address
+        function: iCurrentFunctionStart];
+
     // Find a comment if necessary.
     if (!theCommentCString[0])
     {
@@ -1038,7 +1409,8 @@
     // Demangle operands if necessary.
     if (iLineOperandsCString[0] && iOpts.demangleCppNames)
     {
-        if (strstr(iLineOperandsCString, "__Z") == iLineOperandsCString)
+        if (strstr(iLineOperandsCString, "__Z") == iLineOperandsCString &&
+            [self startDemangler])
         {
             char demangledName[MAX_OPERANDS_LENGTH];
 
@@ -1050,6 +1422,8 @@
             [dataToWrite appendBytes: "\n"
                               length: 1];
 
+            iStats.counts[DemangleCount]++;
+
             @try {
                 [filtWrite writeData: dataToWrite];
             }
@@ -1093,7 +1467,8 @@
     // Demangle comment if necessary.
     if (theCommentCString[0] && iOpts.demangleCppNames)
     {
-        if (strstr(theCommentCString, "__Z") == theCommentCString)
+        if (strstr(theCommentCString, "__Z") == theCommentCString &&
+            [self startDemangler])
         {
             char    demangledName[MAX_COMMENT_LENGTH];
 
@@ -1105,6 +1480,8 @@
             [dataToWrite appendBytes: "\n"
                               length: 1];
 
+            iStats.counts[DemangleCount]++;
+
             @try {
                 [filtWrite writeData: dataToWrite];
             }
@@ -1145,6 +1522,11 @@
         }
     }
 
+    // The comment names what's called, if anything does.
+    if (iCrossRefs)
+        [self addCrossRefCall: theMnemonicCString target:
+            (theCommentCString[0]) ? theCommentCString : iLineOperandsCString];
+
     // Optionally add local offset.
     if (iOpts.localOffsets)
     {
@@ -1201,6 +1583,16 @@
         [self insertLine:funcName before:*ioLine inList:&iPlainLineListHead];
     }
 
+    // One way or another, the previous line is now the function's name.
+    if (iCrossRefs && (*ioLine)->info.isFunction && (*ioLine)->prev)
+        [self addCrossRefFunction: (*ioLine)->info.address
+            name: (*ioLine)->prev->chars length: (*ioLine)->prev->length];
+
+    if (iOpts.jsonOutput && (*ioLine)->info.isFunction && (*ioLine)->prev)
+        [self makeJSONFunctionLine: &(*ioLine)->prev->chars
+            length: &(*ioLine)->prev->length
+            address: (*ioLine)->info.address method: &theMethParts];
+
     // Finally, assemble the new string.
     char    finalFormatCString[MAX_FORMAT_LENGTH];
     uint32_t  formatMarker    = 0;
@@ -1251,7 +1643,12 @@
 
     free((*ioLine)->chars);
 
-    if (iOpts.separateLogicalBlocks && iEnteringNewBlock &&
+    if (iOpts.jsonOutput)
+        (*ioLine)->chars    = [self jsonCodeLine: (*ioLine)->info.address
+            function: iCurrentFunctionStart code: theCodeCString
+            mnemonic: theMnemonicCString operands: iLineOperandsCString
+            comment: theCommentCString length: &(*ioLine)->length];
+    else if (iOpts.separateLogicalBlocks && iEnteringNewBlock &&
         theFinalCString[0] != '\n')
     {
         (*ioLine)->length   = strlen(theFinalCString) + 1;
@@ -1322,66 +1719,53 @@
 - (void)chooseLine: (Line64**)ioLine
 {}
 
+//  mayChooseVerboseLineAtAddress:
+// ----------------------------------------------------------------------------
+//  Whether chooseLine: may want the verbose line of the instruction at
+//  inAddress. Called from the otool reader threads, so overrides must only
+//  read the executable. Subclasses that override chooseLine: must override
+//  this too.
+
+- (BOOL)mayChooseVerboseLineAtAddress: (UInt64)inAddress
+{
+    return NO;
+}
+
 #pragma mark -
 //  printDataSections
 // ----------------------------------------------------------------------------
-//  Append data sections to output file.
+//  Append data sections to the output file opened by printLinesFromList:.
 
 - (BOOL)printDataSections
 {
-    FILE*   outFile = NULL;
-
-    if (iOutputFilePath)
-        outFile = fopen(UTF8STRING(iOutputFilePath), "a");
-    else
-        outFile = stdout;
-
-    if (!outFile)
-    {
-        perror("otx: unable to open output file");
-        return NO;
-    }
-
     if (iDataSect.size)
     {
-        if (fprintf(outFile, "\n(__DATA,__data) section\n") < 0)
-        {
-            perror("otx: unable to write to output file");
-            return NO;
-        }
+        const char* header  = "\n(__DATA,__data) section\n";
 
-        [self printDataSection: &iDataSect toFile: outFile];
+        if ((!iOpts.jsonOutput &&
+            ![self writeOutput: header length: strlen(header)]) ||
+            ![self printDataSection: &iDataSect])
+            return NO;
     }
 
     if (iCoalDataSect.size)
     {
-        if (fprintf(outFile, "\n(__DATA,__coalesced_data) section\n") < 0)
-        {
-            perror("otx: unable to write to output file");
-            return NO;
-        }
+        const char* header  = "\n(__DATA,__coalesced_data) section\n";
 
-        [self printDataSection: &iCoalDataSect toFile: outFile];
+        if ((!iOpts.jsonOutput &&
+            ![self writeOutput: header length: strlen(header)]) ||
+            ![self printDataSection: &iCoalDataSect])
+            return NO;
     }
 
     if (iCoalDataNTSect.size)
     {
-        if (fprintf(outFile, "\n(__DATA,__datacoal_nt) section\n") < 0)
-        {
-            perror("otx: unable to write to output file");
-            return NO;
-        }
+        const char* header  = "\n(__DATA,__datacoal_nt) section\n";
 
-        [self printDataSection: &iCoalDataNTSect toFile: outFile];
-    }
-
-    if (iOutputFilePath)
-    {
-        if (fclose(outFile) != 0)
-        {
-            perror("otx: unable to close output file");
+        if ((!iOpts.jsonOutput &&
+            ![self writeOutput: header length: strlen(header)]) ||
+            ![self printDataSection: &iCoalDataNTSect])
             return NO;
-        }
     }
 
     return YES;
@@ -1389,11 +1773,10 @@
 
 #define _64_BIT_ADDRESS_COLUMN_LENGTH_ 18
 
-//  printDataSection:toFile:
+//  printDataSection:
 // ----------------------------------------------------------------------------
 
-- (void)printDataSection: (section_info_64*)inSect
-                  toFile: (FILE*)outFile;
+- (BOOL)printDataSection: (section_info_64*)inSect;
 {
     uint32_t bytesLeft;
     uint32_t i, j, k;
@@ -1403,6 +1786,12 @@
 
     theLineCString[0] = 0;
 
+    if (iOpts.jsonOutput)
+        return [self printJSONDataSection: inSect->s.segname
+            section: inSect->s.sectname address: inSect->s.addr
+            bytes: (UInt8*)(theMachPtr + inSect->s.offset)
+            length: theDataSize];
+
     for (i = 0; i < theDataSize; i += 16)
     {
         bytesLeft = theDataSize - i;
@@ -1465,13 +1854,12 @@
                 theASCIIData);
         }
 
-        if (fprintf(outFile, "%s", theLineCString) < 0)
-        {
-            perror("otx: [Exe64Processor printDataSection:toFile:]: "
-                "unable to write to output file");
-            return;
-        }
+        if (![self writeOutput: theLineCString
+            length: strlen(theLineCString)])
+            return NO;
     }
+
+    return YES;
 }
 
 #pragma mark -
@@ -1518,15 +1906,13 @@
         return;
 
     // only need to do this math once...
-    static uint32_t   startOfComment  = 0;
-
-    if (startOfComment == 0)
+    if (iStartOfComment == 0)
     {
-        startOfComment  = iFieldWidths.address + iFieldWidths.instruction +
+        iStartOfComment = iFieldWidths.address + iFieldWidths.instruction +
             iFieldWidths.mnemonic + iFieldWidths.operands;
 
         if (iOpts.localOffsets)
-            startOfComment  += iFieldWidths.offset;
+            iStartOfComment += iFieldWidths.offset;
     }
 
     char    entabbedLine[MAX_LINE_LENGTH];
@@ -1550,7 +1936,7 @@
     for (i = firstChar; i < theOrigLength; i += 4)
     {
         // Don't entab comments.
-        if (i >= (startOfComment + firstChar) - 4)
+        if (i >= (iStartOfComment + firstChar) - 4)
         {
             strncpy(&entabbedLine[j], &ioLine->chars[i],
                 (theOrigLength - i) + 1);
@@ -1625,6 +2011,8 @@
 - (char*)getPointer: (UInt64)inAddr
                type: (UInt8*)outType
 {
+    iStats.counts[GetPointerCount]++;
+
     if (inAddr == 0)
         return NULL;
 
@@ -1741,7 +2129,7 @@
         {
             theType = PointerType;
 
-            static uint32_t recurseCount = 0;
+            uint32_t recurseCount = 0;
 
             while (theType == PointerType)
             {
@@ -1763,8 +2151,6 @@
 
                 theValue = *(UInt64*)thePtr;
             }
-
-            recurseCount = 0;
         }
 
         if (outType)
@@ -9,6 +9,7 @@
 #import "SystemIncludes.h"
 
 #import "ObjcTypes.h"
+#import "OutputWriter.h"
 #import "SharedDefs.h"
 #import "StolenDefs.h"
 #import "ProgressReporter.h"
@@ -83,6 +84,70 @@ typedef struct
 }
 TextFieldWidths;
 
+/*  AddressRange
+
+    A range of addresses, not including 'end'.
+*/
+typedef struct
+{
+    UInt64  start;
+    UInt64  end;
+}
+AddressRange;
+
+// Phases of processExe:, timed by beginPhase: and endPhase:.
+enum {
+    LoadPhase,              // loadMachHeader, loadLCommands
+    OtoolPhase,             // the otool pipes, all read at once
+    LineInfoPhase,          // gatherLineInfos
+    FindFunctionsPhase,     // findFunctions
+    FuncInfoPhase1,         // first gatherFuncInfos pass
+    FuncInfoPhase2,         // second gatherFuncInfos pass
+    GeneratePhase,          // processCodeLine: etc.
+    WritePhase,             // printLinesFromList:
+    DataSectionsPhase,      // printDataSections
+    NumPhases
+};
+
+// Things counted along the way.
+enum {
+    LineCount,
+    CodeLineCount,
+    FunctionCount,
+    BlockCount,
+    MachineStateCount,      // saved for a block by gatherFuncInfos
+    GetPointerCount,
+    DemangleCount,          // round trips to c++filt
+    BytesWrittenCount,
+    SpilledBytesCount,      // line text moved to the spill file
+    NumCounts
+};
+
+// Memory held by the big consumers, see MemoryBudget.
+enum {
+    LineMemory,             // Line's and their text
+    LineArrayMemory,        // iLineArray
+    FuncInfoMemory,         // iFuncInfos and their blocks
+    MachineStateMemory,     // saved for a block by gatherFuncInfos
+    TableMemory,            // symbol, method and ivar tables
+    NumMemoryKinds
+};
+
+/*  ProcessStats
+
+    Where the time and memory go, see Instrumentation and MemoryBudget.
+    Times are in mach_absolute_time() units, memory in bytes.
+*/
+typedef struct
+{
+    UInt64  phaseTimes[NumPhases];
+    UInt64  phaseStarts[NumPhases];
+    UInt64  counts[NumCounts];
+    UInt64  memory[NumMemoryKinds];
+    UInt64  peakMemory;
+}
+ProcessStats;
+
 // Constants for dealing with objc_msgSend variants.
 enum {
     send,
@@ -127,6 +192,8 @@ enum {
 #define MAX_OPERANDS_LENGTH         10000
 #define MAX_COMMENT_LENGTH          2000
 #define MAX_LINE_LENGTH             10000
+#define OTOOL_PIPE_BUFFER_SIZE      (256 * 1024)
+#define MAX_OTOOL_READERS           6       // 3 sections, verbose and plain
 #define MAX_TYPE_STRING_LENGTH      200     // for encoded ObjC data types
 #define MAX_MD5_LINE                40      // for the md5 pipe
 #define MAX_ARCH_STRING_LENGTH      20      // "ppc", "i386" etc.
@@ -149,6 +216,33 @@ enum {
 #define PROGRESS_FREQ   3500
 #endif
 
+// Defined in FunctionCache.h
+typedef struct FunctionCacheState FunctionCacheState;
+
+// Defined in OutputIndex.h
+typedef struct OutputIndexState OutputIndexState;
+
+// Defined in CrossRefs.h
+typedef struct CrossRefsState CrossRefsState;
+
+// Defined in ObjcIndex.h
+typedef struct ObjcIndexState ObjcIndexState;
+
+// Defined in RefTable.h
+typedef struct RefTableState RefTableState;
+
+// Defined in LiteralTable.h
+typedef struct LiteralTableState LiteralTableState;
+
+// Defined in TypeDecoder.h
+typedef struct TypeDecoderState TypeDecoderState;
+
+// Defined in VerboseLines.h
+typedef struct VerboseLinesState VerboseLinesState;
+
+// Defined in MemoryBudget.h
+typedef struct MemoryBudgetState MemoryBudgetState;
+
 // ============================================================================
 
 @interface ExeProcessor : NSObject
@@ -156,19 +250,40 @@ enum {
 @protected
     BOOL                iSwapped;
     id                  iController;
+    ProgressState*      iProgress;              // owned by iController
     NSTimer*            iIndeterminateProgBarTimer;
 
     // guts
     NSURL*              iOFile;                 // exe on disk
     char*               iRAMFile;               // exe in RAM
     NSUInteger          iRAMFileSize;
+    NSUInteger          iSliceOffset;           // selected arch within iRAMFile
+    NSUInteger          iSliceSize;
     NSString*           iOutputFilePath;
+    NSString*           iCacheTempPath;         // see ResultCache
+    NSString*           iSliceDigest;
+    FunctionCacheState* iFuncCache;             // see FunctionCache
+    NSArray*            iFilterSpecs;           // see FunctionFilter
+    AddressRange*       iFilterRanges;
+    uint32_t            iNumFilterRanges;
+    OutputIndexState*   iOutputIndex;           // see OutputIndex
+    CrossRefsState*     iCrossRefs;             // see CrossRefs
+    ObjcIndexState*     iObjcIndex;             // see ObjcIndex
+    RefTableState*      iRefTable;              // see RefTable
+    LiteralTableState*  iLiterals;              // see LiteralTable
+    TypeDecoderState*   iTypeDecoder;           // see TypeDecoder
+    VerboseLinesState*  iVerboseLines;          // see VerboseLines
+    MemoryBudgetState*  iMemoryBudget;          // see MemoryBudget
+    FILE*               iOutputFile;            // see OutputFile
+    OutputWriter*       iOutputWriter;
     uint32_t              iFileArchMagic;         // 0xCAFEBABE etc.
     BOOL                iExeIsFat;
     ThunkInfo*          iThunks;                // x86 only
     uint32_t              iNumThunks;             // x86 only
     TextFieldWidths     iFieldWidths;
+    uint32_t            iStartOfComment;        // see entabLine:
     ProcOptions         iOpts;
+    ProcessStats        iStats;                 // see Instrumentation
     NSTask*             iCPFiltTask;
     NSPipe*             iCPFiltInputPipe;
     NSPipe*             iCPFiltOutputPipe;
@@ -198,9 +313,9 @@ enum {
 - (id)initWithURL: (NSURL*)inURL
        controller: (id)inController
           options: (ProcOptions*)inOptions;
+- (BOOL)startDemangler;
 - (BOOL)printDataSections;
-- (void)printDataSection: (section_info*)inSect
-                  toFile: (FILE*)outFile;
+- (BOOL)printDataSection: (section_info*)inSect;
 - (UInt8)sendTypeFromMsgSend: (char*)inString;
 
 - (NSString*)generateMD5String;
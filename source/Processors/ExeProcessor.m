@@ -11,11 +11,22 @@
 
 #import "ExeProcessor.h"
 #import "ArchSpecifics.h"
+#import "CrossRefs.h"
+#import "FunctionCache.h"
+#import "Instrumentation.h"
 #import "ListUtils.h"
+#import "LiteralTable.h"
+#import "MemoryBudget.h"
 #import "ObjcAccessors.h"
+#import "ObjcIndex.h"
 #import "ObjectLoader.h"
+#import "OutputFile.h"
+#import "OutputIndex.h"
+#import "RefTable.h"
 #import "SysUtils.h"
+#import "TypeDecoder.h"
 #import "UserDefaultKeys.h"
+#import "VerboseLines.h"
 
 @implementation ExeProcessor
 
@@ -42,9 +53,18 @@
 
     iOFile                  = inURL;
     iController             = inController;
+    iProgress               = [inController progressState];
     iOpts                   = *inOptions;
     iCurrentFuncInfoIndex   = -1;
 
+    // JSON records have no columns to entab, and the function cache only
+    // understands text lines.
+    if (iOpts.jsonOutput)
+    {
+        iOpts.entabOutput   = NO;
+        iOpts.functionCache = NO;
+    }
+
     // Load exe into RAM.
     NSError*    theError    = nil;
     NSData*     theData     = [NSData dataWithContentsOfURL: iOFile
@@ -81,21 +101,10 @@
     iFileArchMagic  = *(uint32_t*)iRAMFile;
     iExeIsFat   = (iFileArchMagic == FAT_MAGIC || iFileArchMagic == FAT_CIGAM);
 
-    // Setup the C++ name demangler.
-    if (iOpts.demangleCppNames)
-    {
-        NSArray* args = [NSArray arrayWithObjects: @"-_", nil];
-
-        iCPFiltTask = [[NSTask alloc] init];
-        iCPFiltInputPipe = [[NSPipe alloc] init];
-        iCPFiltOutputPipe = [[NSPipe alloc] init];
+    [self setupTypeDecoder];
 
-        [iCPFiltTask setLaunchPath: @"/usr/bin/c++filt"];
-        [iCPFiltTask setArguments: args];
-        [iCPFiltTask setStandardInput: iCPFiltInputPipe];
-        [iCPFiltTask setStandardOutput: iCPFiltOutputPipe];
-        [iCPFiltTask launch];
-    }
+    // The C++ name demangler is started with the first mangled name, see
+    // startDemangler.
 
     return self;
 }
@@ -135,9 +144,97 @@
         [iCPFiltTask release];
     }
 
+    // Processing failed after output was diverted into the result cache.
+    if (iCacheTempPath)
+    {
+        unlink([iCacheTempPath fileSystemRepresentation]);
+        RemoveOutputIndex([iCacheTempPath fileSystemRepresentation]);
+        [iCacheTempPath release];
+        iCacheTempPath = nil;
+    }
+
+    // Processing failed with the output file open.
+    [self closeOutputFile];
+
+    [self freeFunctionCache];
+    [self freeOutputIndex];
+    [self freeCrossRefs];
+    [self freeObjcIndex];
+    [self freeRefTable];
+    [self freeLiteralTable];
+    [self freeTypeDecoder];
+    [self freeVerboseLines];
+    [self freeMemoryBudget];
+
+    if (iSliceDigest)
+    {
+        [iSliceDigest release];
+        iSliceDigest = nil;
+    }
+
+    if (iFilterSpecs)
+    {
+        [iFilterSpecs release];
+        iFilterSpecs = nil;
+    }
+
+    if (iFilterRanges)
+    {
+        free(iFilterRanges);
+        iFilterRanges = NULL;
+    }
+
     [super dealloc];
 }
 
+//  startDemangler
+// ----------------------------------------------------------------------------
+//  Launch c++filt if it's not running yet. Most executables have no C++
+//  symbols, so it's started only when a name needs demangling. If it can't
+//  be started, demangling is turned off for the rest of this run.
+
+- (BOOL)startDemangler
+{
+    if (iCPFiltTask)
+        return YES;
+
+    if (!iOpts.demangleCppNames)
+        return NO;
+
+    NSArray* args = [NSArray arrayWithObjects: @"-_", nil];
+
+    iCPFiltTask = [[NSTask alloc] init];
+    iCPFiltInputPipe = [[NSPipe alloc] init];
+    iCPFiltOutputPipe = [[NSPipe alloc] init];
+
+    [iCPFiltTask setLaunchPath: [self pathForTool: @"c++filt"]];
+    [iCPFiltTask setArguments: args];
+    [iCPFiltTask setStandardInput: iCPFiltInputPipe];
+    [iCPFiltTask setStandardOutput: iCPFiltOutputPipe];
+
+    @try
+    {
+        [iCPFiltTask launch];
+    }
+    @catch (NSException* e)
+    {
+        fprintf(stderr, "otx: unable to launch c++filt: %s\n",
+            UTF8STRING([e reason]));
+
+        [iCPFiltInputPipe release];
+        iCPFiltInputPipe = nil;
+        [iCPFiltOutputPipe release];
+        iCPFiltOutputPipe = nil;
+        [iCPFiltTask release];
+        iCPFiltTask = nil;
+        iOpts.demangleCppNames = NO;
+
+        return NO;
+    }
+
+    return YES;
+}
+
 #pragma mark -
 //  sendTypeFromMsgSend:
 // ----------------------------------------------------------------------------
@@ -167,8 +264,8 @@
 
 //  getDescription:forType:
 // ----------------------------------------------------------------------------
-//  "filer types" defined in objc/objc-class.h, NSCoder.h, and
-// http://developer.apple.com/documentation/DeveloperTools/gcc-3.3/gcc/Type-encoding.html
+//  Append the C declaration for an Obj-C type encoding to ioCString, which
+//  must hold MAX_TYPE_STRING_LENGTH chars. See TypeDecoder.
 
 - (void)getDescription: (char*)ioCString
                forType: (const char*)inTypeCode
@@ -176,191 +273,14 @@
     if (!inTypeCode || !ioCString)
         return;
 
-    char    theSuffixCString[50];
-    uint32_t  theNextChar = 0;
-    UInt16  i           = 0;
-
-/*
-    char vs. BOOL
-
-    data type       encoding
-           
-    char            c
-    BOOL            c
-    char[100]       [100c]
-    BOOL[100]       [100c]
-
-    from <objc/objc.h>:
-        typedef signed char     BOOL; 
-        // BOOL is explicitly signed so @encode(BOOL) == "c" rather than "C" 
-        // even if -funsigned-char is used.
-
-    Ok, so BOOL is just a synonym for signed char, and the @encode directive
-    can't be expected to desynonize that. Fair enough, but for our purposes,
-    it would be nicer if BOOL was synonized to unsigned char instead.
-
-    So, any occurence of 'c' may be a char or a BOOL. The best option I can
-    see is to treat arrays as char arrays and atomic values as BOOL, and maybe
-    let the user disagree via preferences. Since the data type of an array is
-    decoded with a recursive call, we can use the following static variable
-    for this purpose.
-
-    As of otx 0.14b, letting the user override this behavior with a pref is
-    left as an exercise for the reader.
-*/
-    static BOOL isArray = NO;
-
-    // Convert '^^' prefix to '**' suffix.
-    while (inTypeCode[theNextChar] == '^')
-    {
-        theSuffixCString[i++]   = '*';
-        theNextChar++;
-    }
-
-    // Add the null terminator.
-    theSuffixCString[i] = 0;
-    i   = 0;
-
     char    theTypeCString[MAX_TYPE_STRING_LENGTH];
+    size_t  theLength   = strlen(ioCString);
 
-    theTypeCString[0]   = 0;
-
-    // Now we can get at the basic type.
-    switch (inTypeCode[theNextChar])
-    {
-        case '@':
-        {
-            if (inTypeCode[theNextChar + 1] == '"')
-            {
-                size_t classNameLength = strlen(&inTypeCode[theNextChar + 2]);
-
-                memcpy(theTypeCString, &inTypeCode[theNextChar + 2],
-                    classNameLength - 1);
-
-                // Add the null terminator.
-                theTypeCString[classNameLength - 1] = 0;
-            }
-            else
-                strncpy(theTypeCString, "id", 3);
-
-            break;
-        }
-
-        case '#':
-            strncpy(theTypeCString, "Class", 6);
-            break;
-        case ':':
-            strncpy(theTypeCString, "SEL", 4);
-            break;
-        case '*':
-            strncpy(theTypeCString, "char*", 6);
-            break;
-        case '?':
-            strncpy(theTypeCString, "undefined", 10);
-            break;
-        case 'i':
-            strncpy(theTypeCString, "int", 4);
-            break;
-        case 'I':
-            strncpy(theTypeCString, "unsigned int", 13);
-            break;
-        // bitfield according to objc-class.h, C++ bool according to NSCoder.h.
-        // The above URL expands on obj-class.h's definition of 'b' when used
-        // in structs/unions, but NSCoder.h's definition seems to take
-        // priority in return values.
-        case 'B':
-        case 'b':
-            strncpy(theTypeCString, "bool", 5);
-            break;
-        case 'c':
-            strncpy(theTypeCString, (isArray) ? "char" : "BOOL", 5);
-            break;
-        case 'C':
-            strncpy(theTypeCString, "unsigned char", 14);
-            break;
-        case 'd':
-            strncpy(theTypeCString, "double", 7);
-            break;
-        case 'f':
-            strncpy(theTypeCString, "float", 6);
-            break;
-        case 'l':
-            strncpy(theTypeCString, "long", 5);
-            break;
-        case 'L':
-            strncpy(theTypeCString, "unsigned long", 14);
-            break;
-        case 'q':   // not in objc-class.h
-            strncpy(theTypeCString, "long long", 10);
-            break;
-        case 'Q':   // not in objc-class.h
-            strncpy(theTypeCString, "unsigned long long", 19);
-            break;
-        case 's':
-            strncpy(theTypeCString, "short", 6);
-            break;
-        case 'S':
-            strncpy(theTypeCString, "unsigned short", 15);
-            break;
-        case 'v':
-            strncpy(theTypeCString, "void", 5);
-            break;
-        case '(':   // union- just copy the name
-            while (inTypeCode[++theNextChar] != '=' &&
-                   inTypeCode[theNextChar]   != ')' &&
-                   inTypeCode[theNextChar]   != '<' &&
-                   theNextChar < MAX_TYPE_STRING_LENGTH)
-                theTypeCString[i++] = inTypeCode[theNextChar];
-
-                // Add the null terminator.
-                theTypeCString[i]   = 0;
-
-            break;
-
-        case '{':   // struct- just copy the name
-            while (inTypeCode[++theNextChar] != '=' &&
-                   inTypeCode[theNextChar]   != '}' &&
-                   inTypeCode[theNextChar]   != '<' &&
-                   theNextChar < MAX_TYPE_STRING_LENGTH)
-                theTypeCString[i++] = inTypeCode[theNextChar];
-
-                // Add the null terminator.
-                theTypeCString[i]   = 0;
-
-            break;
-
-        case '[':   // array   [12^f] <-> float*[12]
-        {
-            char    theArrayCCount[10]  = {0};
-
-            while (inTypeCode[++theNextChar] >= '0' &&
-                   inTypeCode[theNextChar]   <= '9')
-                theArrayCCount[i++] = inTypeCode[theNextChar];
-
-            // Recursive madness. See 'char vs. BOOL' note above.
-            char    theCType[MAX_TYPE_STRING_LENGTH];
-
-            theCType[0] = 0;
-
-            isArray = YES;
-            [self getDescription:theCType forType:&inTypeCode[theNextChar]];
-            isArray = NO;
-
-            snprintf(theTypeCString, MAX_TYPE_STRING_LENGTH, "%s[%s]", theCType, theArrayCCount);
-
-            break;
-        }
-
-        default:
-            strncpy(theTypeCString, "?", 2);
-
-            break;
-    }
-
-    strncat(ioCString, theTypeCString, strlen(theTypeCString));
+    if (theLength >= MAX_TYPE_STRING_LENGTH - 1)
+        return;
 
-    if (theSuffixCString[0])
-        strncat(ioCString, theSuffixCString, strlen(theSuffixCString));
+    [self decodeType: inTypeCode returnType: NO output: theTypeCString];
+    strncat(ioCString, theTypeCString, MAX_TYPE_STRING_LENGTH - theLength - 1);
 }
 
 #pragma mark -
@@ -369,9 +289,10 @@
     return NO;
 }
 
-- (void)printDataSection: (section_info*)inSect
-                  toFile: (FILE*)outFile
-{}
+- (BOOL)printDataSection: (section_info*)inSect
+{
+    return NO;
+}
 
 - (NSString*)generateMD5String
 {
@@ -462,42 +383,12 @@
 #pragma mark -
 //  decodeMethodReturnType:output:
 // ----------------------------------------------------------------------------
+//  outCString must hold MAX_TYPE_STRING_LENGTH chars. See TypeDecoder.
 
 - (void)decodeMethodReturnType: (const char*)inTypeCode
                         output: (char*)outCString
 {
-    uint32_t  theNextChar = 0;
-
-    // Check for type specifiers.
-    // r* <-> const char* ... VI <-> oneway unsigned int
-    switch (inTypeCode[theNextChar++])
-    {
-        case 'r':
-            strncpy(outCString, "const ", 7);
-            break;
-        case 'n':
-            strncpy(outCString, "in ", 4);
-            break;
-        case 'N':
-            strncpy(outCString, "inout ", 7);
-            break;
-        case 'o':
-            strncpy(outCString, "out ", 5);
-            break;
-        case 'O':
-            strncpy(outCString, "bycopy ", 8);
-            break;
-        case 'V':
-            strncpy(outCString, "oneway ", 8);
-            break;
-
-        // No specifier found, roll back the marker.
-        default:
-            theNextChar--;
-            break;
-    }
-
-    [self getDescription:outCString forType:&inTypeCode[theNextChar]];
+    [self decodeType: inTypeCode returnType: YES output: outCString];
 }
 
 
@@ -584,8 +475,17 @@
 
 - (void) printSummary
 {
-    unsigned percentage = (iMatchedSelectorCount * 100) / (iMatchedSelectorCount + iMissedSelectorCount);
+    uint32_t    totalSelectors  = iMatchedSelectorCount + iMissedSelectorCount;
+    unsigned    percentage      = (totalSelectors) ?
+        (iMatchedSelectorCount * 100) / totalSelectors : 100;
+
     fprintf(stderr, "%u selectors matched, %u missed, %u%%\n", iMatchedSelectorCount, iMissedSelectorCount, percentage);
+
+    if (iFuncCache)
+        fprintf(stderr, "%u of %u functions reused from the function cache\n",
+            iFuncCache->numReused, iFuncCache->numFuncs);
+
+    [self printStats];
 }
 
 @end
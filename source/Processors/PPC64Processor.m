@@ -11,9 +11,13 @@
 #import "PPC64Processor.h"
 #import "PPCProcessor.h"
 #import "Arch64Specifics.h"
+#import "CrossRefs.h"
 #import "List64Utils.h"
+#import "LiteralTable.h"
+#import "MemoryBudget.h"
 #import "Objc64Accessors.h"
 #import "Object64Loader.h"
+#import "RefTable.h"
 #import "Searchers64.h"
 #import "SyscallStrings.h"
 #import "UserDefaultKeys.h"
@@ -370,6 +374,12 @@
             else
             {
                 localAddy   = iRegInfos[RA(theCode)].value + SIMM(theCode);
+
+                // Literals were rendered at load, see LiteralTable.
+                if ([self copyLiteralAtAddress: localAddy type:
+                    (opcode == 0x32 || opcode == 0x36) ? DoubleType : FloatType])
+                    break;
+
                 theDummyPtr = [self getPointer:localAddy type:NULL];
 
                 if (!theDummyPtr)
@@ -447,6 +457,10 @@
                 UInt8   theType = PointerType;
                 uint32_t  theValue;
 
+                // Literals were rendered at load, see LiteralTable.
+                if ([self copyStringLiteralAtAddress: localAddy])
+                    break;
+
                 theSymPtr   = [self getPointer:localAddy type:&theType];
 
                 if (theSymPtr)
@@ -602,6 +616,8 @@
                                 "%*s", theSymPtr[0], theSymPtr + 1);
                         else
                             snprintf(iLineCommentCString, MAX_COMMENT_LENGTH, "%s", theSymPtr);
+
+                        [self addCrossRefForType: theType name: iLineCommentCString];
                     }
                 }   // if (theSymPtr)
                 else
@@ -788,6 +804,13 @@
         !iRegInfos[selectorRegNum].value)
         return NULL;
 
+    // Selector refs were resolved at load, see RefTable.
+    selString   = [self refStringAtAddress: iRegInfos[selectorRegNum].value
+        kind: SelectorRefSection];
+
+    if (selString)
+        return selString;
+
     // Get at the selector.
     UInt8   selType     = PointerType;
     char*   selPtr      = [self getPointer:iRegInfos[selectorRegNum].value type:&selType];
@@ -843,6 +866,7 @@
     }
     
     iMatchedSelectorCount++;
+    [self addCrossRef: SelectorRef name: selString];
 
     UInt8 sendType = [self sendTypeFromMsgSend:ioComment];
 
@@ -870,6 +894,10 @@
 //    tempComment[0]  = 0;
 
     if (classNameAddy)
+        className   = [self refStringAtAddress: classNameAddy
+            kind: ClassRefSection];
+
+    if (classNameAddy && !className)
     {
         // Get at the class name
         UInt8   classNameType   = PointerType;
@@ -1034,8 +1062,7 @@
 
 - (void)chooseLine: (Line64**)ioLine
 {
-    if (!(*ioLine) || !(*ioLine)->info.isCode ||
-        !(*ioLine)->alt || !(*ioLine)->alt->chars)
+    if (!(*ioLine) || !(*ioLine)->info.isCode)
         return;
 
     uint32_t theCode = *(uint32_t*)(*ioLine)->info.code;
@@ -1044,20 +1071,35 @@
 
     if (PO(theCode) == 18)  // b, ba, bl, bla
     {
-        Line64* theNewLine  = malloc(sizeof(Line64));
+        size_t  theLength;
+        char*   theChars    = [self takeVerboseLineAtAddress:
+            (*ioLine)->info.address length: &theLength];
 
-        memcpy(theNewLine, (*ioLine)->alt, sizeof(Line64));
-        theNewLine->chars   = malloc(theNewLine->length + 1);
-        strncpy(theNewLine->chars, (*ioLine)->alt->chars,
-            theNewLine->length + 1);
+        if (!theChars)
+            return;
 
-        // Swap in the verbose line and free the previous verbose lines.
-        [self deleteLinesBefore:(*ioLine)->alt fromList:&iVerboseLineListHead];
-        [self replaceLine:*ioLine withLine:theNewLine inList:&iPlainLineListHead];
-        *ioLine = theNewLine;
+        // Swap in the verbose line.
+        free((*ioLine)->chars);
+        (*ioLine)->chars    = theChars;
+        (*ioLine)->length   = theLength;
     }
 }
 
+//  mayChooseVerboseLineAtAddress:
+// ----------------------------------------------------------------------------
+//  Whether the instruction at inAddress is one chooseLine: looks for.
+
+- (BOOL)mayChooseVerboseLineAtAddress: (UInt64)inAddress
+{
+    uint32_t theCode = (iMachHeader.filetype == MH_OBJECT) ?
+        *(uint32_t*)((char*)iMachHeaderPtr + (inAddress + iTextOffset)) :
+        *(uint32_t*)((char*)iMachHeaderPtr + (inAddress - iTextOffset));
+
+    theCode = OSSwapBigToHostInt32(theCode);
+
+    return (PO(theCode) == 18);
+}
+
 #pragma mark -
 //  resetRegisters:
 // ----------------------------------------------------------------------------
@@ -1980,7 +2022,7 @@
     {
         if (!(progCounter % (PROGRESS_FREQ * 5)))
         {
-            if (gCancel == YES)
+            if (ProgressCancelled(iProgress))
                 return;
 
 //            [NSThread sleepForTimeInterval: 0.0];
@@ -1992,6 +2034,14 @@
             continue;
         }
 
+        // Functions reused from the function cache need no block info.
+        if (!theLine->info.isFunction && iCurrentFuncInfoIndex >= 0 &&
+            iFuncInfos[iCurrentFuncInfoIndex].isCached)
+        {
+            theLine = theLine->next;
+            continue;
+        }
+
         theCode = *(uint32_t*)theLine->info.code;
         theCode = OSSwapBigToHostInt32(theCode);
 
@@ -2143,6 +2193,10 @@
                 {branchTarget, endLine, isEpilog, machState};
 
             memcpy(currentBlock, &blockInfo, sizeof(Block64Info));
+            iStats.counts[MachineStateCount]++;
+            [self addMemory: sizeof(GP64RegisterInfo) * 34 +
+                sizeof(Var64Info) * (iNumLocalSelves + iNumLocalVars)
+                kind: MachineStateMemory];
         }
 
         theLine = theLine->next;
@@ -10,14 +10,17 @@
 
 #import "PPCProcessor.h"
 #import "ArchSpecifics.h"
+#import "CrossRefs.h"
 #import "ListUtils.h"
+#import "LiteralTable.h"
+#import "MemoryBudget.h"
 #import "ObjcAccessors.h"
 #import "ObjectLoader.h"
+#import "RefTable.h"
 #import "Searchers.h"
 #import "SyscallStrings.h"
 #import "UserDefaultKeys.h"
 
-extern BOOL gCancel;
 
 @implementation PPCProcessor
 
@@ -180,31 +183,30 @@ extern BOOL gCancel;
 
                         if (iRegInfos[5].isValid)
                         {
-                            objc1_32_ivar   theIvar         = {0};
-                            objc1_32_class  swappedClass    = *(objc1_32_class *)iCurrentClass;
-
-                            #if __LITTLE_ENDIAN__
-                                swap_objc1_32_class(&swappedClass);
-                            #endif
+                            IvarLayoutEntry*    theIvar     = NULL;
+                            objc1_32_class      theClass    = *(objc1_32_class *)iCurrentClass;
 
+                            // findIvar: wants classes as they appear in the
+                            // file, but the metaclass is found by the isa.
                             if (!iIsInstanceMethod)
                             {
-                                if (![self getObjc1MetaClass:&swappedClass fromClass:&swappedClass])
-                                    break;
+                                objc1_32_class  swappedClass    = theClass;
 
-                                #if __LITTLE_ENDIAN__
+                                if (iSwapped)
                                     swap_objc1_32_class(&swappedClass);
-                                #endif
+
+                                if (![self getObjc1MetaClass:&theClass fromClass:&swappedClass])
+                                    break;
                             }
 
-                            if (![self findIvar:&theIvar inClass:&swappedClass withOffset:iRegInfos[5].value])
+                            if (![self findIvar:&theIvar inClass:&theClass withOffset:iRegInfos[5].value])
                             {
                                 strncpy(iLineCommentCString, tempComment,
                                     strlen(tempComment) + 1);
                                 break;
                             }
 
-                            theSymPtr   = [self getPointer:theIvar.ivar_name type:NULL];
+                            theSymPtr   = theIvar->name;
 
                             if (!theSymPtr)
                             {
@@ -220,7 +222,7 @@ extern BOOL gCancel;
                                 theTypeCString[0]   = 0;
 
                                 [self getDescription: theTypeCString
-                                             forType: [self getPointer:theIvar.ivar_type type:NULL]];
+                                             forType: theIvar->type];
 
                                 snprintf(iLineCommentCString, MAX_COMMENT_LENGTH, "%s (%s)%s", tempComment, theTypeCString, theSymPtr);
                             }
@@ -344,6 +346,12 @@ extern BOOL gCancel;
             else
             {
                 localAddy   = iRegInfos[RA(theCode)].value + SIMM(theCode);
+
+                // Literals were rendered at load, see LiteralTable.
+                if ([self copyLiteralAtAddress: localAddy type:
+                    (opcode == 0x32 || opcode == 0x36) ? DoubleType : FloatType])
+                    break;
+
                 theDummyPtr = [self getPointer:localAddy type:NULL];
 
                 if (!theDummyPtr)
@@ -422,6 +430,10 @@ extern BOOL gCancel;
                 UInt8   theType = PointerType;
                 uint32_t  theValue;
 
+                // Literals were rendered at load, see LiteralTable.
+                if ([self copyStringLiteralAtAddress: localAddy])
+                    break;
+
                 theSymPtr   = [self getPointer:localAddy type:&theType];
 
                 if (theSymPtr)
@@ -575,6 +587,8 @@ extern BOOL gCancel;
                                 "%*s", theSymPtr[0], theSymPtr + 1);
                         else
                             snprintf(iLineCommentCString, MAX_COMMENT_LENGTH, "%s", theSymPtr);
+
+                        [self addCrossRefForType: theType name: iLineCommentCString];
                     }
                 }   // if (theSymPtr)
                 else
@@ -688,6 +702,13 @@ extern BOOL gCancel;
         !iRegInfos[selectorRegNum].value)
         return NULL;
 
+    // Selector refs were resolved at load, see RefTable.
+    selString   = [self refStringAtAddress: iRegInfos[selectorRegNum].value
+        kind: SelectorRefSection];
+
+    if (selString)
+        return selString;
+
     // Get at the selector.
     UInt8   selType     = PointerType;
     char*   selPtr      = [self getPointer:iRegInfos[selectorRegNum].value type:&selType];
@@ -737,6 +758,7 @@ extern BOOL gCancel;
     }
     
     iMatchedSelectorCount++;
+    [self addCrossRef: SelectorRef name: selString];
 
     UInt8   sendType    = [self sendTypeFromMsgSend:ioComment];
 
@@ -764,6 +786,10 @@ extern BOOL gCancel;
     tempComment[0]  = 0;
 
     if (classNameAddy)
+        className   = [self refStringAtAddress: classNameAddy
+            kind: ClassRefSection];
+
+    if (classNameAddy && !className)
     {
         // Get at the class name
         UInt8   classNameType   = PointerType;
@@ -893,8 +919,7 @@ extern BOOL gCancel;
 
 - (void)chooseLine: (Line**)ioLine
 {
-    if (!(*ioLine) || !(*ioLine)->info.isCode ||
-        !(*ioLine)->alt || !(*ioLine)->alt->chars)
+    if (!(*ioLine) || !(*ioLine)->info.isCode)
         return;
 
     uint32_t theCode = *(uint32_t*)(*ioLine)->info.code;
@@ -903,20 +928,35 @@ extern BOOL gCancel;
 
     if (PO(theCode) == 18)  // b, ba, bl, bla
     {
-        Line* theNewLine  = malloc(sizeof(Line));
+        size_t  theLength;
+        char*   theChars    = [self takeVerboseLineAtAddress:
+            (*ioLine)->info.address length: &theLength];
 
-        memcpy(theNewLine, (*ioLine)->alt, sizeof(Line));
-        theNewLine->chars   = malloc(theNewLine->length + 1);
-        strncpy(theNewLine->chars, (*ioLine)->alt->chars,
-            theNewLine->length + 1);
+        if (!theChars)
+            return;
 
-        // Swap in the verbose line and free the previous verbose lines.
-        [self deleteLinesBefore:(*ioLine)->alt fromList:&iVerboseLineListHead];
-        [self replaceLine:*ioLine withLine:theNewLine inList:&iPlainLineListHead];
-        *ioLine = theNewLine;
+        // Swap in the verbose line.
+        free((*ioLine)->chars);
+        (*ioLine)->chars    = theChars;
+        (*ioLine)->length   = theLength;
     }
 }
 
+//  mayChooseVerboseLineAtAddress:
+// ----------------------------------------------------------------------------
+//  Whether the instruction at inAddress is one chooseLine: looks for.
+
+- (BOOL)mayChooseVerboseLineAtAddress: (uint32_t)inAddress
+{
+    uint32_t theCode = (iMachHeader.filetype == MH_OBJECT) ?
+        *(uint32_t*)((char*)iMachHeaderPtr + (inAddress + iTextOffset)) :
+        *(uint32_t*)((char*)iMachHeaderPtr + (inAddress - iTextOffset));
+
+    theCode = OSSwapBigToHostInt32(theCode);
+
+    return (PO(theCode) == 18);
+}
+
 #pragma mark -
 //  resetRegisters:
 // ----------------------------------------------------------------------------
@@ -1658,7 +1698,7 @@ extern BOOL gCancel;
     {
         if (!(progCounter % (PROGRESS_FREQ * 5)))
         {
-            if (gCancel == YES)
+            if (ProgressCancelled(iProgress))
                 return;
 
 //            [NSThread sleepForTimeInterval: 0.0];
@@ -1670,6 +1710,14 @@ extern BOOL gCancel;
             continue;
         }
 
+        // Functions reused from the function cache need no block info.
+        if (!theLine->info.isFunction && iCurrentFuncInfoIndex >= 0 &&
+            iFuncInfos[iCurrentFuncInfoIndex].isCached)
+        {
+            theLine = theLine->next;
+            continue;
+        }
+
         theCode = *(uint32_t*)theLine->info.code;
         theCode = OSSwapBigToHostInt32(theCode);
 
@@ -1825,6 +1873,10 @@ extern BOOL gCancel;
                 {branchTarget, endLine, isEpilog, machState};
 
             memcpy(currentBlock, &blockInfo, sizeof(BlockInfo));
+            iStats.counts[MachineStateCount]++;
+            [self addMemory: sizeof(GPRegisterInfo) * 34 +
+                sizeof(VarInfo) * (iNumLocalSelves + iNumLocalVars)
+                kind: MachineStateMemory];
         }
 
         theLine = theLine->next;
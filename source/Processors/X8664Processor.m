@@ -11,9 +11,13 @@
 #import "X8664Processor.h"
 #import "X86Processor.h"
 #import "Arch64Specifics.h"
+#import "CrossRefs.h"
 #import "List64Utils.h"
+#import "LiteralTable.h"
+#import "MemoryBudget.h"
 #import "Objc64Accessors.h"
 #import "Object64Loader.h"
+#import "RefTable.h"
 #import "Searchers64.h"
 #import "SyscallStrings.h"
 #import "UserDefaultKeys.h"
@@ -167,10 +171,7 @@
     iThunks[iNumThunks - 1] = theThunk;
 
     // Recognize it as a function.
-    inLine->prev->info.isFunction = YES;
-
-    if (inLine->prev->alt)
-        inLine->prev->alt->info.isFunction  = YES;*/
+    inLine->prev->info.isFunction = YES;*/
 }
 
 //  getThunkInfo:forLine:
@@ -873,6 +874,14 @@
 
                     localAddy = *(uint32_t*)&inLine->info.code[immOffset];
                     localAddy = OSSwapLittleToHostInt32(localAddy);
+
+                    // Literals were rendered at load, see LiteralTable.
+                    if ((LO(opcode) == 0x9 &&
+                        [self copyLiteralAtAddress: localAddy type: FloatType]) ||
+                        (LO(opcode) == 0xd &&
+                        [self copyLiteralAtAddress: localAddy type: DoubleType]))
+                        break;
+
                     theDummyPtr = [self getPointer:localAddy type:NULL];
 
                     if (!theDummyPtr)
@@ -1076,6 +1085,10 @@
         UInt8   theType     = PointerType;
         uint32_t  theValue;
 
+        // Literals were rendered at load, see LiteralTable.
+        if ([self copyStringLiteralAtAddress: localAddy])
+            return;
+
         theSymPtr = [self findSymbolByAddress:localAddy];
         if (theSymPtr && strncmp("_OBJC_IVAR_$_", theSymPtr, 13) == 0)
             theSymPtr = strchr(theSymPtr, '.') + 1;
@@ -1179,6 +1192,9 @@
                     "%*s", theSymPtr[0], theSymPtr + 1);
             else
                 snprintf(iLineCommentCString, MAX_COMMENT_LENGTH, "%s", theSymPtr);
+
+            if (theDummyPtr)
+                [self addCrossRefForType: theType name: iLineCommentCString];
         }
     }
 }
@@ -1285,6 +1301,13 @@
     if (!selectorAddy)
         return NULL;
 
+    // Selector refs were resolved at load, see RefTable.
+    selString   = [self refStringAtAddress: selectorAddy
+        kind: SelectorRefSection];
+
+    if (selString)
+        return selString;
+
     // Get at the selector.
     UInt8   selType = PointerType;
     char*   selPtr  = [self getPointer:selectorAddy type:&selType];
@@ -1341,6 +1364,7 @@
         }
         
         iMatchedSelectorCount++;
+        [self addCrossRef: SelectorRef name: selString];
 
         UInt8   sendType    = [self sendTypeFromMsgSend:ioComment];
 
@@ -1367,6 +1391,10 @@
             "(struct)" : (sendType == send_fpret) ? "(double)" : "";
 
         if (classNameAddy)
+            className   = [self refStringAtAddress: classNameAddy
+                kind: ClassRefSection];
+
+        if (classNameAddy && !className)
         {
             // Get at the class name
             UInt8   classNameType   = PointerType;
@@ -1497,28 +1525,41 @@
 
 - (void)chooseLine: (Line64**)ioLine
 {
-    if (!(*ioLine) || !(*ioLine)->info.isCode ||
-        !(*ioLine)->alt || !(*ioLine)->alt->chars)
+    if (!(*ioLine) || !(*ioLine)->info.isCode)
         return;
 
     UInt8 theCode = (*ioLine)->info.code[0];
 
     if (theCode == 0xe8 || theCode == 0xe9 || theCode == 0xff || theCode == 0x9a)
     {
-        Line64* theNewLine  = malloc(sizeof(Line64));
+        size_t  theLength;
+        char*   theChars    = [self takeVerboseLineAtAddress:
+            (*ioLine)->info.address length: &theLength];
 
-        memcpy(theNewLine, (*ioLine)->alt, sizeof(Line64));
-        theNewLine->chars   = malloc(theNewLine->length + 1);
-        strncpy(theNewLine->chars, (*ioLine)->alt->chars,
-            theNewLine->length + 1);
+        if (!theChars)
+            return;
 
-        // Swap in the verbose line and free the previous verbose lines.
-        [self deleteLinesBefore:(*ioLine)->alt fromList:&iVerboseLineListHead];
-        [self replaceLine:*ioLine withLine:theNewLine inList:&iPlainLineListHead];
-        *ioLine = theNewLine;
+        // Swap in the verbose line.
+        free((*ioLine)->chars);
+        (*ioLine)->chars    = theChars;
+        (*ioLine)->length   = theLength;
     }
 }
 
+//  mayChooseVerboseLineAtAddress:
+// ----------------------------------------------------------------------------
+//  Whether the instruction at inAddress starts with one of the opcodes
+//  chooseLine: looks for.
+
+- (BOOL)mayChooseVerboseLineAtAddress: (UInt64)inAddress
+{
+    UInt8 theCode = (iMachHeader.filetype == MH_OBJECT) ?
+        *((UInt8*)iMachHeaderPtr + (inAddress + iTextOffset)) :
+        *((UInt8*)iMachHeaderPtr + (inAddress - iTextOffset));
+
+    return (theCode == 0xe8 || theCode == 0xe9 || theCode == 0xff || theCode == 0x9a);
+}
+
 //  postProcessCodeLine:
 // ----------------------------------------------------------------------------
 
@@ -2321,7 +2362,7 @@
     {
         if (!(progCounter % (PROGRESS_FREQ * 5)))
         {
-            if (gCancel == YES)
+            if (ProgressCancelled(iProgress))
                 return;
         }
 
@@ -2331,6 +2372,14 @@
             continue;
         }
 
+        // Functions reused from the function cache need no block info.
+        if (!theLine->info.isFunction && iCurrentFuncInfoIndex >= 0 &&
+            iFuncInfos[iCurrentFuncInfoIndex].isCached)
+        {
+            theLine = theLine->next;
+            continue;
+        }
+
         opcode = theLine->info.code[0];
         opcode2 = theLine->info.code[1];
 
@@ -2517,6 +2566,10 @@
                 {jumpTarget, endLine, isEpilog, machState};
 
             memcpy(currentBlock, &blockInfo, sizeof(Block64Info));
+            iStats.counts[MachineStateCount]++;
+            [self addMemory: sizeof(GP64RegisterInfo) * 16 +
+                sizeof(Var64Info) * (iNumLocalSelves + iNumLocalVars)
+                kind: MachineStateMemory];
 #else
     // At this point, the x86 logic departs from the PPC logic. We seem
     // to get better results by not reusing blocks.
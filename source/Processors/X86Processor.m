@@ -10,9 +10,13 @@
 
 #import "X86Processor.h"
 #import "ArchSpecifics.h"
+#import "CrossRefs.h"
 #import "ListUtils.h"
+#import "LiteralTable.h"
+#import "MemoryBudget.h"
 #import "ObjcAccessors.h"
 #import "ObjectLoader.h"
+#import "RefTable.h"
 #import "Searchers.h"
 #import "SyscallStrings.h"
 #import "UserDefaultKeys.h"
@@ -174,9 +178,6 @@
 
     // Recognize it as a function.
     inLine->prev->info.isFunction = YES;
-
-    if (inLine->prev->alt)
-        inLine->prev->alt->info.isFunction = YES;
 }
 
 //  getThunkInfo:forLine:
@@ -844,6 +845,14 @@
 
                 localAddy = *(uint32_t*)&inLine->info.code[immOffset];
                 localAddy = OSSwapLittleToHostInt32(localAddy);
+
+                // Literals were rendered at load, see LiteralTable.
+                if ((LO(opcode) == 0x9 &&
+                    [self copyLiteralAtAddress: localAddy type: FloatType]) ||
+                    (LO(opcode) == 0xd &&
+                    [self copyLiteralAtAddress: localAddy type: DoubleType]))
+                    break;
+
                 theDummyPtr = [self getPointer:localAddy type:NULL];
 
                 if (!theDummyPtr)
@@ -990,6 +999,10 @@
         UInt8   theType     = PointerType;
         uint32_t  theValue;
 
+        // Literals were rendered at load, see LiteralTable.
+        if ([self copyStringLiteralAtAddress: localAddy])
+            return;
+
         theSymPtr = [self findSymbolByAddress:localAddy];
 
         theDummyPtr = [self getPointer:localAddy type:&theType];
@@ -1106,6 +1119,9 @@
                     "%*s", theSymPtr[0], theSymPtr + 1);
             else
                 snprintf(iLineCommentCString, MAX_COMMENT_LENGTH, "%s", theSymPtr);
+
+            if (theDummyPtr)
+                [self addCrossRefForType: theType name: iLineCommentCString];
         }
     }
 }
@@ -1237,6 +1253,14 @@
     // Get at the selector.
     if (iStack[ESI].isValid)
         selectorAddy += iStack[ESI].value;  // add the esi register
+
+    // Selector refs were resolved at load, see RefTable.
+    selString   = [self refStringAtAddress: selectorAddy
+        kind: SelectorRefSection];
+
+    if (selString)
+        return selString;
+
     UInt8   selType = PointerType;
     char*   selPtr  = [self getPointer:selectorAddy type:&selType];
 
@@ -1302,6 +1326,7 @@
         }
         
         iMatchedSelectorCount++;
+        [self addCrossRef: SelectorRef name: selString];
 
         UInt8   sendType    = [self sendTypeFromMsgSend:ioComment];
 
@@ -1327,6 +1352,10 @@
             "(struct)" : (sendType == send_fpret) ? "(double)" : "";
 
         if (classNameAddy)
+            className   = [self refStringAtAddress: classNameAddy
+                kind: ClassRefSection];
+
+        if (classNameAddy && !className)
         {
             // Get at the class name
             UInt8   classNameType   = PointerType;
@@ -1441,28 +1470,41 @@
 
 - (void)chooseLine: (Line**)ioLine
 {
-    if (!(*ioLine) || !(*ioLine)->info.isCode ||
-        !(*ioLine)->alt || !(*ioLine)->alt->chars)
+    if (!(*ioLine) || !(*ioLine)->info.isCode)
         return;
 
     UInt8 theCode = (*ioLine)->info.code[0];
 
     if (theCode == 0xe8 || theCode == 0xe9 || theCode == 0xff || theCode == 0x9a)
     {
-        Line*   theNewLine  = malloc(sizeof(Line));
+        size_t  theLength;
+        char*   theChars    = [self takeVerboseLineAtAddress:
+            (*ioLine)->info.address length: &theLength];
 
-        memcpy(theNewLine, (*ioLine)->alt, sizeof(Line));
-        theNewLine->chars   = malloc(theNewLine->length + 1);
-        strncpy(theNewLine->chars, (*ioLine)->alt->chars,
-            theNewLine->length + 1);
+        if (!theChars)
+            return;
 
-        // Swap in the verbose line and free the previous verbose lines.
-        [self deleteLinesBefore:(*ioLine)->alt fromList:&iVerboseLineListHead];
-        [self replaceLine:*ioLine withLine:theNewLine inList:&iPlainLineListHead];
-        *ioLine = theNewLine;
+        // Swap in the verbose line.
+        free((*ioLine)->chars);
+        (*ioLine)->chars    = theChars;
+        (*ioLine)->length   = theLength;
     }
 }
 
+//  mayChooseVerboseLineAtAddress:
+// ----------------------------------------------------------------------------
+//  Whether the instruction at inAddress starts with one of the opcodes
+//  chooseLine: looks for.
+
+- (BOOL)mayChooseVerboseLineAtAddress: (uint32_t)inAddress
+{
+    UInt8 theCode = (iMachHeader.filetype == MH_OBJECT) ?
+        *((UInt8*)iMachHeaderPtr + (inAddress + iTextOffset)) :
+        *((UInt8*)iMachHeaderPtr + (inAddress - iTextOffset));
+
+    return (theCode == 0xe8 || theCode == 0xe9 || theCode == 0xff || theCode == 0x9a);
+}
+
 //  postProcessCodeLine:
 // ----------------------------------------------------------------------------
 
@@ -2219,7 +2261,7 @@
     {
         if (!(progCounter % (PROGRESS_FREQ * 5)))
         {
-            if (gCancel == YES)
+            if (ProgressCancelled(iProgress))
                 return;
         }
 
@@ -2229,6 +2271,14 @@
             continue;
         }
 
+        // Functions reused from the function cache need no block info.
+        if (!theLine->info.isFunction && iCurrentFuncInfoIndex >= 0 &&
+            iFuncInfos[iCurrentFuncInfoIndex].isCached)
+        {
+            theLine = theLine->next;
+            continue;
+        }
+
         opcode = theLine->info.code[0];
         opcode2 = theLine->info.code[1];
 
@@ -2419,6 +2469,10 @@
                 {jumpTarget, endLine, isEpilog, machState};
 
             memcpy(currentBlock, &blockInfo, sizeof(BlockInfo));
+            iStats.counts[MachineStateCount]++;
+            [self addMemory: sizeof(GPRegisterInfo) * 8 +
+                sizeof(VarInfo) * (iNumLocalSelves + iNumLocalVars)
+                kind: MachineStateMemory];
 #else
     // At this point, the x86 logic departs from the PPC logic. We seem
     // to get better results by not reusing blocks.
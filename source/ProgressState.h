@@ -0,0 +1,115 @@
+/*
+    ProgressState.h
+
+    Progress and cancellation shared by a processor and its controller. The
+    processor updates the state in place with atomic stores and adds, so
+    the hot loops never allocate or message another thread, and several
+    worker threads may update one state. The controller owns the state and
+    samples it on its own timer with ProgressSample.
+
+    Stage changes are bracketed by a sequence number, odd while a change is
+    in progress, so a sample never mixes two stages.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+#import <libkern/OSAtomic.h>
+
+// Stages of processing, in order.
+enum {
+    IdleStage,
+    LoadingStage,
+    OtoolStage,
+    GatheringStage,
+    GeneratingStage,
+    WritingStage,
+    CompleteStage,
+    NumStages
+};
+
+/*  ProgressState
+
+    Written by processors, read only through ProgressSample. 'total' is 0
+    while the amount of work in the current stage is unknown.
+*/
+typedef struct
+{
+    volatile int32_t    sequence;
+    volatile int32_t    stage;
+    volatile int64_t    done;
+    volatile int64_t    total;
+    volatile int64_t    bytes;      // written to the output file
+    volatile int32_t    cancelled;
+}
+ProgressState;
+
+/*  ProgressSnapshot
+
+    A consistent copy of a ProgressState. 'sequence' changes whenever the
+    stage does.
+*/
+typedef struct
+{
+    uint32_t    sequence;
+    uint32_t    stage;
+    UInt64      done;
+    UInt64      total;
+    UInt64      bytes;
+    BOOL        cancelled;
+}
+ProgressSnapshot;
+
+// ----------------------------------------------------------------------------
+
+void
+ProgressReset(
+    ProgressState*  ioState);
+
+void
+ProgressBeginStage(
+    ProgressState*  ioState,
+    uint32_t        inStage,
+    UInt64          inTotal);
+
+void
+ProgressSample(
+    ProgressState*      inState,
+    ProgressSnapshot*   outSnapshot);
+
+const char*
+ProgressStageDescription(
+    uint32_t    inStage);
+
+// ----------------------------------------------------------------------------
+//  Called from the hot loops, so inline.
+
+static inline void
+ProgressAdvance(
+    ProgressState*  ioState,
+    int64_t         inDone)
+{
+    OSAtomicAdd64(inDone, &ioState->done);
+}
+
+static inline void
+ProgressAddBytes(
+    ProgressState*  ioState,
+    int64_t         inBytes)
+{
+    OSAtomicAdd64(inBytes, &ioState->bytes);
+}
+
+static inline void
+ProgressCancel(
+    ProgressState*  ioState)
+{
+    OSAtomicCompareAndSwap32Barrier(0, 1, &ioState->cancelled);
+}
+
+static inline BOOL
+ProgressCancelled(
+    const ProgressState*    inState)
+{
+    return inState->cancelled != 0;
+}
@@ -0,0 +1,107 @@
+/*
+    ProgressState.m
+
+    This file is in the public domain.
+*/
+
+#import "ProgressState.h"
+
+static const char*  gStageDescriptions[NumStages]   =
+{
+    "",
+    "Loading executable",
+    "Calling otool",
+    "Gathering info",
+    "Generating file",
+    "Writing file",
+    "Done"
+};
+
+// ----------------------------------------------------------------------------
+//  A plain 64-bit store can tear on 32-bit archs.
+
+static void
+StoreInt64(
+    volatile int64_t*   ioPtr,
+    int64_t             inValue)
+{
+    int64_t oldValue;
+
+    do
+    {
+        oldValue    = *ioPtr;
+    } while (!OSAtomicCompareAndSwap64(oldValue, inValue, ioPtr));
+}
+
+//  ProgressReset
+// ----------------------------------------------------------------------------
+//  Only while no processor is using ioState.
+
+void
+ProgressReset(
+    ProgressState*  ioState)
+{
+    memset((void*)ioState, 0, sizeof(ProgressState));
+    OSMemoryBarrier();
+}
+
+//  ProgressBeginStage
+// ----------------------------------------------------------------------------
+//  Start a new stage with inTotal units of work, or 0 if unknown. Stages
+//  change on one thread at a time.
+
+void
+ProgressBeginStage(
+    ProgressState*  ioState,
+    uint32_t        inStage,
+    UInt64          inTotal)
+{
+    OSAtomicIncrement32Barrier(&ioState->sequence);     // now odd
+
+    ioState->stage  = inStage;
+    StoreInt64(&ioState->total, inTotal);
+    StoreInt64(&ioState->done, 0);
+
+    OSAtomicIncrement32Barrier(&ioState->sequence);     // even again
+}
+
+//  ProgressSample
+// ----------------------------------------------------------------------------
+//  Copy inState, retrying if a stage change overlaps the copy. The 64-bit
+//  reads go through OSAtomicAdd64 so they're whole on 32-bit archs too.
+
+void
+ProgressSample(
+    ProgressState*      inState,
+    ProgressSnapshot*   outSnapshot)
+{
+    int32_t sequence;
+
+    do
+    {
+        while ((sequence = inState->sequence) & 1)
+            ;
+
+        OSMemoryBarrier();
+
+        outSnapshot->stage      = inState->stage;
+        outSnapshot->total      = OSAtomicAdd64(0, &inState->total);
+        outSnapshot->done       = OSAtomicAdd64(0, &inState->done);
+        outSnapshot->bytes      = OSAtomicAdd64(0, &inState->bytes);
+        outSnapshot->cancelled  = (inState->cancelled != 0);
+
+        OSMemoryBarrier();
+    } while (inState->sequence != sequence);
+
+    outSnapshot->sequence   = sequence;
+}
+
+//  ProgressStageDescription
+// ----------------------------------------------------------------------------
+
+const char*
+ProgressStageDescription(
+    uint32_t    inStage)
+{
+    return (inStage < NumStages) ? gStageDescriptions[inStage] : "";
+}
@@ -6,14 +6,16 @@
 
 #import <Cocoa/Cocoa.h>
 
-#define PRValueKey          @"PRValueKey"           // NSNumber* (double)
-#define PRIndeterminateKey  @"PRIndeterminateKey"   // NSNumber* (BOOL)
-#define PRNewLineKey        @"PRNewLineKey"         // NSNumber* (BOOL)
-#define PRCompleteKey       @"PRCompleteKey"        // NSNumber* (BOOL)
-#define PRDescriptionKey    @"PRDescriptionKey"     // NSString*
+#import "ProgressState.h"
 
+/*  ProgressReporter
+
+    Controllers own a ProgressState for each processing, hand it to the
+    processor through progressState, and sample it on their own schedule.
+    The processor keeps the pointer for its lifetime.
+*/
 @protocol ProgressReporter
 
-- (void)reportProgress: (NSDictionary*)inState;
+- (ProgressState*)progressState;
 
 @end
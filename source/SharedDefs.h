@@ -26,5 +26,12 @@ typedef struct
     BOOL    variableTypes;          // v
     BOOL    returnStatements;       // R
     BOOL    debugMode;              // -debug
+    BOOL    resultCache;            // -cache
+    BOOL    functionCache;          // -incremental
+    BOOL    compressOutput;         // -gzip
+    BOOL    jsonOutput;             // -json
+    BOOL    functionDigests;        // -diff
+    UInt64  maxMemory;              // -max-memory, in bytes, 0 if none
+    BOOL    serial;                 // -serial
 }
 ProcOptions;
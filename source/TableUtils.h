@@ -0,0 +1,34 @@
+/*
+    TableUtils.h
+
+    Helpers for the flat arrays the loaders build: the symbol table, the
+    method infos and the ivars.
+
+    GrowTable doubles an array's capacity as items are appended, instead of
+    growing it by one item per append. SortTableByKey sorts an array by an
+    unsigned 32- or 64-bit key with an LSD radix sort, which beats qsort(3)
+    and its comparator calls for the million-symbol tables of unstripped
+    C++ executables. Byte positions that are the same in every key, like
+    the high bytes of addresses in one image, are skipped.
+
+    This file is in the public domain.
+*/
+
+#import <Cocoa/Cocoa.h>
+
+BOOL
+GrowTable(
+    void**      ioItems,
+    uint32_t    inCount,
+    uint32_t*   ioCapacity,
+    size_t      inItemSize);
+
+void
+SortTableByKey(
+    void*       ioItems,
+    uint32_t    inCount,
+    size_t      inItemSize,
+    size_t      inKeyOffset,
+    size_t      inKeySize,
+    BOOL        inSwappedKey,
+    int         (*inCompare)(const void*, const void*));
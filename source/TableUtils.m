@@ -0,0 +1,183 @@
+/*
+    TableUtils.m
+
+    This file is in the public domain.
+*/
+
+#import "TableUtils.h"
+
+/*  SortKey
+
+    An item's key, and where the item was before sorting. The keys are
+    sorted, then the items are gathered in key order, so that each pass
+    moves 16 bytes per item no matter how big the items are.
+*/
+typedef struct
+{
+    UInt64      key;
+    uint32_t    index;
+    uint32_t    padding;
+}
+SortKey;
+
+// ----------------------------------------------------------------------------
+
+static UInt64
+ReadKey(
+    const char* inKeyPtr,
+    size_t      inKeySize,
+    BOOL        inSwapped)
+{
+    if (inKeySize == sizeof(uint32_t))
+    {
+        uint32_t    key;
+
+        memcpy(&key, inKeyPtr, sizeof(key));
+
+        return (inSwapped) ? OSSwapInt32(key) : key;
+    }
+
+    UInt64  key;
+
+    memcpy(&key, inKeyPtr, sizeof(key));
+
+    return (inSwapped) ? OSSwapInt64(key) : key;
+}
+
+//  GrowTable
+// ----------------------------------------------------------------------------
+//  Make room for one more item after the inCount in *ioItems. Returns NO,
+//  leaving the table as it was, if there's no memory for it.
+
+BOOL
+GrowTable(
+    void**      ioItems,
+    uint32_t    inCount,
+    uint32_t*   ioCapacity,
+    size_t      inItemSize)
+{
+    if (inCount < *ioCapacity)
+        return YES;
+
+    uint32_t    newCapacity = (*ioCapacity) ? *ioCapacity * 2 : 64;
+    void*       newItems    = realloc(*ioItems, newCapacity * inItemSize);
+
+    if (!newItems)
+    {
+        fprintf(stderr, "otx: not enough memory to grow table\n");
+        return NO;
+    }
+
+    *ioItems    = newItems;
+    *ioCapacity = newCapacity;
+
+    return YES;
+}
+
+//  SortTableByKey
+// ----------------------------------------------------------------------------
+//  Sort inCount items by the key at inKeyOffset in each, byte-swapping the
+//  keys first if inSwappedKey. The sort is stable. Falls back to qsort(3)
+//  with inCompare if the key is an odd size or memory runs out, so
+//  inCompare must order items the same way.
+
+void
+SortTableByKey(
+    void*       ioItems,
+    uint32_t    inCount,
+    size_t      inItemSize,
+    size_t      inKeyOffset,
+    size_t      inKeySize,
+    BOOL        inSwappedKey,
+    int         (*inCompare)(const void*, const void*))
+{
+    if (inCount < 2)
+        return;
+
+    char*       items       = ioItems;
+    SortKey*    keys        = NULL;
+    SortKey*    tempKeys    = NULL;
+    char*       sortedItems = NULL;
+
+    if (inKeySize == sizeof(uint32_t) || inKeySize == sizeof(UInt64))
+    {
+        keys        = malloc(inCount * sizeof(SortKey));
+        tempKeys    = malloc(inCount * sizeof(SortKey));
+        sortedItems = malloc(inCount * inItemSize);
+    }
+
+    if (!keys || !tempKeys || !sortedItems)
+    {
+        if (keys)
+            free(keys);
+
+        if (tempKeys)
+            free(tempKeys);
+
+        if (sortedItems)
+            free(sortedItems);
+
+        qsort(ioItems, inCount, inItemSize, inCompare);
+        return;
+    }
+
+    // Count every byte position's digits in one pass over the items.
+    uint32_t    digitCounts[sizeof(UInt64)][256];
+    uint32_t    i, b;
+
+    memset(digitCounts, 0, sizeof(digitCounts));
+
+    for (i = 0; i < inCount; i++)
+    {
+        UInt64  key = ReadKey(items + i * inItemSize + inKeyOffset,
+            inKeySize, inSwappedKey);
+
+        keys[i] = (SortKey){key, i, 0};
+
+        for (b = 0; b < inKeySize; b++)
+            digitCounts[b][(key >> (b * 8)) & 0xff]++;
+    }
+
+    SortKey*    srcKeys     = keys;
+    SortKey*    destKeys    = tempKeys;
+
+    // Least significant byte first.
+    for (b = 0; b < inKeySize; b++)
+    {
+        uint32_t*   counts  = digitCounts[b];
+        uint32_t    shift   = b * 8;
+
+        // A byte that's the same in every key can't reorder anything.
+        if (counts[(srcKeys[0].key >> shift) & 0xff] == inCount)
+            continue;
+
+        uint32_t    offsets[256];
+        uint32_t    offset  = 0;
+        uint32_t    d;
+
+        for (d = 0; d < 256; d++)
+        {
+            offsets[d]  = offset;
+            offset      += counts[d];
+        }
+
+        for (i = 0; i < inCount; i++)
+            destKeys[offsets[(srcKeys[i].key >> shift) & 0xff]++] =
+                srcKeys[i];
+
+        SortKey*    swapKeys    = srcKeys;
+
+        srcKeys     = destKeys;
+        destKeys    = swapKeys;
+    }
+
+    for (i = 0; i < inCount; i++)
+        memcpy(sortedItems + i * inItemSize,
+            items + srcKeys[i].index * inItemSize, inItemSize);
+
+    memcpy(ioItems, sortedItems, inCount * inItemSize);
+
+    free(keys);
+    free(tempKeys);
+    free(sortedItems);
+}
@@ -5,8 +5,10 @@
 */
 
 #define AskOutputDirKey             @"AskOutputDir"
+#define CompressOutputKey           @"CompressOutput"
 #define DemangleCppNamesKey         @"DemangleCppNames"
 #define EntabOutputKey              @"EntabOutput"
+#define FunctionFiltersKey          @"FunctionFilters"
 #define OpenOutputFileKey           @"OpenOutputFile"
 #define OutputAppKey                @"OutputApp"
 #define OutputFileExtensionKey      @"OutputFileExtension"
@@ -19,4 +21,6 @@
 #define ShowMethodReturnTypesKey    @"ShowMethodReturnTypes"
 #define ShowReturnStatementsKey     @"ShowReturnStatements"
 #define UseCustomNameKey            @"UseCustomName"
+#define UseFunctionCacheKey         @"UseFunctionCache"
+#define UseResultCacheKey           @"UseResultCache"
 #define VerboseMsgSendsKey          @"VerboseMsgSends"